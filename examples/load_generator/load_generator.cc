@@ -0,0 +1,496 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/examples/load_generator/load_generator.h"
+
+#include <magenta/syscalls.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+
+#include "apps/mozart/lib/scene/session_helpers.h"
+#include "apps/mozart/services/images/image_pipe.fidl.h"
+#include "lib/ftl/logging.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace mozart {
+namespace load_generator {
+namespace {
+
+constexpr uint64_t kBillion = 1000000000;
+constexpr uint32_t kMaterialCount = 8;
+constexpr uint32_t kImageBufferCount = 2;
+constexpr float kShapeSize = 40.f;
+
+double ToMilliseconds(uint64_t nanoseconds) {
+  return static_cast<double>(nanoseconds) / 1000000.0;
+}
+
+}  // namespace
+
+// A client session which owns a tree of nodes, and animates part of it every
+// frame.
+class LoadGenerator::LoadSession {
+ public:
+  LoadSession(mozart2::SceneManager* scene_manager,
+              const Params& params,
+              uint32_t index,
+              float cell_width,
+              float cell_height);
+
+  void Export(mx::eventpair export_token);
+  void set_error_handler(ftl::Closure handler) {
+    session_.set_connection_error_handler(std::move(handler));
+  }
+
+  // Begin presenting a new frame whenever the previous one was presented,
+  // until Stop() is called.
+  void Start(uint64_t start_time);
+  void Stop() { stopped_ = true; }
+
+  uint32_t frame_count() const { return frame_count_; }
+  uint32_t skipped_frame_count() const { return skipped_frame_count_; }
+  const std::vector<uint64_t>& latencies() const { return latencies_; }
+
+ private:
+  void Update(uint64_t presentation_time);
+  void OnPresented(uint64_t present_call_time,
+                   mozart2::PresentationInfoPtr info);
+
+  const Params& params_;
+  mozart::client::Session session_;
+  mozart::client::EntityNode root_;
+  mozart::client::RoundedRectangle shape_;
+  std::vector<std::unique_ptr<mozart::client::Material>> materials_;
+  std::vector<std::unique_ptr<mozart::client::EntityNode>> entity_nodes_;
+  std::vector<std::unique_ptr<mozart::client::ShapeNode>> shape_nodes_;
+
+  // The resting position and animation phase of each animated ShapeNode.
+  struct Animation {
+    float x;
+    float y;
+    float phase;
+  };
+  std::vector<Animation> animations_;
+
+  // Each uploaded image is double-buffered.
+  struct ImageUpload {
+    std::unique_ptr<mozart::client::HostImagePool> pool;
+    std::unique_ptr<mozart::client::Material> material;
+    std::unique_ptr<mozart::client::ShapeNode> node;
+    uint32_t index = 0;
+  };
+  std::vector<ImageUpload> image_uploads_;
+
+  // So is each image streamed through an ImagePipe.
+  struct ImagePipeStream {
+    mozart2::ImagePipePtr image_pipe;
+    std::vector<ftl::RefPtr<mozart::client::HostData>> buffers;
+    std::unique_ptr<mozart::client::Material> material;
+    std::unique_ptr<mozart::client::ShapeNode> node;
+    uint32_t index = 0;
+  };
+  std::vector<ImagePipeStream> image_pipes_;
+
+  float cell_width_;
+  float cell_height_;
+  uint64_t start_time_ = 0;
+  uint32_t update_count_ = 0;
+  uint32_t next_material_ = 0;
+  bool stopped_ = false;
+
+  // Statistics.
+  uint32_t frame_count_ = 0;
+  uint32_t skipped_frame_count_ = 0;
+  uint64_t last_presentation_time_ = 0;
+  std::vector<uint64_t> latencies_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(LoadSession);
+};
+
+LoadGenerator::LoadSession::LoadSession(mozart2::SceneManager* scene_manager,
+                                        const Params& params,
+                                        uint32_t index,
+                                        float cell_width,
+                                        float cell_height)
+    : params_(params),
+      session_(scene_manager),
+      root_(&session_),
+      shape_(&session_, kShapeSize, kShapeSize, 8.f, 8.f, 8.f, 8.f),
+      cell_width_(cell_width),
+      cell_height_(cell_height) {
+  if (index < params_.background_sessions)
+    session_.SetPriority(mozart2::SessionPriority::BACKGROUND);
+
+  std::mt19937 random(index);
+  std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+  for (uint32_t i = 0; i < kMaterialCount; ++i) {
+    auto material = std::make_unique<mozart::client::Material>(&session_);
+    material->SetColor(random() & 0xff, random() & 0xff, random() & 0xff, 255);
+    materials_.push_back(std::move(material));
+  }
+
+  // Build |depth| levels of EntityNodes, each with |fan_out| children.
+  std::vector<mozart::client::EntityNode*> parents{&root_};
+  for (uint32_t level = 1; level < params_.depth; ++level) {
+    std::vector<mozart::client::EntityNode*> children;
+    for (auto parent : parents) {
+      for (uint32_t i = 0; i < std::max(params_.fan_out, 1u); ++i) {
+        auto node = std::make_unique<mozart::client::EntityNode>(&session_);
+        parent->AddChild(*node);
+        children.push_back(node.get());
+        entity_nodes_.push_back(std::move(node));
+      }
+    }
+    parents = std::move(children);
+  }
+
+  // Distribute the ShapeNodes among the leaves of the tree.
+  const uint32_t animated_count = static_cast<uint32_t>(
+      ceilf(params_.nodes * std::min(std::max(params_.animated_fraction, 0.f),
+                                     1.f)));
+  for (uint32_t i = 0; i < params_.nodes; ++i) {
+    auto node = std::make_unique<mozart::client::ShapeNode>(&session_);
+    node->SetShape(shape_);
+    node->SetMaterial(*materials_[i % kMaterialCount]);
+    float x = unit(random) * cell_width_;
+    float y = unit(random) * cell_height_;
+    node->SetTranslation(x, y, 0.f);
+    parents[i % parents.size()]->AddChild(*node);
+    if (i < animated_count)
+      animations_.push_back({x, y, unit(random) * 6.28f});
+    shape_nodes_.push_back(std::move(node));
+  }
+
+  mozart2::ImageInfo image_info;
+  image_info.width = params_.image_width;
+  image_info.height = params_.image_height;
+  image_info.stride = params_.image_width * 4u;
+  image_info.pixel_format = mozart2::ImageInfo::PixelFormat::BGRA_8;
+  image_info.color_space = mozart2::ImageInfo::ColorSpace::SRGB;
+  image_info.tiling = mozart2::ImageInfo::Tiling::LINEAR;
+  for (uint32_t i = 0; i < params_.image_uploads; ++i) {
+    auto material = std::make_unique<mozart::client::Material>(&session_);
+    auto node = std::make_unique<mozart::client::ShapeNode>(&session_);
+    node->SetShape(mozart::client::Rectangle(&session_, params_.image_width,
+                                             params_.image_height));
+    node->SetMaterial(*material);
+    node->SetTranslation(unit(random) * cell_width_,
+                         unit(random) * cell_height_, 1.f);
+    root_.AddChild(*node);
+
+    if (params_.image_pipe) {
+      ImagePipeStream stream;
+      uint32_t image_pipe_id = session_.AllocResourceId();
+      session_.Enqueue(mozart::NewCreateImagePipeOp(
+          image_pipe_id, stream.image_pipe.NewRequest()));
+      material->SetTexture(image_pipe_id);
+
+      const size_t image_bytes = image_info.stride * image_info.height;
+      for (uint32_t image_id = 1; image_id <= kImageBufferCount; ++image_id) {
+        mx::vmo vmo;
+        mx_status_t status = mx::vmo::create(image_bytes, 0u, &vmo);
+        FTL_CHECK(status == MX_OK) << "Failed to create vmo: " << status;
+        stream.buffers.push_back(ftl::MakeRefCounted<mozart::client::HostData>(
+            vmo, 0u, image_bytes));
+        stream.image_pipe->AddImage(image_id, image_info.Clone(),
+                                    std::move(vmo),
+                                    mozart2::MemoryType::HOST_MEMORY, 0u);
+      }
+      stream.material = std::move(material);
+      stream.node = std::move(node);
+      image_pipes_.push_back(std::move(stream));
+    } else {
+      ImageUpload upload;
+      upload.pool = std::make_unique<mozart::client::HostImagePool>(
+          &session_, kImageBufferCount);
+      upload.pool->Configure(&image_info);
+      upload.material = std::move(material);
+      upload.node = std::move(node);
+      image_uploads_.push_back(std::move(upload));
+    }
+  }
+}
+
+void LoadGenerator::LoadSession::Export(mx::eventpair export_token) {
+  root_.Export(std::move(export_token));
+}
+
+void LoadGenerator::LoadSession::Start(uint64_t start_time) {
+  start_time_ = start_time;
+  Update(start_time);
+}
+
+void LoadGenerator::LoadSession::Update(uint64_t presentation_time) {
+  double secs = static_cast<double>(presentation_time - start_time_) / kBillion;
+
+  for (size_t i = 0; i < animations_.size(); ++i) {
+    const Animation& animation = animations_[i];
+    shape_nodes_[i]->SetTranslation(
+        animation.x + sin(secs + animation.phase) * kShapeSize,
+        animation.y + cos(secs + animation.phase) * kShapeSize, 0.f);
+  }
+
+  for (uint32_t i = 0; i < params_.ops_per_frame; ++i) {
+    uint8_t value = (update_count_ + i) & 0xff;
+    materials_[next_material_]->SetColor(value, 255 - value, value, 255);
+    next_material_ = (next_material_ + 1) % kMaterialCount;
+  }
+
+  for (auto& upload : image_uploads_) {
+    const mozart::client::HostImage* image = upload.pool->GetImage(upload.index);
+    FTL_DCHECK(image);
+    memset(image->image_ptr(), update_count_ & 0xff,
+           upload.pool->image_info()->stride *
+               upload.pool->image_info()->height);
+    upload.material->SetTexture(*image);
+    upload.pool->DiscardImage(upload.index);
+    upload.index = (upload.index + 1) % kImageBufferCount;
+  }
+
+  // No release fences are used, so a buffer may be rewritten while it is
+  // still being uploaded; only the cost of the uploads matters here.
+  for (auto& stream : image_pipes_) {
+    const auto& buffer = stream.buffers[stream.index];
+    memset(buffer->ptr(), update_count_ & 0xff, buffer->size());
+    stream.image_pipe->PresentImage(
+        stream.index + 1, presentation_time, mx::event(), mx::event(),
+        [](mozart2::PresentationInfoPtr info,
+           mozart2::ImagePresentationStatusPtr status) {});
+    stream.index = (stream.index + 1) % kImageBufferCount;
+  }
+
+  ++update_count_;
+  uint64_t present_call_time = mx_time_get(MX_CLOCK_MONOTONIC);
+  session_.Present(presentation_time, [this, present_call_time](
+                                          mozart2::PresentationInfoPtr info) {
+    OnPresented(present_call_time, std::move(info));
+  });
+}
+
+void LoadGenerator::LoadSession::OnPresented(
+    uint64_t present_call_time,
+    mozart2::PresentationInfoPtr info) {
+  if (stopped_)
+    return;
+
+  latencies_.push_back(mx_time_get(MX_CLOCK_MONOTONIC) - present_call_time);
+  ++frame_count_;
+  if (last_presentation_time_ &&
+      info->presentation_time - last_presentation_time_ >
+          info->presentation_interval * 3 / 2) {
+    ++skipped_frame_count_;
+  }
+  last_presentation_time_ = info->presentation_time;
+
+  Update(info->presentation_time + info->presentation_interval);
+}
+
+LoadGenerator::LoadGenerator(mozart2::SceneManager* scene_manager,
+                             const Params& params)
+    : scene_manager_(scene_manager), params_(params) {}
+
+LoadGenerator::~LoadGenerator() = default;
+
+void LoadGenerator::Start(ftl::Closure done_callback) {
+  done_callback_ = std::move(done_callback);
+  scene_manager_->GetDisplayInfo([this](mozart2::DisplayInfoPtr display_info) {
+    OnDisplayInfo(std::move(display_info));
+  });
+}
+
+void LoadGenerator::OnDisplayInfo(mozart2::DisplayInfoPtr display_info) {
+  const float width = display_info->physical_width;
+  const float height = display_info->physical_height;
+  CreateRootScene(width, height);
+
+  // Lay the sessions out in a grid of equally-sized cells.
+  const uint32_t columns = static_cast<uint32_t>(
+      ceilf(sqrtf(static_cast<float>(std::max(params_.sessions, 1u)))));
+  const uint32_t rows = (params_.sessions + columns - 1) / columns;
+  const float cell_width = width / columns;
+  const float cell_height = height / std::max(rows, 1u);
+
+  for (uint32_t i = 0; i < params_.sessions; ++i) {
+    auto load_session = std::make_unique<LoadSession>(
+        scene_manager_, params_, i, cell_width, cell_height);
+    load_session->set_error_handler([this] {
+      FTL_LOG(ERROR) << "Lost connection to a load session.";
+      Fail();
+    });
+
+    if (params_.link_sessions) {
+      auto import = std::make_unique<mozart::client::ImportNode>(
+          root_session_.get());
+      mx::eventpair export_token;
+      import->BindAsRequest(&export_token);
+      import->SetTranslation((i % columns) * cell_width,
+                             (i / columns) * cell_height, 0.f);
+      scene_root_->AddChild(*import);
+      load_session->Export(std::move(export_token));
+      imports_.push_back(std::move(import));
+    }
+    load_sessions_.push_back(std::move(load_session));
+  }
+
+  root_session_->Present(0, [](mozart2::PresentationInfoPtr info) {});
+
+  scene_manager_->GetFrameStatistics(
+      [this](mozart2::FrameStatisticsPtr statistics) {
+        OnStartStatistics(std::move(statistics));
+      });
+}
+
+void LoadGenerator::CreateRootScene(float width, float height) {
+  root_session_ = std::make_unique<mozart::client::Session>(scene_manager_);
+  root_session_->set_connection_error_handler([this] {
+    FTL_LOG(ERROR) << "Lost connection to the root session.";
+    Fail();
+  });
+  auto session = root_session_.get();
+
+  compositor_ = std::make_unique<mozart::client::DisplayCompositor>(session);
+  mozart::client::LayerStack layer_stack(session);
+  mozart::client::Layer layer(session);
+  mozart::client::Renderer renderer(session);
+  mozart::client::Scene scene(session);
+  camera_ = std::make_unique<mozart::client::Camera>(scene);
+
+  compositor_->SetLayerStack(layer_stack);
+  layer_stack.AddLayer(layer);
+  layer.SetSize(width, height);
+  layer.SetRenderer(renderer);
+  renderer.SetCamera(camera_->id());
+
+  scene_root_ = std::make_unique<mozart::client::EntityNode>(session);
+  scene.AddChild(*scene_root_);
+}
+
+void LoadGenerator::OnStartStatistics(mozart2::FrameStatisticsPtr statistics) {
+  start_statistics_ = std::move(statistics);
+  start_time_ = mx_time_get(MX_CLOCK_MONOTONIC);
+  for (auto& load_session : load_sessions_)
+    load_session->Start(start_time_);
+
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [this] { Stop(); }, ftl::TimeDelta::FromSeconds(params_.duration));
+}
+
+void LoadGenerator::Stop() {
+  if (stopped_)
+    return;
+  stopped_ = true;
+  stop_time_ = mx_time_get(MX_CLOCK_MONOTONIC);
+  for (auto& load_session : load_sessions_)
+    load_session->Stop();
+
+  scene_manager_->GetFrameStatistics(
+      [this](mozart2::FrameStatisticsPtr statistics) {
+        PrintReport(std::move(statistics));
+        done_callback_();
+      });
+}
+
+void LoadGenerator::PrintReport(mozart2::FrameStatisticsPtr end_statistics) {
+  const double duration_secs =
+      static_cast<double>(stop_time_ - start_time_) / kBillion;
+
+  printf("Load: %u sessions x %u nodes (fan-out %u, depth %u, %.0f%% "
+         "animated), %u extra ops/frame, %u %ux%u image uploads/frame%s, "
+         "sessions %s, %u in the background\n",
+         params_.sessions, params_.nodes, params_.fan_out, params_.depth,
+         params_.animated_fraction * 100.f, params_.ops_per_frame,
+         params_.image_uploads, params_.image_width, params_.image_height,
+         params_.image_pipe ? " through ImagePipes" : "",
+         params_.link_sessions ? "linked" : "not linked",
+         std::min(params_.background_sessions, params_.sessions));
+  printf("Duration: %.2f s\n\n", duration_secs);
+
+  printf("Client-side:\n");
+  printf("  session     fps  skipped  latency avg/p50/p95/max (ms)\n");
+  std::vector<uint64_t> all_latencies;
+  uint32_t total_frames = 0;
+  for (size_t i = 0; i < load_sessions_.size(); ++i) {
+    const auto& load_session = load_sessions_[i];
+    std::vector<uint64_t> latencies = load_session->latencies();
+    all_latencies.insert(all_latencies.end(), latencies.begin(),
+                         latencies.end());
+    total_frames += load_session->frame_count();
+    if (latencies.empty()) {
+      printf("  %7zu  no frames presented\n", i);
+      continue;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    uint64_t sum = 0;
+    for (uint64_t latency : latencies)
+      sum += latency;
+    printf("  %7zu%c %6.1f  %7u  %.2f / %.2f / %.2f / %.2f\n", i,
+           i < params_.background_sessions ? '*' : ' ',
+           load_session->frame_count() / duration_secs,
+           load_session->skipped_frame_count(),
+           ToMilliseconds(sum / latencies.size()),
+           ToMilliseconds(latencies[latencies.size() / 2]),
+           ToMilliseconds(latencies[latencies.size() * 95 / 100]),
+           ToMilliseconds(latencies.back()));
+  }
+  if (!all_latencies.empty()) {
+    std::sort(all_latencies.begin(), all_latencies.end());
+    printf("  average fps %.1f, overall p95 latency %.2f ms\n",
+           total_frames / duration_secs / load_sessions_.size(),
+           ToMilliseconds(all_latencies[all_latencies.size() * 95 / 100]));
+  }
+
+  // The server-side statistics are cumulative, so report the difference.
+  const uint64_t frames =
+      end_statistics->frame_count - start_statistics_->frame_count;
+  printf("\nServer-side (%lu frames, %.1f fps):\n", frames,
+         frames / duration_secs);
+  if (frames == 0)
+    return;
+  printf("  phase       avg (ms)  max since start (ms)\n");
+  printf("  apply       %8.3f  %8.3f\n",
+         ToMilliseconds((end_statistics->total_apply_duration -
+                         start_statistics_->total_apply_duration) /
+                        frames),
+         ToMilliseconds(end_statistics->max_apply_duration));
+  printf("  traversal   %8.3f  %8.3f\n",
+         ToMilliseconds((end_statistics->total_traversal_duration -
+                         start_statistics_->total_traversal_duration) /
+                        frames),
+         ToMilliseconds(end_statistics->max_traversal_duration));
+  printf("  render      %8.3f  %8.3f\n",
+         ToMilliseconds((end_statistics->total_render_duration -
+                         start_statistics_->total_render_duration) /
+                        frames),
+         ToMilliseconds(end_statistics->max_render_duration));
+
+  // Fewer frames, and less time spent producing them, are what reducing the
+  // update rate of background sessions saves in power.
+  const uint64_t busy_duration =
+      (end_statistics->total_apply_duration -
+       start_statistics_->total_apply_duration) +
+      (end_statistics->total_traversal_duration -
+       start_statistics_->total_traversal_duration) +
+      (end_statistics->total_render_duration -
+       start_statistics_->total_render_duration);
+  printf("  busy        %8.1f ms/s (%.1f%% of one CPU)\n",
+         ToMilliseconds(busy_duration) / duration_secs,
+         ToMilliseconds(busy_duration) / duration_secs / 10.0);
+}
+
+void LoadGenerator::Fail() {
+  if (stopped_)
+    return;
+  stopped_ = true;
+  for (auto& load_session : load_sessions_)
+    load_session->Stop();
+  done_callback_();
+}
+
+}  // namespace load_generator
+}  // namespace mozart
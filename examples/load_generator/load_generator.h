@@ -0,0 +1,101 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "apps/mozart/lib/scene/client/host_memory.h"
+#include "apps/mozart/lib/scene/client/resources.h"
+#include "apps/mozart/lib/scene/client/session.h"
+#include "apps/mozart/services/scene/scene_manager.fidl.h"
+#include "lib/ftl/functional/closure.h"
+#include "lib/ftl/macros.h"
+
+namespace mozart {
+namespace load_generator {
+
+// Describes the load which is generated.  See README.md for details.
+struct Params {
+  // The number of client sessions.
+  uint32_t sessions = 4;
+  // The number of ShapeNodes in each session.
+  uint32_t nodes = 100;
+  // The number of children of each EntityNode in a session's tree.
+  uint32_t fan_out = 4;
+  // The number of levels of EntityNodes in a session's tree.
+  uint32_t depth = 3;
+  // The fraction of ShapeNodes which are moved every frame.
+  float animated_fraction = 0.5f;
+  // The number of additional SetColor ops enqueued by each session every frame.
+  uint32_t ops_per_frame = 0;
+  // The number of images uploaded by each session every frame, and their size.
+  uint32_t image_uploads = 0;
+  uint32_t image_width = 256;
+  uint32_t image_height = 256;
+  // If true, each image is streamed through its own ImagePipe, whose frames
+  // the SceneManager uploads on a background thread as soon as they are
+  // presented.  Otherwise, the image which is the texture of a Material is
+  // replaced every frame, and uploaded on the render thread.
+  bool image_pipe = false;
+  // If true, each session exports its root node, which the root session
+  // imports into the scene.  Otherwise, the sessions' trees are not attached
+  // to the scene and are never rendered.
+  bool link_sessions = true;
+  // The number of the sessions which set their priority to BACKGROUND, so
+  // that their updates take effect at a reduced rate.
+  uint32_t background_sessions = 0;
+  // How long to generate load for, in seconds.
+  uint32_t duration = 10;
+};
+
+// Generates a configurable amount of load on the SceneManager from several
+// concurrent sessions, then reports the frame rate and Present() callback
+// latency observed by the clients alongside the server-side frame timings
+// reported by |SceneManager.GetFrameStatistics()|.
+class LoadGenerator {
+ public:
+  LoadGenerator(mozart2::SceneManager* scene_manager, const Params& params);
+  ~LoadGenerator();
+
+  // Build the scene and start presenting.  |done_callback| is invoked once the
+  // configured duration has elapsed and the report has been printed, or if the
+  // connection to the SceneManager is lost.
+  void Start(ftl::Closure done_callback);
+
+ private:
+  class LoadSession;
+
+  void OnDisplayInfo(mozart2::DisplayInfoPtr display_info);
+  void CreateRootScene(float width, float height);
+  void OnStartStatistics(mozart2::FrameStatisticsPtr statistics);
+  void Stop();
+  void PrintReport(mozart2::FrameStatisticsPtr end_statistics);
+  void Fail();
+
+  mozart2::SceneManager* const scene_manager_;
+  const Params params_;
+  ftl::Closure done_callback_;
+
+  // The root session owns the compositor and scene, into which the root nodes
+  // of the load sessions are imported.
+  std::unique_ptr<mozart::client::Session> root_session_;
+  std::unique_ptr<mozart::client::DisplayCompositor> compositor_;
+  std::unique_ptr<mozart::client::Camera> camera_;
+  std::unique_ptr<mozart::client::EntityNode> scene_root_;
+  std::vector<std::unique_ptr<mozart::client::ImportNode>> imports_;
+
+  std::vector<std::unique_ptr<LoadSession>> load_sessions_;
+
+  uint64_t start_time_ = 0;
+  uint64_t stop_time_ = 0;
+  mozart2::FrameStatisticsPtr start_statistics_;
+  bool stopped_ = false;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(LoadGenerator);
+};
+
+}  // namespace load_generator
+}  // namespace mozart
@@ -0,0 +1,120 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "application/lib/app/application_context.h"
+#include "application/lib/app/connect.h"
+#include "apps/mozart/examples/load_generator/load_generator.h"
+#include "lib/ftl/command_line.h"
+#include "lib/ftl/log_settings_command_line.h"
+#include "lib/ftl/logging.h"
+#include "lib/ftl/strings/string_number_conversions.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace {
+
+constexpr char kUsage[] =
+    "Usage: scene_manager_load_generator [--sessions=<n>] [--nodes=<n>]\n"
+    "    [--fan_out=<n>] [--depth=<n>] [--animated_fraction=<0..1>]\n"
+    "    [--ops_per_frame=<n>] [--image_uploads=<n>]\n"
+    "    [--image_size=<pixels>|<width>x<height>] [--image_pipe]\n"
+    "    [--no_link_sessions] [--background_sessions=<n>]\n"
+    "    [--duration=<seconds>]\n"
+    "\n"
+    "Generates load on the SceneManager from several sessions and reports\n"
+    "client-side frame rate and Present() latency alongside server-side\n"
+    "frame timings.  See README.md for details.\n";
+
+bool ParseUint32Option(const ftl::CommandLine& command_line,
+                       const char* name,
+                       uint32_t* out_value) {
+  std::string value;
+  if (command_line.GetOptionValue(name, &value) &&
+      !ftl::StringToNumberWithError(value, out_value)) {
+    FTL_LOG(ERROR) << "Invalid --" << name << ": " << value;
+    return false;
+  }
+  return true;
+}
+
+bool ParseParams(const ftl::CommandLine& command_line,
+                 mozart::load_generator::Params* params) {
+  if (!ParseUint32Option(command_line, "sessions", &params->sessions) ||
+      !ParseUint32Option(command_line, "nodes", &params->nodes) ||
+      !ParseUint32Option(command_line, "fan_out", &params->fan_out) ||
+      !ParseUint32Option(command_line, "depth", &params->depth) ||
+      !ParseUint32Option(command_line, "ops_per_frame",
+                         &params->ops_per_frame) ||
+      !ParseUint32Option(command_line, "image_uploads",
+                         &params->image_uploads) ||
+      !ParseUint32Option(command_line, "background_sessions",
+                         &params->background_sessions) ||
+      !ParseUint32Option(command_line, "duration", &params->duration)) {
+    return false;
+  }
+
+  std::string value;
+  if (command_line.GetOptionValue("animated_fraction", &value)) {
+    char* end = nullptr;
+    params->animated_fraction = strtof(value.c_str(), &end);
+    if (value.empty() || *end || params->animated_fraction < 0.f ||
+        params->animated_fraction > 1.f) {
+      FTL_LOG(ERROR) << "Invalid --animated_fraction: " << value;
+      return false;
+    }
+  }
+  if (command_line.GetOptionValue("image_size", &value)) {
+    // Either a single size for square images, or "<width>x<height>".
+    size_t separator = value.find('x');
+    std::string width = value.substr(0, separator);
+    std::string height =
+        separator == std::string::npos ? width : value.substr(separator + 1);
+    if (!ftl::StringToNumberWithError(width, &params->image_width) ||
+        !ftl::StringToNumberWithError(height, &params->image_height)) {
+      FTL_LOG(ERROR) << "Invalid --image_size: " << value;
+      return false;
+    }
+  }
+  params->image_pipe = command_line.HasOption("image_pipe");
+  params->link_sessions = !command_line.HasOption("no_link_sessions");
+
+  if (params->image_uploads &&
+      (!params->image_width || !params->image_height)) {
+    FTL_LOG(ERROR) << "--image_size must be non-zero.";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  auto command_line = ftl::CommandLineFromArgcArgv(argc, argv);
+  if (!ftl::SetLogSettingsFromCommandLine(command_line))
+    return 1;
+
+  mozart::load_generator::Params params;
+  if (command_line.HasOption("help") || !ParseParams(command_line, &params)) {
+    fprintf(stderr, "%s", kUsage);
+    return 1;
+  }
+
+  mtl::MessageLoop loop;
+  auto application_context = app::ApplicationContext::CreateFromStartupInfo();
+  auto scene_manager =
+      application_context
+          ->ConnectToEnvironmentService<mozart2::SceneManager>();
+  scene_manager.set_connection_error_handler([&loop] {
+    FTL_LOG(ERROR) << "Lost connection to SceneManager service.";
+    loop.QuitNow();
+  });
+
+  mozart::load_generator::LoadGenerator load_generator(scene_manager.get(),
+                                                       params);
+  load_generator.Start([&loop] { loop.PostQuitTask(); });
+  loop.Run();
+  return 0;
+}
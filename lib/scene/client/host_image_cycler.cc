@@ -60,8 +60,7 @@ void HostImageCycler::ReleaseAndSwapImage() {
     reconfigured_ = false;
   }
 
-  // TODO(MZ-145): Define an |InvalidateOp| on |Image| instead.
-  image_pool_.DiscardImage(image_index_);
+  image_pool_.InvalidateImage(image_index_);
   image_index_ = (image_index_ + 1) % kNumBuffers;
 }
 
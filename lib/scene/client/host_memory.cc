@@ -146,5 +146,12 @@ void HostImagePool::DiscardImage(uint32_t index) {
   image_ptrs_[index].reset();
 }
 
+void HostImagePool::InvalidateImage(uint32_t index) {
+  FTL_DCHECK(index < num_images());
+
+  if (image_ptrs_[index])
+    image_ptrs_[index]->Invalidate();
+}
+
 }  // namespace client
 }  // namespace mozart
@@ -131,6 +131,12 @@ class HostImagePool {
   // The |index| must be between 0 and |num_images() - 1|.
   void DiscardImage(uint32_t index);
 
+  // Informs the scene manager that the contents of the image with the
+  // specified index have changed, so that it can be reused for another frame
+  // rather than discarded.
+  // The |index| must be between 0 and |num_images() - 1|.
+  void InvalidateImage(uint32_t index);
+
  private:
   Session* const session_;
 
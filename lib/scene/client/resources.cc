@@ -82,12 +82,30 @@ Image::Image(Session* session,
 
 Image::~Image() = default;
 
+void Image::Invalidate() {
+  session()->Enqueue(mozart::NewInvalidateImageOp(id(), nullptr));
+}
+
+void Image::Invalidate(uint32_t x,
+                       uint32_t y,
+                       uint32_t width,
+                       uint32_t height) {
+  auto dirty_rects = ::fidl::Array<mozart2::ImageRectPtr>::New(1);
+  dirty_rects[0] = mozart::NewImageRect(x, y, width, height);
+  session()->Enqueue(
+      mozart::NewInvalidateImageOp(id(), std::move(dirty_rects)));
+}
+
 size_t Image::ComputeSize(const mozart2::ImageInfo& image_info) {
   FTL_DCHECK(image_info.tiling == mozart2::ImageInfo::Tiling::LINEAR);
 
   switch (image_info.pixel_format) {
     case mozart2::ImageInfo::PixelFormat::BGRA_8:
       return image_info.height * image_info.stride;
+    case mozart2::ImageInfo::PixelFormat::NV12:
+    case mozart2::ImageInfo::PixelFormat::I420:
+      // A full-size plane of luma, and half as much again of chroma.
+      return image_info.height * image_info.stride * 3 / 2;
   }
 
   FTL_NOTREACHED();
@@ -136,6 +136,11 @@ class Image : public Resource {
   // Gets information about the image's layout.
   const mozart2::ImageInfo& info() const { return info_; }
 
+  // Informs the scene manager that the pixels of the image have changed, so
+  // that they are uploaded again.  Only needed for images in host memory.
+  void Invalidate();
+  void Invalidate(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
  private:
   off_t const memory_offset_;
   mozart2::ImageInfo const info_;
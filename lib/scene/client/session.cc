@@ -92,6 +92,20 @@ void Session::HitTest(uint32_t node_id,
                     std::move(ray_direction_vec), std::move(callback));
 }
 
+void Session::GetFuturePresentationTimes(
+    uint32_t count,
+    FuturePresentationTimesCallback callback) {
+  session_->GetFuturePresentationTimes(count, std::move(callback));
+}
+
+void Session::SetPriority(mozart2::SessionPriority priority) {
+  session_->SetPriority(priority);
+}
+
+void Session::SetMaxUpdateRate(float updates_per_second) {
+  session_->SetMaxUpdateRate(updates_per_second);
+}
+
 void Session::OnError(const fidl::String& error) {
   FTL_LOG(ERROR) << "Session error: " << error;
 }
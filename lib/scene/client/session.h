@@ -31,6 +31,10 @@ class Session : private mozart2::SessionListener {
   using HitTestCallback =
       std::function<void(fidl::Array<mozart2::HitPtr> hits)>;
 
+  // Provides predicted presentation times.
+  using FuturePresentationTimesCallback = std::function<void(
+      fidl::Array<mozart2::FuturePresentationTimePtr> future_times)>;
+
   // Called when session events are received.
   using EventHandler = std::function<void(uint64_t presentation_time,
                                           fidl::Array<mozart2::EventPtr>)>;
@@ -96,6 +100,18 @@ class Session : private mozart2::SessionListener {
                const float ray_direction[3],
                HitTestCallback callback);
 
+  // Requests the next |count| predicted presentation times, and the latest
+  // time at which |Present()| can be called to meet each of them.
+  void GetFuturePresentationTimes(uint32_t count,
+                                  FuturePresentationTimesCallback callback);
+
+  // Sets how urgently the session's updates are applied.
+  void SetPriority(mozart2::SessionPriority priority);
+
+  // Limits how often the session's updates take effect; zero removes the
+  // limit.
+  void SetMaxUpdateRate(float updates_per_second);
+
  private:
   // |mozart2::SessionListener|
   void OnError(const fidl::String& error) override;
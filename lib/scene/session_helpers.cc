@@ -708,6 +708,32 @@ mozart2::OpPtr NewSetLabelOp(uint32_t resource_id, const std::string& label) {
   return op;
 }
 
+mozart2::OpPtr NewInvalidateImageOp(
+    uint32_t image_id,
+    ::fidl::Array<mozart2::ImageRectPtr> dirty_rects) {
+  auto invalidate_image = mozart2::InvalidateImageOp::New();
+  invalidate_image->image_id = image_id;
+  invalidate_image->dirty_rects =
+      dirty_rects ? std::move(dirty_rects)
+                  : ::fidl::Array<mozart2::ImageRectPtr>::New(0);
+
+  auto op = mozart2::Op::New();
+  op->set_invalidate_image(std::move(invalidate_image));
+  return op;
+}
+
+mozart2::ImageRectPtr NewImageRect(uint32_t x,
+                                   uint32_t y,
+                                   uint32_t width,
+                                   uint32_t height) {
+  auto rect = mozart2::ImageRect::New();
+  rect->x = x;
+  rect->y = y;
+  rect->width = width;
+  rect->height = height;
+  return rect;
+}
+
 mozart2::FloatValuePtr NewFloatValue(float value) {
   auto val = mozart2::FloatValue::New();
   val->variable_id = 0;
@@ -153,6 +153,16 @@ mozart2::OpPtr NewSetEventMaskOp(uint32_t resource_id, uint32_t event_mask);
 // Diagnostic operations.
 mozart2::OpPtr NewSetLabelOp(uint32_t resource_id, const std::string& label);
 
+// Image operations.
+// If |dirty_rects| is empty, the whole image is invalidated.
+mozart2::OpPtr NewInvalidateImageOp(
+    uint32_t image_id,
+    ::fidl::Array<mozart2::ImageRectPtr> dirty_rects);
+mozart2::ImageRectPtr NewImageRect(uint32_t x,
+                                   uint32_t y,
+                                   uint32_t width,
+                                   uint32_t height);
+
 // Basic types.
 
 mozart2::FloatValuePtr NewFloatValue(float value);
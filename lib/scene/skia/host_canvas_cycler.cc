@@ -67,8 +67,7 @@ void HostCanvasCycler::ReleaseAndSwapCanvas() {
     reconfigured_ = false;
   }
 
-  // TODO(MZ-145): Define an |InvalidateOp| on |Image| instead.
-  surface_pool_.DiscardImage(surface_index_);
+  surface_pool_.InvalidateImage(surface_index_);
   surface_index_ = (surface_index_ + 1) % kNumBuffers;
 }
 
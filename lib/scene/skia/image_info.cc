@@ -16,6 +16,10 @@ SkImageInfo MakeSkImageInfo(const mozart2::ImageInfo& image_info) {
     case mozart2::ImageInfo::PixelFormat::BGRA_8:
       return SkImageInfo::Make(image_info.width, image_info.height,
                                kBGRA_8888_SkColorType, kOpaque_SkAlphaType);
+    case mozart2::ImageInfo::PixelFormat::NV12:
+    case mozart2::ImageInfo::PixelFormat::I420:
+      // Skia cannot draw into YUV images.
+      break;
   }
 
   FTL_NOTREACHED();
@@ -4,16 +4,73 @@
 
 #include "apps/mozart/src/scene_manager/acquire_fence_set.h"
 
-#include <mx/time.h>
+#include <algorithm>
+
 #include "lib/ftl/logging.h"
+#include "lib/mtl/tasks/message_loop.h"
 
 namespace scene_manager {
 
-AcquireFenceSet::AcquireFenceSet(::fidl::Array<mx::event> acquire_fences)
-    : fences_(std::move(acquire_fences)) {}
+AcquireFenceWaiter::AcquireFenceWaiter()
+    : wait_set_([this](const std::vector<WaitSet::Signal>& signals) {
+        OnSignals(signals);
+      }) {}
+
+AcquireFenceWaiter::~AcquireFenceWaiter() {
+  FTL_DCHECK(sets_.empty());
+}
+
+uint64_t AcquireFenceWaiter::Add(AcquireFenceSet* set, mx_handle_t fence) {
+  // Keys are never reused, as WaitSet requires; koids would not do, since the
+  // same fence may be passed to more than one Present().
+  uint64_t key = next_key_++;
+  if (!wait_set_.Add(key, fence, kFenceSignalledOrClosed))
+    return 0u;
+  sets_[key] = set;
+  return key;
+}
+
+void AcquireFenceWaiter::Remove(uint64_t key) {
+  wait_set_.Remove(key);
+  sets_.erase(key);
+}
+
+void AcquireFenceWaiter::OnSignals(
+    const std::vector<WaitSet::Signal>& signals) {
+  for (const WaitSet::Signal& signal : signals) {
+    FTL_DCHECK(signal.observed & kFenceSignalledOrClosed);
+    // A set's callback may destroy other sets, so each is looked up afresh.
+    auto it = sets_.find(signal.key);
+    if (it == sets_.end())
+      continue;
+    AcquireFenceSet* set = it->second;
+    sets_.erase(it);
+    set->OnFenceSignalled(signal.key);
+  }
+}
+
+AcquireFenceSet::AcquireFenceSet(::fidl::Array<mx::event> acquire_fences,
+                                 AcquireFenceWaiter* waiter)
+    : fences_(std::move(acquire_fences)), waiter_(waiter) {}
 
 AcquireFenceSet::~AcquireFenceSet() {
-  ClearHandlers();
+  ClearWaits();
+}
+
+bool AcquireFenceSet::IsSignalled(const mx::event& fence) {
+  mx_signals_t pending = 0u;
+  mx_status_t status = fence.wait_one(kFenceSignalledOrClosed, 0u, &pending);
+  FTL_DCHECK(status == MX_OK || status == MX_ERR_TIMED_OUT);
+  return pending & kFenceSignalledOrClosed;
+}
+
+bool AcquireFenceSet::PollReady() {
+  FTL_DCHECK(!ready_callback_);
+  if (!ready()) {
+    num_signalled_fences_ = std::count_if(fences_.begin(), fences_.end(),
+                                          &AcquireFenceSet::IsSignalled);
+  }
+  return ready();
 }
 
 void AcquireFenceSet::WaitReadyAsync(ftl::Closure ready_callback) {
@@ -23,59 +80,58 @@ void AcquireFenceSet::WaitReadyAsync(ftl::Closure ready_callback) {
   // Make sure callback was not set before.
   FTL_DCHECK(!ready_callback_);
 
+  if (!ready()) {
+    // Only wait for the fences which have not already been signalled.
+    FTL_DCHECK(wait_keys_.empty());
+    num_signalled_fences_ = 0;
+    for (auto& fence : fences_) {
+      if (IsSignalled(fence)) {
+        ++num_signalled_fences_;
+        continue;
+      }
+      if (!waiter_) {
+        own_waiter_ = std::make_unique<AcquireFenceWaiter>();
+        waiter_ = own_waiter_.get();
+      }
+      uint64_t key = waiter_->Add(this, fence.get());
+      if (key) {
+        wait_keys_.push_back(key);
+      } else {
+        // The fence cannot be waited for, which is treated like its having
+        // been closed.
+        ++num_signalled_fences_;
+      }
+    }
+  }
+
   if (ready()) {
     mtl::MessageLoop::GetCurrent()->task_runner()->PostTask(
         std::move(ready_callback));
     return;
   }
-
-  FTL_DCHECK(handler_keys_.empty());
-  for (auto& fence : fences_) {
-    handler_keys_.push_back(mtl::MessageLoop::GetCurrent()->AddHandler(
-        this, fence.get(), kFenceSignalledOrClosed));
-  }
-
   ready_callback_ = std::move(ready_callback);
 }
 
-void AcquireFenceSet::ClearHandlers() {
-  for (auto& handler_key : handler_keys_) {
-    // It's possible that a handler got removed earlier (during an
-    // OnHandleReady) so check that it's not zero.
-    if (handler_key != 0) {
-      mtl::MessageLoop::GetCurrent()->RemoveHandler(handler_key);
-    }
+void AcquireFenceSet::ClearWaits() {
+  for (uint64_t key : wait_keys_) {
+    waiter_->Remove(key);
   }
-  handler_keys_.clear();
+  wait_keys_.clear();
 }
 
-void AcquireFenceSet::OnHandleReady(mx_handle_t handle,
-                                    mx_signals_t pending,
-                                    uint64_t count) {
-  FTL_DCHECK(pending & kFenceSignalledOrClosed);
+void AcquireFenceSet::OnFenceSignalled(uint64_t key) {
   FTL_DCHECK(ready_callback_);
 
   // TODO: Handle the case where there is an error condition, probably want to
   // close the session.
+  auto it = std::find(wait_keys_.begin(), wait_keys_.end(), key);
+  FTL_DCHECK(it != wait_keys_.end());
+  wait_keys_.erase(it);
   num_signalled_fences_++;
 
-  // Remove the handler that is associated with this handle.
-  FTL_DCHECK(fences_.size() == handler_keys_.size());
-  size_t handler_index = 0;
-  for (; handler_index < fences_.size(); handler_index++) {
-    if (fences_[handler_index].get() == handle) {
-      break;
-    }
-  }
-  mtl::MessageLoop::HandlerKey handler_key = handler_keys_[handler_index];
-  FTL_DCHECK(handler_key != 0);
-  mtl::MessageLoop::GetCurrent()->RemoveHandler(handler_key);
-  // Set the handler key to 0 so we don't try to remove it twice.
-  handler_keys_[handler_index] = 0;
   if (ready()) {
+    FTL_DCHECK(wait_keys_.empty());
     ftl::Closure callback = std::move(ready_callback_);
-    handler_keys_.clear();
-
     callback();
   }
 }
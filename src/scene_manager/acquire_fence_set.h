@@ -6,29 +6,66 @@
 
 #include <mx/event.h>
 
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 #include "lib/fidl/cpp/bindings/array.h"
 #include "lib/ftl/functional/closure.h"
 #include "lib/ftl/macros.h"
-#include "lib/ftl/time/time_delta.h"
-#include "lib/mtl/tasks/message_loop.h"
-#include "lib/mtl/tasks/message_loop_handler.h"
 
 #include "apps/mozart/src/scene_manager/fence.h"
+#include "apps/mozart/src/scene_manager/util/wait_set.h"
 
 namespace scene_manager {
 
+class AcquireFenceSet;
+
+// Waits for the fences of any number of AcquireFenceSets with a single
+// WaitSet, and so a single port, rather than registering a message loop
+// handler per fence.  Must outlive the sets which use it.
+class AcquireFenceWaiter {
+ public:
+  AcquireFenceWaiter();
+  ~AcquireFenceWaiter();
+
+ private:
+  friend class AcquireFenceSet;
+
+  // Reports to |set| when |fence| has been signalled or closed.  Returns the
+  // key of the wait, or 0 if it could not be started.
+  uint64_t Add(AcquireFenceSet* set, mx_handle_t fence);
+  void Remove(uint64_t key);
+
+  void OnSignals(const std::vector<WaitSet::Signal>& signals);
+
+  WaitSet wait_set_;
+  std::unordered_map<uint64_t, AcquireFenceSet*> sets_;
+  uint64_t next_key_ = 1;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(AcquireFenceWaiter);
+};
+
 // Provides access to the consumption fences associated with a call to
 // |Present|.
-class AcquireFenceSet : private mtl::MessageLoopHandler {
+class AcquireFenceSet {
  public:
   // Takes ownership of the fences.
-  // |acquire_fences| must be valid handles.
-  explicit AcquireFenceSet(::fidl::Array<mx::event> acquire_fences);
+  // |acquire_fences| must be valid handles.  The fences are waited for by
+  // |waiter| if it is not null, and otherwise by a waiter of the set's own.
+  explicit AcquireFenceSet(::fidl::Array<mx::event> acquire_fences,
+                           AcquireFenceWaiter* waiter = nullptr);
 
   // Releases the fence, implicitly signalling to the producer that the
   // buffer is available to be recycled.
   ~AcquireFenceSet();
 
+  // Checks, without blocking, whether all the fences have already been
+  // signalled, so that a set which is ready can be acted upon at once rather
+  // than after a trip through the message loop.  Returns ready().  Can only be
+  // called before WaitReadyAsync().
+  bool PollReady();
+
   // Invokes the callback when all the fences have been signalled. The callback
   // will be invoked on the current message loop.
   // Can only be called after any previous WaitReadyAsync has invoked the
@@ -39,19 +76,24 @@ class AcquireFenceSet : private mtl::MessageLoopHandler {
   bool ready() const { return num_signalled_fences_ == fences_.size(); }
 
  private:
-  // |mtl::MessageLoopHandler|
-  void OnHandleReady(mx_handle_t handle,
-                     mx_signals_t pending,
-                     uint64_t count) override;
+  friend class AcquireFenceWaiter;
 
-  void ClearHandlers();
+  // Called by |waiter_| when the fence waited for with |key| is signalled.
+  void OnFenceSignalled(uint64_t key);
+
+  // Returns whether |fence| has already been signalled or closed.
+  static bool IsSignalled(const mx::event& fence);
+
+  void ClearWaits();
 
   ::fidl::Array<mx::event> fences_;
   uint32_t num_signalled_fences_ = 0;
 
-  // HandlerKeys, each corresponding to an |mx::event| with the same index in
-  // |fences_|. The size of this array must match that of |fences_|.
-  std::vector<mtl::MessageLoop::HandlerKey> handler_keys_;
+  AcquireFenceWaiter* waiter_;
+  std::unique_ptr<AcquireFenceWaiter> own_waiter_;
+
+  // The keys of the waits which have not completed yet.
+  std::vector<uint64_t> wait_keys_;
 
   ftl::Closure ready_callback_;
 
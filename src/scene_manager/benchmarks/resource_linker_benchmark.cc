@@ -0,0 +1,141 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdio.h>
+
+#include <memory>
+#include <vector>
+
+#include <magenta/syscalls.h>
+
+#include "apps/mozart/src/scene_manager/displays/display_manager.h"
+#include "apps/mozart/src/scene_manager/engine/engine.h"
+#include "apps/mozart/src/scene_manager/engine/session.h"
+#include "apps/mozart/src/scene_manager/release_fence_signaller.h"
+#include "apps/mozart/src/scene_manager/resources/nodes/entity_node.h"
+#include "apps/mozart/src/scene_manager/resources/resource_linker.h"
+#include "escher/impl/command_buffer_sequencer.h"
+#include "lib/ftl/command_line.h"
+#include "lib/ftl/log_settings_command_line.h"
+#include "lib/ftl/logging.h"
+#include "lib/ftl/strings/string_number_conversions.h"
+#include "lib/mtl/tasks/message_loop.h"
+#include "magenta/system/ulib/mx/include/mx/eventpair.h"
+
+using namespace scene_manager;
+
+namespace {
+
+constexpr char kUsage[] =
+    "Usage: scene_manager_resource_linker_benchmark [--pairs=<n>]\n"
+    "\n"
+    "Links export/import pairs with the batched ResourceLinker APIs, then\n"
+    "closes all the import handles, and reports how long each phase took and\n"
+    "how much memory the linker used.\n";
+
+// Uses the Engine constructor intended for testing, which does not require
+// Escher; the exported nodes only need a session to belong to.
+class BenchmarkEngine : public Engine {
+ public:
+  BenchmarkEngine(
+      DisplayManager* display_manager,
+      std::unique_ptr<ReleaseFenceSignaller> release_fence_signaller)
+      : Engine(display_manager, std::move(release_fence_signaller)) {}
+};
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  auto command_line = ftl::CommandLineFromArgcArgv(argc, argv);
+  if (!ftl::SetLogSettingsFromCommandLine(command_line))
+    return 1;
+
+  if (command_line.HasOption("help")) {
+    fprintf(stderr, "%s", kUsage);
+    return 1;
+  }
+
+  uint32_t pair_count = 10000;
+  std::string value;
+  if (command_line.GetOptionValue("pairs", &value) &&
+      (!ftl::StringToNumberWithError(value, &pair_count) || !pair_count)) {
+    FTL_LOG(ERROR) << "Invalid --pairs: " << value;
+    return 1;
+  }
+
+  mtl::MessageLoop loop;
+  DisplayManager display_manager;
+  escher::impl::CommandBufferSequencer command_buffer_sequencer;
+  BenchmarkEngine engine(&display_manager,
+                         std::make_unique<ReleaseFenceSignaller>(
+                             &command_buffer_sequencer));
+  auto session = ftl::MakeRefCounted<Session>(1, &engine);
+  ResourceLinker linker;
+
+  std::vector<ResourceLinker::ExportRequest> export_requests;
+  std::vector<mx::eventpair> import_handles;
+  import_handles.reserve(pair_count);
+  for (uint32_t i = 0; i < pair_count; ++i) {
+    mx::eventpair source, destination;
+    if (mx::eventpair::create(0, &source, &destination) != MX_OK) {
+      FTL_LOG(ERROR) << "Could not create eventpair " << i;
+      return 1;
+    }
+    export_requests.push_back(
+        {ftl::MakeRefCounted<EntityNode>(session.get(), i + 1),
+         std::move(source)});
+    import_handles.push_back(std::move(destination));
+  }
+
+  size_t resolved_count = 0;
+  std::vector<ResourceLinker::ImportRequest> import_requests;
+  for (const auto& import_handle : import_handles) {
+    import_requests.push_back(
+        {mozart2::ImportSpec::NODE, &import_handle,
+         [&resolved_count](ResourcePtr resource,
+                           ResourceLinker::ResolutionResult cause) {
+           if (resource && cause == ResourceLinker::ResolutionResult::kSuccess)
+             ++resolved_count;
+         }});
+  }
+
+  const uint64_t start_time = mx_time_get(MX_CLOCK_MONOTONIC);
+  const size_t exported_count =
+      linker.ExportResources(std::move(export_requests));
+  const uint64_t export_time = mx_time_get(MX_CLOCK_MONOTONIC);
+  linker.ImportResources(std::move(import_requests));
+  const uint64_t link_time = mx_time_get(MX_CLOCK_MONOTONIC);
+  const size_t memory_usage = linker.EstimateMemoryUsage();
+
+  if (exported_count != pair_count || resolved_count != pair_count) {
+    FTL_LOG(ERROR) << "Exported " << exported_count << " and resolved "
+                   << resolved_count << " of " << pair_count << " pairs";
+    return 1;
+  }
+
+  // Closing the import handles expires every export.
+  size_t expired_count = 0;
+  linker.SetOnExpiredCallback(
+      [&loop, &expired_count, pair_count](ResourcePtr,
+                                          ResourceLinker::ExpirationCause) {
+        if (++expired_count == pair_count)
+          loop.QuitNow();
+      });
+  const uint64_t close_time = mx_time_get(MX_CLOCK_MONOTONIC);
+  import_handles.clear();
+  loop.Run();
+  const uint64_t expire_time = mx_time_get(MX_CLOCK_MONOTONIC);
+
+  printf("pairs: %u\n", pair_count);
+  printf("export: %llu us\n",
+         static_cast<unsigned long long>((export_time - start_time) / 1000));
+  printf("import+link: %llu us\n",
+         static_cast<unsigned long long>((link_time - export_time) / 1000));
+  printf("expire: %llu us\n",
+         static_cast<unsigned long long>((expire_time - close_time) / 1000));
+  printf("memory: ~%zu bytes/pair\n", memory_usage / pair_count);
+
+  session->TearDown();
+  return 0;
+}
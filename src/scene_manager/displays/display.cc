@@ -6,26 +6,62 @@
 
 #include <magenta/syscalls.h>
 
+#include "apps/tracing/lib/trace/event.h"
 #include "lib/ftl/logging.h"
 
 namespace scene_manager {
 
+constexpr uint64_t Display::kNominalVsyncIntervalNanos;
+
 Display::Display(uint32_t width, uint32_t height, float device_pixel_ratio)
-    : first_vsync_(mx_time_get(MX_CLOCK_MONOTONIC)),
+    : Display(width,
+              height,
+              device_pixel_ratio,
+              std::make_unique<MeasuredVsyncSource>(
+                  mx_time_get(MX_CLOCK_MONOTONIC),
+                  kNominalVsyncIntervalNanos)) {}
+
+Display::Display(uint32_t width,
+                 uint32_t height,
+                 float device_pixel_ratio,
+                 std::unique_ptr<VsyncSource> vsync_source)
+    : vsync_source_(std::move(vsync_source)),
       width_(width),
       height_(height),
-      device_pixel_ratio_(device_pixel_ratio) {}
+      device_pixel_ratio_(device_pixel_ratio) {
+  FTL_DCHECK(vsync_source_);
+}
+
+Display::~Display() = default;
 
 uint64_t Display::GetLastVsyncTime() const {
-  uint64_t current_time = mx_time_get(MX_CLOCK_MONOTONIC);
-  uint64_t num_elapsed_intervals =
-      (current_time - first_vsync_) / kHardcodedPresentationIntervalNanos;
-  return first_vsync_ +
-         num_elapsed_intervals * kHardcodedPresentationIntervalNanos;
+  return GetLastVsyncTime(mx_time_get(MX_CLOCK_MONOTONIC));
+}
+
+uint64_t Display::GetLastVsyncTime(uint64_t now) const {
+  return vsync_source_->GetLastVsyncTime(now);
 }
 
 uint64_t Display::GetVsyncInterval() const {
-  return kHardcodedPresentationIntervalNanos;
+  return vsync_source_->GetVsyncInterval();
+}
+
+void Display::OnVsync(uint64_t timestamp) {
+  vsync_source_->AddVsyncTimestamp(timestamp);
+
+  const VsyncStatistics statistics = vsync_source_->GetStatistics();
+  TRACE_COUNTER("gfx", "Vsync", 0u, "interval_ns", GetVsyncInterval(),
+                "mean_error_ns",
+                static_cast<uint64_t>(statistics.mean_error_nanos),
+                "rejected_samples", statistics.rejected_sample_count);
+}
+
+double Display::GetRefreshRate() const {
+  return 1e9 / static_cast<double>(GetVsyncInterval());
+}
+
+VsyncStatistics Display::GetVsyncStatistics() const {
+  return vsync_source_->GetStatistics();
 }
 
 void Display::Claim() {
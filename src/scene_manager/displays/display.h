@@ -5,28 +5,51 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 
+#include "apps/mozart/src/scene_manager/displays/vsync_source.h"
 #include "lib/ftl/macros.h"
 
 namespace scene_manager {
 
-// Display is a placeholder that provides make-believe values for screen
-// resolution, vsync interval, last vsync time, etc.
+// Display provides the screen resolution and vsync timing of a display.
 class Display {
  public:
-  // TODO(MZ-124): We should derive an appropriate value from the rendering
-  // targets, in particular giving priority to couple to the display refresh
-  // (vsync).
-  static constexpr uint64_t kHardcodedPresentationIntervalNanos = 16'666'667;
+  // The vsync interval assumed until it has been measured.
+  static constexpr uint64_t kNominalVsyncIntervalNanos = 16'666'667;
 
+  // Measures the vsync timing from the timestamps passed to OnVsync().
   Display(uint32_t width, uint32_t height, float device_pixel_ratio);
 
+  // Uses |vsync_source| for the vsync timing, such as a
+  // SimulatedVsyncSource in tests.
+  Display(uint32_t width,
+          uint32_t height,
+          float device_pixel_ratio,
+          std::unique_ptr<VsyncSource> vsync_source);
+
+  ~Display();
+
   // Obtain the time of the last Vsync, in nanoseconds.
   uint64_t GetLastVsyncTime() const;
 
+  // Obtain the time of the last Vsync at or before |now|, for callers with
+  // their own clock.
+  uint64_t GetLastVsyncTime(uint64_t now) const;
+
   // Obtain the interval between Vsyncs.
   uint64_t GetVsyncInterval() const;
 
+  // Reports the time of a vsync, in nanoseconds, as measured by the display
+  // hardware or estimated from the completion of a swapchain present.
+  void OnVsync(uint64_t timestamp);
+
+  // The measured refresh rate, in Hz.
+  double GetRefreshRate() const;
+
+  // How closely the reported vsyncs match the measured timing.
+  VsyncStatistics GetVsyncStatistics() const;
+
   // Claiming a display means that no other display renderer can use it.
   bool is_claimed() const { return claimed_; }
   void Claim();
@@ -37,7 +60,7 @@ class Display {
   float device_pixel_ratio() const { return device_pixel_ratio_; }
 
  private:
-  uint64_t const first_vsync_;
+  const std::unique_ptr<VsyncSource> vsync_source_;
   uint32_t const width_;
   uint32_t const height_;
   float const device_pixel_ratio_;
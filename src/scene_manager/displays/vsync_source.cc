@@ -0,0 +1,129 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/displays/vsync_source.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "lib/ftl/logging.h"
+
+namespace scene_manager {
+
+namespace {
+
+// Timestamps further than this fraction of an interval from the nearest
+// predicted vsync are not used to correct the estimate.
+constexpr double kMaxErrorFraction = 0.25;
+
+// After this many timestamps in a row are rejected, the estimate is
+// restarted from the latest ones.
+constexpr uint32_t kResyncRejectedCount = 4;
+
+// The gains of the phase and interval corrections.  Together they
+// critically damp the estimate, so that it follows drift without
+// overshooting.
+constexpr double kPhaseGain = 0.1;
+constexpr double kIntervalGain = kPhaseGain * kPhaseGain / (2.0 - kPhaseGain);
+
+// The weight of each new error in VsyncStatistics::mean_error_nanos.
+constexpr double kMeanErrorWeight = 0.05;
+
+// Intervals outside this range of the nominal interval are assumed to span
+// more or less than one vsync when resynchronizing.
+constexpr double kMinIntervalFraction = 0.4;
+constexpr double kMaxIntervalFraction = 2.5;
+
+}  // namespace
+
+SimulatedVsyncSource::SimulatedVsyncSource(uint64_t first_vsync_time,
+                                           uint64_t interval)
+    : first_vsync_time_(first_vsync_time), interval_(interval) {
+  FTL_DCHECK(interval_ > 0);
+}
+
+uint64_t SimulatedVsyncSource::GetLastVsyncTime(uint64_t now) const {
+  if (now < first_vsync_time_)
+    return first_vsync_time_;
+  return first_vsync_time_ +
+         (now - first_vsync_time_) / interval_ * interval_;
+}
+
+uint64_t SimulatedVsyncSource::GetVsyncInterval() const {
+  return interval_;
+}
+
+MeasuredVsyncSource::MeasuredVsyncSource(uint64_t initial_vsync_time,
+                                         uint64_t nominal_interval)
+    : phase_(static_cast<double>(initial_vsync_time)),
+      interval_(static_cast<double>(nominal_interval)),
+      nominal_interval_(static_cast<double>(nominal_interval)) {
+  FTL_DCHECK(nominal_interval > 0);
+}
+
+uint64_t MeasuredVsyncSource::GetLastVsyncTime(uint64_t now) const {
+  const double cycles =
+      std::floor((static_cast<double>(now) - phase_) / interval_);
+  const double last_vsync = phase_ + cycles * interval_;
+  return last_vsync <= 0.0 ? 0u : static_cast<uint64_t>(last_vsync);
+}
+
+uint64_t MeasuredVsyncSource::GetVsyncInterval() const {
+  return static_cast<uint64_t>(std::round(interval_));
+}
+
+void MeasuredVsyncSource::AddVsyncTimestamp(uint64_t timestamp) {
+  ++statistics_.sample_count;
+  if (!has_timestamp_) {
+    has_timestamp_ = true;
+    last_timestamp_ = timestamp;
+    phase_ = static_cast<double>(timestamp);
+    return;
+  }
+
+  // Find the predicted vsync nearest to the timestamp.  Timestamps for the
+  // vsync which last corrected the estimate, or an earlier one, are
+  // duplicates or out of order.
+  const double elapsed = static_cast<double>(timestamp) - phase_;
+  const double cycles = std::round(elapsed / interval_);
+  const double error = elapsed - cycles * interval_;
+  if (cycles < 1.0 || std::abs(error) > kMaxErrorFraction * interval_) {
+    ++statistics_.rejected_sample_count;
+    if (cycles >= 1.0 &&
+        ++consecutive_rejected_count_ >= kResyncRejectedCount) {
+      Resync(timestamp);
+    }
+    last_timestamp_ = std::max(last_timestamp_, timestamp);
+    return;
+  }
+  consecutive_rejected_count_ = 0;
+  last_timestamp_ = timestamp;
+
+  phase_ += cycles * interval_ + kPhaseGain * error;
+  interval_ += kIntervalGain * error / cycles;
+
+  const double abs_error = std::abs(error);
+  statistics_.mean_error_nanos +=
+      kMeanErrorWeight * (abs_error - statistics_.mean_error_nanos);
+  statistics_.max_error_nanos =
+      std::max(statistics_.max_error_nanos, abs_error);
+}
+
+void MeasuredVsyncSource::Resync(uint64_t timestamp) {
+  ++statistics_.resync_count;
+  consecutive_rejected_count_ = 0;
+
+  // The refresh rate may have changed, or the nominal interval may have been
+  // wrong; if the latest timestamps look like consecutive vsyncs, take the
+  // interval from them.
+  const double interval = static_cast<double>(timestamp - last_timestamp_);
+  if (timestamp > last_timestamp_ &&
+      interval >= kMinIntervalFraction * nominal_interval_ &&
+      interval <= kMaxIntervalFraction * nominal_interval_) {
+    interval_ = interval;
+  }
+  phase_ = static_cast<double>(timestamp);
+}
+
+}  // namespace scene_manager
@@ -0,0 +1,102 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+
+#include "lib/ftl/macros.h"
+
+namespace scene_manager {
+
+// Describes how closely the vsync timestamps reported to a VsyncSource match
+// its estimate of the vsync timing.
+struct VsyncStatistics {
+  // The number of timestamps reported, and how many of those were discarded
+  // as being too far from any predicted vsync.
+  uint64_t sample_count = 0;
+  uint64_t rejected_sample_count = 0;
+  // The number of times the estimate was discarded and restarted, because
+  // too many timestamps in a row were rejected.
+  uint64_t resync_count = 0;
+  // The moving average, and the maximum, of the absolute difference between
+  // the accepted timestamps and the predicted vsync times.
+  double mean_error_nanos = 0.0;
+  double max_error_nanos = 0.0;
+};
+
+// Provides the vsync timing of a display.  Times are in nanoseconds.
+class VsyncSource {
+ public:
+  virtual ~VsyncSource() = default;
+
+  // Returns the time of the last vsync at or before |now|.
+  virtual uint64_t GetLastVsyncTime(uint64_t now) const = 0;
+
+  // Returns the interval between vsyncs.
+  virtual uint64_t GetVsyncInterval() const = 0;
+
+  // Reports the time at which a vsync occurred, as measured by the display
+  // hardware or estimated from the completion of a swapchain present.
+  // Sources which do not measure vsync ignore it.
+  virtual void AddVsyncTimestamp(uint64_t /* timestamp */) {}
+
+  virtual VsyncStatistics GetStatistics() const { return VsyncStatistics(); }
+};
+
+// Pretends that vsyncs occur at exactly |interval| from |first_vsync_time|.
+// Used for tests, and where no vsync timestamps are available.
+class SimulatedVsyncSource : public VsyncSource {
+ public:
+  SimulatedVsyncSource(uint64_t first_vsync_time, uint64_t interval);
+
+  // |VsyncSource|
+  uint64_t GetLastVsyncTime(uint64_t now) const override;
+  uint64_t GetVsyncInterval() const override;
+
+ private:
+  const uint64_t first_vsync_time_;
+  const uint64_t interval_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(SimulatedVsyncSource);
+};
+
+// Estimates the vsync timing from reported vsync timestamps, which may be
+// noisy, and need not be for consecutive vsyncs.  Each timestamp corrects the
+// predicted phase by part of its error, to filter out jitter, and the
+// interval by the drift which the error accumulated since the last one.
+// Until timestamps are reported, vsyncs are predicted at |nominal_interval|
+// from |initial_vsync_time|.
+class MeasuredVsyncSource : public VsyncSource {
+ public:
+  MeasuredVsyncSource(uint64_t initial_vsync_time, uint64_t nominal_interval);
+
+  // |VsyncSource|
+  uint64_t GetLastVsyncTime(uint64_t now) const override;
+  uint64_t GetVsyncInterval() const override;
+  void AddVsyncTimestamp(uint64_t timestamp) override;
+  VsyncStatistics GetStatistics() const override { return statistics_; }
+
+  // The estimated interval, without rounding to whole nanoseconds.
+  double interval() const { return interval_; }
+
+ private:
+  // Discards the estimated phase, and if possible the interval, after losing
+  // track of the vsync timing.
+  void Resync(uint64_t timestamp);
+
+  // The time of a predicted vsync, and the predicted interval.
+  double phase_;
+  double interval_;
+  const double nominal_interval_;
+
+  bool has_timestamp_ = false;
+  uint64_t last_timestamp_ = 0;
+  uint32_t consecutive_rejected_count_ = 0;
+  VsyncStatistics statistics_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(MeasuredVsyncSource);
+};
+
+}  // namespace scene_manager
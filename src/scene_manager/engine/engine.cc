@@ -4,6 +4,9 @@
 
 #include "apps/mozart/src/scene_manager/engine/engine.h"
 
+#include <magenta/syscalls.h>
+
+#include <algorithm>
 #include <set>
 
 #include "apps/mozart/src/scene_manager/engine/frame_scheduler.h"
@@ -14,9 +17,14 @@
 #include "apps/tracing/lib/trace/event.h"
 #include "escher/renderer/paper_renderer.h"
 #include "lib/ftl/functional/make_copyable.h"
+#include "lib/mtl/tasks/message_loop.h"
 
 namespace scene_manager {
 
+constexpr uint64_t Engine::kDefaultSessionUpdateBudget;
+constexpr uint64_t Engine::kDefaultSessionCommandCost;
+constexpr uint32_t Engine::kMaxConsecutiveSessionDeferrals;
+
 Engine::Engine(DisplayManager* display_manager,
                escher::Escher* escher,
                std::unique_ptr<escher::VulkanSwapchain> swapchain)
@@ -28,34 +36,89 @@ Engine::Engine(DisplayManager* display_manager,
           escher->gpu_allocator())),
       rounded_rect_factory_(
           std::make_unique<escher::RoundedRectFactory>(escher)),
+      rounded_rect_mesh_cache_(std::make_unique<RoundedRectMeshCache>(
+          rounded_rect_factory_.get())),
       release_fence_signaller_(std::make_unique<ReleaseFenceSignaller>(
           escher->command_buffer_sequencer())),
       swapchain_(std::move(swapchain)),
-      session_count_(0) {
+      resource_reaper_(Display::kNominalVsyncIntervalNanos),
+      session_count_(0),
+      weak_factory_(this) {
   FTL_DCHECK(display_manager_);
   FTL_DCHECK(escher_);
   FTL_DCHECK(swapchain_);
 
-  InitializeFrameScheduler();
+  InitializeFrameScheduler(nullptr);
   paper_renderer_->set_sort_by_pipeline(false);
 }
 
 Engine::Engine(DisplayManager* display_manager,
-               std::unique_ptr<ReleaseFenceSignaller> release_fence_signaller)
+               std::unique_ptr<ReleaseFenceSignaller> release_fence_signaller,
+               std::unique_ptr<FrameTimer> frame_timer)
     : display_manager_(display_manager),
       escher_(nullptr),
-      release_fence_signaller_(std::move(release_fence_signaller)) {
+      release_fence_signaller_(std::move(release_fence_signaller)),
+      resource_reaper_(Display::kNominalVsyncIntervalNanos),
+      weak_factory_(this) {
   FTL_DCHECK(display_manager_);
 
-  InitializeFrameScheduler();
+  InitializeFrameScheduler(std::move(frame_timer));
+}
+
+Engine::~Engine() {
+  if (upload_thread_) {
+    upload_thread_->TaskRunner()->PostTask(
+        []() { mtl::MessageLoop::GetCurrent()->QuitNow(); });
+    upload_thread_->Join();
+  }
+  // Every |fill| has finished, so the uploads can be abandoned safely, while
+  // the resources they hold can still be destroyed.
+  pending_uploads_.clear();
+}
+
+void Engine::PostUpload(ftl::RefPtr<Session> session,
+                        ftl::Closure fill,
+                        ftl::Closure submit) {
+  if (!upload_thread_) {
+    upload_thread_ = std::make_unique<mtl::Thread>();
+    upload_thread_->Run();
+  }
+  const uint64_t upload_id = next_upload_id_++;
+  pending_uploads_[upload_id] = {std::move(session), std::move(submit)};
+  upload_thread_->TaskRunner()->PostTask([
+    fill = std::move(fill), weak = weak_factory_.GetWeakPtr(), upload_id,
+    reply_runner = mtl::MessageLoop::GetCurrent()->task_runner()
+  ] {
+    fill();
+    reply_runner->PostTask([weak, upload_id] {
+      if (weak)
+        weak->OnUploadFilled(upload_id);
+    });
+  });
+}
+
+void Engine::OnUploadFilled(uint64_t upload_id) {
+  auto it = pending_uploads_.find(upload_id);
+  FTL_DCHECK(it != pending_uploads_.end());
+  PendingUpload upload = std::move(it->second);
+  pending_uploads_.erase(it);
+  upload.submit();
 }
 
-Engine::~Engine() = default;
+AcquireFenceWaiter* Engine::acquire_fence_waiter() {
+  if (!acquire_fence_waiter_) {
+    acquire_fence_waiter_ = std::make_unique<AcquireFenceWaiter>();
+  }
+  return acquire_fence_waiter_.get();
+}
 
-void Engine::InitializeFrameScheduler() {
+void Engine::InitializeFrameScheduler(
+    std::unique_ptr<FrameTimer> frame_timer) {
   if (display_manager_->default_display()) {
-    frame_scheduler_ =
-        std::make_unique<FrameScheduler>(display_manager_->default_display());
+    frame_scheduler_ = std::make_unique<FrameScheduler>(
+        display_manager_->default_display(),
+        frame_timer ? std::move(frame_timer)
+                    : std::make_unique<RealFrameTimer>());
     frame_scheduler_->set_delegate(this);
   }
 }
@@ -74,13 +137,12 @@ void Engine::ImportResource(ImportPtr import,
                             const mx::eventpair& endpoint) {
   // The import is not captured in the OnImportResolvedCallback because we don't
   // want the reference in the bind to prevent the import from being collected.
-  // However, when the import dies, its handle is collected which will cause the
-  // resource to expire within the resource linker. In that case, we will never
-  // receive the callback with |ResolutionResult::kSuccess|.
+  // Resolution may be deferred until the ResourceLinker's batch ends, by which
+  // time the import may have been released, so only a weak pointer is bound.
   ResourceLinker::OnImportResolvedCallback import_resolved_callback =
       std::bind(&Engine::OnImportResolvedForResource,  // method
                 this,                                  // target
-                import.get(),  // the import that will be resolved by the linker
+                import->GetWeakPtr(),  // the import that will be resolved
                 std::placeholders::_1,  // the acutal object to link to import
                 std::placeholders::_2   // result of the linking
       );
@@ -88,11 +150,12 @@ void Engine::ImportResource(ImportPtr import,
 }
 
 void Engine::OnImportResolvedForResource(
-    Import* import,
+    ftl::WeakPtr<Import> import,
     ResourcePtr actual,
     ResourceLinker::ResolutionResult resolution_result) {
-  if (resolution_result == ResourceLinker::ResolutionResult::kSuccess) {
-    actual->AddImport(import);
+  if (import &&
+      resolution_result == ResourceLinker::ResolutionResult::kSuccess) {
+    actual->AddImport(import.get());
   }
 }
 
@@ -115,6 +178,13 @@ void Engine::ScheduleUpdate(uint64_t presentation_time) {
   }
 }
 
+std::vector<FuturePresentation> Engine::GetFuturePresentations(
+    size_t count) const {
+  if (!frame_scheduler_)
+    return std::vector<FuturePresentation>();
+  return frame_scheduler_->GetFuturePresentations(count);
+}
+
 void Engine::CreateSession(
     ::fidl::InterfaceRequest<mozart2::Session> request,
     ::fidl::InterfaceHandle<mozart2::SessionListener> listener) {
@@ -164,14 +234,38 @@ void Engine::RenderFrame(uint64_t presentation_time,
   TRACE_DURATION("gfx", "RenderFrame", "time", presentation_time, "interval",
                  presentation_interval);
 
+  FrameTimings timings;
+  timings.presentation_time = presentation_time;
+
+  uint64_t start_time = mx_time_get(MX_CLOCK_MONOTONIC);
   if (!ApplyScheduledSessionUpdates(presentation_time, presentation_interval))
     return;
+  uint64_t apply_end_time = mx_time_get(MX_CLOCK_MONOTONIC);
+  timings.apply_duration = apply_end_time - start_time;
 
   UpdateAndDeliverMetrics(presentation_time);
+  uint64_t traversal_end_time = mx_time_get(MX_CLOCK_MONOTONIC);
+  timings.traversal_duration = traversal_end_time - apply_end_time;
 
   for (auto& compositor : compositors_) {
     compositor->DrawFrame(paper_renderer_.get());
   }
+  timings.render_duration =
+      mx_time_get(MX_CLOCK_MONOTONIC) - traversal_end_time;
+
+  ++frame_statistics_.frame_count;
+  frame_statistics_.total.apply_duration += timings.apply_duration;
+  frame_statistics_.total.traversal_duration += timings.traversal_duration;
+  frame_statistics_.total.render_duration += timings.render_duration;
+  frame_statistics_.max.apply_duration =
+      std::max(frame_statistics_.max.apply_duration, timings.apply_duration);
+  frame_statistics_.max.traversal_duration = std::max(
+      frame_statistics_.max.traversal_duration, timings.traversal_duration);
+  frame_statistics_.max.render_duration =
+      std::max(frame_statistics_.max.render_duration, timings.render_duration);
+
+  if (frame_timings_callback_)
+    frame_timings_callback_(timings);
 }
 
 bool Engine::ApplyScheduledSessionUpdates(uint64_t presentation_time,
@@ -179,20 +273,88 @@ bool Engine::ApplyScheduledSessionUpdates(uint64_t presentation_time,
   TRACE_DURATION("gfx", "ApplyScheduledSessionUpdates", "time",
                  presentation_time, "interval", presentation_interval);
 
+  // Gather the sessions with due updates, each once, and apply those of
+  // higher priority first; sessions of the same priority keep the order of
+  // their requested presentation times.
   bool needs_render = false;
+  std::vector<SessionUpdate> due_updates;
   while (!updatable_sessions_.empty() &&
          updatable_sessions_.top().first <= presentation_time) {
-    auto session = std::move(updatable_sessions_.top().second);
+    SessionUpdate update = updatable_sessions_.top();
     updatable_sessions_.pop();
-    if (session) {
-      needs_render |= session->ApplyScheduledUpdates(presentation_time,
-                                                     presentation_interval);
-    } else {
+    if (!update.second) {
       // Corresponds to a call to ScheduleUpdate(), which always triggers a
       // render.
       needs_render = true;
+    } else if (std::none_of(due_updates.begin(), due_updates.end(),
+                            [&update](const SessionUpdate& other) {
+                              return other.second == update.second;
+                            })) {
+      due_updates.push_back(std::move(update));
     }
   }
+  std::stable_sort(due_updates.begin(), due_updates.end(),
+                   [](const SessionUpdate& a, const SessionUpdate& b) {
+                     return a.second->priority() < b.second->priority();
+                   });
+
+  // Imports and exports made by the updates are resolved in a single pass,
+  // once all of them have been applied.
+  resource_linker_.BeginBatch();
+
+  // The time spent is measured with the FrameScheduler's timer, but is never
+  // taken to be less than the estimated cost of the updates applied so far.
+  FrameTimer* timer = frame_scheduler_ && session_update_budget_
+                          ? frame_scheduler_->timer()
+                          : nullptr;
+  const uint64_t start_time = timer ? timer->Now() : 0u;
+  uint64_t estimated_time = 0;
+  size_t applied_count = 0;
+  std::vector<SessionUpdate> deferred_updates;
+  for (auto& update : due_updates) {
+    Session* session = update.second.get();
+    if (timer) {
+      const uint64_t cost =
+          session->GetDueCommandCount(presentation_time) *
+          session_command_cost_;
+      const uint64_t spent =
+          std::max(timer->Now() - start_time, estimated_time);
+      if (session->priority() != mozart2::SessionPriority::SYSTEM &&
+          session->consecutive_deferral_count() <
+              kMaxConsecutiveSessionDeferrals &&
+          cost > session_update_budget_ -
+                     std::min(spent, session_update_budget_)) {
+        deferred_updates.push_back(std::move(update));
+        continue;
+      }
+      estimated_time = spent + cost;
+    }
+    needs_render |=
+        session->ApplyScheduledUpdates(presentation_time, presentation_interval);
+    ++applied_count;
+  }
+
+  // Deferring the updates of a frame which would otherwise apply none would
+  // only delay them, without making them any cheaper.
+  if (applied_count == 0 && !deferred_updates.empty()) {
+    needs_render |= deferred_updates.front().second->ApplyScheduledUpdates(
+        presentation_time, presentation_interval);
+    deferred_updates.erase(deferred_updates.begin());
+  }
+
+  // Put off all of each deferred session's due updates, so that each is still
+  // applied atomically.
+  for (auto& update : deferred_updates) {
+    update.second->RecordDeferral();
+    updatable_sessions_.push(std::move(update));
+  }
+
+  resource_linker_.EndBatch();
+
+  if (!deferred_updates.empty()) {
+    // Request the next frame, for which the deferred updates are due.
+    frame_scheduler_->RequestFrame(presentation_time + 1);
+  }
   return needs_render;
 }
 
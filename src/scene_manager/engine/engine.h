@@ -4,7 +4,10 @@
 
 #pragma once
 
+#include <functional>
 #include <set>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "escher/escher.h"
@@ -14,12 +17,18 @@
 #include "lib/escher/escher/renderer/simple_image_factory.h"
 #include "lib/escher/escher/shape/rounded_rect_factory.h"
 
+#include "apps/mozart/src/scene_manager/acquire_fence_set.h"
 #include "apps/mozart/src/scene_manager/displays/display_manager.h"
 #include "apps/mozart/src/scene_manager/engine/frame_scheduler.h"
+#include "apps/mozart/src/scene_manager/engine/resource_reaper.h"
+#include "apps/mozart/src/scene_manager/engine/rounded_rect_mesh_cache.h"
 #include "apps/mozart/src/scene_manager/release_fence_signaller.h"
 #include "apps/mozart/src/scene_manager/resources/import.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/scene.h"
 #include "apps/mozart/src/scene_manager/resources/resource_linker.h"
+#include "lib/ftl/functional/closure.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "lib/mtl/threading/thread.h"
 
 namespace scene_manager {
 
@@ -77,10 +86,33 @@ class Engine : private FrameSchedulerDelegate {
     return rounded_rect_factory_.get();
   }
 
+  // Shares rounded-rectangle meshes between sessions.  Null if there is no
+  // RoundedRectFactory.
+  RoundedRectMeshCache* rounded_rect_mesh_cache() {
+    return rounded_rect_mesh_cache_.get();
+  }
+
   ReleaseFenceSignaller* release_fence_signaller() {
     return release_fence_signaller_.get();
   }
 
+  // Destroys the resources of torn-down sessions in the background.
+  ResourceReaper* resource_reaper() { return &resource_reaper_; }
+
+  // Runs |fill| on a background thread, which copies the pixels of ImagePipe
+  // frames into upload buffers away from the render thread, and then |submit|
+  // on this thread.  Both may use the resources of |session|, which is kept
+  // alive until |submit| has run.  If the Engine is destroyed first, it waits
+  // for |fill| to finish, and destroys |submit| without running it.  The
+  // thread is started on first use.
+  void PostUpload(ftl::RefPtr<Session> session,
+                  ftl::Closure fill,
+                  ftl::Closure submit);
+
+  // Waits for the acquire fences of every session's Present() calls.  Created
+  // on first use.
+  AcquireFenceWaiter* acquire_fence_waiter();
+
   // Tell the FrameScheduler to schedule a frame, and remember the Session so
   // that we can tell it to apply updates when the FrameScheduler notifies us
   // via OnPrepareFrame().
@@ -92,6 +124,11 @@ class Engine : private FrameSchedulerDelegate {
   // a new Image to present.
   void ScheduleUpdate(uint64_t presentation_time);
 
+  // Predicts the next |count| presentation times for Session updates.  Empty
+  // if there is no FrameScheduler, in which case updates are applied
+  // immediately.
+  std::vector<FuturePresentation> GetFuturePresentations(size_t count) const;
+
   void CreateSession(
       ::fidl::InterfaceRequest<mozart2::Session> request,
       ::fidl::InterfaceHandle<mozart2::SessionListener> listener);
@@ -104,10 +141,70 @@ class Engine : private FrameSchedulerDelegate {
   void AddCompositor(Compositor* compositor);
   void RemoveCompositor(Compositor* compositor);
 
+  // Durations of the phases of a single frame, in nanoseconds.
+  struct FrameTimings {
+    uint64_t presentation_time = 0;
+    // Applying scheduled session updates.
+    uint64_t apply_duration = 0;
+    // Traversing the scene graph to update and deliver metrics.
+    uint64_t traversal_duration = 0;
+    // Drawing all compositors.
+    uint64_t render_duration = 0;
+  };
+  using FrameTimingsCallback = std::function<void(const FrameTimings&)>;
+
+  // Cumulative timings of every frame rendered so far.
+  struct FrameStatistics {
+    uint64_t frame_count = 0;
+    FrameTimings total;
+    FrameTimings max;
+  };
+  const FrameStatistics& frame_statistics() const { return frame_statistics_; }
+
+  // Set a callback which is invoked after every frame in which session updates
+  // were applied.  Used by tools such as scene_manager_replay.
+  void SetFrameTimingsCallback(FrameTimingsCallback callback) {
+    frame_timings_callback_ = std::move(callback);
+  }
+
+  // The CPU time which may be spent applying session updates in one frame,
+  // in nanoseconds, or zero for no limit.  Updates are applied in order of
+  // session priority.  The due updates of a FOREGROUND or BACKGROUND session
+  // whose estimated cost exceeds what remains of the budget are deferred
+  // whole to the next frame, but never for more than
+  // |kMaxConsecutiveSessionDeferrals| frames in a row, and never when no
+  // other session's updates are applied in the frame.  SYSTEM sessions are
+  // never deferred, and nor is anything without a FrameScheduler.
+  void set_session_update_budget(uint64_t budget) {
+    session_update_budget_ = budget;
+  }
+  uint64_t session_update_budget() const { return session_update_budget_; }
+
+  // The estimated time to apply one command, in nanoseconds.  A session's due
+  // updates are estimated to cost this much per command which they contain.
+  void set_session_command_cost(uint64_t cost) { session_command_cost_ = cost; }
+  uint64_t session_command_cost() const { return session_command_cost_; }
+
+  static constexpr uint64_t kDefaultSessionUpdateBudget = 2'000'000;  // 2ms
+  static constexpr uint64_t kDefaultSessionCommandCost = 1'000;       // 1us
+  static constexpr uint32_t kMaxConsecutiveSessionDeferrals = 4;
+
+  // If non-empty, the Enqueue()/Present() stream of each subsequently created
+  // session is recorded to a file in this directory.  See SessionRecorder.
+  void set_session_recording_directory(std::string directory) {
+    session_recording_directory_ = std::move(directory);
+  }
+  const std::string& session_recording_directory() const {
+    return session_recording_directory_;
+  }
+
  protected:
-  // Only used by subclasses used in testing.
+  // Only used by subclasses used in testing.  If |frame_timer| is provided,
+  // the FrameScheduler of the default display runs on it, rather than on the
+  // real clock.
   Engine(DisplayManager* display_manager,
-         std::unique_ptr<ReleaseFenceSignaller> release_fence_signaller);
+         std::unique_ptr<ReleaseFenceSignaller> release_fence_signaller,
+         std::unique_ptr<FrameTimer> frame_timer = nullptr);
 
  private:
   friend class SessionHandler;
@@ -126,16 +223,20 @@ class Engine : private FrameSchedulerDelegate {
   void RenderFrame(uint64_t presentation_time,
                    uint64_t presentation_interval) override;
 
-  // Returns true if rendering is needed.
+  // Returns true if rendering is needed.  See set_session_update_budget().
   bool ApplyScheduledSessionUpdates(uint64_t presentation_time,
                                     uint64_t presentation_interval);
 
   void OnImportResolvedForResource(
-      Import* import,
+      ftl::WeakPtr<Import> import,
       ResourcePtr actual,
       ResourceLinker::ResolutionResult resolution_result);
 
-  void InitializeFrameScheduler();
+  void InitializeFrameScheduler(std::unique_ptr<FrameTimer> frame_timer);
+
+  // Submits the upload identified by |upload_id|, once its upload buffer has
+  // been filled.
+  void OnUploadFilled(uint64_t upload_id);
 
   // Update and deliver metrics for all nodes which subscribe to metrics events.
   void UpdateAndDeliverMetrics(uint64_t presentation_time);
@@ -150,14 +251,25 @@ class Engine : private FrameSchedulerDelegate {
   escher::Escher* const escher_;
   escher::PaperRendererPtr paper_renderer_;
 
-  ResourceLinker resource_linker_;
   std::unique_ptr<escher::SimpleImageFactory> image_factory_;
   std::unique_ptr<escher::RoundedRectFactory> rounded_rect_factory_;
+  std::unique_ptr<RoundedRectMeshCache> rounded_rect_mesh_cache_;
   std::unique_ptr<ReleaseFenceSignaller> release_fence_signaller_;
   std::unique_ptr<FrameScheduler> frame_scheduler_;
   std::unique_ptr<escher::VulkanSwapchain> swapchain_;
   std::set<Compositor*> compositors_;
 
+  // Declared before |sessions_|, whose pending updates use it.
+  std::unique_ptr<AcquireFenceWaiter> acquire_fence_waiter_;
+
+  // Declared after everything that resources depend upon, so that its
+  // destructor can finish reaping them, and before everything that can own
+  // resources, whose nodes hand their children to it when destroyed.
+  ResourceReaper resource_reaper_;
+
+  // Retains exported resources, which may outlive their sessions.
+  ResourceLinker resource_linker_;
+
   // Map of all the sessions.
   std::unordered_map<SessionId, std::unique_ptr<SessionHandler>> sessions_;
   std::atomic<size_t> session_count_;
@@ -165,9 +277,30 @@ class Engine : private FrameSchedulerDelegate {
 
   // Lists all Session that have updates to apply, sorted by the earliest
   // requested presentation time of each update.
-  std::priority_queue<std::pair<uint64_t, ftl::RefPtr<Session>>>
+  using SessionUpdate = std::pair<uint64_t, ftl::RefPtr<Session>>;
+  std::priority_queue<SessionUpdate,
+                      std::vector<SessionUpdate>,
+                      std::greater<SessionUpdate>>
       updatable_sessions_;
 
+  FrameTimingsCallback frame_timings_callback_;
+  FrameStatistics frame_statistics_;
+  uint64_t session_update_budget_ = kDefaultSessionUpdateBudget;
+  uint64_t session_command_cost_ = kDefaultSessionCommandCost;
+  std::string session_recording_directory_;
+  std::unique_ptr<mtl::Thread> upload_thread_;
+
+  // The uploads whose |fill| has been posted to |upload_thread_|, but whose
+  // |submit| has not yet run, by upload id.
+  struct PendingUpload {
+    ftl::RefPtr<Session> session;
+    ftl::Closure submit;
+  };
+  std::unordered_map<uint64_t, PendingUpload> pending_uploads_;
+  uint64_t next_upload_id_ = 1u;
+
+  ftl::WeakPtrFactory<Engine> weak_factory_;  // must be last
+
   FTL_DISALLOW_COPY_AND_ASSIGN(Engine);
 };
 
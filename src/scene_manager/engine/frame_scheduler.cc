@@ -4,11 +4,10 @@
 
 #include "apps/mozart/src/scene_manager/engine/frame_scheduler.h"
 
-#include <magenta/syscalls.h>
+#include <algorithm>
 
 #include "apps/mozart/src/scene_manager/displays/display.h"
 #include "ftl/logging.h"
-#include "lib/mtl/tasks/message_loop.h"
 
 namespace scene_manager {
 
@@ -16,9 +15,17 @@ namespace scene_manager {
 // TODO: more sophisticated prediction.
 constexpr uint64_t kPredictedFrameRenderTime = 4'000'000;  // 4ms
 
+constexpr size_t FrameScheduler::kMaxFuturePresentationCount;
+
 FrameScheduler::FrameScheduler(Display* display)
-    : task_runner_(mtl::MessageLoop::GetCurrent()->task_runner().get()),
-      display_(display) {}
+    : FrameScheduler(display, std::make_unique<RealFrameTimer>()) {}
+
+FrameScheduler::FrameScheduler(Display* display,
+                               std::unique_ptr<FrameTimer> timer)
+    : timer_(std::move(timer)), display_(display) {
+  FTL_DCHECK(timer_);
+  FTL_DCHECK(display_);
+}
 
 FrameScheduler::~FrameScheduler() {}
 
@@ -35,7 +42,7 @@ uint64_t FrameScheduler::ComputeTargetPresentationTime(uint64_t now) const {
 
   // Compute the time that the content would ideally appear on screen: the next
   // Vsync at or after the requested time.
-  const uint64_t last_vsync = display_->GetLastVsyncTime();
+  const uint64_t last_vsync = display_->GetLastVsyncTime(now);
   const uint64_t vsync_interval = display_->GetVsyncInterval();
   const uint64_t requested_time = requested_presentation_times_.top();
   uint64_t target_time = 0;  // computed below.
@@ -79,9 +86,31 @@ uint64_t FrameScheduler::ComputeTargetPresentationTime(uint64_t now) const {
   return target_time;
 }
 
+std::vector<FuturePresentation> FrameScheduler::GetFuturePresentations(
+    size_t count) const {
+  const uint64_t now = timer_->Now();
+  const uint64_t vsync_interval = display_->GetVsyncInterval();
+
+  // As in ComputeTargetPresentationTime(), a Vsync can be targeted only if
+  // there is enough time left to render the frame.
+  uint64_t presentation_time = display_->GetLastVsyncTime(now) + vsync_interval;
+  while (presentation_time < now + kPredictedFrameRenderTime ||
+         presentation_time <= last_presentation_time_) {
+    presentation_time += vsync_interval;
+  }
+
+  std::vector<FuturePresentation> presentations;
+  presentations.reserve(std::min(count, kMaxFuturePresentationCount));
+  for (size_t i = 0; i < count && i < kMaxFuturePresentationCount; ++i) {
+    presentations.push_back(
+        {presentation_time, presentation_time - kPredictedFrameRenderTime});
+    presentation_time += vsync_interval;
+  }
+  return presentations;
+}
+
 void FrameScheduler::MaybeScheduleFrame() {
-  uint64_t target_time =
-      ComputeTargetPresentationTime(mx_time_get(MX_CLOCK_MONOTONIC));
+  uint64_t target_time = ComputeTargetPresentationTime(timer_->Now());
   if (target_time <= last_presentation_time_) {
     FTL_DCHECK(target_time == last_presentation_time_);
     return;
@@ -90,11 +119,8 @@ void FrameScheduler::MaybeScheduleFrame() {
   // Set the next presentation time to our target, and post a task early enough
   // that we can render and present the resulting image on time.
   next_presentation_time_ = target_time;
-  auto time_to_start_rendering =
-      ftl::TimePoint::FromEpochDelta(ftl::TimeDelta::FromNanoseconds(
-          next_presentation_time_ - kPredictedFrameRenderTime));
-  task_runner_->PostTaskForTime([this] { MaybeRenderFrame(); },
-                                time_to_start_rendering);
+  timer_->PostTaskForTime([this] { MaybeRenderFrame(); },
+                          next_presentation_time_ - kPredictedFrameRenderTime);
 }
 
 void FrameScheduler::MaybeRenderFrame() {
@@ -4,14 +4,14 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
 #include <queue>
+#include <vector>
 
+#include "apps/mozart/src/scene_manager/engine/frame_timer.h"
 #include "ftl/macros.h"
 
-namespace ftl {
-class TaskRunner;
-}  // namespace ftl
-
 namespace mozart2 {
 class Metrics;
 }  // namespace mozart2
@@ -38,6 +38,13 @@ class FrameSchedulerDelegate {
                            uint64_t presentation_interval) = 0;
 };
 
+// A time at which a frame is predicted to be presented, and the latest time
+// at which an update can be scheduled to appear in that frame.
+struct FuturePresentation {
+  uint64_t presentation_time;
+  uint64_t latch_point;
+};
+
 // The FrameScheduler is responsible for scheduling frames to be drawn in
 // response to requests from clients.  When a frame is requested, the
 // FrameScheduler will decide at which Vsync the frame should be displayed at.
@@ -46,13 +53,25 @@ class FrameSchedulerDelegate {
 // example, if the requested time is earlier than the time that rendering would
 // finish, were it started immediately, then the frame will be scheduled for a
 // later Vsync.
+//
+// The FrameScheduler obtains the time, and waits, through a FrameTimer.  With
+// a VirtualFrameTimer, and a Display with a SimulatedVsyncSource, it runs in
+// virtual time: scheduling can then be tested or benchmarked over thousands
+// of frames, with the delegate advancing the timer to simulate rendering.
 class FrameScheduler {
  public:
+  // Uses the real clock and the current message loop.
   explicit FrameScheduler(Display* display);
+  FrameScheduler(Display* display, std::unique_ptr<FrameTimer> timer);
   ~FrameScheduler();
 
   void set_delegate(FrameSchedulerDelegate* delegate) { delegate_ = delegate; }
 
+  // The timer through which the FrameScheduler obtains the time.  The
+  // delegate also times its work per frame with it, so that it too runs in
+  // virtual time under a VirtualFrameTimer.
+  FrameTimer* timer() const { return timer_.get(); }
+
   // Request a frame to be scheduled at or after |presentation_time|, which
   // may be in the past.
   void RequestFrame(uint64_t presentation_time);
@@ -62,6 +81,15 @@ class FrameScheduler {
   // to be scheduled.
   uint64_t ComputeTargetPresentationTime(uint64_t now) const;
 
+  // The most presentation times that GetFuturePresentations() predicts.
+  static constexpr size_t kMaxFuturePresentationCount = 16;
+
+  // Predicts the next |count| vsyncs for which a frame has not yet been
+  // rendered, and could still be rendered in time if an update was requested
+  // now.  The latch point of each is the time at which rendering that frame is
+  // expected to start.
+  std::vector<FuturePresentation> GetFuturePresentations(size_t count) const;
+
  private:
   // Update the global scene and then draw it... maybe.  There are multiple
   // reasons why this might not happen.  For example, the swapchain might apply
@@ -79,12 +107,14 @@ class FrameScheduler {
   // render a frame.
   bool TooMuchBackPressure();
 
-  ftl::TaskRunner* const task_runner_;
-  FrameSchedulerDelegate* delegate_;
+  const std::unique_ptr<FrameTimer> timer_;
+  FrameSchedulerDelegate* delegate_ = nullptr;
 
   uint64_t last_presentation_time_ = 0;
   uint64_t next_presentation_time_ = 0;
-  std::priority_queue<uint64_t> requested_presentation_times_;
+  // The earliest requested time is at the top.
+  std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>>
+      requested_presentation_times_;
 
   Display* const display_;
 
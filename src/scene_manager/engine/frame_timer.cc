@@ -0,0 +1,70 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/engine/frame_timer.h"
+
+#include <magenta/syscalls.h>
+
+#include <algorithm>
+
+#include "lib/ftl/logging.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace scene_manager {
+
+RealFrameTimer::RealFrameTimer()
+    : task_runner_(mtl::MessageLoop::GetCurrent()->task_runner().get()) {}
+
+RealFrameTimer::~RealFrameTimer() = default;
+
+uint64_t RealFrameTimer::Now() {
+  return mx_time_get(MX_CLOCK_MONOTONIC);
+}
+
+void RealFrameTimer::PostTaskForTime(ftl::Closure task, uint64_t target_time) {
+  task_runner_->PostTaskForTime(
+      std::move(task), ftl::TimePoint::FromEpochDelta(
+                           ftl::TimeDelta::FromNanoseconds(target_time)));
+}
+
+VirtualFrameTimer::VirtualFrameTimer(uint64_t start_time) : now_(start_time) {}
+
+VirtualFrameTimer::~VirtualFrameTimer() = default;
+
+uint64_t VirtualFrameTimer::Now() {
+  return now_;
+}
+
+void VirtualFrameTimer::PostTaskForTime(ftl::Closure task,
+                                        uint64_t target_time) {
+  tasks_.emplace(target_time, std::move(task));
+}
+
+void VirtualFrameTimer::Advance(uint64_t duration) {
+  now_ += duration;
+}
+
+bool VirtualFrameTimer::RunNextTask() {
+  if (tasks_.empty())
+    return false;
+
+  auto it = tasks_.begin();
+  now_ = std::max(now_, it->first);
+  ftl::Closure task = std::move(it->second);
+  tasks_.erase(it);
+  task();
+  return true;
+}
+
+size_t VirtualFrameTimer::RunUntil(uint64_t end_time) {
+  size_t task_count = 0;
+  while (!tasks_.empty() && tasks_.begin()->first <= end_time) {
+    RunNextTask();
+    ++task_count;
+  }
+  now_ = std::max(now_, end_time);
+  return task_count;
+}
+
+}  // namespace scene_manager
@@ -0,0 +1,81 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stddef.h>
+#include <cstdint>
+#include <map>
+
+#include "lib/ftl/functional/closure.h"
+#include "lib/ftl/macros.h"
+
+namespace ftl {
+class TaskRunner;
+}  // namespace ftl
+
+namespace scene_manager {
+
+// Provides the current time to the FrameScheduler, and runs its tasks at the
+// times it asks for.  Times are in nanoseconds.
+class FrameTimer {
+ public:
+  virtual ~FrameTimer() = default;
+
+  virtual uint64_t Now() = 0;
+
+  // Runs |task| at |target_time|, or as soon as possible if that has passed.
+  virtual void PostTaskForTime(ftl::Closure task, uint64_t target_time) = 0;
+};
+
+// Uses the monotonic clock, and posts tasks to the current message loop.
+class RealFrameTimer : public FrameTimer {
+ public:
+  RealFrameTimer();
+  ~RealFrameTimer() override;
+
+  uint64_t Now() override;
+  void PostTaskForTime(ftl::Closure task, uint64_t target_time) override;
+
+ private:
+  ftl::TaskRunner* const task_runner_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(RealFrameTimer);
+};
+
+// Simulates the passing of time, so that scheduling can be tested and
+// benchmarked deterministically over many frames, without waiting.  Time only
+// moves when the owner advances it, either explicitly, for example to account
+// for a simulated render, or by running the next posted task.
+class VirtualFrameTimer : public FrameTimer {
+ public:
+  explicit VirtualFrameTimer(uint64_t start_time = 0);
+  ~VirtualFrameTimer() override;
+
+  uint64_t Now() override;
+  void PostTaskForTime(ftl::Closure task, uint64_t target_time) override;
+
+  // Moves the time forward by |duration|, without running any tasks.
+  void Advance(uint64_t duration);
+
+  // Moves the time forward to that of the earliest posted task, if it is in
+  // the future, and runs that task.  Returns false if there was none.
+  bool RunNextTask();
+
+  // Runs the posted tasks in order until the next one is later than
+  // |end_time|, then moves the time forward to |end_time|.  Returns the
+  // number of tasks run.
+  size_t RunUntil(uint64_t end_time);
+
+  size_t pending_task_count() const { return tasks_.size(); }
+
+ private:
+  uint64_t now_;
+  // Tasks posted for the same time run in the order they were posted.
+  std::multimap<uint64_t, ftl::Closure> tasks_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(VirtualFrameTimer);
+};
+
+}  // namespace scene_manager
@@ -4,6 +4,7 @@
 
 #include "apps/mozart/src/scene_manager/engine/hit_tester.h"
 
+#include "apps/mozart/src/scene_manager/resources/nodes/clip_node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/traversal.h"
 #include "lib/ftl/logging.h"
 
@@ -82,6 +83,13 @@ void HitTester::AccumulateHitsLocal(Node* node) {
 }
 
 void HitTester::AccumulateHitsInner(Node* node) {
+  // Clip nodes only define a region; they have no content of their own.
+  if (node->IsKindOf<ClipNode>())
+    return;
+
+  if (node->clip() && !IsRayWithinClipInner(node, ray_info_->ray))
+    return;
+
   if (node->clip_to_self() && !IsRayWithinPartsInner(node, ray_info_->ray))
     return;
 
@@ -100,6 +108,19 @@ bool HitTester::IsRayWithinPartsInner(Node* node, const escher::ray4& ray) {
   });
 }
 
+bool HitTester::IsRayWithinClipInner(Node* node, const escher::ray4& ray) {
+  // A clip node which is not part of the scene has no effect.
+  ClipNode* clip = node->clip().get();
+  if (!clip->IsRooted())
+    return true;
+
+  // Map the ray into the coordinate system of the clip node's parent.
+  escher::mat4 node_to_clip_parent =
+      glm::inverse(clip->parent()->GetGlobalTransform()) *
+      node->GetGlobalTransform();
+  return IsRayWithinClippedContentOuter(clip, node_to_clip_parent * ray);
+}
+
 bool HitTester::IsRayWithinClippedContentOuter(Node* node,
                                                const escher::ray4& ray) {
   if (node->transform().IsIdentity()) {
@@ -114,6 +135,10 @@ bool HitTester::IsRayWithinClippedContentOuter(Node* node,
 
 bool HitTester::IsRayWithinClippedContentInner(Node* node,
                                                const escher::ray4& ray) {
+  // Use the region which the clip node has cached.
+  if (node->IsKindOf<ClipNode>())
+    return static_cast<ClipNode*>(node)->IsRayWithinRegion(ray);
+
   float distance;
   if (node->GetIntersection(ray, &distance))
     return true;
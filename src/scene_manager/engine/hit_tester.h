@@ -69,6 +69,10 @@ class HitTester {
   // |ray| must be in the node's local coordinate system.
   static bool IsRayWithinPartsInner(Node* node, const escher::ray4& ray);
 
+  // Returns true if the ray passes through the region of the node's clip
+  // node.  |ray| must be in the node's local coordinate system.
+  static bool IsRayWithinClipInner(Node* node, const escher::ray4& ray);
+
   // Returns true if the ray passes through the node's clipped content.
   // |ray| must be in the parent's local coordinate system.
   //
@@ -0,0 +1,151 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/engine/resource_reaper.h"
+
+#include <magenta/syscalls.h>
+
+#include "apps/mozart/src/scene_manager/engine/session.h"
+#include "apps/tracing/lib/trace/event.h"
+#include "lib/ftl/logging.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace scene_manager {
+
+namespace {
+
+// Reading the clock after every release would dominate the cost of releasing
+// small resources, so the deadline is only checked periodically.
+constexpr size_t kResourcesPerDeadlineCheck = 32;
+
+}  // namespace
+
+ResourceReaper::ResourceReaper(uint64_t step_interval, uint64_t step_budget)
+    : step_interval_(step_interval),
+      step_budget_(step_budget),
+      weak_factory_(this) {}
+
+ResourceReaper::~ResourceReaper() {
+  ReapUntil(UINT64_MAX);
+}
+
+void ResourceReaper::Reap(SessionPtr session,
+                          std::vector<ResourcePtr> resources) {
+  FTL_DCHECK(session);
+  FTL_DCHECK(!session->is_valid());
+  FTL_DCHECK(!FindJob(session.get()));
+
+  TRACE_ASYNC_BEGIN("gfx", "SessionTearDown", session->id(), "session_id",
+                    session->id(), "resource_count", resources.size());
+
+  Job job;
+  job.session = std::move(session);
+  job.resources = std::move(resources);
+  job.start_time = mx_time_get(MX_CLOCK_MONOTONIC);
+  jobs_.push_back(std::move(job));
+
+  if (!mtl::MessageLoop::GetCurrent()) {
+    // If this is called by a resource destructor, the caller's ReapUntil()
+    // will pick up the new job.
+    if (!reaping_)
+      ReapUntil(UINT64_MAX);
+    return;
+  }
+  ScheduleStep();
+}
+
+void ResourceReaper::Defer(ResourcePtr resource) {
+  FTL_DCHECK(resource);
+  Job* job = FindJob(resource->session());
+  if (!job) {
+    // The session's job has already finished; this happens when a resource
+    // outlived the rest of its session, such as an exported resource which
+    // was retained by the ResourceLinker.
+    Reap(SessionPtr(resource->session()), {std::move(resource)});
+    return;
+  }
+  job->resources.push_back(std::move(resource));
+}
+
+bool ResourceReaper::ReapUntil(uint64_t deadline) {
+  FTL_DCHECK(!reaping_);
+  reaping_ = true;
+  bool done = ReapJobsUntil(deadline);
+  reaping_ = false;
+  return done;
+}
+
+bool ResourceReaper::ReapJobsUntil(uint64_t deadline) {
+  size_t released_since_check = 0;
+  while (!jobs_.empty()) {
+    // References to deque elements remain valid when resource destructors
+    // call Defer() or Reap(), which only append.
+    Job* job = &jobs_.front();
+    while (!job->resources.empty()) {
+      if (++released_since_check == kResourcesPerDeadlineCheck) {
+        released_since_check = 0;
+        if (mx_time_get(MX_CLOCK_MONOTONIC) >= deadline)
+          return false;
+      }
+
+      // Remove the resource from the list before releasing it, since its
+      // destructor may add more resources to the list.
+      ResourcePtr resource = std::move(job->resources.back());
+      job->resources.pop_back();
+      resource = nullptr;
+      ++job->destroyed_resource_count;
+    }
+    FinishJob(job);
+    jobs_.pop_front();
+  }
+  return true;
+}
+
+ResourceReaper::Job* ResourceReaper::FindJob(Session* session) {
+  for (auto& job : jobs_) {
+    if (job.session.get() == session)
+      return &job;
+  }
+  return nullptr;
+}
+
+void ResourceReaper::FinishJob(Job* job) {
+  uint64_t duration = mx_time_get(MX_CLOCK_MONOTONIC) - job->start_time;
+  TRACE_ASYNC_END("gfx", "SessionTearDown", job->session->id(), "duration",
+                  duration, "destroyed_resource_count",
+                  job->destroyed_resource_count);
+  // TODO(MZ-134): Resources which are retained by the ResourceLinker outlive
+  // their session.  Fix that bug and turn this log into an assertion.
+  if (job->session->GetTotalResourceCount() != 0) {
+    job->session->error_reporter()->ERROR()
+        << "ResourceReaper: Not all resources of session "
+        << job->session->id() << " have been collected. See MZ-134.";
+  }
+  FTL_VLOG(1) << "ResourceReaper: destroyed " << job->destroyed_resource_count
+              << " resources of session " << job->session->id() << " in "
+              << duration / 1000 << "us";
+}
+
+void ResourceReaper::ScheduleStep() {
+  if (step_scheduled_ || jobs_.empty())
+    return;
+  step_scheduled_ = true;
+
+  auto weak = weak_factory_.GetWeakPtr();
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [weak] {
+        if (weak)
+          weak->Step();
+      },
+      ftl::TimeDelta::FromNanoseconds(step_interval_));
+}
+
+void ResourceReaper::Step() {
+  TRACE_DURATION("gfx", "ResourceReaper::Step");
+  step_scheduled_ = false;
+  ReapUntil(mx_time_get(MX_CLOCK_MONOTONIC) + step_budget_);
+  ScheduleStep();
+}
+
+}  // namespace scene_manager
@@ -0,0 +1,82 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "apps/mozart/src/scene_manager/resources/resource.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+
+namespace scene_manager {
+
+class Session;
+using SessionPtr = ::ftl::RefPtr<Session>;
+
+// Destroys the resources of torn-down sessions incrementally, so that the
+// death of a session with a very large number of resources does not stall
+// rendering for every other session.
+//
+// Resources are released in steps which are spread out by |step_interval|
+// (typically one frame), and each of which runs for at most |step_budget|.
+// Nodes which are destroyed while their session is being reaped hand their
+// children and parts back to the reaper instead of destroying them
+// recursively, so that no single release does an unbounded amount of work.
+class ResourceReaper {
+ public:
+  static constexpr uint64_t kDefaultStepBudget = 2'000'000;  // 2ms
+
+  ResourceReaper(uint64_t step_interval,
+                 uint64_t step_budget = kDefaultStepBudget);
+
+  // Synchronously destroys any resources which have not yet been reaped.
+  ~ResourceReaper();
+
+  // Takes ownership of |resources|, all of which must belong to |session|.
+  // The session is kept alive until they have all been destroyed.
+  //
+  // If there is no message loop on the current thread, the resources are
+  // destroyed synchronously.
+  void Reap(SessionPtr session, std::vector<ResourcePtr> resources);
+
+  // Adds a resource to the job of its session, which must have been passed to
+  // Reap().  Used by resources which are destroyed while being reaped.
+  void Defer(ResourcePtr resource);
+
+  // Destroys resources until all have been destroyed, or until |deadline| has
+  // passed.  Returns true if there is nothing left to destroy.
+  bool ReapUntil(uint64_t deadline);
+
+  bool is_idle() const { return jobs_.empty(); }
+
+ private:
+  struct Job {
+    SessionPtr session;
+    std::vector<ResourcePtr> resources;
+    uint64_t start_time;
+    size_t destroyed_resource_count = 0;
+  };
+
+  bool ReapJobsUntil(uint64_t deadline);
+  Job* FindJob(Session* session);
+  void FinishJob(Job* job);
+  void ScheduleStep();
+  void Step();
+
+  const uint64_t step_interval_;
+  const uint64_t step_budget_;
+
+  // Processed in order; only the front job's resources are being destroyed.
+  std::deque<Job> jobs_;
+  bool step_scheduled_ = false;
+  bool reaping_ = false;
+
+  ftl::WeakPtrFactory<ResourceReaper> weak_factory_;  // must be last
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ResourceReaper);
+};
+
+}  // namespace scene_manager
@@ -0,0 +1,115 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/engine/rounded_rect_mesh_cache.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "apps/tracing/lib/trace/event.h"
+
+namespace scene_manager {
+
+namespace {
+
+uint32_t Quantize(float value, float scale) {
+  return static_cast<uint32_t>(std::max(
+      0.f, std::round(value / scale * RoundedRectMeshCache::kQuantization)));
+}
+
+float Dequantize(uint32_t value) {
+  return static_cast<float>(value) / RoundedRectMeshCache::kQuantization;
+}
+
+}  // namespace
+
+bool RoundedRectMeshCache::Key::operator==(const Key& other) const {
+  return width == other.width && height == other.height &&
+         top_left_radius == other.top_left_radius &&
+         top_right_radius == other.top_right_radius &&
+         bottom_right_radius == other.bottom_right_radius &&
+         bottom_left_radius == other.bottom_left_radius;
+}
+
+size_t RoundedRectMeshCache::KeyHash::operator()(const Key& key) const {
+  size_t hash = 0;
+  for (uint32_t value :
+       {key.width, key.height, key.top_left_radius, key.top_right_radius,
+        key.bottom_right_radius, key.bottom_left_radius}) {
+    hash = hash * 31 + value;
+  }
+  return hash;
+}
+
+RoundedRectMeshCache::RoundedRectMeshCache(
+    escher::RoundedRectFactory* factory,
+    size_t max_unused_count)
+    : factory_(factory), max_unused_count_(max_unused_count) {
+  FTL_DCHECK(factory_);
+}
+
+RoundedRectMeshCache::~RoundedRectMeshCache() = default;
+
+escher::MeshPtr RoundedRectMeshCache::GetMesh(
+    const escher::RoundedRectSpec& spec,
+    float* scale_out) {
+  float scale = std::max(spec.width, spec.height);
+  if (!(scale > 0.f)) {
+    scale = 1.f;
+  }
+  *scale_out = scale;
+
+  const Key key{Quantize(spec.width, scale),
+                Quantize(spec.height, scale),
+                Quantize(spec.top_left_radius, scale),
+                Quantize(spec.top_right_radius, scale),
+                Quantize(spec.bottom_right_radius, scale),
+                Quantize(spec.bottom_left_radius, scale)};
+
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    ++hit_count_;
+    lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+  } else {
+    ++miss_count_;
+    escher::RoundedRectSpec unit_spec(
+        Dequantize(key.width), Dequantize(key.height),
+        Dequantize(key.top_left_radius), Dequantize(key.top_right_radius),
+        Dequantize(key.bottom_right_radius),
+        Dequantize(key.bottom_left_radius));
+    escher::MeshSpec mesh_spec{escher::MeshAttribute::kPosition |
+                               escher::MeshAttribute::kUV};
+    auto mesh = factory_->NewRoundedRect(unit_spec, mesh_spec);
+    EvictUnusedMeshes();
+    lru_.push_front(key);
+    it = entries_.emplace(key, Entry{std::move(mesh), lru_.begin()}).first;
+  }
+
+  TRACE_COUNTER("gfx", "RoundedRectMeshCache", 0u, "hits", hit_count_,
+                "misses", miss_count_, "meshes", entries_.size());
+  return it->second.mesh;
+}
+
+void RoundedRectMeshCache::EvictUnusedMeshes() {
+  // A mesh which only the cache refers to is unused.
+  size_t unused_count = 0;
+  for (const auto& pair : entries_) {
+    if (pair.second.mesh->HasOneRef())
+      ++unused_count;
+  }
+
+  auto position = lru_.end();
+  while (unused_count > max_unused_count_ && position != lru_.begin()) {
+    --position;
+    auto it = entries_.find(*position);
+    FTL_DCHECK(it != entries_.end());
+    if (!it->second.mesh->HasOneRef())
+      continue;
+    entries_.erase(it);
+    position = lru_.erase(position);
+    --unused_count;
+  }
+}
+
+}  // namespace scene_manager
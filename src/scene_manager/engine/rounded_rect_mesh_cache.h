@@ -0,0 +1,84 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+
+#include "escher/shape/mesh.h"
+#include "escher/shape/rounded_rect.h"
+#include "escher/shape/rounded_rect_factory.h"
+#include "lib/ftl/macros.h"
+
+namespace scene_manager {
+
+// Shares rounded-rectangle meshes between the shapes which need them, rather
+// than tessellating a new mesh for each.
+//
+// Meshes are made for rectangles scaled so that their larger dimension is 1,
+// and shapes scale them back up when they are drawn; rectangles which differ
+// only in size therefore share a mesh.  The scaled dimensions and radii are
+// quantized to 1/|kQuantization|, which keeps the error below a quarter of a
+// pixel for rectangles up to 2048 pixels across.
+//
+// Meshes which are no longer used by any shape are kept, in case they are
+// needed again, until there are more than |max_unused_count| of them; then
+// the least recently used are released.
+class RoundedRectMeshCache {
+ public:
+  static constexpr uint32_t kQuantization = 4096;
+
+  RoundedRectMeshCache(escher::RoundedRectFactory* factory,
+                       size_t max_unused_count = 256);
+  ~RoundedRectMeshCache();
+
+  // Returns a mesh of |spec| scaled down by |*scale_out|, which must be
+  // applied to the mesh to draw it at the size of |spec|.  The mesh has
+  // positions and UV coordinates.
+  escher::MeshPtr GetMesh(const escher::RoundedRectSpec& spec,
+                          float* scale_out);
+
+  size_t mesh_count() const { return entries_.size(); }
+  uint64_t hit_count() const { return hit_count_; }
+  uint64_t miss_count() const { return miss_count_; }
+
+ private:
+  struct Key {
+    uint32_t width;
+    uint32_t height;
+    uint32_t top_left_radius;
+    uint32_t top_right_radius;
+    uint32_t bottom_right_radius;
+    uint32_t bottom_left_radius;
+
+    bool operator==(const Key& other) const;
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  struct Entry {
+    escher::MeshPtr mesh;
+    // Position in |lru_|.
+    std::list<Key>::iterator lru_position;
+  };
+
+  // Releases the least recently used meshes which are not used by any shape,
+  // until at most |max_unused_count_| remain.
+  void EvictUnusedMeshes();
+
+  escher::RoundedRectFactory* const factory_;
+  const size_t max_unused_count_;
+  std::unordered_map<Key, Entry, KeyHash> entries_;
+  // Most recently used first.
+  std::list<Key> lru_;
+  uint64_t hit_count_ = 0;
+  uint64_t miss_count_ = 0;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(RoundedRectMeshCache);
+};
+
+}  // namespace scene_manager
@@ -4,7 +4,10 @@
 
 #include "apps/mozart/src/scene_manager/engine/session.h"
 
+#include <algorithm>
+
 #include "apps/mozart/src/scene_manager/engine/hit_tester.h"
+#include "apps/mozart/src/scene_manager/engine/session_command.h"
 #include "apps/mozart/src/scene_manager/print_op.h"
 #include "apps/mozart/src/scene_manager/resources/camera.h"
 #include "apps/mozart/src/scene_manager/resources/compositor/display_compositor.h"
@@ -15,7 +18,9 @@
 #include "apps/mozart/src/scene_manager/resources/image.h"
 #include "apps/mozart/src/scene_manager/resources/image_pipe.h"
 #include "apps/mozart/src/scene_manager/resources/image_pipe_handler.h"
+#include "apps/mozart/src/scene_manager/resources/import.h"
 #include "apps/mozart/src/scene_manager/resources/lights/directional_light.h"
+#include "apps/mozart/src/scene_manager/resources/nodes/clip_node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/entity_node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/scene.h"
@@ -28,24 +33,15 @@
 #include "apps/mozart/src/scene_manager/util/wrap.h"
 #include "apps/tracing/lib/trace/event.h"
 
+#include "escher/material/material.h"
 #include "escher/renderer/paper_renderer.h"
 #include "escher/shape/mesh.h"
 #include "escher/shape/rounded_rect_factory.h"
 
 namespace scene_manager {
 
-namespace {
-
-// Makes it convenient to check that a value is constant and of a specific type,
-// or a variable.
-// TODO: There should also be a convenient way of type-checking a variable;
-// this will necessarily involve looking up the value in the ResourceMap.
-constexpr std::array<mozart2::Value::Tag, 2> kFloatValueTypes{
-    {mozart2::Value::Tag::VECTOR1, mozart2::Value::Tag::VARIABLE_ID}};
-constexpr std::array<mozart2::Value::Tag, 2> kVec3ValueTypes{
-    {mozart2::Value::Tag::VECTOR3, mozart2::Value::Tag::VARIABLE_ID}};
-
-}  // anonymous namespace
+constexpr uint64_t Session::kBackgroundVsyncDivisor;
+constexpr uint64_t Session::kMaxUpdateInterval;
 
 Session::Session(SessionId id, Engine* engine, ErrorReporter* error_reporter)
     : id_(id),
@@ -60,80 +56,87 @@ Session::~Session() {
   FTL_DCHECK(!is_valid_);
 }
 
-bool Session::ApplyOp(const mozart2::OpPtr& op) {
-  switch (op->which()) {
+bool Session::ApplyOp(mozart2::OpPtr op) {
+  SessionCommand command;
+  return DecodeOp(std::move(op), &command, error_reporter()) &&
+         ApplyCommand(&command);
+}
+
+bool Session::ApplyCommand(SessionCommand* command) {
+  const mozart::ResourceId* ids = command->ids;
+  switch (command->tag) {
     case mozart2::Op::Tag::CREATE_RESOURCE:
-      return ApplyCreateResourceOp(op->get_create_resource());
+      return ApplyCreateResourceOp(command->op->get_create_resource());
     case mozart2::Op::Tag::RELEASE_RESOURCE:
-      return ApplyReleaseResourceOp(op->get_release_resource());
+      return ApplyReleaseResourceOp(ids[0]);
     case mozart2::Op::Tag::EXPORT_RESOURCE:
-      return ApplyExportResourceOp(op->get_export_resource());
+      return ApplyExportResourceOp(command->op->get_export_resource());
     case mozart2::Op::Tag::IMPORT_RESOURCE:
-      return ApplyImportResourceOp(op->get_import_resource());
+      return ApplyImportResourceOp(command->op->get_import_resource());
     case mozart2::Op::Tag::ADD_CHILD:
-      return ApplyAddChildOp(op->get_add_child());
+      return ApplyAddChildOp(ids[0], ids[1]);
     case mozart2::Op::Tag::ADD_PART:
-      return ApplyAddPartOp(op->get_add_part());
+      return ApplyAddPartOp(ids[0], ids[1]);
     case mozart2::Op::Tag::DETACH:
-      return ApplyDetachOp(op->get_detach());
+      return ApplyDetachOp(ids[0]);
     case mozart2::Op::Tag::DETACH_CHILDREN:
-      return ApplyDetachChildrenOp(op->get_detach_children());
+      return ApplyDetachChildrenOp(ids[0]);
     case mozart2::Op::Tag::SET_TAG:
-      return ApplySetTagOp(op->get_set_tag());
+      return ApplySetTagOp(ids[0], command->value);
     case mozart2::Op::Tag::SET_TRANSLATION:
-      return ApplySetTranslationOp(op->get_set_translation());
+      return ApplySetTranslationOp(ids[0], escher::vec3(command->vector));
     case mozart2::Op::Tag::SET_SCALE:
-      return ApplySetScaleOp(op->get_set_scale());
+      return ApplySetScaleOp(ids[0], escher::vec3(command->vector));
     case mozart2::Op::Tag::SET_ROTATION:
-      return ApplySetRotationOp(op->get_set_rotation());
+      return ApplySetRotationOp(
+          ids[0], escher::quat(command->vector.w, command->vector.x,
+                               command->vector.y, command->vector.z));
     case mozart2::Op::Tag::SET_ANCHOR:
-      return ApplySetAnchorOp(op->get_set_anchor());
+      return ApplySetAnchorOp(ids[0], escher::vec3(command->vector));
     case mozart2::Op::Tag::SET_SIZE:
-      return ApplySetSizeOp(op->get_set_size());
+      return ApplySetSizeOp(ids[0], escher::vec2(command->vector));
     case mozart2::Op::Tag::SET_SHAPE:
-      return ApplySetShapeOp(op->get_set_shape());
+      return ApplySetShapeOp(ids[0], ids[1]);
     case mozart2::Op::Tag::SET_MATERIAL:
-      return ApplySetMaterialOp(op->get_set_material());
+      return ApplySetMaterialOp(ids[0], ids[1]);
     case mozart2::Op::Tag::SET_CLIP:
-      return ApplySetClipOp(op->get_set_clip());
+      return ApplySetClipOp(ids[0], ids[1], command->value != 0);
     case mozart2::Op::Tag::SET_HIT_TEST_BEHAVIOR:
-      return ApplySetHitTestBehaviorOp(op->get_set_hit_test_behavior());
+      return ApplySetHitTestBehaviorOp(
+          ids[0], static_cast<mozart2::HitTestBehavior>(command->value));
     case mozart2::Op::Tag::SET_CAMERA:
-      return ApplySetCameraOp(op->get_set_camera());
+      return ApplySetCameraOp(ids[0], ids[1]);
     case mozart2::Op::Tag::SET_CAMERA_PROJECTION:
-      return ApplySetCameraProjectionOp(op->get_set_camera_projection());
+      return ApplySetCameraProjectionOp(
+          command->op->get_set_camera_projection());
     case mozart2::Op::Tag::SET_LIGHT_INTENSITY:
-      return ApplySetLightIntensityOp(op->get_set_light_intensity());
+      return ApplySetLightIntensityOp(ids[0], command->vector.x);
     case mozart2::Op::Tag::SET_TEXTURE:
-      return ApplySetTextureOp(op->get_set_texture());
+      return ApplySetTextureOp(ids[0], ids[1]);
     case mozart2::Op::Tag::SET_COLOR:
-      return ApplySetColorOp(op->get_set_color());
+      return ApplySetColorOp(ids[0], command->vector);
     case mozart2::Op::Tag::ADD_LAYER:
-      return ApplyAddLayerOp(op->get_add_layer());
+      return ApplyAddLayerOp(ids[0], ids[1]);
     case mozart2::Op::Tag::SET_LAYER_STACK:
-      return ApplySetLayerStackOp(op->get_set_layer_stack());
+      return ApplySetLayerStackOp(ids[0], ids[1]);
     case mozart2::Op::Tag::SET_RENDERER:
-      return ApplySetRendererOp(op->get_set_renderer());
+      return ApplySetRendererOp(ids[0], ids[1]);
     case mozart2::Op::Tag::SET_EVENT_MASK:
-      return ApplySetEventMaskOp(op->get_set_event_mask());
+      return ApplySetEventMaskOp(ids[0], command->value);
     case mozart2::Op::Tag::SET_LABEL:
-      return ApplySetLabelOp(op->get_set_label());
+      return ApplySetLabelOp(command->op->get_set_label());
+    case mozart2::Op::Tag::INVALIDATE_IMAGE:
+      return ApplyInvalidateImageOp(command->op->get_invalidate_image());
     case mozart2::Op::Tag::__UNKNOWN__:
-      // FIDL validation should make this impossible.
+      // DecodeOp() makes this impossible.
       FTL_CHECK(false);
       return false;
   }
 }
 
 bool Session::ApplyCreateResourceOp(const mozart2::CreateResourceOpPtr& op) {
+  // The ID was checked by DecodeOp().
   const mozart::ResourceId id = op->id;
-  if (id == 0) {
-    error_reporter_->ERROR()
-        << "scene_manager::Session::ApplyCreateResourceOp(): invalid ID: "
-        << op;
-    return false;
-  }
-
   switch (op->resource->which()) {
     case mozart2::Resource::Tag::MEMORY:
       return ApplyCreateMemory(id, op->resource->get_memory());
@@ -188,8 +191,8 @@ bool Session::ApplyCreateResourceOp(const mozart2::CreateResourceOpPtr& op) {
   }
 }
 
-bool Session::ApplyReleaseResourceOp(const mozart2::ReleaseResourceOpPtr& op) {
-  return resources_.RemoveResource(op->id);
+bool Session::ApplyReleaseResourceOp(mozart::ResourceId id) {
+  return resources_.RemoveResource(id);
 }
 
 bool Session::ApplyExportResourceOp(const mozart2::ExportResourceOpPtr& op) {
@@ -206,112 +209,92 @@ bool Session::ApplyImportResourceOp(const mozart2::ImportResourceOpPtr& op) {
   return resources_.AddResource(op->id, std::move(import));
 }
 
-bool Session::ApplyAddChildOp(const mozart2::AddChildOpPtr& op) {
+bool Session::ApplyAddChildOp(mozart::ResourceId node_id,
+                              mozart::ResourceId child_id) {
   // Find the parent and child nodes.
-  if (auto parent_node = resources_.FindResource<Node>(op->node_id)) {
-    if (auto child_node = resources_.FindResource<Node>(op->child_id)) {
+  if (auto parent_node = resources_.FindResource<Node>(node_id)) {
+    if (auto child_node = resources_.FindResource<Node>(child_id)) {
       return parent_node->AddChild(std::move(child_node));
     }
   }
   return false;
 }
 
-bool Session::ApplyAddPartOp(const mozart2::AddPartOpPtr& op) {
+bool Session::ApplyAddPartOp(mozart::ResourceId node_id,
+                             mozart::ResourceId part_id) {
   // Find the parent and part nodes.
-  if (auto parent_node = resources_.FindResource<Node>(op->node_id)) {
-    if (auto part_node = resources_.FindResource<Node>(op->part_id)) {
+  if (auto parent_node = resources_.FindResource<Node>(node_id)) {
+    if (auto part_node = resources_.FindResource<Node>(part_id)) {
       return parent_node->AddPart(std::move(part_node));
     }
   }
   return false;
 }
 
-bool Session::ApplyDetachOp(const mozart2::DetachOpPtr& op) {
-  if (auto resource = resources_.FindResource<Resource>(op->id)) {
+bool Session::ApplyDetachOp(mozart::ResourceId id) {
+  if (auto resource = resources_.FindResource<Resource>(id)) {
     return resource->Detach();
   }
   return false;
 }
 
-bool Session::ApplyDetachChildrenOp(const mozart2::DetachChildrenOpPtr& op) {
-  if (auto node = resources_.FindResource<Node>(op->node_id)) {
+bool Session::ApplyDetachChildrenOp(mozart::ResourceId node_id) {
+  if (auto node = resources_.FindResource<Node>(node_id)) {
     return node->DetachChildren();
   }
   return false;
 }
 
-bool Session::ApplySetTagOp(const mozart2::SetTagOpPtr& op) {
-  if (auto node = resources_.FindResource<Node>(op->node_id)) {
-    return node->SetTagValue(op->tag_value);
+bool Session::ApplySetTagOp(mozart::ResourceId node_id, uint32_t tag_value) {
+  if (auto node = resources_.FindResource<Node>(node_id)) {
+    return node->SetTagValue(tag_value);
   }
   return false;
 }
 
-bool Session::ApplySetTranslationOp(const mozart2::SetTranslationOpPtr& op) {
-  if (auto node = resources_.FindResource<Node>(op->id)) {
-    if (IsVariable(op->value)) {
-      error_reporter_->ERROR()
-          << "scene_manager::Session::ApplySetTranslationOp(): "
-             "unimplemented for variable value.";
-      return false;
-    }
-    return node->SetTranslation(UnwrapVector3(op->value));
+bool Session::ApplySetTranslationOp(mozart::ResourceId id,
+                                    const escher::vec3& translation) {
+  if (auto node = resources_.FindResource<Node>(id)) {
+    return node->SetTranslation(translation);
   }
   return false;
 }
 
-bool Session::ApplySetScaleOp(const mozart2::SetScaleOpPtr& op) {
-  if (auto node = resources_.FindResource<Node>(op->id)) {
-    if (IsVariable(op->value)) {
-      error_reporter_->ERROR() << "scene_manager::Session::ApplySetScaleOp(): "
-                                  "unimplemented for variable value.";
-      return false;
-    }
-    return node->SetScale(UnwrapVector3(op->value));
+bool Session::ApplySetScaleOp(mozart::ResourceId id,
+                              const escher::vec3& scale) {
+  if (auto node = resources_.FindResource<Node>(id)) {
+    return node->SetScale(scale);
   }
   return false;
 }
 
-bool Session::ApplySetRotationOp(const mozart2::SetRotationOpPtr& op) {
-  if (auto node = resources_.FindResource<Node>(op->id)) {
-    if (IsVariable(op->value)) {
-      error_reporter_->ERROR()
-          << "scene_manager::Session::ApplySetRotationOp(): "
-             "unimplemented for variable value.";
-      return false;
-    }
-    return node->SetRotation(UnwrapQuaternion(op->value));
+bool Session::ApplySetRotationOp(mozart::ResourceId id,
+                                 const escher::quat& rotation) {
+  if (auto node = resources_.FindResource<Node>(id)) {
+    return node->SetRotation(rotation);
   }
   return false;
 }
 
-bool Session::ApplySetAnchorOp(const mozart2::SetAnchorOpPtr& op) {
-  if (auto node = resources_.FindResource<Node>(op->id)) {
-    if (IsVariable(op->value)) {
-      error_reporter_->ERROR() << "scene_manager::Session::ApplySetAnchorOp(): "
-                                  "unimplemented for variable value.";
-      return false;
-    }
-    return node->SetAnchor(UnwrapVector3(op->value));
+bool Session::ApplySetAnchorOp(mozart::ResourceId id,
+                               const escher::vec3& anchor) {
+  if (auto node = resources_.FindResource<Node>(id)) {
+    return node->SetAnchor(anchor);
   }
   return false;
 }
 
-bool Session::ApplySetSizeOp(const mozart2::SetSizeOpPtr& op) {
-  if (auto layer = resources_.FindResource<Layer>(op->id)) {
-    if (IsVariable(op->value)) {
-      error_reporter_->ERROR() << "scene_manager::Session::ApplySetSizeOp(): "
-                                  "unimplemented for variable value.";
-      return false;
-    }
-    return layer->SetSize(UnwrapVector2(op->value));
+bool Session::ApplySetSizeOp(mozart::ResourceId id, const escher::vec2& size) {
+  if (auto layer = resources_.FindResource<Layer>(id)) {
+    return layer->SetSize(size);
   }
   return false;
 }
 
-bool Session::ApplySetShapeOp(const mozart2::SetShapeOpPtr& op) {
-  if (auto node = resources_.FindResource<ShapeNode>(op->node_id)) {
-    if (auto shape = resources_.FindResource<Shape>(op->shape_id)) {
+bool Session::ApplySetShapeOp(mozart::ResourceId node_id,
+                              mozart::ResourceId shape_id) {
+  if (auto node = resources_.FindResource<ShapeNode>(node_id)) {
+    if (auto shape = resources_.FindResource<Shape>(shape_id)) {
       node->SetShape(std::move(shape));
       return true;
     }
@@ -319,9 +302,10 @@ bool Session::ApplySetShapeOp(const mozart2::SetShapeOpPtr& op) {
   return false;
 }
 
-bool Session::ApplySetMaterialOp(const mozart2::SetMaterialOpPtr& op) {
-  if (auto node = resources_.FindResource<ShapeNode>(op->node_id)) {
-    if (auto material = resources_.FindResource<Material>(op->material_id)) {
+bool Session::ApplySetMaterialOp(mozart::ResourceId node_id,
+                                 mozart::ResourceId material_id) {
+  if (auto node = resources_.FindResource<ShapeNode>(node_id)) {
+    if (auto material = resources_.FindResource<Material>(material_id)) {
       node->SetMaterial(std::move(material));
       return true;
     }
@@ -329,37 +313,39 @@ bool Session::ApplySetMaterialOp(const mozart2::SetMaterialOpPtr& op) {
   return false;
 }
 
-bool Session::ApplySetClipOp(const mozart2::SetClipOpPtr& op) {
-  if (op->clip_id != 0) {
-    // TODO(MZ-167): Support non-zero clip_id.
-    error_reporter_->ERROR()
-        << "scene_manager::Session::ApplySetClipOp(): only "
-           "clip_to_self is implemented.";
-    return false;
-  }
-
-  if (auto node = resources_.FindResource<Node>(op->node_id)) {
-    return node->SetClipToSelf(op->clip_to_self);
+bool Session::ApplySetClipOp(mozart::ResourceId node_id,
+                             mozart::ResourceId clip_id,
+                             bool clip_to_self) {
+  if (auto node = resources_.FindResource<Node>(node_id)) {
+    ClipNodePtr clip;
+    if (clip_id) {
+      clip = resources_.FindResource<ClipNode>(clip_id);
+      if (!clip)
+        return false;
+    }
+    return node->SetClip(std::move(clip)) && node->SetClipToSelf(clip_to_self);
   }
 
   return false;
 }
 
 bool Session::ApplySetHitTestBehaviorOp(
-    const mozart2::SetHitTestBehaviorOpPtr& op) {
-  if (auto node = resources_.FindResource<Node>(op->node_id)) {
-    return node->SetHitTestBehavior(op->hit_test_behavior);
+    mozart::ResourceId node_id,
+    mozart2::HitTestBehavior hit_test_behavior) {
+  if (auto node = resources_.FindResource<Node>(node_id)) {
+    return node->SetHitTestBehavior(hit_test_behavior);
   }
 
   return false;
 }
 
-bool Session::ApplySetCameraOp(const mozart2::SetCameraOpPtr& op) {
-  if (auto renderer = resources_.FindResource<Renderer>(op->renderer_id)) {
-    if (op->camera_id == 0) {
+bool Session::ApplySetCameraOp(mozart::ResourceId renderer_id,
+                               mozart::ResourceId camera_id) {
+  if (auto renderer = resources_.FindResource<Renderer>(renderer_id)) {
+    if (camera_id == 0) {
       renderer->SetCamera(nullptr);
       return true;
-    } else if (auto camera = resources_.FindResource<Camera>(op->camera_id)) {
+    } else if (auto camera = resources_.FindResource<Camera>(camera_id)) {
       renderer->SetCamera(std::move(camera));
       return true;
     }
@@ -367,13 +353,13 @@ bool Session::ApplySetCameraOp(const mozart2::SetCameraOpPtr& op) {
   return false;
 }
 
-bool Session::ApplySetTextureOp(const mozart2::SetTextureOpPtr& op) {
-  if (auto material = resources_.FindResource<Material>(op->material_id)) {
-    if (op->texture_id == 0) {
+bool Session::ApplySetTextureOp(mozart::ResourceId material_id,
+                                mozart::ResourceId texture_id) {
+  if (auto material = resources_.FindResource<Material>(material_id)) {
+    if (texture_id == 0) {
       material->SetTexture(nullptr);
       return true;
-    } else if (auto image =
-                   resources_.FindResource<ImageBase>(op->texture_id)) {
+    } else if (auto image = resources_.FindResource<ImageBase>(texture_id)) {
       material->SetTexture(std::move(image));
       return true;
     }
@@ -381,46 +367,39 @@ bool Session::ApplySetTextureOp(const mozart2::SetTextureOpPtr& op) {
   return false;
 }
 
-bool Session::ApplySetColorOp(const mozart2::SetColorOpPtr& op) {
-  if (auto material = resources_.FindResource<Material>(op->material_id)) {
-    if (IsVariable(op->color)) {
-      error_reporter_->ERROR() << "scene_manager::Session::ApplySetColorOp(): "
-                                  "unimplemented for variable color.";
-      return false;
-    }
-
-    auto& color = op->color->value;
-    float red = static_cast<float>(color->red) / 255.f;
-    float green = static_cast<float>(color->green) / 255.f;
-    float blue = static_cast<float>(color->blue) / 255.f;
-    float alpha = static_cast<float>(color->alpha) / 255.f;
-    material->SetColor(red, green, blue, alpha);
+bool Session::ApplySetColorOp(mozart::ResourceId material_id,
+                              const escher::vec4& color) {
+  if (auto material = resources_.FindResource<Material>(material_id)) {
+    material->SetColor(color.r, color.g, color.b, color.a);
     return true;
   }
   return false;
 }
 
-bool Session::ApplyAddLayerOp(const mozart2::AddLayerOpPtr& op) {
-  auto layer_stack = resources_.FindResource<LayerStack>(op->layer_stack_id);
-  auto layer = resources_.FindResource<Layer>(op->layer_id);
+bool Session::ApplyAddLayerOp(mozart::ResourceId layer_stack_id,
+                              mozart::ResourceId layer_id) {
+  auto layer_stack = resources_.FindResource<LayerStack>(layer_stack_id);
+  auto layer = resources_.FindResource<Layer>(layer_id);
   if (layer_stack && layer) {
     return layer_stack->AddLayer(std::move(layer));
   }
   return false;
 }
 
-bool Session::ApplySetLayerStackOp(const mozart2::SetLayerStackOpPtr& op) {
-  auto compositor = resources_.FindResource<Compositor>(op->compositor_id);
-  auto layer_stack = resources_.FindResource<LayerStack>(op->layer_stack_id);
+bool Session::ApplySetLayerStackOp(mozart::ResourceId compositor_id,
+                                   mozart::ResourceId layer_stack_id) {
+  auto compositor = resources_.FindResource<Compositor>(compositor_id);
+  auto layer_stack = resources_.FindResource<LayerStack>(layer_stack_id);
   if (compositor && layer_stack) {
     return compositor->SetLayerStack(std::move(layer_stack));
   }
   return false;
 }
 
-bool Session::ApplySetRendererOp(const mozart2::SetRendererOpPtr& op) {
-  auto layer = resources_.FindResource<Layer>(op->layer_id);
-  auto renderer = resources_.FindResource<Renderer>(op->renderer_id);
+bool Session::ApplySetRendererOp(mozart::ResourceId layer_id,
+                                 mozart::ResourceId renderer_id) {
+  auto layer = resources_.FindResource<Layer>(layer_id);
+  auto renderer = resources_.FindResource<Renderer>(renderer_id);
 
   if (layer && renderer) {
     return layer->SetRenderer(std::move(renderer));
@@ -428,23 +407,17 @@ bool Session::ApplySetRendererOp(const mozart2::SetRendererOpPtr& op) {
   return false;
 }
 
-bool Session::ApplySetEventMaskOp(const mozart2::SetEventMaskOpPtr& op) {
-  if (auto r = resources_.FindResource<Resource>(op->id)) {
-    return r->SetEventMask(op->event_mask);
+bool Session::ApplySetEventMaskOp(mozart::ResourceId id, uint32_t event_mask) {
+  if (auto r = resources_.FindResource<Resource>(id)) {
+    return r->SetEventMask(event_mask);
   }
   return false;
 }
 
 bool Session::ApplySetCameraProjectionOp(
     const mozart2::SetCameraProjectionOpPtr& op) {
-  // TODO(MZ-123): support variables.
-  if (IsVariable(op->eye_position) || IsVariable(op->eye_look_at) ||
-      IsVariable(op->eye_up) || IsVariable(op->fovy)) {
-    error_reporter_->ERROR()
-        << "scene_manager::Session::ApplySetCameraProjectionOp(): "
-           "unimplemented: variable properties.";
-    return false;
-  } else if (auto camera = resources_.FindResource<Camera>(op->camera_id)) {
+  // Variable properties were rejected by DecodeOp().
+  if (auto camera = resources_.FindResource<Camera>(op->camera_id)) {
     camera->SetProjection(UnwrapVector3(op->eye_position),
                           UnwrapVector3(op->eye_look_at),
                           UnwrapVector3(op->eye_up), UnwrapFloat(op->fovy));
@@ -453,22 +426,10 @@ bool Session::ApplySetCameraProjectionOp(
   return false;
 }
 
-bool Session::ApplySetLightIntensityOp(
-    const mozart2::SetLightIntensityOpPtr& op) {
-  // TODO(MZ-123): support variables.
-  if (IsVariable(op->intensity)) {
-    error_reporter_->ERROR()
-        << "scene_manager::Session::ApplySetLightIntensityOp(): "
-           "unimplemented: variable intensity.";
-    return false;
-  } else if (!IsFloat(op->intensity)) {
-    error_reporter_->ERROR()
-        << "scene_manager::Session::ApplySetLightIntensityOp(): "
-           "intensity is not a float.";
-    return false;
-  } else if (auto light =
-                 resources_.FindResource<DirectionalLight>(op->light_id)) {
-    light->set_intensity(op->intensity->get_vector1());
+bool Session::ApplySetLightIntensityOp(mozart::ResourceId light_id,
+                                       float intensity) {
+  if (auto light = resources_.FindResource<DirectionalLight>(light_id)) {
+    light->set_intensity(intensity);
     return true;
   }
   return false;
@@ -481,6 +442,28 @@ bool Session::ApplySetLabelOp(const mozart2::SetLabelOpPtr& op) {
   return false;
 }
 
+bool Session::ApplyInvalidateImageOp(
+    const mozart2::InvalidateImageOpPtr& op) {
+  if (auto image = resources_.FindResource<Image>(op->image_id)) {
+    if (op->dirty_rects.size() == 0) {
+      image->InvalidateAll();
+      return true;
+    }
+    for (const auto& rect : op->dirty_rects) {
+      if (!image->Invalidate({rect->x, rect->y, rect->width, rect->height})) {
+        error_reporter_->ERROR()
+            << "scene_manager::Session::ApplyInvalidateImageOp(): rect ("
+            << rect->x << ", " << rect->y << ", " << rect->width << ", "
+            << rect->height << ") does not lie within image "
+            << op->image_id << ".";
+        return false;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
 bool Session::ApplyCreateMemory(mozart::ResourceId id,
                                 const mozart2::MemoryPtr& args) {
   auto memory = CreateMemory(id, args);
@@ -533,19 +516,6 @@ bool Session::ApplyCreateRenderer(mozart::ResourceId id,
 bool Session::ApplyCreateDirectionalLight(
     mozart::ResourceId id,
     const mozart2::DirectionalLightPtr& args) {
-  if (!AssertValueIsOfType(args->direction, kVec3ValueTypes) ||
-      !AssertValueIsOfType(args->intensity, kFloatValueTypes)) {
-    return false;
-  }
-
-  // TODO(MZ-123): support variables.
-  if (IsVariable(args->direction) || IsVariable(args->intensity)) {
-    error_reporter_->ERROR()
-        << "scene_manager::Session::ApplyCreateDirectionalLight(): "
-           "unimplemented: variable direction/intensity.";
-    return false;
-  }
-
   auto light =
       CreateDirectionalLight(id, Unwrap(args->direction->get_vector3()),
                              args->intensity->get_vector1());
@@ -554,19 +524,6 @@ bool Session::ApplyCreateDirectionalLight(
 
 bool Session::ApplyCreateRectangle(mozart::ResourceId id,
                                    const mozart2::RectanglePtr& args) {
-  if (!AssertValueIsOfType(args->width, kFloatValueTypes) ||
-      !AssertValueIsOfType(args->height, kFloatValueTypes)) {
-    return false;
-  }
-
-  // TODO(MZ-123): support variables.
-  if (IsVariable(args->width) || IsVariable(args->height)) {
-    error_reporter_->ERROR()
-        << "scene_manager::Session::ApplyCreateRectangle(): "
-           "unimplemented: variable width/height.";
-    return false;
-  }
-
   auto rectangle = CreateRectangle(id, args->width->get_vector1(),
                                    args->height->get_vector1());
   return rectangle ? resources_.AddResource(id, std::move(rectangle)) : false;
@@ -575,26 +532,6 @@ bool Session::ApplyCreateRectangle(mozart::ResourceId id,
 bool Session::ApplyCreateRoundedRectangle(
     mozart::ResourceId id,
     const mozart2::RoundedRectanglePtr& args) {
-  if (!AssertValueIsOfType(args->width, kFloatValueTypes) ||
-      !AssertValueIsOfType(args->height, kFloatValueTypes) ||
-      !AssertValueIsOfType(args->top_left_radius, kFloatValueTypes) ||
-      !AssertValueIsOfType(args->top_right_radius, kFloatValueTypes) ||
-      !AssertValueIsOfType(args->bottom_left_radius, kFloatValueTypes) ||
-      !AssertValueIsOfType(args->bottom_right_radius, kFloatValueTypes)) {
-    return false;
-  }
-
-  // TODO(MZ-123): support variables.
-  if (IsVariable(args->width) || IsVariable(args->height) ||
-      IsVariable(args->top_left_radius) || IsVariable(args->top_right_radius) ||
-      IsVariable(args->bottom_left_radius) ||
-      IsVariable(args->bottom_right_radius)) {
-    error_reporter_->ERROR()
-        << "scene_manager::Session::ApplyCreateRoundedRectangle(): "
-           "unimplemented: variable width/height/radii.";
-    return false;
-  }
-
   auto rectangle = CreateRoundedRectangle(
       id, args->width->get_vector1(), args->height->get_vector1(),
       args->top_left_radius->get_vector1(),
@@ -606,17 +543,6 @@ bool Session::ApplyCreateRoundedRectangle(
 
 bool Session::ApplyCreateCircle(mozart::ResourceId id,
                                 const mozart2::CirclePtr& args) {
-  if (!AssertValueIsOfType(args->radius, kFloatValueTypes)) {
-    return false;
-  }
-
-  // TODO(MZ-123): support variables.
-  if (IsVariable(args->radius)) {
-    error_reporter_->ERROR() << "scene_manager::Session::ApplyCreateCircle(): "
-                                "unimplemented: variable radius.";
-    return false;
-  }
-
   auto circle = CreateCircle(id, args->radius->get_vector1());
   return circle ? resources_.AddResource(id, std::move(circle)) : false;
 }
@@ -730,9 +656,7 @@ ResourcePtr Session::CreateDirectionalLight(mozart::ResourceId id,
 
 ResourcePtr Session::CreateClipNode(mozart::ResourceId id,
                                     const mozart2::ClipNodePtr& args) {
-  error_reporter_->ERROR() << "scene_manager::Session::CreateClipNode(): "
-                              "unimplemented.";
-  return ResourcePtr();
+  return ftl::MakeRefCounted<ClipNode>(this, id);
 }
 
 ResourcePtr Session::CreateEntityNode(mozart::ResourceId id,
@@ -761,8 +685,8 @@ ResourcePtr Session::CreateDisplayCompositor(
   }
   return ftl::MakeRefCounted<DisplayCompositor>(
       this, id, display,
-      std::make_unique<DisplaySwapchain>(engine()->escher(),
-                                         engine()->GetVulkanSwapchain()));
+      std::make_unique<DisplaySwapchain>(
+          engine()->escher(), engine()->GetVulkanSwapchain(), display));
 }
 
 ResourcePtr Session::CreateImagePipeCompositor(
@@ -802,8 +726,8 @@ ResourcePtr Session::CreateRoundedRectangle(mozart::ResourceId id,
                                             float top_right_radius,
                                             float bottom_right_radius,
                                             float bottom_left_radius) {
-  auto factory = engine()->escher_rounded_rect_factory();
-  if (!factory) {
+  auto mesh_cache = engine()->rounded_rect_mesh_cache();
+  if (!mesh_cache) {
     error_reporter_->ERROR()
         << "scene_manager::Session::CreateRoundedRectangle(): "
            "no RoundedRectFactory available.";
@@ -813,92 +737,125 @@ ResourcePtr Session::CreateRoundedRectangle(mozart::ResourceId id,
   escher::RoundedRectSpec rect_spec(width, height, top_left_radius,
                                     top_right_radius, bottom_right_radius,
                                     bottom_left_radius);
-  escher::MeshSpec mesh_spec{escher::MeshAttribute::kPosition |
-                             escher::MeshAttribute::kUV};
-
+  float mesh_scale;
+  auto mesh = mesh_cache->GetMesh(rect_spec, &mesh_scale);
   return ftl::MakeRefCounted<RoundedRectangleShape>(
-      this, id, rect_spec, factory->NewRoundedRect(rect_spec, mesh_spec));
+      this, id, rect_spec, std::move(mesh), mesh_scale);
 }
 
 ResourcePtr Session::CreateMaterial(mozart::ResourceId id) {
   return ftl::MakeRefCounted<Material>(this, id);
 }
 
+escher::MaterialPtr Session::GetSharedColorMaterial(const escher::vec3& color) {
+  auto& material =
+      shared_color_materials_[std::make_tuple(color.x, color.y, color.z)];
+  if (material) {
+    return material;
+  }
+  material = ftl::MakeRefCounted<escher::Material>();
+  material->set_color(color);
+  escher::MaterialPtr result = material;
+
+  if (shared_color_materials_.size() >= shared_color_material_limit_) {
+    for (auto it = shared_color_materials_.begin();
+         it != shared_color_materials_.end();) {
+      if (it->second->HasOneRef()) {
+        it = shared_color_materials_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    shared_color_material_limit_ =
+        std::max(size_t{64}, shared_color_materials_.size() * 2);
+  }
+  return result;
+}
+
 void Session::TearDown() {
   if (!is_valid_) {
     // TearDown already called.
     return;
   }
   is_valid_ = false;
-  resources_.Clear();
-  // TODO(MZ-134): Shutting down the session must eagerly collect any
-  // exported resources from the resource linker. Currently, the only way
-  // to evict an exported entry is to shut down its peer. But this does
-  // not handle session shutdown. Fix that bug and turn this log into an
-  // assertion.
-  if (resource_count_ != 0) {
-    error_reporter()->ERROR()
-        << "Session::TearDown(): Not all resources have been "
-           "collected. See MZ-134.";
-  }
   error_reporter_ = nullptr;
+
+  // Detach the session's content from the global scene immediately, so that
+  // it is no longer rendered.  Destroying the resources themselves may take a
+  // long time for large sessions, so it is done incrementally by the
+  // ResourceReaper.
+  std::vector<ResourcePtr> resources = resources_.TakeResources();
+  std::vector<ResourcePtr> compositors;
+  for (auto& resource : resources) {
+    if (resource->IsKindOf<Import>()) {
+      static_cast<Import*>(resource.get())->Unbind();
+    } else if (resource->IsKindOf<Compositor>()) {
+      // Compositors are destroyed right away, which stops them from drawing
+      // and releases their display; their layer stacks are reaped.
+      ResourcePtr layer_stack =
+          static_cast<Compositor*>(resource.get())->layer_stack();
+      compositors.push_back(std::move(resource));
+      resource = std::move(layer_stack);
+    }
+  }
+  resources.erase(
+      std::remove_if(resources.begin(), resources.end(),
+                     [](const ResourcePtr& resource) { return !resource; }),
+      resources.end());
+  compositors.clear();
+
+  engine_->resource_reaper()->Reap(SessionPtr(this), std::move(resources));
 }
 
 ErrorReporter* Session::error_reporter() const {
   return error_reporter_ ? error_reporter_ : ErrorReporter::Default();
 }
 
-bool Session::AssertValueIsOfType(const mozart2::ValuePtr& value,
-                                  const mozart2::Value::Tag* tags,
-                                  size_t tag_count) {
-  FTL_DCHECK(tag_count > 0);
-  for (size_t i = 0; i < tag_count; ++i) {
-    if (value->which() == tags[i]) {
-      return true;
-    }
-  }
-  std::ostringstream str;
-  if (tag_count == 1) {
-    str << ", which is not the expected type: " << tags[0] << ".";
-  } else {
-    str << ", which is not one of the expected types (" << tags[0];
-    for (size_t i = 1; i < tag_count; ++i) {
-      str << ", " << tags[i];
-    }
-    str << ").";
-  }
-  error_reporter_->ERROR() << "scene_manager::Session: received value of type: "
-                           << value->which() << str.str();
-  return false;
-}
-
 void Session::ScheduleUpdate(
     uint64_t presentation_time,
-    ::fidl::Array<mozart2::OpPtr> ops,
+    std::vector<SessionCommand> commands,
     ::fidl::Array<mx::event> acquire_fences,
     ::fidl::Array<mx::event> release_events,
     const mozart2::Session::PresentCallback& callback) {
   if (is_valid()) {
-    auto acquire_fence_set =
-        std::make_unique<AcquireFenceSet>(std::move(acquire_fences));
-    // TODO: Consider calling ScheduleSessionUpdate immediately if
-    // acquire_fence_set is already ready (which is the case if there are zero
-    // acquire fences).
-    acquire_fence_set->WaitReadyAsync([this, presentation_time] {
+    TRACE_DURATION("gfx", "Session::ScheduleUpdate", "id", id_, "fences",
+                   acquire_fences.size());
+    auto acquire_fence_set = std::make_unique<AcquireFenceSet>(
+        std::move(acquire_fences), engine_->acquire_fence_waiter());
+    AcquireFenceSet* fences = acquire_fence_set.get();
+
+    presentation_time = ThrottlePresentationTime(presentation_time);
+
+    Update update;
+    update.presentation_time = presentation_time;
+    update.commands = std::move(commands);
+    update.acquire_fences = std::move(acquire_fence_set);
+    update.release_fences = std::move(release_events);
+    update.present_callback = callback;
+    scheduled_updates_.push_back(std::move(update));
+
+    // Most updates have no acquire fences, or ones which have already been
+    // signalled; those are scheduled at once, rather than on the next turn of
+    // the message loop.
+    if (fences->PollReady()) {
       engine_->ScheduleSessionUpdate(presentation_time, SessionPtr(this));
-    });
-
-    scheduled_updates_.push(Update{presentation_time, std::move(ops),
-                                   std::move(acquire_fence_set),
-                                   std::move(release_events), callback});
+    } else {
+      fences->WaitReadyAsync([this, presentation_time] {
+        engine_->ScheduleSessionUpdate(presentation_time, SessionPtr(this));
+      });
+    }
   }
 }
 
 void Session::ScheduleImagePipeUpdate(uint64_t presentation_time,
                                       ImagePipePtr image_pipe) {
   if (is_valid()) {
-    scheduled_image_pipe_updates_.push(
-        {presentation_time, std::move(image_pipe)});
+    presentation_time = ThrottlePresentationTime(presentation_time);
+
+    Update update;
+    update.presentation_time = presentation_time;
+    update.image_pipe = std::move(image_pipe);
+    scheduled_updates_.push_back(std::move(update));
 
     engine_->ScheduleSessionUpdate(presentation_time, SessionPtr(this));
   }
@@ -908,25 +865,44 @@ bool Session::ApplyScheduledUpdates(uint64_t presentation_time,
                                     uint64_t presentation_interval) {
   TRACE_DURATION("gfx", "Session::ApplyScheduledUpdates", "id", id_, "time",
                  presentation_time, "interval", presentation_interval);
+  consecutive_deferral_count_ = 0;
+
+  // Applying an update may schedule others, so work from a copy of the queue,
+  // and put the updates which are not yet due back in front of any new ones.
+  std::deque<Update> updates;
+  updates.swap(scheduled_updates_);
+  std::deque<Update> pending_updates;
+  std::vector<ImagePipePtr> image_pipes;
+  bool present_blocked = false;
   bool needs_render = false;
-  while (!scheduled_updates_.empty() &&
-         scheduled_updates_.front().presentation_time <= presentation_time &&
-         scheduled_updates_.front().acquire_fences->ready()) {
-    if (ApplyUpdate(&scheduled_updates_.front())) {
+  for (auto& update : updates) {
+    if (update.image_pipe) {
+      if (update.presentation_time > presentation_time) {
+        pending_updates.push_back(std::move(update));
+      } else if (std::find(image_pipes.begin(), image_pipes.end(),
+                           update.image_pipe) == image_pipes.end()) {
+        image_pipes.push_back(std::move(update.image_pipe));
+      }
+      continue;
+    }
+
+    if (present_blocked || update.presentation_time > presentation_time ||
+        !update.acquire_fences->ready()) {
+      present_blocked = true;
+      pending_updates.push_back(std::move(update));
+      continue;
+    }
+
+    if (ApplyUpdate(&update)) {
       needs_render = true;
       auto info = mozart2::PresentationInfo::New();
       info->presentation_time = presentation_time;
       info->presentation_interval = presentation_interval;
-      scheduled_updates_.front().present_callback(std::move(info));
-
-      for (auto& fence : fences_to_release_on_next_update_) {
-        engine()->release_fence_signaller()->AddCPUReleaseFence(
-            std::move(fence));
-      }
-      fences_to_release_on_next_update_ =
-          std::move(scheduled_updates_.front().release_fences);
+      update.present_callback(std::move(info));
 
-      scheduled_updates_.pop();
+      engine()->release_fence_signaller()->AddCPUReleaseFences(
+          std::move(fences_to_release_on_next_update_));
+      fences_to_release_on_next_update_ = std::move(update.release_fences);
 
       // TODO: gather statistics about how close the actual
       // presentation_time was to the requested time.
@@ -943,26 +919,100 @@ bool Session::ApplyScheduledUpdates(uint64_t presentation_time,
       return true;
     }
   }
+  for (auto& update : scheduled_updates_) {
+    pending_updates.push_back(std::move(update));
+  }
+  scheduled_updates_.swap(pending_updates);
 
-  // TODO: Unify with other session updates.
-  while (!scheduled_image_pipe_updates_.empty() &&
-         scheduled_image_pipe_updates_.front().presentation_time <=
-             presentation_time) {
-    needs_render = scheduled_image_pipe_updates_.front().image_pipe->Update(
-        presentation_time, presentation_interval);
-    scheduled_image_pipe_updates_.pop();
+  for (auto& image_pipe : image_pipes) {
+    if (image_pipe->Update(presentation_time, presentation_interval)) {
+      needs_render = true;
+    }
   }
 
+  if (needs_render)
+    last_update_presentation_time_ = presentation_time;
   return needs_render;
 }
 
+size_t Session::GetDueCommandCount(uint64_t presentation_time) const {
+  size_t count = 0;
+  for (const auto& update : scheduled_updates_) {
+    if (update.image_pipe) {
+      if (update.presentation_time <= presentation_time)
+        ++count;
+      continue;
+    }
+    // Updates are applied in order, so none after a blocked one are due.
+    if (update.presentation_time > presentation_time ||
+        !update.acquire_fences->ready())
+      break;
+    count += update.commands.size();
+  }
+  return count;
+}
+
+void Session::RecordDeferral() {
+  ++deferral_count_;
+  ++consecutive_deferral_count_;
+  TRACE_COUNTER("gfx", "SessionDeferrals", id_, "count", deferral_count_);
+}
+
+void Session::SetMaxUpdateRate(float updates_per_second) {
+  // Also rejects NaN.
+  if (!(updates_per_second >= 0.f)) {
+    error_reporter()->ERROR() << "scene_manager::Session::SetMaxUpdateRate(): "
+                                 "the rate must not be negative.";
+    return;
+  }
+  if (updates_per_second == 0.f) {
+    min_update_interval_ = 0u;
+    return;
+  }
+  // Clamping also keeps the conversion to an integer defined for tiny rates.
+  const double min_update_interval = 1'000'000'000.0 / updates_per_second;
+  min_update_interval_ =
+      min_update_interval < kMaxUpdateInterval
+          ? static_cast<uint64_t>(min_update_interval)
+          : kMaxUpdateInterval;
+}
+
+uint64_t Session::ThrottlePresentationTime(uint64_t presentation_time) const {
+  Display* display = engine_->display_manager()->default_display();
+  const uint64_t vsync_interval = display ? display->GetVsyncInterval() : 0u;
+
+  uint64_t min_update_interval = min_update_interval_;
+  if (priority_ == mozart2::SessionPriority::BACKGROUND) {
+    min_update_interval = std::max(min_update_interval,
+                                   vsync_interval * kBackgroundVsyncDivisor);
+  }
+  if (min_update_interval == 0 || last_update_presentation_time_ == 0)
+    return presentation_time;
+
+  // Allow half a vsync of slack, so that an interval which is a multiple of
+  // the vsync interval lands on that vsync rather than the one after.
+  const uint64_t interval =
+      min_update_interval - std::min(min_update_interval, vsync_interval / 2);
+  const uint64_t earliest_time =
+      last_update_presentation_time_ > UINT64_MAX - interval
+          ? UINT64_MAX
+          : last_update_presentation_time_ + interval;
+  if (presentation_time < earliest_time) {
+    TRACE_DURATION("gfx", "Session::ThrottlePresentationTime", "id", id_,
+                   "deferred_by", earliest_time - presentation_time);
+    return earliest_time;
+  }
+  return presentation_time;
+}
+
 bool Session::ApplyUpdate(Session::Update* update) {
   TRACE_DURATION("gfx", "Session::ApplyUpdate");
   if (is_valid()) {
-    for (auto& op : update->ops) {
-      if (!ApplyOp(op)) {
+    for (auto& command : update->commands) {
+      if (!ApplyCommand(&command)) {
         error_reporter_->ERROR()
-            << "scene_manager::Session::ApplyOp() failed to apply Op: " << op;
+            << "scene_manager::Session::ApplyCommand() failed to apply Op: "
+            << command.tag;
         return false;
       }
     }
@@ -4,11 +4,15 @@
 
 #pragma once
 
+#include <deque>
+#include <map>
+#include <tuple>
 #include <vector>
 
 #include "apps/mozart/services/scene/session.fidl.h"
 #include "apps/mozart/src/scene_manager/acquire_fence_set.h"
 #include "apps/mozart/src/scene_manager/engine/engine.h"
+#include "apps/mozart/src/scene_manager/engine/session_command.h"
 #include "apps/mozart/src/scene_manager/resources/memory.h"
 #include "apps/mozart/src/scene_manager/resources/resource_map.h"
 #include "apps/mozart/src/scene_manager/util/error_reporter.h"
@@ -44,7 +48,11 @@ class Session : public ftl::RefCountedThreadSafe<Session> {
   // Apply the operation to the current session state.  Return true if
   // successful, and false if the op is somehow invalid.  In the latter case,
   // the Session is left unchanged.
-  bool ApplyOp(const mozart2::OpPtr& op);
+  bool ApplyOp(mozart2::OpPtr op);
+
+  // Apply an op which has already been decoded by DecodeOp().  As above,
+  // return false if the op cannot be applied to the current session state.
+  bool ApplyCommand(SessionCommand* command);
 
   SessionId id() const { return id_; }
   Engine* engine() const { return engine_; }
@@ -72,63 +80,116 @@ class Session : public ftl::RefCountedThreadSafe<Session> {
 
   // Called by SessionHandler::Present().  Stashes the arguments without
   // applying them; they will later be applied by ApplyScheduledUpdates().
+  // |commands| were decoded from the ops passed to SessionHandler::Enqueue().
   // TODO: nothing is currently done with the acquire and release fences.
   void ScheduleUpdate(uint64_t presentation_time,
-                      ::fidl::Array<mozart2::OpPtr> ops,
+                      std::vector<SessionCommand> commands,
                       ::fidl::Array<mx::event> acquire_fences,
                       ::fidl::Array<mx::event> release_fences,
                       const mozart2::Session::PresentCallback& callback);
 
-  // Called by ImagePipe::PresentImage().  Stashes the arguments without
-  // applying them; they will later be applied by ApplyScheduledUpdates().
+  // Called by ImagePipe when one of its frames is ready to be presented.
+  // Queues the ImagePipe to be updated by ApplyScheduledUpdates(), along with
+  // the updates scheduled by ScheduleUpdate().
   void ScheduleImagePipeUpdate(uint64_t presentation_time,
                                ImagePipePtr image_pipe);
 
   // Called by Engine() when it is notified by the FrameScheduler that
-  // a frame should be rendered for the specified |presentation_time|.  Return
-  // true if any updates were applied, and false otherwise.
+  // a frame should be rendered for the specified |presentation_time|.  Applies
+  // the due updates in the order in which they were scheduled; see
+  // |scheduled_updates_|.  Return true if any updates were applied, and false
+  // otherwise.
   bool ApplyScheduledUpdates(uint64_t presentation_time,
                              uint64_t presentation_interval);
 
+  // Called by SessionHandler::SetPriority().  Background sessions' updates
+  // take effect at most every |kBackgroundVsyncDivisor| vsyncs.
+  void set_priority(mozart2::SessionPriority priority) { priority_ = priority; }
+  mozart2::SessionPriority priority() const { return priority_; }
+
+  // Called by SessionHandler::SetMaxUpdateRate().  Updates are deferred so
+  // that at most |updates_per_second| of them take effect each second; zero
+  // removes the limit.  Updates are never deferred by more than
+  // |kMaxUpdateInterval|, however low the rate.  Negative and NaN rates are
+  // reported as errors, and leave the limit unchanged.
+  void SetMaxUpdateRate(float updates_per_second);
+
+  static constexpr uint64_t kBackgroundVsyncDivisor = 4;
+  static constexpr uint64_t kMaxUpdateInterval = 60'000'000'000;  // 1 minute
+
+  // The number of commands in the updates which ApplyScheduledUpdates() would
+  // apply for a frame presented at |presentation_time|; each ImagePipe update
+  // counts as one.  Used by Engine to estimate their cost.
+  size_t GetDueCommandCount(uint64_t presentation_time) const;
+
+  // Called by Engine when it puts off the session's due updates to the next
+  // frame, because they would not fit in what remains of the frame's budget
+  // for applying updates.
+  void RecordDeferral();
+
+  // The number of frames for which the session's updates were deferred, in
+  // total and since they were last applied.
+  uint64_t deferral_count() const { return deferral_count_; }
+  uint32_t consecutive_deferral_count() const {
+    return consecutive_deferral_count_;
+  }
+
   // Called by SessionHandler::HitTest().
   void HitTest(uint32_t node_id,
                mozart2::vec3Ptr ray_origin,
                mozart2::vec3Ptr ray_direction,
                const mozart2::Session::HitTestCallback& callback);
 
+  // Returns an untextured escher::Material of |color|, which is shared by all
+  // of the session's Materials of that color and must not be modified.
+  escher::MaterialPtr GetSharedColorMaterial(const escher::vec3& color);
+
  private:
   // Called internally to initiate teardown.
   void BeginTearDown();
 
-  // Operation application functions, called by ApplyOp().
+  // Operation application functions, called by ApplyCommand().  Ops which
+  // DecodeOp() does not decode are applied from their FIDL form.
   bool ApplyCreateResourceOp(const mozart2::CreateResourceOpPtr& op);
-  bool ApplyReleaseResourceOp(const mozart2::ReleaseResourceOpPtr& op);
+  bool ApplyReleaseResourceOp(mozart::ResourceId id);
   bool ApplyExportResourceOp(const mozart2::ExportResourceOpPtr& op);
   bool ApplyImportResourceOp(const mozart2::ImportResourceOpPtr& op);
-  bool ApplyAddChildOp(const mozart2::AddChildOpPtr& op);
-  bool ApplyAddPartOp(const mozart2::AddPartOpPtr& op);
-  bool ApplyDetachOp(const mozart2::DetachOpPtr& op);
-  bool ApplyDetachChildrenOp(const mozart2::DetachChildrenOpPtr& op);
-  bool ApplySetTagOp(const mozart2::SetTagOpPtr& op);
-  bool ApplySetTranslationOp(const mozart2::SetTranslationOpPtr& op);
-  bool ApplySetScaleOp(const mozart2::SetScaleOpPtr& op);
-  bool ApplySetRotationOp(const mozart2::SetRotationOpPtr& op);
-  bool ApplySetAnchorOp(const mozart2::SetAnchorOpPtr& op);
-  bool ApplySetSizeOp(const mozart2::SetSizeOpPtr& op);
-  bool ApplySetShapeOp(const mozart2::SetShapeOpPtr& op);
-  bool ApplySetMaterialOp(const mozart2::SetMaterialOpPtr& op);
-  bool ApplySetClipOp(const mozart2::SetClipOpPtr& op);
-  bool ApplySetHitTestBehaviorOp(const mozart2::SetHitTestBehaviorOpPtr& op);
-  bool ApplySetCameraOp(const mozart2::SetCameraOpPtr& op);
+  bool ApplyAddChildOp(mozart::ResourceId node_id, mozart::ResourceId child_id);
+  bool ApplyAddPartOp(mozart::ResourceId node_id, mozart::ResourceId part_id);
+  bool ApplyDetachOp(mozart::ResourceId id);
+  bool ApplyDetachChildrenOp(mozart::ResourceId node_id);
+  bool ApplySetTagOp(mozart::ResourceId node_id, uint32_t tag_value);
+  bool ApplySetTranslationOp(mozart::ResourceId id,
+                             const escher::vec3& translation);
+  bool ApplySetScaleOp(mozart::ResourceId id, const escher::vec3& scale);
+  bool ApplySetRotationOp(mozart::ResourceId id, const escher::quat& rotation);
+  bool ApplySetAnchorOp(mozart::ResourceId id, const escher::vec3& anchor);
+  bool ApplySetSizeOp(mozart::ResourceId id, const escher::vec2& size);
+  bool ApplySetShapeOp(mozart::ResourceId node_id, mozart::ResourceId shape_id);
+  bool ApplySetMaterialOp(mozart::ResourceId node_id,
+                          mozart::ResourceId material_id);
+  bool ApplySetClipOp(mozart::ResourceId node_id,
+                      mozart::ResourceId clip_id,
+                      bool clip_to_self);
+  bool ApplySetHitTestBehaviorOp(mozart::ResourceId node_id,
+                                 mozart2::HitTestBehavior hit_test_behavior);
+  bool ApplySetCameraOp(mozart::ResourceId renderer_id,
+                        mozart::ResourceId camera_id);
   bool ApplySetCameraProjectionOp(const mozart2::SetCameraProjectionOpPtr& op);
-  bool ApplySetLightIntensityOp(const mozart2::SetLightIntensityOpPtr& op);
-  bool ApplySetTextureOp(const mozart2::SetTextureOpPtr& op);
-  bool ApplySetColorOp(const mozart2::SetColorOpPtr& op);
-  bool ApplyAddLayerOp(const mozart2::AddLayerOpPtr& op);
-  bool ApplySetLayerStackOp(const mozart2::SetLayerStackOpPtr& op);
-  bool ApplySetRendererOp(const mozart2::SetRendererOpPtr& op);
-  bool ApplySetEventMaskOp(const mozart2::SetEventMaskOpPtr& op);
+  bool ApplySetLightIntensityOp(mozart::ResourceId light_id, float intensity);
+  bool ApplySetTextureOp(mozart::ResourceId material_id,
+                         mozart::ResourceId texture_id);
+  bool ApplySetColorOp(mozart::ResourceId material_id,
+                       const escher::vec4& color);
+  bool ApplyAddLayerOp(mozart::ResourceId layer_stack_id,
+                       mozart::ResourceId layer_id);
+  bool ApplySetLayerStackOp(mozart::ResourceId compositor_id,
+                            mozart::ResourceId layer_stack_id);
+  bool ApplySetRendererOp(mozart::ResourceId layer_id,
+                          mozart::ResourceId renderer_id);
+  bool ApplySetEventMaskOp(mozart::ResourceId id, uint32_t event_mask);
   bool ApplySetLabelOp(const mozart2::SetLabelOpPtr& op);
+  bool ApplyInvalidateImageOp(const mozart2::InvalidateImageOpPtr& op);
 
   // Resource creation functions, called by ApplyCreateResourceOp().
   bool ApplyCreateMemory(mozart::ResourceId id, const mozart2::MemoryPtr& args);
@@ -207,43 +268,40 @@ class Session : public ftl::RefCountedThreadSafe<Session> {
                                      float bottom_left_radius);
   ResourcePtr CreateMaterial(mozart::ResourceId id);
 
-  // Return false and log an error if the value is not of the expected type.
-  // NOTE: although failure does not halt execution of the program, it does
-  // indicate client error, and will be used by the caller to tear down the
-  // Session.
-  bool AssertValueIsOfType(const mozart2::ValuePtr& value,
-                           const mozart2::Value::Tag* tags,
-                           size_t tag_count);
-  template <size_t N>
-  bool AssertValueIsOfType(const mozart2::ValuePtr& value,
-                           const std::array<mozart2::Value::Tag, N>& tags) {
-    return AssertValueIsOfType(value, tags.data(), N);
-  }
-
   friend class Resource;
   void IncrementResourceCount() { ++resource_count_; }
   void DecrementResourceCount() { --resource_count_; }
 
+  // An update scheduled either by Session.Present(), or by an ImagePipe.
   struct Update {
     uint64_t presentation_time;
 
-    ::fidl::Array<mozart2::OpPtr> ops;
+    std::vector<SessionCommand> commands;
     std::unique_ptr<AcquireFenceSet> acquire_fences;
     ::fidl::Array<mx::event> release_fences;
 
     // Callback to report when the update has been applied in response to
     // an invocation of |Session.Present()|.
     mozart2::Session::PresentCallback present_callback;
-  };
-  bool ApplyUpdate(Update* update);
-  std::queue<Update> scheduled_updates_;
-  ::fidl::Array<mx::event> fences_to_release_on_next_update_;
 
-  struct ImagePipeUpdate {
-    uint64_t presentation_time;
+    // Set only for ImagePipe updates, which have no commands; the ImagePipe
+    // has already waited for the acquire fence of its frame.
     ImagePipePtr image_pipe;
   };
-  std::queue<ImagePipeUpdate> scheduled_image_pipe_updates_;
+  bool ApplyUpdate(Update* update);
+
+  // Returns the time at which an update requested for |presentation_time| is
+  // scheduled, which is later if the session's priority or maximum update
+  // rate do not yet allow another update.
+  uint64_t ThrottlePresentationTime(uint64_t presentation_time) const;
+
+  // Updates in the order in which they were scheduled.  Updates from
+  // Session.Present() are applied strictly in order, so one whose acquire
+  // fences have not been signalled holds back all those after it.  ImagePipe
+  // updates do not depend on them, and are applied as soon as they are due;
+  // each ImagePipe is updated at most once per frame.
+  std::deque<Update> scheduled_updates_;
+  ::fidl::Array<mx::event> fences_to_release_on_next_update_;
 
   const SessionId id_;
   Engine* const engine_;
@@ -251,6 +309,19 @@ class Session : public ftl::RefCountedThreadSafe<Session> {
 
   ResourceMap resources_;
 
+  // See GetSharedColorMaterial().  Materials which are no longer used are
+  // pruned whenever the map grows to |shared_color_material_limit_|.
+  std::map<std::tuple<float, float, float>, escher::MaterialPtr>
+      shared_color_materials_;
+  size_t shared_color_material_limit_ = 64;
+
+  mozart2::SessionPriority priority_ = mozart2::SessionPriority::FOREGROUND;
+  uint64_t min_update_interval_ = 0;
+  // The presentation time of the frame in which updates were last applied.
+  uint64_t last_update_presentation_time_ = 0;
+  uint64_t deferral_count_ = 0;
+  uint32_t consecutive_deferral_count_ = 0;
+
   size_t resource_count_ = 0;
   bool is_valid_ = true;
 };
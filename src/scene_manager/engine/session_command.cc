@@ -0,0 +1,371 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/engine/session_command.h"
+
+#include <array>
+#include <sstream>
+
+#include "apps/mozart/src/scene_manager/print_op.h"
+#include "apps/mozart/src/scene_manager/util/unwrap.h"
+
+namespace scene_manager {
+
+namespace {
+
+// Makes it convenient to check that a value is constant and of a specific type,
+// or a variable.
+// TODO: There should also be a convenient way of type-checking a variable;
+// this will necessarily involve looking up the value in the ResourceMap.
+constexpr std::array<mozart2::Value::Tag, 2> kFloatValueTypes{
+    {mozart2::Value::Tag::VECTOR1, mozart2::Value::Tag::VARIABLE_ID}};
+constexpr std::array<mozart2::Value::Tag, 2> kVec3ValueTypes{
+    {mozart2::Value::Tag::VECTOR3, mozart2::Value::Tag::VARIABLE_ID}};
+
+// Return false and log an error if the value is not of the expected type.
+template <size_t N>
+bool AssertValueIsOfType(const mozart2::ValuePtr& value,
+                         const std::array<mozart2::Value::Tag, N>& tags,
+                         ErrorReporter* error_reporter) {
+  static_assert(N > 0, "at least one type is required");
+  for (size_t i = 0; i < N; ++i) {
+    if (value->which() == tags[i]) {
+      return true;
+    }
+  }
+  std::ostringstream str;
+  if (N == 1) {
+    str << ", which is not the expected type: " << tags[0] << ".";
+  } else {
+    str << ", which is not one of the expected types (" << tags[0];
+    for (size_t i = 1; i < N; ++i) {
+      str << ", " << tags[i];
+    }
+    str << ").";
+  }
+  error_reporter->ERROR() << "scene_manager::Session: received value of type: "
+                          << value->which() << str.str();
+  return false;
+}
+
+bool ValidateCreateResourceOp(const mozart2::CreateResourceOpPtr& op,
+                              ErrorReporter* error_reporter) {
+  if (op->id == 0) {
+    error_reporter->ERROR()
+        << "scene_manager::Session::ApplyCreateResourceOp(): invalid ID: "
+        << op;
+    return false;
+  }
+
+  switch (op->resource->which()) {
+    case mozart2::Resource::Tag::DIRECTIONAL_LIGHT: {
+      auto& args = op->resource->get_directional_light();
+      if (!AssertValueIsOfType(args->direction, kVec3ValueTypes,
+                               error_reporter) ||
+          !AssertValueIsOfType(args->intensity, kFloatValueTypes,
+                               error_reporter)) {
+        return false;
+      }
+      // TODO(MZ-123): support variables.
+      if (IsVariable(args->direction) || IsVariable(args->intensity)) {
+        error_reporter->ERROR()
+            << "scene_manager::Session::ApplyCreateDirectionalLight(): "
+               "unimplemented: variable direction/intensity.";
+        return false;
+      }
+      return true;
+    }
+    case mozart2::Resource::Tag::RECTANGLE: {
+      auto& args = op->resource->get_rectangle();
+      if (!AssertValueIsOfType(args->width, kFloatValueTypes,
+                               error_reporter) ||
+          !AssertValueIsOfType(args->height, kFloatValueTypes,
+                               error_reporter)) {
+        return false;
+      }
+      // TODO(MZ-123): support variables.
+      if (IsVariable(args->width) || IsVariable(args->height)) {
+        error_reporter->ERROR()
+            << "scene_manager::Session::ApplyCreateRectangle(): "
+               "unimplemented: variable width/height.";
+        return false;
+      }
+      return true;
+    }
+    case mozart2::Resource::Tag::ROUNDED_RECTANGLE: {
+      auto& args = op->resource->get_rounded_rectangle();
+      for (auto* value :
+           {&args->width, &args->height, &args->top_left_radius,
+            &args->top_right_radius, &args->bottom_left_radius,
+            &args->bottom_right_radius}) {
+        if (!AssertValueIsOfType(*value, kFloatValueTypes, error_reporter)) {
+          return false;
+        }
+        // TODO(MZ-123): support variables.
+        if (IsVariable(*value)) {
+          error_reporter->ERROR()
+              << "scene_manager::Session::ApplyCreateRoundedRectangle(): "
+                 "unimplemented: variable width/height/radii.";
+          return false;
+        }
+      }
+      return true;
+    }
+    case mozart2::Resource::Tag::CIRCLE: {
+      auto& args = op->resource->get_circle();
+      if (!AssertValueIsOfType(args->radius, kFloatValueTypes,
+                               error_reporter)) {
+        return false;
+      }
+      // TODO(MZ-123): support variables.
+      if (IsVariable(args->radius)) {
+        error_reporter->ERROR()
+            << "scene_manager::Session::ApplyCreateCircle(): "
+               "unimplemented: variable radius.";
+        return false;
+      }
+      return true;
+    }
+    case mozart2::Resource::Tag::BUFFER:
+    case mozart2::Resource::Tag::MESH:
+    case mozart2::Resource::Tag::CLIP_NODE:
+    case mozart2::Resource::Tag::IMAGE_PIPE_COMPOSITOR:
+    case mozart2::Resource::Tag::VARIABLE:
+      error_reporter->ERROR()
+          << "scene_manager::Session::ApplyCreateResourceOp(): unimplemented: "
+          << op;
+      return false;
+    case mozart2::Resource::Tag::__UNKNOWN__:
+      // FIDL validation should make this impossible.
+      FTL_CHECK(false);
+      return false;
+    default:
+      return true;
+  }
+}
+
+// Reports an error if |value| is a variable.  The caller must return false if
+// this returns false.
+template <typename ValuePtrT>
+bool AssertValueIsConstant(const ValuePtrT& value,
+                           const char* op_name,
+                           ErrorReporter* error_reporter) {
+  // TODO(MZ-123): support variables.
+  if (IsVariable(value)) {
+    error_reporter->ERROR() << "scene_manager::Session::Apply" << op_name
+                            << "(): unimplemented for variable value.";
+    return false;
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+bool DecodeOp(mozart2::OpPtr op,
+              SessionCommand* command,
+              ErrorReporter* error_reporter) {
+  FTL_DCHECK(command);
+  command->tag = op->which();
+  switch (op->which()) {
+    case mozart2::Op::Tag::CREATE_RESOURCE:
+      if (!ValidateCreateResourceOp(op->get_create_resource(),
+                                    error_reporter)) {
+        return false;
+      }
+      command->op = std::move(op);
+      return true;
+    case mozart2::Op::Tag::EXPORT_RESOURCE:
+    case mozart2::Op::Tag::IMPORT_RESOURCE:
+    case mozart2::Op::Tag::SET_LABEL:
+    case mozart2::Op::Tag::INVALIDATE_IMAGE:
+      command->op = std::move(op);
+      return true;
+    case mozart2::Op::Tag::RELEASE_RESOURCE:
+      command->ids[0] = op->get_release_resource()->id;
+      return true;
+    case mozart2::Op::Tag::ADD_CHILD: {
+      auto& args = op->get_add_child();
+      command->ids[0] = args->node_id;
+      command->ids[1] = args->child_id;
+      return true;
+    }
+    case mozart2::Op::Tag::ADD_PART: {
+      auto& args = op->get_add_part();
+      command->ids[0] = args->node_id;
+      command->ids[1] = args->part_id;
+      return true;
+    }
+    case mozart2::Op::Tag::DETACH:
+      command->ids[0] = op->get_detach()->id;
+      return true;
+    case mozart2::Op::Tag::DETACH_CHILDREN:
+      command->ids[0] = op->get_detach_children()->node_id;
+      return true;
+    case mozart2::Op::Tag::SET_TAG: {
+      auto& args = op->get_set_tag();
+      command->ids[0] = args->node_id;
+      command->value = args->tag_value;
+      return true;
+    }
+    case mozart2::Op::Tag::SET_TRANSLATION: {
+      auto& args = op->get_set_translation();
+      if (!AssertValueIsConstant(args->value, "SetTranslationOp",
+                                 error_reporter)) {
+        return false;
+      }
+      command->ids[0] = args->id;
+      command->vector = escher::vec4(UnwrapVector3(args->value), 0.f);
+      return true;
+    }
+    case mozart2::Op::Tag::SET_SCALE: {
+      auto& args = op->get_set_scale();
+      if (!AssertValueIsConstant(args->value, "SetScaleOp", error_reporter)) {
+        return false;
+      }
+      command->ids[0] = args->id;
+      command->vector = escher::vec4(UnwrapVector3(args->value), 0.f);
+      return true;
+    }
+    case mozart2::Op::Tag::SET_ROTATION: {
+      auto& args = op->get_set_rotation();
+      if (!AssertValueIsConstant(args->value, "SetRotationOp",
+                                 error_reporter)) {
+        return false;
+      }
+      auto& quaternion = args->value->value;
+      command->ids[0] = args->id;
+      command->vector = escher::vec4(quaternion->x, quaternion->y,
+                                     quaternion->z, quaternion->w);
+      return true;
+    }
+    case mozart2::Op::Tag::SET_ANCHOR: {
+      auto& args = op->get_set_anchor();
+      if (!AssertValueIsConstant(args->value, "SetAnchorOp", error_reporter)) {
+        return false;
+      }
+      command->ids[0] = args->id;
+      command->vector = escher::vec4(UnwrapVector3(args->value), 0.f);
+      return true;
+    }
+    case mozart2::Op::Tag::SET_SIZE: {
+      auto& args = op->get_set_size();
+      if (!AssertValueIsConstant(args->value, "SetSizeOp", error_reporter)) {
+        return false;
+      }
+      command->ids[0] = args->id;
+      command->vector = escher::vec4(UnwrapVector2(args->value), 0.f, 0.f);
+      return true;
+    }
+    case mozart2::Op::Tag::SET_SHAPE: {
+      auto& args = op->get_set_shape();
+      command->ids[0] = args->node_id;
+      command->ids[1] = args->shape_id;
+      return true;
+    }
+    case mozart2::Op::Tag::SET_MATERIAL: {
+      auto& args = op->get_set_material();
+      command->ids[0] = args->node_id;
+      command->ids[1] = args->material_id;
+      return true;
+    }
+    case mozart2::Op::Tag::SET_CLIP: {
+      auto& args = op->get_set_clip();
+      command->ids[0] = args->node_id;
+      command->ids[1] = args->clip_id;
+      command->value = args->clip_to_self;
+      return true;
+    }
+    case mozart2::Op::Tag::SET_HIT_TEST_BEHAVIOR: {
+      auto& args = op->get_set_hit_test_behavior();
+      command->ids[0] = args->node_id;
+      command->value = static_cast<uint32_t>(args->hit_test_behavior);
+      return true;
+    }
+    case mozart2::Op::Tag::SET_CAMERA: {
+      auto& args = op->get_set_camera();
+      command->ids[0] = args->renderer_id;
+      command->ids[1] = args->camera_id;
+      return true;
+    }
+    case mozart2::Op::Tag::SET_CAMERA_PROJECTION: {
+      auto& args = op->get_set_camera_projection();
+      // TODO(MZ-123): support variables.
+      if (IsVariable(args->eye_position) || IsVariable(args->eye_look_at) ||
+          IsVariable(args->eye_up) || IsVariable(args->fovy)) {
+        error_reporter->ERROR()
+            << "scene_manager::Session::ApplySetCameraProjectionOp(): "
+               "unimplemented: variable properties.";
+        return false;
+      }
+      command->op = std::move(op);
+      return true;
+    }
+    case mozart2::Op::Tag::SET_LIGHT_INTENSITY: {
+      auto& args = op->get_set_light_intensity();
+      // TODO(MZ-123): support variables.
+      if (IsVariable(args->intensity)) {
+        error_reporter->ERROR()
+            << "scene_manager::Session::ApplySetLightIntensityOp(): "
+               "unimplemented: variable intensity.";
+        return false;
+      } else if (!IsFloat(args->intensity)) {
+        error_reporter->ERROR()
+            << "scene_manager::Session::ApplySetLightIntensityOp(): "
+               "intensity is not a float.";
+        return false;
+      }
+      command->ids[0] = args->light_id;
+      command->vector.x = args->intensity->get_vector1();
+      return true;
+    }
+    case mozart2::Op::Tag::SET_TEXTURE: {
+      auto& args = op->get_set_texture();
+      command->ids[0] = args->material_id;
+      command->ids[1] = args->texture_id;
+      return true;
+    }
+    case mozart2::Op::Tag::SET_COLOR: {
+      auto& args = op->get_set_color();
+      if (!AssertValueIsConstant(args->color, "SetColorOp", error_reporter)) {
+        return false;
+      }
+      auto& color = args->color->value;
+      command->ids[0] = args->material_id;
+      command->vector = escher::vec4(color->red, color->green, color->blue,
+                                     color->alpha) /
+                        255.f;
+      return true;
+    }
+    case mozart2::Op::Tag::ADD_LAYER: {
+      auto& args = op->get_add_layer();
+      command->ids[0] = args->layer_stack_id;
+      command->ids[1] = args->layer_id;
+      return true;
+    }
+    case mozart2::Op::Tag::SET_LAYER_STACK: {
+      auto& args = op->get_set_layer_stack();
+      command->ids[0] = args->compositor_id;
+      command->ids[1] = args->layer_stack_id;
+      return true;
+    }
+    case mozart2::Op::Tag::SET_RENDERER: {
+      auto& args = op->get_set_renderer();
+      command->ids[0] = args->layer_id;
+      command->ids[1] = args->renderer_id;
+      return true;
+    }
+    case mozart2::Op::Tag::SET_EVENT_MASK: {
+      auto& args = op->get_set_event_mask();
+      command->ids[0] = args->id;
+      command->value = args->event_mask;
+      return true;
+    }
+    case mozart2::Op::Tag::__UNKNOWN__:
+      // FIDL validation should make this impossible.
+      FTL_CHECK(false);
+      return false;
+  }
+}
+
+}  // namespace scene_manager
@@ -0,0 +1,48 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "apps/mozart/lib/scene/types.h"
+#include "apps/mozart/services/scene/ops.fidl.h"
+#include "apps/mozart/src/scene_manager/util/error_reporter.h"
+#include "escher/geometry/types.h"
+
+namespace scene_manager {
+
+// An op which has already been validated, and whose arguments have been
+// decoded into the form in which they are applied.  Commands are produced by
+// DecodeOp() when ops arrive in SessionHandler::Enqueue(), so that applying
+// them during a frame involves only resource lookups and the changes
+// themselves.
+struct SessionCommand {
+  mozart2::Op::Tag tag = mozart2::Op::Tag::__UNKNOWN__;
+
+  // The resources referred to by the op, in the order in which they appear in
+  // it.  For example, {node_id, child_id} for ADD_CHILD.
+  mozart::ResourceId ids[2] = {0, 0};
+
+  // The scalar argument of the op, if any: a tag value, an event mask, a
+  // HitTestBehavior, or the clip_to_self flag.
+  uint32_t value = 0;
+
+  // The vector argument of the op, if any: a translation, scale, anchor or
+  // size, the (x, y, z, w) of a rotation, or an RGBA color in [0, 1].
+  escher::vec4 vector;
+
+  // Ops which create resources, or carry handles, strings or arrays, are
+  // applied from their FIDL form, as are camera projections; they have
+  // nonetheless been validated.  Null for all other ops.
+  mozart2::OpPtr op;
+};
+
+// Validates |op| and decodes it into |command|.  Checks which do not depend on
+// the state of the session, such as the types of values, are all made here.
+// Returns false, having reported an error to |error_reporter|, if the op is
+// invalid.
+bool DecodeOp(mozart2::OpPtr op,
+              SessionCommand* command,
+              ErrorReporter* error_reporter);
+
+}  // namespace scene_manager
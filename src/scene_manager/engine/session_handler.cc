@@ -5,6 +5,7 @@
 #include "apps/mozart/src/scene_manager/engine/session_handler.h"
 
 #include "apps/mozart/src/scene_manager/scene_manager_impl.h"
+#include "apps/tracing/lib/trace/event.h"
 #include "lib/ftl/functional/make_copyable.h"
 
 namespace scene_manager {
@@ -25,6 +26,11 @@ SessionHandler::SessionHandler(
 
   bindings_.set_on_empty_set_handler([this]() { BeginTearDown(); });
   bindings_.AddBinding(this, std::move(request));
+
+  if (!engine->session_recording_directory().empty()) {
+    recorder_ = SessionRecorder::New(engine->session_recording_directory(),
+                                     session_id);
+  }
 }
 
 SessionHandler::~SessionHandler() {}
@@ -45,11 +51,20 @@ void SessionHandler::FlushEvents(uint64_t presentation_time) {
 }
 
 void SessionHandler::Enqueue(::fidl::Array<mozart2::OpPtr> ops) {
-  // TODO: Add them all at once instead of iterating.  The problem
-  // is that ::fidl::Array doesn't support this.  Or, at least reserve
-  // enough space.  But ::fidl::Array doesn't support this, either.
+  TRACE_DURATION("gfx", "SessionHandler::Enqueue", "count", ops.size());
+  if (recorder_)
+    recorder_->RecordEnqueue(ops);
+
+  // Validate and decode the ops now, rather than when they are applied during
+  // a frame.  If any op is invalid, the session is torn down right away.
+  buffered_commands_.reserve(buffered_commands_.size() + ops.size());
   for (auto& op : ops) {
-    buffered_ops_.push_back(std::move(op));
+    buffered_commands_.emplace_back();
+    if (!DecodeOp(std::move(op), &buffered_commands_.back(),
+                  static_cast<ErrorReporter*>(this))) {
+      BeginTearDown();
+      return;
+    }
   }
 }
 
@@ -57,7 +72,23 @@ void SessionHandler::Present(uint64_t presentation_time,
                              ::fidl::Array<mx::event> acquire_fences,
                              ::fidl::Array<mx::event> release_fences,
                              const PresentCallback& callback) {
-  session_->ScheduleUpdate(presentation_time, std::move(buffered_ops_),
+  if (recorder_) {
+    uint32_t present_id = recorder_->RecordPresent(
+        presentation_time, acquire_fences, release_fences.size());
+    auto weak_recorder = recorder_->GetWeakPtr();
+    session_->ScheduleUpdate(
+        presentation_time, std::move(buffered_commands_),
+        std::move(acquire_fences), std::move(release_fences),
+        [weak_recorder, present_id,
+         callback](mozart2::PresentationInfoPtr info) {
+          if (weak_recorder)
+            weak_recorder->RecordPresented(present_id, info);
+          callback(std::move(info));
+        });
+    return;
+  }
+
+  session_->ScheduleUpdate(presentation_time, std::move(buffered_commands_),
                            std::move(acquire_fences), std::move(release_fences),
                            callback);
 }
@@ -70,6 +101,39 @@ void SessionHandler::HitTest(uint32_t node_id,
                     callback);
 }
 
+void SessionHandler::GetFuturePresentationTimes(
+    uint32_t count,
+    const GetFuturePresentationTimesCallback& callback) {
+  std::vector<FuturePresentation> presentations =
+      engine_->GetFuturePresentations(count);
+  auto future_presentation_times =
+      ::fidl::Array<mozart2::FuturePresentationTimePtr>::New(
+          presentations.size());
+  for (size_t i = 0; i < presentations.size(); ++i) {
+    auto time = mozart2::FuturePresentationTime::New();
+    time->presentation_time = presentations[i].presentation_time;
+    time->latch_point = presentations[i].latch_point;
+    future_presentation_times[i] = std::move(time);
+  }
+  callback(std::move(future_presentation_times));
+}
+
+void SessionHandler::SetPriority(mozart2::SessionPriority priority) {
+  // SYSTEM sessions are exempt from the per-frame update budget, so clients
+  // may not claim it for themselves.
+  if (priority == mozart2::SessionPriority::SYSTEM) {
+    session_->error_reporter()->ERROR()
+        << "scene_manager::SessionHandler::SetPriority(): SYSTEM priority "
+           "is reserved for the scene manager's own sessions.";
+    return;
+  }
+  session_->set_priority(priority);
+}
+
+void SessionHandler::SetMaxUpdateRate(float updates_per_second) {
+  session_->SetMaxUpdateRate(updates_per_second);
+}
+
 void SessionHandler::ReportError(ftl::LogSeverity severity,
                                  std::string error_string) {
   switch (severity) {
@@ -100,6 +164,7 @@ void SessionHandler::BeginTearDown() {
 }
 
 void SessionHandler::TearDown() {
+  recorder_.reset();
   bindings_.CloseAllBindings();
   listener_.reset();
   session_->TearDown();
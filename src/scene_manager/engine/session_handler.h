@@ -6,6 +6,7 @@
 
 #include "apps/mozart/services/scene/session.fidl.h"
 #include "apps/mozart/src/scene_manager/engine/session.h"
+#include "apps/mozart/src/scene_manager/engine/session_recorder.h"
 #include "apps/mozart/src/scene_manager/util/error_reporter.h"
 #include "lib/fidl/cpp/bindings/binding_set.h"
 #include "lib/fidl/cpp/bindings/interface_ptr_set.h"
@@ -15,10 +16,9 @@ namespace scene_manager {
 
 class SceneManagerImpl;
 
-// Implements the Session FIDL interface.  For now, does nothing but buffer
-// operations from Enqueue() before passing them all to |session_| when Commit()
-// is called.  Eventually, this class may do more work if performance profiling
-// suggests to.
+// Implements the Session FIDL interface.  Validates and decodes the operations
+// passed to Enqueue(), then buffers them until they are passed to |session_|
+// when Present() is called.
 class SessionHandler : public mozart2::Session, private ErrorReporter {
  public:
   SessionHandler(Engine* engine,
@@ -48,6 +48,13 @@ class SessionHandler : public mozart2::Session, private ErrorReporter {
                mozart2::vec3Ptr ray_direction,
                const HitTestCallback& callback) override;
 
+  void GetFuturePresentationTimes(
+      uint32_t count,
+      const GetFuturePresentationTimesCallback& callback) override;
+
+  void SetPriority(mozart2::SessionPriority priority) override;
+  void SetMaxUpdateRate(float updates_per_second) override;
+
  private:
   friend class Engine;
 
@@ -69,8 +76,11 @@ class SessionHandler : public mozart2::Session, private ErrorReporter {
   ::fidl::BindingSet<mozart2::Session> bindings_;
   ::fidl::InterfacePtr<mozart2::SessionListener> listener_;
 
-  ::fidl::Array<mozart2::OpPtr> buffered_ops_;
+  std::vector<SessionCommand> buffered_commands_;
   ::fidl::Array<mozart2::EventPtr> buffered_events_;
+
+  // Only non-null when session recording is enabled; see SessionRecorder.
+  std::unique_ptr<SessionRecorder> recorder_;
 };
 
 }  // namespace scene_manager
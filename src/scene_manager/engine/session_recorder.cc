@@ -0,0 +1,114 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/engine/session_recorder.h"
+
+#include <fcntl.h>
+#include <magenta/syscalls.h>
+
+#include "lib/ftl/files/file_descriptor.h"
+#include "lib/ftl/logging.h"
+#include "lib/ftl/strings/string_printf.h"
+
+namespace scene_manager {
+
+std::unique_ptr<SessionRecorder> SessionRecorder::New(
+    const std::string& directory,
+    SessionId session_id) {
+  std::string path = ftl::StringPrintf("%s/session_%lu.rec", directory.c_str(),
+                                       session_id);
+  ftl::UniqueFD fd(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+  if (!fd.is_valid()) {
+    FTL_LOG(ERROR) << "SessionRecorder: could not create " << path;
+    return nullptr;
+  }
+  FTL_LOG(INFO) << "SessionRecorder: recording session " << session_id
+                << " to " << path;
+
+  auto recorder =
+      std::unique_ptr<SessionRecorder>(new SessionRecorder(std::move(fd)));
+  recorder->writer_.WriteHeader(session_id, mx_time_get(MX_CLOCK_MONOTONIC));
+  recorder->Flush();
+  return recorder;
+}
+
+SessionRecorder::SessionRecorder(ftl::UniqueFD fd)
+    : fd_(std::move(fd)), weak_factory_(this) {}
+
+SessionRecorder::~SessionRecorder() {
+  Flush();
+}
+
+void SessionRecorder::RecordEnqueue(const ::fidl::Array<mozart2::OpPtr>& ops) {
+  writer_.BeginRecord(recording::RecordType::kEnqueue,
+                      mx_time_get(MX_CLOCK_MONOTONIC));
+  writer_.WriteUint32(ops.size());
+  for (auto& op : ops) {
+    writer_.WriteOp(op);
+  }
+}
+
+uint32_t SessionRecorder::RecordPresent(
+    uint64_t requested_presentation_time,
+    const ::fidl::Array<mx::event>& acquire_fences,
+    size_t release_fence_count) {
+  uint32_t present_id = next_present_id_++;
+  writer_.BeginRecord(recording::RecordType::kPresent,
+                      mx_time_get(MX_CLOCK_MONOTONIC));
+  writer_.WriteUint32(present_id);
+  writer_.WriteUint64(requested_presentation_time);
+  writer_.WriteUint32(acquire_fences.size());
+  writer_.WriteUint32(release_fence_count);
+
+  // Watch duplicates of the acquire fences, so that the session's own
+  // AcquireFenceSet is unaffected.
+  auto duplicates = ::fidl::Array<mx::event>::New(0);
+  for (auto& fence : acquire_fences) {
+    mx::event duplicate;
+    if (fence.duplicate(MX_RIGHT_SAME_RIGHTS, &duplicate) == MX_OK) {
+      duplicates.push_back(std::move(duplicate));
+    }
+  }
+  auto fence_set = std::make_unique<AcquireFenceSet>(std::move(duplicates));
+  auto weak = weak_factory_.GetWeakPtr();
+  fence_set->WaitReadyAsync([weak, present_id] {
+    if (weak)
+      weak->OnAcquireFencesReady(present_id);
+  });
+  pending_acquire_fences_[present_id] = std::move(fence_set);
+
+  Flush();
+  return present_id;
+}
+
+void SessionRecorder::OnAcquireFencesReady(uint32_t present_id) {
+  writer_.BeginRecord(recording::RecordType::kAcquireFencesReady,
+                      mx_time_get(MX_CLOCK_MONOTONIC));
+  writer_.WriteUint32(present_id);
+  pending_acquire_fences_.erase(present_id);
+}
+
+void SessionRecorder::RecordPresented(
+    uint32_t present_id,
+    const mozart2::PresentationInfoPtr& info) {
+  writer_.BeginRecord(recording::RecordType::kPresented,
+                      mx_time_get(MX_CLOCK_MONOTONIC));
+  writer_.WriteUint32(present_id);
+  writer_.WriteUint64(info->presentation_time);
+  writer_.WriteUint64(info->presentation_interval);
+}
+
+void SessionRecorder::Flush() {
+  const auto& data = writer_.data();
+  if (data.empty())
+    return;
+  if (!ftl::WriteFileDescriptor(fd_.get(),
+                                reinterpret_cast<const char*>(data.data()),
+                                data.size())) {
+    FTL_LOG(ERROR) << "SessionRecorder: write failed; recording is truncated.";
+  }
+  writer_.Clear();
+}
+
+}  // namespace scene_manager
@@ -0,0 +1,72 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "apps/mozart/services/scene/session.fidl.h"
+#include "apps/mozart/src/scene_manager/acquire_fence_set.h"
+#include "apps/mozart/src/scene_manager/engine/session_recording.h"
+#include "lib/ftl/files/unique_fd.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+
+namespace scene_manager {
+
+using SessionId = uint64_t;
+
+// Writes the Enqueue()/Present() stream of a single session to a file, along
+// with the time at which each event was received, the time at which the acquire
+// fences of each Present() were signalled, and the time at which each update
+// was actually applied.  The recording can be replayed with the
+// scene_manager_replay tool; see session_recording.h for the format.
+//
+// Recording is enabled by passing --record_sessions=<directory> to the
+// scene_manager; each session is written to "<directory>/session_<id>.rec".
+class SessionRecorder {
+ public:
+  // Return nullptr if the recording file could not be created.
+  static std::unique_ptr<SessionRecorder> New(const std::string& directory,
+                                              SessionId session_id);
+  ~SessionRecorder();
+
+  void RecordEnqueue(const ::fidl::Array<mozart2::OpPtr>& ops);
+
+  // Return an id which identifies this Present() in subsequent calls to
+  // RecordPresented().  The recorder watches duplicates of |acquire_fences| to
+  // record when they are signalled.
+  uint32_t RecordPresent(uint64_t requested_presentation_time,
+                         const ::fidl::Array<mx::event>& acquire_fences,
+                         size_t release_fence_count);
+
+  void RecordPresented(uint32_t present_id,
+                       const mozart2::PresentationInfoPtr& info);
+
+  // Write all buffered records to the file.
+  void Flush();
+
+  ftl::WeakPtr<SessionRecorder> GetWeakPtr() {
+    return weak_factory_.GetWeakPtr();
+  }
+
+ private:
+  explicit SessionRecorder(ftl::UniqueFD fd);
+
+  void OnAcquireFencesReady(uint32_t present_id);
+
+  ftl::UniqueFD fd_;
+  recording::Writer writer_;
+  uint32_t next_present_id_ = 1;
+  std::unordered_map<uint32_t, std::unique_ptr<AcquireFenceSet>>
+      pending_acquire_fences_;
+
+  ftl::WeakPtrFactory<SessionRecorder> weak_factory_;  // must be last
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(SessionRecorder);
+};
+
+}  // namespace scene_manager
@@ -0,0 +1,993 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/engine/session_recording.h"
+
+#include <cstring>
+
+#include "lib/ftl/logging.h"
+#include "lib/mtl/handles/object_info.h"
+
+namespace scene_manager {
+namespace recording {
+
+namespace {
+
+// Written in place of a union tag when the union is null.
+constexpr uint32_t kNullTag = 0xffffffff;
+
+// Guards against allocating absurd amounts of memory when reading a corrupt
+// recording.
+constexpr uint32_t kMaxStringLength = 4096;
+constexpr uint32_t kMaxDirtyRectCount = 4096;
+
+}  // namespace
+
+void Writer::WriteHeader(uint64_t session_id, uint64_t start_time) {
+  WriteUint32(kMagic);
+  WriteUint32(kVersion);
+  WriteUint64(session_id);
+  WriteUint64(start_time);
+}
+
+void Writer::BeginRecord(RecordType type, uint64_t timestamp) {
+  WriteUint8(static_cast<uint8_t>(type));
+  WriteUint64(timestamp);
+}
+
+void Writer::WriteUint8(uint8_t value) {
+  data_.push_back(value);
+}
+
+void Writer::WriteUint32(uint32_t value) {
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    data_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+void Writer::WriteUint64(uint64_t value) {
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    data_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+void Writer::WriteFloat(float value) {
+  uint32_t bits;
+  static_assert(sizeof(bits) == sizeof(value), "unexpected float size");
+  memcpy(&bits, &value, sizeof(bits));
+  WriteUint32(bits);
+}
+
+void Writer::WriteString(const std::string& value) {
+  WriteUint32(value.size());
+  data_.insert(data_.end(), value.begin(), value.end());
+}
+
+void Writer::WriteVec3(const mozart2::vec3Ptr& value) {
+  WriteFloat(value->x);
+  WriteFloat(value->y);
+  WriteFloat(value->z);
+}
+
+void Writer::WriteVector3Value(const mozart2::Vector3ValuePtr& value) {
+  WriteVec3(value->value);
+  WriteUint32(value->variable_id);
+}
+
+void Writer::WriteEventPairKoids(mx_handle_t handle) {
+  WriteUint64(mtl::GetKoid(handle));
+  WriteUint64(mtl::GetRelatedKoid(handle));
+}
+
+void Writer::WriteValue(const mozart2::ValuePtr& value) {
+  if (!value) {
+    WriteUint32(kNullTag);
+    return;
+  }
+  WriteUint32(static_cast<uint32_t>(value->which()));
+  switch (value->which()) {
+    case mozart2::Value::Tag::VECTOR1:
+      WriteFloat(value->get_vector1());
+      break;
+    case mozart2::Value::Tag::VECTOR2:
+      WriteFloat(value->get_vector2()->x);
+      WriteFloat(value->get_vector2()->y);
+      break;
+    case mozart2::Value::Tag::VECTOR3:
+      WriteVec3(value->get_vector3());
+      break;
+    case mozart2::Value::Tag::VECTOR4:
+      WriteFloat(value->get_vector4()->x);
+      WriteFloat(value->get_vector4()->y);
+      WriteFloat(value->get_vector4()->z);
+      WriteFloat(value->get_vector4()->w);
+      break;
+    case mozart2::Value::Tag::MATRIX4X4:
+      for (size_t i = 0; i < 16; ++i) {
+        WriteFloat(value->get_matrix4x4()->matrix[i]);
+      }
+      break;
+    case mozart2::Value::Tag::COLOR_RGBA:
+      WriteUint8(value->get_color_rgba()->red);
+      WriteUint8(value->get_color_rgba()->green);
+      WriteUint8(value->get_color_rgba()->blue);
+      WriteUint8(value->get_color_rgba()->alpha);
+      break;
+    case mozart2::Value::Tag::DEGREES:
+      WriteFloat(value->get_degrees());
+      break;
+    case mozart2::Value::Tag::QUATERNION:
+      WriteFloat(value->get_quaternion()->x);
+      WriteFloat(value->get_quaternion()->y);
+      WriteFloat(value->get_quaternion()->z);
+      WriteFloat(value->get_quaternion()->w);
+      break;
+    case mozart2::Value::Tag::TRANSFORM: {
+      auto& transform = value->get_transform();
+      WriteVec3(transform->translation);
+      WriteVec3(transform->scale);
+      WriteVec3(transform->anchor);
+      WriteFloat(transform->rotation->x);
+      WriteFloat(transform->rotation->y);
+      WriteFloat(transform->rotation->z);
+      WriteFloat(transform->rotation->w);
+      break;
+    }
+    case mozart2::Value::Tag::VARIABLE_ID:
+      WriteUint32(value->get_variable_id());
+      break;
+    case mozart2::Value::Tag::__UNKNOWN__:
+      break;
+  }
+}
+
+void Writer::WriteResource(const mozart2::ResourcePtr& resource) {
+  WriteUint32(static_cast<uint32_t>(resource->which()));
+  switch (resource->which()) {
+    case mozart2::Resource::Tag::MEMORY: {
+      auto& memory = resource->get_memory();
+      uint64_t size = 0;
+      if (memory->vmo) {
+        memory->vmo.get_size(&size);
+      }
+      WriteUint32(static_cast<uint32_t>(memory->memory_type));
+      WriteUint64(size);
+      break;
+    }
+    case mozart2::Resource::Tag::IMAGE: {
+      auto& image = resource->get_image();
+      WriteUint32(image->info->width);
+      WriteUint32(image->info->height);
+      WriteUint32(image->info->stride);
+      WriteUint32(static_cast<uint32_t>(image->info->pixel_format));
+      WriteUint32(static_cast<uint32_t>(image->info->color_space));
+      WriteUint32(static_cast<uint32_t>(image->info->tiling));
+      WriteUint32(static_cast<uint32_t>(image->info->alpha_format));
+      WriteUint32(image->memory_id);
+      WriteUint32(image->memory_offset);
+      break;
+    }
+    case mozart2::Resource::Tag::BUFFER: {
+      auto& buffer = resource->get_buffer();
+      WriteUint32(buffer->memory_id);
+      WriteUint32(buffer->memory_offset);
+      WriteUint32(buffer->num_bytes);
+      break;
+    }
+    case mozart2::Resource::Tag::RECTANGLE:
+      WriteValue(resource->get_rectangle()->width);
+      WriteValue(resource->get_rectangle()->height);
+      break;
+    case mozart2::Resource::Tag::ROUNDED_RECTANGLE: {
+      auto& rect = resource->get_rounded_rectangle();
+      WriteValue(rect->width);
+      WriteValue(rect->height);
+      WriteValue(rect->top_left_radius);
+      WriteValue(rect->top_right_radius);
+      WriteValue(rect->bottom_right_radius);
+      WriteValue(rect->bottom_left_radius);
+      break;
+    }
+    case mozart2::Resource::Tag::CIRCLE:
+      WriteValue(resource->get_circle()->radius);
+      break;
+    case mozart2::Resource::Tag::MESH: {
+      auto& mesh = resource->get_mesh();
+      WriteUint32(mesh->index_buffer_id);
+      WriteUint32(static_cast<uint32_t>(mesh->index_format));
+      WriteUint64(mesh->index_offset);
+      WriteUint32(mesh->index_count);
+      WriteUint32(mesh->vertex_buffer_id);
+      WriteUint32(static_cast<uint32_t>(mesh->vertex_format->position_type));
+      WriteUint32(static_cast<uint32_t>(mesh->vertex_format->normal_type));
+      WriteUint32(static_cast<uint32_t>(mesh->vertex_format->tex_coord_type));
+      WriteUint64(mesh->vertex_offset);
+      WriteUint32(mesh->vertex_count);
+      break;
+    }
+    case mozart2::Resource::Tag::CAMERA:
+      WriteUint32(resource->get_camera()->scene_id);
+      break;
+    case mozart2::Resource::Tag::DIRECTIONAL_LIGHT:
+      WriteValue(resource->get_directional_light()->direction);
+      WriteValue(resource->get_directional_light()->intensity);
+      break;
+    case mozart2::Resource::Tag::VARIABLE:
+      WriteUint32(static_cast<uint32_t>(resource->get_variable()->type));
+      WriteValue(resource->get_variable()->initial_value);
+      break;
+    // The remaining resources either have no arguments, or only have handle
+    // arguments which are recreated during replay.
+    case mozart2::Resource::Tag::IMAGE_PIPE:
+    case mozart2::Resource::Tag::MATERIAL:
+    case mozart2::Resource::Tag::CLIP_NODE:
+    case mozart2::Resource::Tag::ENTITY_NODE:
+    case mozart2::Resource::Tag::SHAPE_NODE:
+    case mozart2::Resource::Tag::DISPLAY_COMPOSITOR:
+    case mozart2::Resource::Tag::IMAGE_PIPE_COMPOSITOR:
+    case mozart2::Resource::Tag::LAYER_STACK:
+    case mozart2::Resource::Tag::LAYER:
+    case mozart2::Resource::Tag::SCENE:
+    case mozart2::Resource::Tag::RENDERER:
+    case mozart2::Resource::Tag::__UNKNOWN__:
+      break;
+  }
+}
+
+void Writer::WriteOp(const mozart2::OpPtr& op) {
+  WriteUint32(static_cast<uint32_t>(op->which()));
+  switch (op->which()) {
+    case mozart2::Op::Tag::CREATE_RESOURCE:
+      WriteUint32(op->get_create_resource()->id);
+      WriteResource(op->get_create_resource()->resource);
+      break;
+    case mozart2::Op::Tag::RELEASE_RESOURCE:
+      WriteUint32(op->get_release_resource()->id);
+      break;
+    case mozart2::Op::Tag::EXPORT_RESOURCE:
+      WriteUint32(op->get_export_resource()->id);
+      WriteEventPairKoids(op->get_export_resource()->token.get());
+      break;
+    case mozart2::Op::Tag::IMPORT_RESOURCE:
+      WriteUint32(op->get_import_resource()->id);
+      WriteEventPairKoids(op->get_import_resource()->token.get());
+      WriteUint32(static_cast<uint32_t>(op->get_import_resource()->spec));
+      break;
+    case mozart2::Op::Tag::SET_TAG:
+      WriteUint32(op->get_set_tag()->node_id);
+      WriteUint32(op->get_set_tag()->tag_value);
+      break;
+    case mozart2::Op::Tag::DETACH:
+      WriteUint32(op->get_detach()->id);
+      break;
+    case mozart2::Op::Tag::SET_TRANSLATION:
+      WriteUint32(op->get_set_translation()->id);
+      WriteVector3Value(op->get_set_translation()->value);
+      break;
+    case mozart2::Op::Tag::SET_SCALE:
+      WriteUint32(op->get_set_scale()->id);
+      WriteVector3Value(op->get_set_scale()->value);
+      break;
+    case mozart2::Op::Tag::SET_ROTATION: {
+      auto& rotation = op->get_set_rotation();
+      WriteUint32(rotation->id);
+      WriteFloat(rotation->value->value->x);
+      WriteFloat(rotation->value->value->y);
+      WriteFloat(rotation->value->value->z);
+      WriteFloat(rotation->value->value->w);
+      WriteUint32(rotation->value->variable_id);
+      break;
+    }
+    case mozart2::Op::Tag::SET_ANCHOR:
+      WriteUint32(op->get_set_anchor()->id);
+      WriteVector3Value(op->get_set_anchor()->value);
+      break;
+    case mozart2::Op::Tag::SET_SIZE:
+      WriteUint32(op->get_set_size()->id);
+      WriteFloat(op->get_set_size()->value->value->x);
+      WriteFloat(op->get_set_size()->value->value->y);
+      WriteUint32(op->get_set_size()->value->variable_id);
+      break;
+    case mozart2::Op::Tag::ADD_CHILD:
+      WriteUint32(op->get_add_child()->node_id);
+      WriteUint32(op->get_add_child()->child_id);
+      break;
+    case mozart2::Op::Tag::ADD_PART:
+      WriteUint32(op->get_add_part()->node_id);
+      WriteUint32(op->get_add_part()->part_id);
+      break;
+    case mozart2::Op::Tag::DETACH_CHILDREN:
+      WriteUint32(op->get_detach_children()->node_id);
+      break;
+    case mozart2::Op::Tag::SET_SHAPE:
+      WriteUint32(op->get_set_shape()->node_id);
+      WriteUint32(op->get_set_shape()->shape_id);
+      break;
+    case mozart2::Op::Tag::SET_MATERIAL:
+      WriteUint32(op->get_set_material()->node_id);
+      WriteUint32(op->get_set_material()->material_id);
+      break;
+    case mozart2::Op::Tag::SET_CLIP:
+      WriteUint32(op->get_set_clip()->node_id);
+      WriteUint32(op->get_set_clip()->clip_id);
+      WriteUint8(op->get_set_clip()->clip_to_self ? 1 : 0);
+      break;
+    case mozart2::Op::Tag::SET_HIT_TEST_BEHAVIOR:
+      WriteUint32(op->get_set_hit_test_behavior()->node_id);
+      WriteUint32(static_cast<uint32_t>(
+          op->get_set_hit_test_behavior()->hit_test_behavior));
+      break;
+    case mozart2::Op::Tag::SET_CAMERA:
+      WriteUint32(op->get_set_camera()->renderer_id);
+      WriteUint32(op->get_set_camera()->camera_id);
+      break;
+    case mozart2::Op::Tag::SET_CAMERA_PROJECTION: {
+      auto& projection = op->get_set_camera_projection();
+      WriteUint32(projection->camera_id);
+      WriteVector3Value(projection->eye_position);
+      WriteVector3Value(projection->eye_look_at);
+      WriteVector3Value(projection->eye_up);
+      WriteFloat(projection->fovy->value);
+      WriteUint32(projection->fovy->variable_id);
+      break;
+    }
+    case mozart2::Op::Tag::SET_LIGHT_INTENSITY:
+      WriteUint32(op->get_set_light_intensity()->light_id);
+      WriteValue(op->get_set_light_intensity()->intensity);
+      break;
+    case mozart2::Op::Tag::SET_TEXTURE:
+      WriteUint32(op->get_set_texture()->material_id);
+      WriteUint32(op->get_set_texture()->texture_id);
+      break;
+    case mozart2::Op::Tag::INVALIDATE_IMAGE: {
+      auto& invalidate = op->get_invalidate_image();
+      WriteUint32(invalidate->image_id);
+      WriteUint32(invalidate->dirty_rects.size());
+      for (const auto& rect : invalidate->dirty_rects) {
+        WriteUint32(rect->x);
+        WriteUint32(rect->y);
+        WriteUint32(rect->width);
+        WriteUint32(rect->height);
+      }
+      break;
+    }
+    case mozart2::Op::Tag::SET_COLOR: {
+      auto& color = op->get_set_color()->color;
+      WriteUint32(op->get_set_color()->material_id);
+      WriteUint8(color->value->red);
+      WriteUint8(color->value->green);
+      WriteUint8(color->value->blue);
+      WriteUint8(color->value->alpha);
+      WriteUint32(color->variable_id);
+      break;
+    }
+    case mozart2::Op::Tag::ADD_LAYER:
+      WriteUint32(op->get_add_layer()->layer_stack_id);
+      WriteUint32(op->get_add_layer()->layer_id);
+      break;
+    case mozart2::Op::Tag::SET_LAYER_STACK:
+      WriteUint32(op->get_set_layer_stack()->compositor_id);
+      WriteUint32(op->get_set_layer_stack()->layer_stack_id);
+      break;
+    case mozart2::Op::Tag::SET_RENDERER:
+      WriteUint32(op->get_set_renderer()->layer_id);
+      WriteUint32(op->get_set_renderer()->renderer_id);
+      break;
+    case mozart2::Op::Tag::SET_EVENT_MASK:
+      WriteUint32(op->get_set_event_mask()->id);
+      WriteUint32(op->get_set_event_mask()->event_mask);
+      break;
+    case mozart2::Op::Tag::SET_LABEL:
+      WriteUint32(op->get_set_label()->id);
+      WriteString(op->get_set_label()->label.get());
+      break;
+    case mozart2::Op::Tag::__UNKNOWN__:
+      break;
+  }
+}
+
+Reader::Reader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+bool Reader::ReadBytes(void* out, size_t count) {
+  if (size_ - position_ < count)
+    return false;
+  memcpy(out, data_ + position_, count);
+  position_ += count;
+  return true;
+}
+
+bool Reader::ReadHeader(uint64_t* session_id, uint64_t* start_time) {
+  uint32_t magic, version;
+  if (!ReadUint32(&magic) || magic != kMagic) {
+    FTL_LOG(ERROR) << "Not a session recording.";
+    return false;
+  }
+  if (!ReadUint32(&version) || version != kVersion) {
+    FTL_LOG(ERROR) << "Unsupported session recording version: " << version;
+    return false;
+  }
+  return ReadUint64(session_id) && ReadUint64(start_time);
+}
+
+bool Reader::ReadRecordHeader(RecordType* type, uint64_t* timestamp) {
+  uint8_t raw_type;
+  if (!ReadUint8(&raw_type) || !ReadUint64(timestamp))
+    return false;
+  *type = static_cast<RecordType>(raw_type);
+  return true;
+}
+
+bool Reader::ReadUint8(uint8_t* value) {
+  return ReadBytes(value, sizeof(*value));
+}
+
+bool Reader::ReadUint32(uint32_t* value) {
+  uint8_t bytes[sizeof(*value)];
+  if (!ReadBytes(bytes, sizeof(bytes)))
+    return false;
+  *value = 0;
+  for (size_t i = 0; i < sizeof(bytes); ++i) {
+    *value |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+  }
+  return true;
+}
+
+bool Reader::ReadUint64(uint64_t* value) {
+  uint8_t bytes[sizeof(*value)];
+  if (!ReadBytes(bytes, sizeof(bytes)))
+    return false;
+  *value = 0;
+  for (size_t i = 0; i < sizeof(bytes); ++i) {
+    *value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+  }
+  return true;
+}
+
+bool Reader::ReadFloat(float* value) {
+  uint32_t bits;
+  if (!ReadUint32(&bits))
+    return false;
+  memcpy(value, &bits, sizeof(bits));
+  return true;
+}
+
+bool Reader::ReadString(std::string* value) {
+  uint32_t length;
+  if (!ReadUint32(&length) || length > kMaxStringLength ||
+      size_ - position_ < length)
+    return false;
+  value->assign(reinterpret_cast<const char*>(data_ + position_), length);
+  position_ += length;
+  return true;
+}
+
+mozart2::vec3Ptr Reader::ReadVec3() {
+  auto vec = mozart2::vec3::New();
+  if (!ReadFloat(&vec->x) || !ReadFloat(&vec->y) || !ReadFloat(&vec->z))
+    return nullptr;
+  return vec;
+}
+
+mozart2::Vector3ValuePtr Reader::ReadVector3Value() {
+  auto value = mozart2::Vector3Value::New();
+  value->value = ReadVec3();
+  if (!value->value || !ReadUint32(&value->variable_id))
+    return nullptr;
+  return value;
+}
+
+mx::eventpair Reader::ReadEventPair(HandleFactory* handle_factory) {
+  uint64_t koid, related_koid;
+  if (!ReadUint64(&koid) || !ReadUint64(&related_koid))
+    return mx::eventpair();
+  return handle_factory->CreateEventPair(koid, related_koid);
+}
+
+mozart2::ValuePtr Reader::ReadValue() {
+  uint32_t tag;
+  if (!ReadUint32(&tag) || tag == kNullTag)
+    return nullptr;
+
+  auto value = mozart2::Value::New();
+  bool ok = true;
+  switch (static_cast<mozart2::Value::Tag>(tag)) {
+    case mozart2::Value::Tag::VECTOR1: {
+      float f = 0.f;
+      ok = ReadFloat(&f);
+      value->set_vector1(f);
+      break;
+    }
+    case mozart2::Value::Tag::VECTOR2: {
+      auto vec = mozart2::vec2::New();
+      ok = ReadFloat(&vec->x) && ReadFloat(&vec->y);
+      value->set_vector2(std::move(vec));
+      break;
+    }
+    case mozart2::Value::Tag::VECTOR3: {
+      auto vec = ReadVec3();
+      ok = !!vec;
+      value->set_vector3(std::move(vec));
+      break;
+    }
+    case mozart2::Value::Tag::VECTOR4: {
+      auto vec = mozart2::vec4::New();
+      ok = ReadFloat(&vec->x) && ReadFloat(&vec->y) && ReadFloat(&vec->z) &&
+           ReadFloat(&vec->w);
+      value->set_vector4(std::move(vec));
+      break;
+    }
+    case mozart2::Value::Tag::MATRIX4X4: {
+      auto mat = mozart2::mat4::New();
+      mat->matrix = ::fidl::Array<float>::New(16);
+      for (size_t i = 0; i < 16 && ok; ++i) {
+        ok = ReadFloat(&mat->matrix[i]);
+      }
+      value->set_matrix4x4(std::move(mat));
+      break;
+    }
+    case mozart2::Value::Tag::COLOR_RGBA: {
+      auto color = mozart2::ColorRgba::New();
+      ok = ReadUint8(&color->red) && ReadUint8(&color->green) &&
+           ReadUint8(&color->blue) && ReadUint8(&color->alpha);
+      value->set_color_rgba(std::move(color));
+      break;
+    }
+    case mozart2::Value::Tag::DEGREES: {
+      float f = 0.f;
+      ok = ReadFloat(&f);
+      value->set_degrees(f);
+      break;
+    }
+    case mozart2::Value::Tag::QUATERNION: {
+      auto quat = mozart2::Quaternion::New();
+      ok = ReadFloat(&quat->x) && ReadFloat(&quat->y) && ReadFloat(&quat->z) &&
+           ReadFloat(&quat->w);
+      value->set_quaternion(std::move(quat));
+      break;
+    }
+    case mozart2::Value::Tag::TRANSFORM: {
+      auto transform = mozart2::Transform::New();
+      transform->translation = ReadVec3();
+      transform->scale = ReadVec3();
+      transform->anchor = ReadVec3();
+      transform->rotation = mozart2::Quaternion::New();
+      ok = transform->translation && transform->scale && transform->anchor &&
+           ReadFloat(&transform->rotation->x) &&
+           ReadFloat(&transform->rotation->y) &&
+           ReadFloat(&transform->rotation->z) &&
+           ReadFloat(&transform->rotation->w);
+      value->set_transform(std::move(transform));
+      break;
+    }
+    case mozart2::Value::Tag::VARIABLE_ID: {
+      uint32_t variable_id = 0;
+      ok = ReadUint32(&variable_id);
+      value->set_variable_id(variable_id);
+      break;
+    }
+    default:
+      ok = false;
+      break;
+  }
+  if (!ok)
+    return nullptr;
+  return value;
+}
+
+mozart2::ResourcePtr Reader::ReadResource(HandleFactory* handle_factory) {
+  uint32_t tag;
+  if (!ReadUint32(&tag))
+    return nullptr;
+
+  auto resource = mozart2::Resource::New();
+  bool ok = true;
+  switch (static_cast<mozart2::Resource::Tag>(tag)) {
+    case mozart2::Resource::Tag::MEMORY: {
+      auto memory = mozart2::Memory::New();
+      uint32_t memory_type;
+      uint64_t size;
+      ok = ReadUint32(&memory_type) && ReadUint64(&size);
+      memory->memory_type = static_cast<mozart2::MemoryType>(memory_type);
+      if (ok)
+        memory->vmo = handle_factory->CreateVmo(size);
+      resource->set_memory(std::move(memory));
+      break;
+    }
+    case mozart2::Resource::Tag::IMAGE: {
+      auto image = mozart2::Image::New();
+      image->info = mozart2::ImageInfo::New();
+      uint32_t pixel_format, color_space, tiling, alpha_format;
+      ok = ReadUint32(&image->info->width) &&
+           ReadUint32(&image->info->height) &&
+           ReadUint32(&image->info->stride) && ReadUint32(&pixel_format) &&
+           ReadUint32(&color_space) && ReadUint32(&tiling) &&
+           ReadUint32(&alpha_format) && ReadUint32(&image->memory_id) &&
+           ReadUint32(&image->memory_offset);
+      image->info->pixel_format =
+          static_cast<mozart2::ImageInfo::PixelFormat>(pixel_format);
+      image->info->color_space =
+          static_cast<mozart2::ImageInfo::ColorSpace>(color_space);
+      image->info->tiling = static_cast<mozart2::ImageInfo::Tiling>(tiling);
+      image->info->alpha_format =
+          static_cast<mozart2::ImageInfo::AlphaFormat>(alpha_format);
+      resource->set_image(std::move(image));
+      break;
+    }
+    case mozart2::Resource::Tag::IMAGE_PIPE: {
+      auto image_pipe = mozart2::ImagePipeArgs::New();
+      image_pipe->image_pipe_request = handle_factory->CreateImagePipe();
+      resource->set_image_pipe(std::move(image_pipe));
+      break;
+    }
+    case mozart2::Resource::Tag::BUFFER: {
+      auto buffer = mozart2::Buffer::New();
+      ok = ReadUint32(&buffer->memory_id) &&
+           ReadUint32(&buffer->memory_offset) &&
+           ReadUint32(&buffer->num_bytes);
+      resource->set_buffer(std::move(buffer));
+      break;
+    }
+    case mozart2::Resource::Tag::RECTANGLE: {
+      auto rect = mozart2::Rectangle::New();
+      rect->width = ReadValue();
+      rect->height = ReadValue();
+      ok = rect->width && rect->height;
+      resource->set_rectangle(std::move(rect));
+      break;
+    }
+    case mozart2::Resource::Tag::ROUNDED_RECTANGLE: {
+      auto rect = mozart2::RoundedRectangle::New();
+      rect->width = ReadValue();
+      rect->height = ReadValue();
+      rect->top_left_radius = ReadValue();
+      rect->top_right_radius = ReadValue();
+      rect->bottom_right_radius = ReadValue();
+      rect->bottom_left_radius = ReadValue();
+      ok = rect->width && rect->height && rect->top_left_radius &&
+           rect->top_right_radius && rect->bottom_right_radius &&
+           rect->bottom_left_radius;
+      resource->set_rounded_rectangle(std::move(rect));
+      break;
+    }
+    case mozart2::Resource::Tag::CIRCLE: {
+      auto circle = mozart2::Circle::New();
+      circle->radius = ReadValue();
+      ok = !!circle->radius;
+      resource->set_circle(std::move(circle));
+      break;
+    }
+    case mozart2::Resource::Tag::MESH: {
+      auto mesh = mozart2::Mesh::New();
+      mesh->vertex_format = mozart2::MeshVertexFormat::New();
+      uint32_t index_format, position_type, normal_type, tex_coord_type;
+      ok = ReadUint32(&mesh->index_buffer_id) && ReadUint32(&index_format) &&
+           ReadUint64(&mesh->index_offset) && ReadUint32(&mesh->index_count) &&
+           ReadUint32(&mesh->vertex_buffer_id) &&
+           ReadUint32(&position_type) && ReadUint32(&normal_type) &&
+           ReadUint32(&tex_coord_type) && ReadUint64(&mesh->vertex_offset) &&
+           ReadUint32(&mesh->vertex_count);
+      mesh->index_format = static_cast<mozart2::MeshIndexFormat>(index_format);
+      mesh->vertex_format->position_type =
+          static_cast<mozart2::ValueType>(position_type);
+      mesh->vertex_format->normal_type =
+          static_cast<mozart2::ValueType>(normal_type);
+      mesh->vertex_format->tex_coord_type =
+          static_cast<mozart2::ValueType>(tex_coord_type);
+      resource->set_mesh(std::move(mesh));
+      break;
+    }
+    case mozart2::Resource::Tag::MATERIAL:
+      resource->set_material(mozart2::Material::New());
+      break;
+    case mozart2::Resource::Tag::CLIP_NODE:
+      resource->set_clip_node(mozart2::ClipNode::New());
+      break;
+    case mozart2::Resource::Tag::ENTITY_NODE:
+      resource->set_entity_node(mozart2::EntityNode::New());
+      break;
+    case mozart2::Resource::Tag::SHAPE_NODE:
+      resource->set_shape_node(mozart2::ShapeNode::New());
+      break;
+    case mozart2::Resource::Tag::DISPLAY_COMPOSITOR:
+      resource->set_display_compositor(mozart2::DisplayCompositor::New());
+      break;
+    case mozart2::Resource::Tag::IMAGE_PIPE_COMPOSITOR:
+      // The target ImagePipe is not recorded.
+      resource->set_image_pipe_compositor(
+          mozart2::ImagePipeCompositor::New());
+      break;
+    case mozart2::Resource::Tag::LAYER_STACK:
+      resource->set_layer_stack(mozart2::LayerStack::New());
+      break;
+    case mozart2::Resource::Tag::LAYER:
+      resource->set_layer(mozart2::Layer::New());
+      break;
+    case mozart2::Resource::Tag::SCENE:
+      resource->set_scene(mozart2::Scene::New());
+      break;
+    case mozart2::Resource::Tag::CAMERA: {
+      auto camera = mozart2::Camera::New();
+      ok = ReadUint32(&camera->scene_id);
+      resource->set_camera(std::move(camera));
+      break;
+    }
+    case mozart2::Resource::Tag::RENDERER:
+      resource->set_renderer(mozart2::Renderer::New());
+      break;
+    case mozart2::Resource::Tag::DIRECTIONAL_LIGHT: {
+      auto light = mozart2::DirectionalLight::New();
+      light->direction = ReadValue();
+      light->intensity = ReadValue();
+      ok = light->direction && light->intensity;
+      resource->set_directional_light(std::move(light));
+      break;
+    }
+    case mozart2::Resource::Tag::VARIABLE: {
+      auto variable = mozart2::Variable::New();
+      uint32_t type;
+      ok = ReadUint32(&type);
+      variable->type = static_cast<mozart2::ValueType>(type);
+      variable->initial_value = ReadValue();
+      ok = ok && variable->initial_value;
+      resource->set_variable(std::move(variable));
+      break;
+    }
+    default:
+      ok = false;
+      break;
+  }
+  if (!ok)
+    return nullptr;
+  return resource;
+}
+
+mozart2::OpPtr Reader::ReadOp(HandleFactory* handle_factory) {
+  uint32_t tag;
+  if (!ReadUint32(&tag))
+    return nullptr;
+
+  auto op = mozart2::Op::New();
+  bool ok = true;
+  switch (static_cast<mozart2::Op::Tag>(tag)) {
+    case mozart2::Op::Tag::CREATE_RESOURCE: {
+      auto create = mozart2::CreateResourceOp::New();
+      ok = ReadUint32(&create->id) &&
+           (create->resource = ReadResource(handle_factory));
+      op->set_create_resource(std::move(create));
+      break;
+    }
+    case mozart2::Op::Tag::RELEASE_RESOURCE: {
+      auto release = mozart2::ReleaseResourceOp::New();
+      ok = ReadUint32(&release->id);
+      op->set_release_resource(std::move(release));
+      break;
+    }
+    case mozart2::Op::Tag::EXPORT_RESOURCE: {
+      auto export_op = mozart2::ExportResourceOp::New();
+      ok = ReadUint32(&export_op->id);
+      export_op->token = ReadEventPair(handle_factory);
+      op->set_export_resource(std::move(export_op));
+      break;
+    }
+    case mozart2::Op::Tag::IMPORT_RESOURCE: {
+      auto import_op = mozart2::ImportResourceOp::New();
+      uint32_t spec;
+      ok = ReadUint32(&import_op->id);
+      import_op->token = ReadEventPair(handle_factory);
+      ok = ok && ReadUint32(&spec);
+      import_op->spec = static_cast<mozart2::ImportSpec>(spec);
+      op->set_import_resource(std::move(import_op));
+      break;
+    }
+    case mozart2::Op::Tag::SET_TAG: {
+      auto set_tag = mozart2::SetTagOp::New();
+      ok = ReadUint32(&set_tag->node_id) && ReadUint32(&set_tag->tag_value);
+      op->set_set_tag(std::move(set_tag));
+      break;
+    }
+    case mozart2::Op::Tag::DETACH: {
+      auto detach = mozart2::DetachOp::New();
+      ok = ReadUint32(&detach->id);
+      op->set_detach(std::move(detach));
+      break;
+    }
+    case mozart2::Op::Tag::SET_TRANSLATION: {
+      auto set_translation = mozart2::SetTranslationOp::New();
+      ok = ReadUint32(&set_translation->id) &&
+           (set_translation->value = ReadVector3Value());
+      op->set_set_translation(std::move(set_translation));
+      break;
+    }
+    case mozart2::Op::Tag::SET_SCALE: {
+      auto set_scale = mozart2::SetScaleOp::New();
+      ok = ReadUint32(&set_scale->id) && (set_scale->value = ReadVector3Value());
+      op->set_set_scale(std::move(set_scale));
+      break;
+    }
+    case mozart2::Op::Tag::SET_ROTATION: {
+      auto set_rotation = mozart2::SetRotationOp::New();
+      set_rotation->value = mozart2::QuaternionValue::New();
+      set_rotation->value->value = mozart2::Quaternion::New();
+      auto& quat = set_rotation->value->value;
+      ok = ReadUint32(&set_rotation->id) && ReadFloat(&quat->x) &&
+           ReadFloat(&quat->y) && ReadFloat(&quat->z) && ReadFloat(&quat->w) &&
+           ReadUint32(&set_rotation->value->variable_id);
+      op->set_set_rotation(std::move(set_rotation));
+      break;
+    }
+    case mozart2::Op::Tag::SET_ANCHOR: {
+      auto set_anchor = mozart2::SetAnchorOp::New();
+      ok = ReadUint32(&set_anchor->id) &&
+           (set_anchor->value = ReadVector3Value());
+      op->set_set_anchor(std::move(set_anchor));
+      break;
+    }
+    case mozart2::Op::Tag::SET_SIZE: {
+      auto set_size = mozart2::SetSizeOp::New();
+      set_size->value = mozart2::Vector2Value::New();
+      set_size->value->value = mozart2::vec2::New();
+      ok = ReadUint32(&set_size->id) &&
+           ReadFloat(&set_size->value->value->x) &&
+           ReadFloat(&set_size->value->value->y) &&
+           ReadUint32(&set_size->value->variable_id);
+      op->set_set_size(std::move(set_size));
+      break;
+    }
+    case mozart2::Op::Tag::ADD_CHILD: {
+      auto add_child = mozart2::AddChildOp::New();
+      ok = ReadUint32(&add_child->node_id) && ReadUint32(&add_child->child_id);
+      op->set_add_child(std::move(add_child));
+      break;
+    }
+    case mozart2::Op::Tag::ADD_PART: {
+      auto add_part = mozart2::AddPartOp::New();
+      ok = ReadUint32(&add_part->node_id) && ReadUint32(&add_part->part_id);
+      op->set_add_part(std::move(add_part));
+      break;
+    }
+    case mozart2::Op::Tag::DETACH_CHILDREN: {
+      auto detach_children = mozart2::DetachChildrenOp::New();
+      ok = ReadUint32(&detach_children->node_id);
+      op->set_detach_children(std::move(detach_children));
+      break;
+    }
+    case mozart2::Op::Tag::SET_SHAPE: {
+      auto set_shape = mozart2::SetShapeOp::New();
+      ok = ReadUint32(&set_shape->node_id) && ReadUint32(&set_shape->shape_id);
+      op->set_set_shape(std::move(set_shape));
+      break;
+    }
+    case mozart2::Op::Tag::SET_MATERIAL: {
+      auto set_material = mozart2::SetMaterialOp::New();
+      ok = ReadUint32(&set_material->node_id) &&
+           ReadUint32(&set_material->material_id);
+      op->set_set_material(std::move(set_material));
+      break;
+    }
+    case mozart2::Op::Tag::SET_CLIP: {
+      auto set_clip = mozart2::SetClipOp::New();
+      uint8_t clip_to_self = 0;
+      ok = ReadUint32(&set_clip->node_id) && ReadUint32(&set_clip->clip_id) &&
+           ReadUint8(&clip_to_self);
+      set_clip->clip_to_self = clip_to_self != 0;
+      op->set_set_clip(std::move(set_clip));
+      break;
+    }
+    case mozart2::Op::Tag::SET_HIT_TEST_BEHAVIOR: {
+      auto set_behavior = mozart2::SetHitTestBehaviorOp::New();
+      uint32_t behavior;
+      ok = ReadUint32(&set_behavior->node_id) && ReadUint32(&behavior);
+      set_behavior->hit_test_behavior =
+          static_cast<mozart2::HitTestBehavior>(behavior);
+      op->set_set_hit_test_behavior(std::move(set_behavior));
+      break;
+    }
+    case mozart2::Op::Tag::SET_CAMERA: {
+      auto set_camera = mozart2::SetCameraOp::New();
+      ok = ReadUint32(&set_camera->renderer_id) &&
+           ReadUint32(&set_camera->camera_id);
+      op->set_set_camera(std::move(set_camera));
+      break;
+    }
+    case mozart2::Op::Tag::SET_CAMERA_PROJECTION: {
+      auto projection = mozart2::SetCameraProjectionOp::New();
+      projection->fovy = mozart2::FloatValue::New();
+      ok = ReadUint32(&projection->camera_id) &&
+           (projection->eye_position = ReadVector3Value()) &&
+           (projection->eye_look_at = ReadVector3Value()) &&
+           (projection->eye_up = ReadVector3Value()) &&
+           ReadFloat(&projection->fovy->value) &&
+           ReadUint32(&projection->fovy->variable_id);
+      op->set_set_camera_projection(std::move(projection));
+      break;
+    }
+    case mozart2::Op::Tag::SET_LIGHT_INTENSITY: {
+      auto set_intensity = mozart2::SetLightIntensityOp::New();
+      ok = ReadUint32(&set_intensity->light_id) &&
+           (set_intensity->intensity = ReadValue());
+      op->set_set_light_intensity(std::move(set_intensity));
+      break;
+    }
+    case mozart2::Op::Tag::SET_TEXTURE: {
+      auto set_texture = mozart2::SetTextureOp::New();
+      ok = ReadUint32(&set_texture->material_id) &&
+           ReadUint32(&set_texture->texture_id);
+      op->set_set_texture(std::move(set_texture));
+      break;
+    }
+    case mozart2::Op::Tag::INVALIDATE_IMAGE: {
+      auto invalidate = mozart2::InvalidateImageOp::New();
+      uint32_t rect_count;
+      ok = ReadUint32(&invalidate->image_id) && ReadUint32(&rect_count) &&
+           rect_count <= kMaxDirtyRectCount;
+      invalidate->dirty_rects =
+          ::fidl::Array<mozart2::ImageRectPtr>::New(ok ? rect_count : 0);
+      for (size_t i = 0; i < invalidate->dirty_rects.size() && ok; ++i) {
+        auto rect = mozart2::ImageRect::New();
+        ok = ReadUint32(&rect->x) && ReadUint32(&rect->y) &&
+             ReadUint32(&rect->width) && ReadUint32(&rect->height);
+        invalidate->dirty_rects[i] = std::move(rect);
+      }
+      op->set_invalidate_image(std::move(invalidate));
+      break;
+    }
+    case mozart2::Op::Tag::SET_COLOR: {
+      auto set_color = mozart2::SetColorOp::New();
+      set_color->color = mozart2::ColorRgbaValue::New();
+      set_color->color->value = mozart2::ColorRgba::New();
+      auto& color = set_color->color->value;
+      ok = ReadUint32(&set_color->material_id) && ReadUint8(&color->red) &&
+           ReadUint8(&color->green) && ReadUint8(&color->blue) &&
+           ReadUint8(&color->alpha) &&
+           ReadUint32(&set_color->color->variable_id);
+      op->set_set_color(std::move(set_color));
+      break;
+    }
+    case mozart2::Op::Tag::ADD_LAYER: {
+      auto add_layer = mozart2::AddLayerOp::New();
+      ok = ReadUint32(&add_layer->layer_stack_id) &&
+           ReadUint32(&add_layer->layer_id);
+      op->set_add_layer(std::move(add_layer));
+      break;
+    }
+    case mozart2::Op::Tag::SET_LAYER_STACK: {
+      auto set_layer_stack = mozart2::SetLayerStackOp::New();
+      ok = ReadUint32(&set_layer_stack->compositor_id) &&
+           ReadUint32(&set_layer_stack->layer_stack_id);
+      op->set_set_layer_stack(std::move(set_layer_stack));
+      break;
+    }
+    case mozart2::Op::Tag::SET_RENDERER: {
+      auto set_renderer = mozart2::SetRendererOp::New();
+      ok = ReadUint32(&set_renderer->layer_id) &&
+           ReadUint32(&set_renderer->renderer_id);
+      op->set_set_renderer(std::move(set_renderer));
+      break;
+    }
+    case mozart2::Op::Tag::SET_EVENT_MASK: {
+      auto set_event_mask = mozart2::SetEventMaskOp::New();
+      ok = ReadUint32(&set_event_mask->id) &&
+           ReadUint32(&set_event_mask->event_mask);
+      op->set_set_event_mask(std::move(set_event_mask));
+      break;
+    }
+    case mozart2::Op::Tag::SET_LABEL: {
+      auto set_label = mozart2::SetLabelOp::New();
+      std::string label;
+      ok = ReadUint32(&set_label->id) && ReadString(&label);
+      set_label->label = label;
+      op->set_set_label(std::move(set_label));
+      break;
+    }
+    default:
+      ok = false;
+      break;
+  }
+  if (!ok)
+    return nullptr;
+  return op;
+}
+
+}  // namespace recording
+}  // namespace scene_manager
@@ -0,0 +1,134 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "apps/mozart/services/scene/ops.fidl.h"
+#include "lib/ftl/macros.h"
+
+namespace scene_manager {
+
+// Binary format shared by SessionRecorder (which writes the Enqueue()/Present()
+// stream of a live Session to a file) and the scene_manager_replay tool (which
+// feeds the recorded stream back through an Engine).
+//
+// A recording consists of a header followed by a sequence of records.  All
+// integers are little-endian.  Each record starts with a one-byte
+// |RecordType|, followed by the monotonic time (in nanoseconds) at which the
+// event was observed by the SceneManager.
+//
+// Handles cannot be recorded.  Instead, enough information is stored to
+// recreate equivalent handles during replay: the koids of eventpair tokens (so
+// that export/import pairs can be re-linked) and the size of VMOs.  Memory
+// contents are not recorded.
+namespace recording {
+
+constexpr uint32_t kMagic = 0x4352'5a4d;  // "MZRC"
+constexpr uint32_t kVersion = 1;
+
+enum class RecordType : uint8_t {
+  // uint32 op count, followed by that many encoded ops.
+  kEnqueue = 1,
+  // uint32 present id, uint64 requested presentation time, uint32 number of
+  // acquire fences, uint32 number of release fences.
+  kPresent = 2,
+  // uint32 present id.  The acquire fences passed to the corresponding
+  // Present() have all been signalled.
+  kAcquireFencesReady = 3,
+  // uint32 present id, uint64 actual presentation time, uint64 presentation
+  // interval.  The update was applied and the present callback invoked.
+  kPresented = 4,
+};
+
+// Accumulates an encoded recording in memory.
+class Writer {
+ public:
+  Writer() = default;
+
+  void WriteHeader(uint64_t session_id, uint64_t start_time);
+  void BeginRecord(RecordType type, uint64_t timestamp);
+
+  void WriteUint8(uint8_t value);
+  void WriteUint32(uint32_t value);
+  void WriteUint64(uint64_t value);
+  void WriteFloat(float value);
+  void WriteString(const std::string& value);
+
+  // Encode |op|.  Handles are replaced by the information needed to recreate
+  // them; see above.
+  void WriteOp(const mozart2::OpPtr& op);
+
+  const std::vector<uint8_t>& data() const { return data_; }
+  void Clear() { data_.clear(); }
+
+ private:
+  void WriteValue(const mozart2::ValuePtr& value);
+  void WriteVec3(const mozart2::vec3Ptr& value);
+  void WriteVector3Value(const mozart2::Vector3ValuePtr& value);
+  void WriteResource(const mozart2::ResourcePtr& resource);
+  void WriteEventPairKoids(mx_handle_t handle);
+
+  std::vector<uint8_t> data_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(Writer);
+};
+
+// Creates the handles that are required to turn a recorded op back into a
+// mozart2::Op.
+class HandleFactory {
+ public:
+  virtual ~HandleFactory() = default;
+
+  // Return an eventpair endpoint standing in for the recorded one with the
+  // specified koid.  |related_koid| is the koid of the recorded peer; the two
+  // returned endpoints for a recorded pair must be peers of each other.
+  virtual mx::eventpair CreateEventPair(uint64_t koid,
+                                        uint64_t related_koid) = 0;
+
+  // Return a VMO of at least |size| bytes.
+  virtual mx::vmo CreateVmo(uint64_t size) = 0;
+
+  // Return a request for a new ImagePipe.  The client end is owned by the
+  // factory.
+  virtual ::fidl::InterfaceRequest<mozart2::ImagePipe> CreateImagePipe() = 0;
+};
+
+// Decodes a recording produced by Writer.  All reads fail gracefully (by
+// returning false) on truncated or malformed input.
+class Reader {
+ public:
+  Reader(const uint8_t* data, size_t size);
+
+  bool ReadHeader(uint64_t* session_id, uint64_t* start_time);
+  bool ReadRecordHeader(RecordType* type, uint64_t* timestamp);
+  bool at_end() const { return position_ == size_; }
+
+  bool ReadUint8(uint8_t* value);
+  bool ReadUint32(uint32_t* value);
+  bool ReadUint64(uint64_t* value);
+  bool ReadFloat(float* value);
+  bool ReadString(std::string* value);
+
+  mozart2::OpPtr ReadOp(HandleFactory* handle_factory);
+
+ private:
+  mozart2::ValuePtr ReadValue();
+  mozart2::vec3Ptr ReadVec3();
+  mozart2::Vector3ValuePtr ReadVector3Value();
+  mozart2::ResourcePtr ReadResource(HandleFactory* handle_factory);
+  mx::eventpair ReadEventPair(HandleFactory* handle_factory);
+  bool ReadBytes(void* out, size_t count);
+
+  const uint8_t* const data_;
+  const size_t size_;
+  size_t position_ = 0;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(Reader);
+};
+
+}  // namespace recording
+}  // namespace scene_manager
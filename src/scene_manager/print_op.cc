@@ -12,9 +12,15 @@ using mozart2::Resource;
 using mozart2::Value;
 
 std::ostream& operator<<(std::ostream& stream, const mozart2::OpPtr& op) {
-  switch (op->which()) {
+  if (op->which() == Op::Tag::CREATE_RESOURCE)
+    return stream << op->get_create_resource();
+  return stream << op->which();
+}
+
+std::ostream& operator<<(std::ostream& stream, const mozart2::Op::Tag& tag) {
+  switch (tag) {
     case Op::Tag::CREATE_RESOURCE:
-      return stream << op->get_create_resource();
+      return stream << "CREATE_RESOURCE";
     case Op::Tag::EXPORT_RESOURCE:
       return stream << "EXPORT_RESOURCE";
     case Op::Tag::IMPORT_RESOURCE:
@@ -69,6 +75,8 @@ std::ostream& operator<<(std::ostream& stream, const mozart2::OpPtr& op) {
       return stream << "SET_EVENT_MASK";
     case Op::Tag::SET_LABEL:
       return stream << "SET_LABEL";
+    case Op::Tag::INVALIDATE_IMAGE:
+      return stream << "INVALIDATE_IMAGE";
     case Op::Tag::__UNKNOWN__:
       return stream << "__UNKNOWN__";
   }
@@ -10,6 +10,7 @@
 namespace scene_manager {
 
 std::ostream& operator<<(std::ostream& stream, const mozart2::OpPtr& op);
+std::ostream& operator<<(std::ostream& stream, const mozart2::Op::Tag& tag);
 std::ostream& operator<<(std::ostream& stream,
                          const mozart2::CreateResourceOpPtr& op);
 std::ostream& operator<<(std::ostream& stream, const mozart2::Value::Tag& tag);
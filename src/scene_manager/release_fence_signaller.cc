@@ -4,6 +4,8 @@
 
 #include "apps/mozart/src/scene_manager/release_fence_signaller.h"
 
+#include "apps/tracing/lib/trace/event.h"
+
 namespace scene_manager {
 
 ReleaseFenceSignaller::ReleaseFenceSignaller(
@@ -21,36 +23,73 @@ ReleaseFenceSignaller::~ReleaseFenceSignaller() {
 };
 
 void ReleaseFenceSignaller::AddVulkanReleaseFence(mx::event fence) {
-  // TODO: Submit a command buffer with the vulkan fence as a semaphore
-  FTL_LOG(ERROR) << "Vulkan Release Fences not yet supported.";
-  FTL_DCHECK(false);
+  // Escher cannot yet import |fence| as a semaphore for the GPU to signal, so
+  // it joins the fences which are signalled when the most recently submitted
+  // CommandBuffer finishes; the GPU work it guards is complete by then.
+  AddCPUReleaseFence(std::move(fence));
 }
 
-void ReleaseFenceSignaller::AddCPUReleaseFence(mx::event fence) {
+std::vector<mx::event>* ReleaseFenceSignaller::GetPendingFences() {
   uint64_t latest_sequence_number =
       command_buffer_sequencer_->latest_sequence_number();
 
   if (latest_sequence_number > last_finished_sequence_number_) {
-    pending_fences_.push({latest_sequence_number, std::move(fence)});
+    if (pending_fences_.empty() ||
+        pending_fences_.back().sequence_number != latest_sequence_number) {
+      FTL_DCHECK(pending_fences_.empty() ||
+                 pending_fences_.back().sequence_number <
+                     latest_sequence_number);
+      pending_fences_.push_back({latest_sequence_number, {}});
+    }
+    return &pending_fences_.back().fences;
   } else if (latest_sequence_number == last_finished_sequence_number_) {
-    // Signal the fence immediately if its sequence number has already been
-    // marked finished.
+    // The fences can be signalled immediately, since their sequence number
+    // has already been marked finished.
+    return nullptr;
+  } else {
+    FTL_CHECK(false) << "ReleaseFenceSignaller: sequence numbers are in an "
+                        "invalid state";
+    return nullptr;
+  }
+}
+
+void ReleaseFenceSignaller::AddCPUReleaseFence(mx::event fence) {
+  if (auto pending_fences = GetPendingFences()) {
+    pending_fences->push_back(std::move(fence));
+    ++pending_fence_count_;
+  } else {
     fence.signal(0u, kFenceSignalled);
+  }
+}
+
+void ReleaseFenceSignaller::AddCPUReleaseFences(
+    ::fidl::Array<mx::event> fences) {
+  if (fences.size() == 0)
+    return;
+  if (auto pending_fences = GetPendingFences()) {
+    for (auto& fence : fences)
+      pending_fences->push_back(std::move(fence));
+    pending_fence_count_ += fences.size();
   } else {
-    FTL_CHECK(false) << "ReleaseFenceSignaller::AddCPUReleaseFence: sequence "
-                        "numbers are in an invalid state";
+    for (auto& fence : fences)
+      fence.signal(0u, kFenceSignalled);
   }
 }
 
 void ReleaseFenceSignaller::OnCommandBufferFinished(uint64_t sequence_number) {
-  // Iterate through the pending fences until you hit something that is
-  // greater than |sequence_number|.
+  // Signal the groups of fences in order until reaching one which waits for a
+  // CommandBuffer after |sequence_number|.
   last_finished_sequence_number_ = sequence_number;
 
   while (!pending_fences_.empty() &&
          pending_fences_.front().sequence_number <= sequence_number) {
-    pending_fences_.front().fence.signal(0u, kFenceSignalled);
-    pending_fences_.pop();
+    FenceGroup& group = pending_fences_.front();
+    TRACE_DURATION("gfx", "ReleaseFenceSignaller::SignalFences", "count",
+                   group.fences.size());
+    for (auto& fence : group.fences)
+      fence.signal(0u, kFenceSignalled);
+    pending_fence_count_ -= group.fences.size();
+    pending_fences_.pop_front();
   }
 };
 
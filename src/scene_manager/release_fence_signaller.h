@@ -5,10 +5,11 @@
 #pragma once
 
 #include <deque>
-#include <queue>
+#include <vector>
 
 #include <mx/event.h>
 #include "escher/impl/command_buffer_sequencer.h"
+#include "lib/fidl/cpp/bindings/array.h"
 #include "lib/ftl/logging.h"
 
 #include "apps/mozart/src/scene_manager/fence.h"
@@ -27,11 +28,19 @@ class ReleaseFenceSignaller
   ~ReleaseFenceSignaller();
 
   // Must be called on the same thread that we're submitting frames to Escher.
+  // Signals |fence| when the most recently submitted CommandBuffer finishes.
   void AddVulkanReleaseFence(mx::event fence);
 
   // Must be called on the same thread that we're submitting frames to Escher.
   virtual void AddCPUReleaseFence(mx::event fence);
 
+  // Like AddCPUReleaseFence(), for all of |fences|, which are signalled
+  // together.
+  virtual void AddCPUReleaseFences(::fidl::Array<mx::event> fences);
+
+  // The number of fences which are waiting to be signalled.
+  size_t pending_fence_count() const { return pending_fence_count_; }
+
  private:
   // The sequence number for the most recently finished CommandBuffer.
   uint64_t last_finished_sequence_number_ = 0;
@@ -41,16 +50,21 @@ class ReleaseFenceSignaller
   // numbers equal to or less than |sequence_number|.
   void OnCommandBufferFinished(uint64_t sequence_number) override;
 
-  // A fence along with the sequence number it is waiting for before it will be
-  // signalled.
-  struct FenceWithSequenceNumber {
+  // Returns the fences which wait for the most recently submitted
+  // CommandBuffer, or null if it has already finished.
+  std::vector<mx::event>* GetPendingFences();
+
+  // The fences which are waiting for the same CommandBuffer; typically, those
+  // released during a single frame.
+  struct FenceGroup {
     uint64_t sequence_number;
-    mx::event fence;
+    std::vector<mx::event> fences;
   };
 
-  // Queue of fences we need to signal along with their corresponding sequence
-  // numbers. The sequence numbers must be in non-decreasing order.
-  std::queue<FenceWithSequenceNumber> pending_fences_;
+  // Groups of fences we need to signal, in increasing order of sequence
+  // number.
+  std::deque<FenceGroup> pending_fences_;
+  size_t pending_fence_count_ = 0;
 
   // Used to query for last generated sequence number, corresponding to the most
   // recently submitted CommandBuffer.
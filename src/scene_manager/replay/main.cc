@@ -0,0 +1,97 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdio.h>
+
+#include <memory>
+
+#include "apps/mozart/src/scene_manager/displays/display_manager.h"
+#include "apps/mozart/src/scene_manager/engine/engine.h"
+#include "apps/mozart/src/scene_manager/release_fence_signaller.h"
+#include "apps/mozart/src/scene_manager/replay/session_replayer.h"
+#include "escher/impl/command_buffer_sequencer.h"
+#include "lib/ftl/command_line.h"
+#include "lib/ftl/log_settings_command_line.h"
+#include "lib/ftl/logging.h"
+#include "lib/ftl/strings/string_number_conversions.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+using namespace scene_manager;
+
+namespace {
+
+constexpr char kUsage[] =
+    "Usage: scene_manager_replay [--real_time] [--width=<pixels>] "
+    "[--height=<pixels>] <recording>...\n"
+    "\n"
+    "Replays session recordings made with scene_manager "
+    "--record_sessions=<directory>.\n"
+    "By default, updates are applied as fast as possible.  With --real_time,\n"
+    "the recorded timing is reproduced and frames are scheduled against a\n"
+    "simulated display of the given size.\n";
+
+// Uses the Engine constructor intended for testing, which does not require
+// Escher; nothing is rendered.
+class ReplayEngine : public Engine {
+ public:
+  ReplayEngine(DisplayManager* display_manager,
+               std::unique_ptr<ReleaseFenceSignaller> release_fence_signaller)
+      : Engine(display_manager, std::move(release_fence_signaller)) {}
+};
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  auto command_line = ftl::CommandLineFromArgcArgv(argc, argv);
+  if (!ftl::SetLogSettingsFromCommandLine(command_line))
+    return 1;
+
+  const auto& recordings = command_line.positional_args();
+  if (recordings.empty() || command_line.HasOption("help")) {
+    fprintf(stderr, "%s", kUsage);
+    return 1;
+  }
+
+  const bool real_time = command_line.HasOption("real_time");
+  uint32_t width = 1280;
+  uint32_t height = 800;
+  std::string value;
+  if (command_line.GetOptionValue("width", &value) &&
+      !ftl::StringToNumberWithError(value, &width)) {
+    FTL_LOG(ERROR) << "Invalid --width: " << value;
+    return 1;
+  }
+  if (command_line.GetOptionValue("height", &value) &&
+      !ftl::StringToNumberWithError(value, &height)) {
+    FTL_LOG(ERROR) << "Invalid --height: " << value;
+    return 1;
+  }
+
+  mtl::MessageLoop loop;
+
+  // Without a default display the Engine has no FrameScheduler, and applies
+  // each update as soon as it is ready.
+  DisplayManager display_manager;
+  if (real_time) {
+    display_manager.SetDefaultDisplayForTests(
+        std::make_unique<Display>(width, height, 1.f));
+  }
+
+  escher::impl::CommandBufferSequencer command_buffer_sequencer;
+  ReplayEngine engine(&display_manager,
+                      std::make_unique<ReleaseFenceSignaller>(
+                          &command_buffer_sequencer));
+
+  SessionReplayer replayer(&engine, real_time);
+  for (const auto& recording : recordings) {
+    if (!replayer.LoadRecording(recording))
+      return 1;
+  }
+
+  replayer.Start([&loop] { loop.PostQuitTask(); });
+  loop.Run();
+
+  replayer.PrintReport();
+  return 0;
+}
@@ -0,0 +1,385 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/replay/session_replayer.h"
+
+#include <magenta/syscalls.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "apps/mozart/src/scene_manager/fence.h"
+#include "lib/ftl/files/file.h"
+#include "lib/ftl/logging.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace scene_manager {
+
+namespace {
+
+// Return true if creating this resource requires the GPU, or a resource which
+// requires the GPU.
+bool ResourceRequiresGpu(const mozart2::ResourcePtr& resource) {
+  switch (resource->which()) {
+    case mozart2::Resource::Tag::MEMORY:
+    case mozart2::Resource::Tag::IMAGE:
+    case mozart2::Resource::Tag::IMAGE_PIPE:
+    case mozart2::Resource::Tag::BUFFER:
+    case mozart2::Resource::Tag::MESH:
+    case mozart2::Resource::Tag::DISPLAY_COMPOSITOR:
+    case mozart2::Resource::Tag::IMAGE_PIPE_COMPOSITOR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+struct DurationStats {
+  uint64_t total = 0;
+  uint64_t max = 0;
+
+  void Add(uint64_t duration) {
+    total += duration;
+    max = std::max(max, duration);
+  }
+};
+
+}  // namespace
+
+SessionReplayer::SessionReplayer(Engine* engine, bool real_time)
+    : engine_(engine), real_time_(real_time) {
+  FTL_DCHECK(engine_);
+}
+
+SessionReplayer::~SessionReplayer() {
+  engine_->SetFrameTimingsCallback(nullptr);
+}
+
+bool SessionReplayer::LoadRecording(const std::string& path) {
+  std::string contents;
+  if (!files::ReadFileToString(path, &contents)) {
+    FTL_LOG(ERROR) << "Could not read " << path;
+    return false;
+  }
+
+  recording::Reader reader(reinterpret_cast<const uint8_t*>(contents.data()),
+                           contents.size());
+  uint64_t session_id, start_time;
+  if (!reader.ReadHeader(&session_id, &start_time))
+    return false;
+
+  const size_t session_index = sessions_.size();
+  sessions_.emplace_back();
+  ReplayedSession* session = &sessions_.back();
+
+  size_t op_count = 0;
+  while (!reader.at_end()) {
+    Event event;
+    event.session_index = session_index;
+    bool ok = reader.ReadRecordHeader(&event.type, &event.timestamp);
+    switch (event.type) {
+      case recording::RecordType::kEnqueue: {
+        uint32_t count = 0;
+        ok = ok && reader.ReadUint32(&count);
+        event.ops = ::fidl::Array<mozart2::OpPtr>::New(0);
+        for (uint32_t i = 0; ok && i < count; ++i) {
+          auto op = reader.ReadOp(this);
+          ok = !!op;
+          if (ok && !ShouldDropOp(session, op)) {
+            event.ops.push_back(std::move(op));
+          }
+        }
+        op_count += count;
+        break;
+      }
+      case recording::RecordType::kPresent:
+        ok = ok && reader.ReadUint32(&event.present_id) &&
+             reader.ReadUint64(&event.presentation_time) &&
+             reader.ReadUint32(&event.acquire_fence_count) &&
+             reader.ReadUint32(&event.release_fence_count);
+        break;
+      case recording::RecordType::kAcquireFencesReady:
+        ok = ok && reader.ReadUint32(&event.present_id);
+        break;
+      case recording::RecordType::kPresented: {
+        // The recorded presentation times are not needed for replay.
+        uint32_t present_id;
+        uint64_t presentation_time, presentation_interval;
+        ok = ok && reader.ReadUint32(&present_id) &&
+             reader.ReadUint64(&presentation_time) &&
+             reader.ReadUint64(&presentation_interval);
+        break;
+      }
+      default:
+        ok = false;
+        break;
+    }
+    if (!ok) {
+      // Recordings of sessions which were still alive when the SceneManager
+      // died may be truncated; replay as much as possible.
+      FTL_LOG(WARNING) << "Truncated or corrupt record in " << path
+                       << "; ignoring the remainder.";
+      break;
+    }
+    if (event.type != recording::RecordType::kPresented)
+      events_.push_back(std::move(event));
+  }
+
+  FTL_LOG(INFO) << "Loaded session " << session_id << " from " << path << ": "
+                << op_count << " ops.";
+  return true;
+}
+
+bool SessionReplayer::ShouldDropOp(ReplayedSession* session,
+                                   const mozart2::OpPtr& op) {
+  auto& dropped = session->dropped_resource_ids;
+  auto is_dropped = [&dropped](uint32_t id) { return dropped.count(id) > 0; };
+
+  bool drop = false;
+  switch (op->which()) {
+    case mozart2::Op::Tag::CREATE_RESOURCE:
+      if (ResourceRequiresGpu(op->get_create_resource()->resource)) {
+        dropped.insert(op->get_create_resource()->id);
+        drop = true;
+      }
+      break;
+    case mozart2::Op::Tag::RELEASE_RESOURCE:
+      drop = is_dropped(op->get_release_resource()->id);
+      if (drop)
+        dropped.erase(op->get_release_resource()->id);
+      break;
+    case mozart2::Op::Tag::EXPORT_RESOURCE:
+      drop = is_dropped(op->get_export_resource()->id);
+      break;
+    case mozart2::Op::Tag::SET_SHAPE:
+      drop = is_dropped(op->get_set_shape()->shape_id);
+      break;
+    case mozart2::Op::Tag::SET_TEXTURE:
+      drop = is_dropped(op->get_set_texture()->texture_id);
+      break;
+    case mozart2::Op::Tag::SET_LAYER_STACK:
+      drop = is_dropped(op->get_set_layer_stack()->compositor_id);
+      break;
+    case mozart2::Op::Tag::SET_EVENT_MASK:
+      drop = is_dropped(op->get_set_event_mask()->id);
+      break;
+    case mozart2::Op::Tag::SET_LABEL:
+      drop = is_dropped(op->get_set_label()->id);
+      break;
+    case mozart2::Op::Tag::INVALIDATE_IMAGE:
+      drop = is_dropped(op->get_invalidate_image()->image_id);
+      break;
+    default:
+      break;
+  }
+  if (drop)
+    ++dropped_op_count_;
+  return drop;
+}
+
+mx::eventpair SessionReplayer::CreateEventPair(uint64_t koid,
+                                               uint64_t related_koid) {
+  auto it = pending_eventpairs_.find(koid);
+  if (it != pending_eventpairs_.end()) {
+    mx::eventpair endpoint = std::move(it->second);
+    pending_eventpairs_.erase(it);
+    return endpoint;
+  }
+
+  mx::eventpair endpoint, peer;
+  if (mx::eventpair::create(0, &endpoint, &peer) != MX_OK) {
+    FTL_LOG(ERROR) << "Failed to create eventpair.";
+    return mx::eventpair();
+  }
+  // The peer was closed while recording if there is no related koid.  Drop
+  // our replacement peer too, so that linking fails in the same way.
+  if (related_koid != MX_KOID_INVALID)
+    pending_eventpairs_[related_koid] = std::move(peer);
+  return endpoint;
+}
+
+mx::vmo SessionReplayer::CreateVmo(uint64_t size) {
+  mx::vmo vmo;
+  if (mx::vmo::create(size, 0u, &vmo) != MX_OK) {
+    FTL_LOG(ERROR) << "Failed to create VMO of size " << size;
+  }
+  return vmo;
+}
+
+::fidl::InterfaceRequest<mozart2::ImagePipe>
+SessionReplayer::CreateImagePipe() {
+  mozart2::ImagePipePtr image_pipe;
+  auto request = image_pipe.NewRequest();
+  image_pipes_.push_back(std::move(image_pipe));
+  return request;
+}
+
+void SessionReplayer::Start(ftl::Closure done_callback) {
+  FTL_DCHECK(!done_callback_);
+  done_callback_ = std::move(done_callback);
+
+  if (dropped_op_count_ > 0) {
+    FTL_LOG(INFO) << "Dropped " << dropped_op_count_
+                  << " ops which require the GPU.";
+  }
+
+  engine_->SetFrameTimingsCallback([this](const Engine::FrameTimings& t) {
+    frame_timings_.push_back(t);
+  });
+
+  for (size_t i = 0; i < sessions_.size(); ++i) {
+    engine_->CreateSession(sessions_[i].session.NewRequest(), nullptr);
+    sessions_[i].session.set_connection_error_handler(
+        [this, i] { OnSessionClosed(i); });
+  }
+
+  std::stable_sort(events_.begin(), events_.end(),
+                   [](const Event& a, const Event& b) {
+                     return a.timestamp < b.timestamp;
+                   });
+
+  if (events_.empty()) {
+    MaybeFinish();
+    return;
+  }
+
+  if (!real_time_) {
+    for (size_t i = 0; i < events_.size(); ++i) {
+      ReplayEvent(i);
+    }
+    return;
+  }
+
+  // Shift the recorded timeline so that the first event happens now.
+  const uint64_t recording_start = events_.front().timestamp;
+  const uint64_t replay_start = mx_time_get(MX_CLOCK_MONOTONIC);
+  auto task_runner = mtl::MessageLoop::GetCurrent()->task_runner();
+  for (size_t i = 0; i < events_.size(); ++i) {
+    Event& event = events_[i];
+    if (event.presentation_time > recording_start) {
+      event.presentation_time += replay_start - recording_start;
+    } else {
+      event.presentation_time = 0;
+    }
+    auto time = ftl::TimePoint::FromEpochDelta(ftl::TimeDelta::FromNanoseconds(
+        replay_start + event.timestamp - recording_start));
+    task_runner->PostTaskForTime([this, i] { ReplayEvent(i); }, time);
+  }
+}
+
+void SessionReplayer::ReplayEvent(size_t event_index) {
+  Event& event = events_[event_index];
+  ReplayedSession& session = sessions_[event.session_index];
+  ++events_replayed_;
+
+  if (session.closed) {
+    MaybeFinish();
+    return;
+  }
+
+  switch (event.type) {
+    case recording::RecordType::kEnqueue:
+      session.session->Enqueue(std::move(event.ops));
+      break;
+    case recording::RecordType::kPresent: {
+      auto acquire_fences = ::fidl::Array<mx::event>::New(0);
+      auto release_fences = ::fidl::Array<mx::event>::New(0);
+      std::vector<mx::event>& originals =
+          session.acquire_fences[event.present_id];
+      for (uint32_t i = 0; i < event.acquire_fence_count; ++i) {
+        mx::event fence, duplicate;
+        mx::event::create(0, &fence);
+        fence.duplicate(MX_RIGHT_SAME_RIGHTS, &duplicate);
+        acquire_fences.push_back(std::move(duplicate));
+        originals.push_back(std::move(fence));
+      }
+      for (uint32_t i = 0; i < event.release_fence_count; ++i) {
+        mx::event fence;
+        mx::event::create(0, &fence);
+        release_fences.push_back(std::move(fence));
+      }
+      ++session.outstanding_presents;
+      const size_t session_index = event.session_index;
+      session.session->Present(
+          event.presentation_time, std::move(acquire_fences),
+          std::move(release_fences),
+          [this, session_index](mozart2::PresentationInfoPtr info) {
+            OnPresented(session_index);
+          });
+      break;
+    }
+    case recording::RecordType::kAcquireFencesReady: {
+      auto it = session.acquire_fences.find(event.present_id);
+      if (it != session.acquire_fences.end()) {
+        for (auto& fence : it->second) {
+          fence.signal(0u, kFenceSignalled);
+        }
+        session.acquire_fences.erase(it);
+      }
+      break;
+    }
+    case recording::RecordType::kPresented:
+      break;
+  }
+  MaybeFinish();
+}
+
+void SessionReplayer::OnPresented(size_t session_index) {
+  ReplayedSession& session = sessions_[session_index];
+  FTL_DCHECK(session.outstanding_presents > 0);
+  --session.outstanding_presents;
+  MaybeFinish();
+}
+
+void SessionReplayer::OnSessionClosed(size_t session_index) {
+  FTL_LOG(WARNING) << "Replayed session " << session_index
+                   << " was closed by the SceneManager.";
+  ReplayedSession& session = sessions_[session_index];
+  session.closed = true;
+  session.outstanding_presents = 0;
+  session.acquire_fences.clear();
+  MaybeFinish();
+}
+
+void SessionReplayer::MaybeFinish() {
+  if (!done_callback_ || events_replayed_ < events_.size())
+    return;
+  for (auto& session : sessions_) {
+    if (!session.closed && session.outstanding_presents > 0)
+      return;
+  }
+  ftl::Closure callback = std::move(done_callback_);
+  callback();
+}
+
+void SessionReplayer::PrintReport() const {
+  DurationStats apply, traversal, render;
+  printf("%-8s %-20s %12s %12s %12s\n", "frame", "presentation_time",
+         "apply_us", "traversal_us", "render_us");
+  for (size_t i = 0; i < frame_timings_.size(); ++i) {
+    const auto& t = frame_timings_[i];
+    printf("%-8zu %-20lu %12.1f %12.1f %12.1f\n", i, t.presentation_time,
+           t.apply_duration / 1000.0, t.traversal_duration / 1000.0,
+           t.render_duration / 1000.0);
+    apply.Add(t.apply_duration);
+    traversal.Add(t.traversal_duration);
+    render.Add(t.render_duration);
+  }
+
+  const size_t count = frame_timings_.size();
+  if (count == 0) {
+    printf("No frames were rendered.\n");
+    return;
+  }
+  printf("\n%zu frames\n", count);
+  printf("%-10s %12s %12s\n", "phase", "mean_us", "max_us");
+  printf("%-10s %12.1f %12.1f\n", "apply", apply.total / 1000.0 / count,
+         apply.max / 1000.0);
+  printf("%-10s %12.1f %12.1f\n", "traversal",
+         traversal.total / 1000.0 / count, traversal.max / 1000.0);
+  printf("%-10s %12.1f %12.1f\n", "render", render.total / 1000.0 / count,
+         render.max / 1000.0);
+}
+
+}  // namespace scene_manager
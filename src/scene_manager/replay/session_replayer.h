@@ -0,0 +1,106 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "apps/mozart/services/images/image_pipe.fidl.h"
+#include "apps/mozart/services/scene/session.fidl.h"
+#include "apps/mozart/src/scene_manager/engine/engine.h"
+#include "apps/mozart/src/scene_manager/engine/session_recording.h"
+#include "lib/ftl/functional/closure.h"
+#include "lib/ftl/macros.h"
+
+namespace scene_manager {
+
+// Feeds one or more session recordings (see SessionRecorder) back through an
+// Engine, either as fast as possible or with the recorded timing, and collects
+// the per-frame timings reported by the Engine.
+//
+// The Engine is expected to have been created without Escher, so ops which
+// require the GPU (memory, images, image pipes, compositors) and ops which
+// refer to the resources they would have created are dropped.
+class SessionReplayer : private recording::HandleFactory {
+ public:
+  SessionReplayer(Engine* engine, bool real_time);
+  ~SessionReplayer() override;
+
+  // Load a recording.  All recordings must be loaded before calling Start().
+  bool LoadRecording(const std::string& path);
+
+  // Begin replaying.  |done_callback| is invoked once every recorded event has
+  // been replayed and every Present() has been acknowledged.
+  void Start(ftl::Closure done_callback);
+
+  // Print the per-frame timings collected so far, followed by a summary.
+  void PrintReport() const;
+
+ private:
+  struct Event {
+    uint64_t timestamp = 0;
+    size_t session_index = 0;
+    recording::RecordType type = recording::RecordType::kEnqueue;
+
+    // kEnqueue.
+    ::fidl::Array<mozart2::OpPtr> ops;
+
+    // kPresent and kAcquireFencesReady.
+    uint32_t present_id = 0;
+    uint64_t presentation_time = 0;
+    uint32_t acquire_fence_count = 0;
+    uint32_t release_fence_count = 0;
+  };
+
+  struct ReplayedSession {
+    mozart2::SessionPtr session;
+    bool closed = false;
+    size_t outstanding_presents = 0;
+
+    // Ids of resources whose creation was dropped; see ShouldDropOp().
+    std::set<uint32_t> dropped_resource_ids;
+
+    // Acquire fences passed to each Present(), keyed by recorded present id.
+    // They are signalled when the corresponding kAcquireFencesReady record is
+    // replayed.
+    std::map<uint32_t, std::vector<mx::event>> acquire_fences;
+  };
+
+  // |recording::HandleFactory|
+  mx::eventpair CreateEventPair(uint64_t koid, uint64_t related_koid) override;
+  mx::vmo CreateVmo(uint64_t size) override;
+  ::fidl::InterfaceRequest<mozart2::ImagePipe> CreateImagePipe() override;
+
+  bool ShouldDropOp(ReplayedSession* session, const mozart2::OpPtr& op);
+
+  void ReplayEvent(size_t event_index);
+  void OnPresented(size_t session_index);
+  void OnSessionClosed(size_t session_index);
+  void MaybeFinish();
+
+  Engine* const engine_;
+  const bool real_time_;
+
+  std::vector<Event> events_;
+  std::vector<ReplayedSession> sessions_;
+  size_t events_replayed_ = 0;
+  size_t dropped_op_count_ = 0;
+  ftl::Closure done_callback_;
+
+  // Replacement eventpair endpoints, keyed by the koid of the recorded
+  // endpoint which they stand in for.
+  std::map<uint64_t, mx::eventpair> pending_eventpairs_;
+
+  // Client ends of replayed ImagePipes; nothing is presented to them.
+  std::vector<mozart2::ImagePipePtr> image_pipes_;
+
+  std::vector<Engine::FrameTimings> frame_timings_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(SessionReplayer);
+};
+
+}  // namespace scene_manager
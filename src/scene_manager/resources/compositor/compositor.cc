@@ -4,6 +4,8 @@
 
 #include "apps/mozart/src/scene_manager/resources/compositor/compositor.h"
 
+#include <iterator>
+
 #include "escher/impl/image_cache.h"
 #include "escher/renderer/image.h"
 #include "escher/renderer/paper_renderer.h"
@@ -16,7 +18,9 @@
 #include "apps/mozart/src/scene_manager/resources/compositor/layer.h"
 #include "apps/mozart/src/scene_manager/resources/compositor/layer_stack.h"
 #include "apps/mozart/src/scene_manager/resources/dump_visitor.h"
+#include "apps/mozart/src/scene_manager/resources/nodes/scene.h"
 #include "apps/mozart/src/scene_manager/resources/renderers/renderer.h"
+#include "apps/mozart/src/scene_manager/util/viewport_layout.h"
 #include "apps/mozart/src/scene_manager/vulkan_swapchain.h"
 #include "apps/tracing/lib/trace/event.h"
 
@@ -71,23 +75,11 @@ void Compositor::InitStage(escher::Stage* stage,
 void Compositor::DrawLayer(escher::PaperRenderer* escher_renderer,
                            Layer* layer,
                            const escher::ImagePtr& output_image,
-                           const escher::SemaphorePtr& frame_done_semaphore,
-                           const escher::Model* overlay_model) {
+                           const escher::SemaphorePtr& frame_done_semaphore) {
   TRACE_DURATION("gfx", "Compositor::DrawLayer");
   FTL_DCHECK(layer->IsDrawable());
-
-  float stage_width = static_cast<float>(output_image->width());
-  float stage_height = static_cast<float>(output_image->height());
-
-  if (layer->size().x != stage_width || layer->size().y != stage_height) {
-    // TODO(MZ-248): Should be able to render into a viewport of the
-    // output image, but we're not that fancy yet.
-    layer->error_reporter()->ERROR()
-        << "TODO(MZ-248): scene_manager::Compositor::DrawLayer()"
-           ": layer size does not match output image size of "
-        << stage_width << "x" << stage_height;
-    return;
-  }
+  FTL_DCHECK(layer->width() == output_image->width() &&
+             layer->height() == output_image->height());
 
   escher::Stage stage;
   InitStage(&stage, output_image->width(), output_image->height());
@@ -97,10 +89,85 @@ void Compositor::DrawLayer(escher::PaperRenderer* escher_renderer,
   escher::Camera camera =
       renderer->camera()->GetEscherCamera(stage.viewing_volume());
 
-  escher_renderer->DrawFrame(stage, model, camera, output_image, overlay_model,
+  escher_renderer->DrawFrame(stage, model, camera, output_image, nullptr,
                              frame_done_semaphore, nullptr);
 }
 
+void Compositor::DrawLayers(escher::PaperRenderer* escher_renderer,
+                            const std::vector<Layer*>& drawable_layers,
+                            const escher::ImagePtr& output_image,
+                            const escher::SemaphorePtr& frame_done_semaphore) {
+  TRACE_DURATION("gfx", "Compositor::DrawLayers");
+
+  // Layers which do not overlap any layer beneath them are drawn straight
+  // into their viewport of the output image, in a single pass, instead of
+  // into an intermediate texture.
+  const escher::vec2 output_size(output_image->width(),
+                                 output_image->height());
+  std::vector<LayerViewport> viewports;
+  viewports.reserve(drawable_layers.size());
+  for (Layer* layer : drawable_layers) {
+    LayerViewport viewport;
+    const escher::vec2 position(layer->translation());
+    viewport.rect = {position, position + layer->size()};
+    viewport.orthographic = layer->renderer()->IsOrthographic();
+    viewports.push_back(viewport);
+  }
+  const std::vector<bool> drawn_in_viewport =
+      FindLayersDrawnInViewports(viewports, output_size);
+
+  escher::Stage stage;
+  InitStage(&stage, output_image->width(), output_image->height());
+  escher::Camera camera = escher::Camera::NewOrtho(stage.viewing_volume());
+  std::vector<escher::Object> objects;
+  std::vector<escher::Object> layer_objects;
+  auto recycler = escher()->resource_recycler();
+  for (size_t i = 0; i < drawable_layers.size(); ++i) {
+    Layer* layer = drawable_layers[i];
+    Renderer* renderer = layer->renderer().get();
+    const ScenePtr& scene = renderer->camera()->scene();
+    if (drawn_in_viewport[i]) {
+      if (renderer->IsOrthographic()) {
+        auto layer_display_list = renderer->CreateDisplayList(
+            scene, escher::vec2(layer->size()), &viewports[i].rect);
+        std::move(layer_display_list.begin(), layer_display_list.end(),
+                  std::back_inserter(objects));
+      } else {
+        // Only a layer which covers the whole output image can use a
+        // perspective camera, so it is the only layer in this pass.
+        objects = renderer->CreateDisplayList(scene, output_size);
+        camera = renderer->camera()->GetEscherCamera(stage.viewing_volume());
+      }
+      continue;
+    }
+
+    // Render the layer into a texture, which is composited on top of the
+    // layers drawn into their viewports.
+    auto texture = escher::Texture::New(
+        recycler, GetLayerFramebufferImage(layer->width(), layer->height()),
+        vk::Filter::eLinear);
+    auto semaphore = escher::Semaphore::New(escher()->vk_device());
+    DrawLayer(escher_renderer, layer, texture->image(), semaphore);
+    texture->image()->SetWaitSemaphore(std::move(semaphore));
+
+    auto material = escher::Material::New(layer->color(), std::move(texture));
+    material->set_opaque(layer->opaque());
+
+    escher::Transform transform(layer->translation());
+    transform.scale = escher::vec3(layer->size(), 1.f);
+    layer_objects.push_back(
+        escher::Object::NewRect(transform, std::move(material)));
+  }
+  TRACE_COUNTER("gfx", "Compositor", 0u, "viewport_layers",
+                drawable_layers.size() - layer_objects.size(),
+                "texture_layers", layer_objects.size());
+
+  escher::Model model(std::move(objects));
+  escher::Model overlay_model(std::move(layer_objects));
+  escher_renderer->DrawFrame(stage, model, camera, output_image,
+                             &overlay_model, frame_done_semaphore, nullptr);
+}
+
 void Compositor::DrawFrame(escher::PaperRenderer* escher_renderer) {
   TRACE_DURATION("gfx", "Compositor::DrawFrame");
 
@@ -121,40 +188,14 @@ void Compositor::DrawFrame(escher::PaperRenderer* escher_renderer) {
     return a->translation().z < b->translation().z;
   });
 
-  // Render each layer, except the bottom one.  Create an escher::Object for
-  // each layer, which will be composited as part of rendering the final
-  // layer.
-  std::vector<escher::Object> layer_objects;
-
-  layer_objects.reserve(drawable_layers.size() - 1);
-  auto recycler = escher()->resource_recycler();
-  for (size_t i = 1; i < drawable_layers.size(); ++i) {
-    auto layer = drawable_layers[i];
-    auto texture = escher::Texture::New(
-        recycler, GetLayerFramebufferImage(layer->width(), layer->height()),
-        vk::Filter::eLinear);
-
-    auto semaphore = escher::Semaphore::New(escher()->vk_device());
-    DrawLayer(escher_renderer, drawable_layers[i], texture->image(), semaphore,
-              nullptr);
-    texture->image()->SetWaitSemaphore(std::move(semaphore));
-
-    auto material = escher::Material::New(layer->color(), std::move(texture));
-    material->set_opaque(layer->opaque());
-
-    layer_objects.push_back(escher::Object::NewRect(
-        escher::Transform(layer->translation()), std::move(material)));
-  }
-  escher::Model overlay_model(std::move(layer_objects));
-
   swapchain_->DrawAndPresentFrame([
-    this, escher_renderer, layer = drawable_layers[0], overlay = &overlay_model
+    this, escher_renderer, &drawable_layers
   ](const escher::ImagePtr& output_image,
     const escher::SemaphorePtr& acquire_semaphore,
     const escher::SemaphorePtr& frame_done_semaphore) {
     output_image->SetWaitSemaphore(acquire_semaphore);
-    DrawLayer(escher_renderer, layer, output_image, frame_done_semaphore,
-              overlay);
+    DrawLayers(escher_renderer, drawable_layers, output_image,
+               frame_done_semaphore);
   });
 
   if (FTL_VLOG_IS_ON(3)) {
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "apps/mozart/src/scene_manager/resources/resource.h"
 #include "apps/mozart/src/scene_manager/vulkan_swapchain.h"
 
@@ -57,11 +59,16 @@ class Compositor : public Resource {
   escher::ImagePtr GetLayerFramebufferImage(uint32_t width, uint32_t height);
 
   void InitStage(escher::Stage* stage, uint32_t width, uint32_t height);
+  // Draws |layer| into |output_image|, which must be the same size.
   void DrawLayer(escher::PaperRenderer* escher_renderer,
                  Layer* layer,
                  const escher::ImagePtr& output_image,
-                 const escher::SemaphorePtr& frame_done_semaphore,
-                 const escher::Model* overlay_model);
+                 const escher::SemaphorePtr& frame_done_semaphore);
+  // Draws |drawable_layers|, ordered from bottom to top, into |output_image|.
+  void DrawLayers(escher::PaperRenderer* escher_renderer,
+                  const std::vector<Layer*>& drawable_layers,
+                  const escher::ImagePtr& output_image,
+                  const escher::SemaphorePtr& frame_done_semaphore);
 
   escher::Escher* const escher_;
   std::unique_ptr<Swapchain> swapchain_;
@@ -17,6 +17,7 @@
 #include "apps/mozart/src/scene_manager/resources/import.h"
 #include "apps/mozart/src/scene_manager/resources/lights/directional_light.h"
 #include "apps/mozart/src/scene_manager/resources/material.h"
+#include "apps/mozart/src/scene_manager/resources/nodes/clip_node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/entity_node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/scene.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/shape_node.h"
@@ -75,6 +76,12 @@ void DumpVisitor::Visit(ImagePipe* r) {
   EndItem();
 }
 
+void DumpVisitor::Visit(ClipNode* r) {
+  BeginItem("ClipNode", r);
+  VisitNode(r);
+  EndItem();
+}
+
 void DumpVisitor::Visit(EntityNode* r) {
   BeginItem("EntityNode", r);
   VisitNode(r);
@@ -114,6 +121,9 @@ void DumpVisitor::VisitNode(Node* r) {
   if (r->clip_to_self()) {
     WriteProperty("clip_to_self") << r->clip_to_self();
   }
+  if (r->clip()) {
+    WriteProperty("clip") << r->clip()->id();
+  }
   if (!r->transform().IsIdentity()) {
     WriteProperty("transform") << r->transform();
   }
@@ -26,6 +26,7 @@ class DumpVisitor : public ResourceVisitor {
   void Visit(HostMemory* r) override;
   void Visit(Image* r) override;
   void Visit(ImagePipe* r) override;
+  void Visit(ClipNode* r) override;
   void Visit(EntityNode* r) override;
   void Visit(ShapeNode* r) override;
   void Visit(Scene* r) override;
@@ -4,9 +4,14 @@
 
 #include "apps/mozart/src/scene_manager/resources/image.h"
 
+#include <cstring>
+
+#include "apps/mozart/src/scene_manager/engine/engine.h"
 #include "apps/mozart/src/scene_manager/engine/session.h"
 #include "apps/mozart/src/scene_manager/resources/gpu_memory.h"
 #include "apps/mozart/src/scene_manager/resources/host_memory.h"
+#include "apps/mozart/src/scene_manager/util/yuv_conversion.h"
+#include "apps/tracing/lib/trace/event.h"
 #include "escher/util/image_utils.h"
 
 namespace scene_manager {
@@ -17,10 +22,19 @@ const ResourceTypeInfo Image::kTypeInfo = {
 Image::Image(Session* session,
              mozart::ResourceId id,
              MemoryPtr memory,
-             escher::ImagePtr image)
+             escher::ImagePtr image,
+             uint64_t memory_offset,
+             uint32_t stride,
+             uint32_t bytes_per_pixel,
+             mozart2::ImageInfo::PixelFormat pixel_format)
     : ImageBase(session, id, Image::kTypeInfo),
       memory_(std::move(memory)),
-      image_(std::move(image)) {}
+      image_(std::move(image)),
+      memory_offset_(memory_offset),
+      stride_(stride),
+      bytes_per_pixel_(bytes_per_pixel),
+      pixel_format_(pixel_format),
+      dirty_region_(image_->width(), image_->height()) {}
 
 Image::Image(Session* session,
              mozart::ResourceId id,
@@ -33,7 +47,8 @@ Image::Image(Session* session,
           session->engine()->escher_resource_recycler(),
           image_info,
           vk_image,
-          static_cast<GpuMemory*>(memory_.get())->escher_gpu_mem())) {}
+          static_cast<GpuMemory*>(memory_.get())->escher_gpu_mem())),
+      dirty_region_(image_info.width, image_info.height) {}
 
 ImagePtr Image::New(Session* session,
                     mozart::ResourceId id,
@@ -44,13 +59,28 @@ ImagePtr Image::New(Session* session,
   vk::Format pixel_format = vk::Format::eUndefined;
   size_t bytes_per_pixel;
   size_t pixel_alignment;
+  // The name of the format, if it is a YUV one.
+  const char* yuv_format_name = nullptr;
   switch (image_info->pixel_format) {
     case mozart2::ImageInfo::PixelFormat::BGRA_8:
       pixel_format = vk::Format::eB8G8R8A8Unorm;
       bytes_per_pixel = 4u;
       pixel_alignment = 4u;
       break;
+    // YUV images are converted to BGRA when they are uploaded, so the Escher
+    // image is BGRA; the stride and bytes per pixel are those of the Y plane.
+    case mozart2::ImageInfo::PixelFormat::NV12:
+    case mozart2::ImageInfo::PixelFormat::I420:
+      pixel_format = vk::Format::eB8G8R8A8Unorm;
+      bytes_per_pixel = 1u;
+      pixel_alignment = 2u;
+      yuv_format_name =
+          image_info->pixel_format == mozart2::ImageInfo::PixelFormat::NV12
+              ? "NV12"
+              : "I420";
+      break;
   }
+  const bool is_yuv = yuv_format_name != nullptr;
 
   if (image_info->width <= 0) {
     error_reporter->ERROR()
@@ -77,6 +107,14 @@ ImagePtr Image::New(Session* session,
     return nullptr;
   }
 
+  if (is_yuv &&
+      (image_info->width % 2 != 0 || image_info->height % 2 != 0)) {
+    error_reporter->ERROR()
+        << "Image::CreateFromMemory(): width and height of YUV images must be "
+        << "even.";
+    return nullptr;
+  }
+
   // Create from host memory.
   if (memory->IsKindOf<HostMemory>()) {
     auto host_memory = memory->As<HostMemory>();
@@ -98,7 +136,14 @@ ImagePtr Image::New(Session* session,
       return nullptr;
     }
 
-    size_t image_size = image_info->height * image_info->stride;
+    // The last row only needs to be as long as the image is wide, so that the
+    // image can be a sub-rectangle at the bottom-right of a larger one.  YUV
+    // images are followed by their chroma planes, which must fit in full.
+    size_t image_size = (image_info->height - 1) * size_t{image_info->stride} +
+                        image_info->width * bytes_per_pixel;
+    if (is_yuv) {
+      image_size = size_t{image_info->height} * image_info->stride * 3 / 2;
+    }
     if (memory_offset >= host_memory->size()) {
       error_reporter->ERROR()
           << "Image::CreateFromMemory(): the offset of the Image must be "
@@ -113,23 +158,35 @@ ImagePtr Image::New(Session* session,
       return nullptr;
     }
 
-    // TODO(MZ-141): Support non-minimal strides.
-    if (image_info->stride != image_info->width * bytes_per_pixel) {
-      error_reporter->ERROR()
-          << "Image::CreateFromMemory(): the stride must be minimal (MZ-141)";
-      return nullptr;
-    }
+    escher::ImageInfo escher_image_info;
+    escher_image_info.format = pixel_format;
+    escher_image_info.width = image_info->width;
+    escher_image_info.height = image_info->height;
+    escher_image_info.sample_count = 1;
+    escher_image_info.usage =
+        vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    escher_image_info.memory_flags = vk::MemoryPropertyFlagBits::eDeviceLocal;
+    auto escher_image =
+        session->engine()->escher_image_factory()->NewImage(escher_image_info);
 
-    auto escher_image = escher::image_utils::NewImageFromPixels(
-        session->engine()->escher_image_factory(),
-        session->engine()->escher_gpu_uploader(), pixel_format,
-        image_info->width, image_info->height,
-        static_cast<uint8_t*>(host_memory->memory_base()) + memory_offset);
-    return ftl::AdoptRef(new Image(session, id, std::move(host_memory),
-                                   std::move(escher_image)));
+    auto image = ftl::AdoptRef(new Image(
+        session, id, std::move(host_memory), std::move(escher_image),
+        memory_offset, image_info->stride, bytes_per_pixel,
+        image_info->pixel_format));
+    image->InvalidateAll();
+    image->UpdatePixels();
+    return image;
 
     // Create from GPU memory.
   } else if (memory->IsKindOf<GpuMemory>()) {
+    // YUV images are only converted when they are uploaded from host memory;
+    // Escher cannot sample them from GPU memory.
+    if (is_yuv) {
+      error_reporter->ERROR()
+          << "Image::CreateFromMemory(): " << yuv_format_name
+          << " images must be created using host memory.";
+      return nullptr;
+    }
     auto gpu_memory = memory->As<GpuMemory>();
 
     escher::ImageInfo escher_image_info;
@@ -181,7 +238,179 @@ ImagePtr Image::NewForTesting(Session* session,
   escher::ImagePtr escher_image = ftl::MakeRefCounted<escher::Image>(
       image_owner, escher::ImageInfo(), vk::Image(), nullptr);
 
-  return ftl::AdoptRef(new Image(session, id, host_memory, escher_image));
+  return ftl::AdoptRef(
+      new Image(session, id, host_memory, escher_image, 0u, 0u, 0u,
+                mozart2::ImageInfo::PixelFormat::BGRA_8));
+}
+
+bool Image::Invalidate(const DirtyRegion::Rect& rect) {
+  if (uint64_t{rect.x} + rect.width > image_->width() ||
+      uint64_t{rect.y} + rect.height > image_->height()) {
+    return false;
+  }
+  if (!memory_->IsKindOf<HostMemory>() || rect.is_empty()) {
+    return true;
+  }
+  if (is_yuv()) {
+    // Each pair of chroma samples applies to a 2x2 block of pixels.  The
+    // width and height of the image are even, so this stays within bounds.
+    uint32_t right = (rect.right() + 1) & ~1u;
+    uint32_t bottom = (rect.bottom() + 1) & ~1u;
+    uint32_t x = rect.x & ~1u;
+    uint32_t y = rect.y & ~1u;
+    dirty_region_.Add({x, y, right - x, bottom - y});
+  } else {
+    dirty_region_.Add(rect);
+  }
+  return true;
+}
+
+void Image::InvalidateAll() {
+  if (memory_->IsKindOf<HostMemory>()) {
+    dirty_region_.AddAll();
+  }
+}
+
+void Image::UpdatePixels() {
+  if (dirty_region_.is_empty() || upload_in_progress_) {
+    return;
+  }
+  TRACE_DURATION("gfx", "Image::UpdatePixels", "rects",
+                 dirty_region_.rects().size(), "pixels", dirty_region_.area());
+  FTL_DCHECK(memory_->IsKindOf<HostMemory>());
+
+  auto gpu_uploader = session()->engine()->escher_gpu_uploader();
+  if (!gpu_uploader) {
+    dirty_region_.Clear();
+    return;
+  }
+
+  std::vector<UploadRegion> regions;
+  auto writer = gpu_uploader->GetWriter(PlanUpload(&regions));
+  FillUploadBuffer(regions, writer.ptr());
+  for (const UploadRegion& region : regions) {
+    writer.WriteImage(image_, region.copy);
+  }
+  writer.Submit();
+}
+
+void Image::UpdatePixelsAsync(ftl::Closure callback) {
+  FTL_DCHECK(!upload_in_progress_);
+  Engine* engine = session()->engine();
+  auto gpu_uploader = engine->escher_gpu_uploader();
+  if (dirty_region_.is_empty() || !gpu_uploader) {
+    UpdatePixels();
+    callback();
+    return;
+  }
+  TRACE_ASYNC_BEGIN("gfx", "Image::UpdatePixelsAsync", id(), "pixels",
+                    dirty_region_.area());
+
+  // The upload buffer is allocated, and the copy into the image submitted, on
+  // this thread; only filling the buffer happens on the Engine's upload
+  // thread.  The Engine keeps the image, and so its memory, alive until the
+  // upload is submitted, or abandoned when the Engine is destroyed.
+  struct Upload {
+    std::vector<UploadRegion> regions;
+    std::unique_ptr<escher::impl::GpuUploader::Writer> writer;
+  };
+  auto upload = std::make_shared<Upload>();
+  upload->writer = std::make_unique<escher::impl::GpuUploader::Writer>(
+      gpu_uploader->GetWriter(PlanUpload(&upload->regions)));
+  upload_in_progress_ = true;
+
+  engine->PostUpload(
+      SessionPtr(session()),
+      [ image = this, upload ] {
+        image->FillUploadBuffer(upload->regions, upload->writer->ptr());
+      },
+      [ image = ImagePtr(this), upload, callback = std::move(callback) ] {
+        for (const UploadRegion& region : upload->regions) {
+          upload->writer->WriteImage(image->image_, region.copy);
+        }
+        upload->writer->Submit();
+        image->upload_in_progress_ = false;
+        TRACE_ASYNC_END("gfx", "Image::UpdatePixelsAsync", image->id());
+        callback();
+      });
+}
+
+size_t Image::PlanUpload(std::vector<UploadRegion>* regions) {
+  // Each dirty rectangle is copied into the upload buffer, one after the
+  // other, and from there into place.  Rectangles which span most of a row are
+  // copied as a single block, including the padding between their rows, and
+  // the copy command skips the padding; the rows of narrower rectangles are
+  // packed together instead.  YUV images are converted to BGRA on the way.
+  size_t buffer_size = 0;
+  for (const DirtyRegion::Rect& rect : dirty_region_.rects()) {
+    UploadRegion region;
+    region.rect = rect;
+    region.as_block =
+        !is_yuv() && rect.width * bytes_per_pixel_ * 2 >= stride_;
+    region.copy.bufferOffset = buffer_size;
+    region.copy.bufferRowLength =
+        region.as_block ? stride_ / bytes_per_pixel_ : 0;
+    region.copy.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    region.copy.imageSubresource.mipLevel = 0;
+    region.copy.imageSubresource.baseArrayLayer = 0;
+    region.copy.imageSubresource.layerCount = 1;
+    region.copy.imageOffset = vk::Offset3D(rect.x, rect.y, 0);
+    region.copy.imageExtent = vk::Extent3D(rect.width, rect.height, 1);
+
+    const size_t row_size = rect.width * (is_yuv() ? 4u : bytes_per_pixel_);
+    buffer_size += region.as_block
+                       ? (rect.height - 1) * size_t{stride_} + row_size
+                       : rect.height * row_size;
+    regions->push_back(region);
+  }
+  dirty_region_.Clear();
+  return buffer_size;
+}
+
+void Image::FillUploadBuffer(const std::vector<UploadRegion>& regions,
+                             uint8_t* buffer) const {
+  TRACE_DURATION("gfx", "Image::FillUploadBuffer", "rects", regions.size());
+  auto pixels = static_cast<const uint8_t*>(
+                    static_cast<HostMemory*>(memory_.get())->memory_base()) +
+                memory_offset_;
+  const uint32_t height = image_->height();
+  const uint8_t* chroma_planes = pixels + size_t{height} * stride_;
+
+  for (const UploadRegion& region : regions) {
+    const DirtyRegion::Rect& rect = region.rect;
+    uint8_t* destination = buffer + region.copy.bufferOffset;
+    const uint8_t* source = pixels + size_t{rect.y} * stride_ +
+                            size_t{rect.x} * bytes_per_pixel_;
+    if (pixel_format_ == mozart2::ImageInfo::PixelFormat::NV12) {
+      FTL_DCHECK(rect.x % 2 == 0 && rect.y % 2 == 0);
+      const uint8_t* uv_samples =
+          chroma_planes + size_t{rect.y / 2} * stride_ + rect.x;
+      ConvertNv12ToBgra(source, stride_, uv_samples, stride_, rect.width,
+                        rect.height, destination, rect.width * 4u);
+    } else if (pixel_format_ == mozart2::ImageInfo::PixelFormat::I420) {
+      FTL_DCHECK(rect.x % 2 == 0 && rect.y % 2 == 0);
+      const uint32_t chroma_stride = stride_ / 2;
+      const uint8_t* u_samples = chroma_planes +
+                                 size_t{rect.y / 2} * chroma_stride +
+                                 rect.x / 2;
+      const uint8_t* v_samples =
+          u_samples + size_t{height / 2} * chroma_stride;
+      ConvertI420ToBgra(source, stride_, u_samples, v_samples, chroma_stride,
+                        rect.width, rect.height, destination,
+                        rect.width * 4u);
+    } else if (region.as_block) {
+      const size_t row_size = rect.width * bytes_per_pixel_;
+      memcpy(destination, source,
+             (rect.height - 1) * size_t{stride_} + row_size);
+    } else {
+      const size_t row_size = rect.width * bytes_per_pixel_;
+      for (uint32_t row = 0; row < rect.height; ++row) {
+        memcpy(destination, source, row_size);
+        destination += row_size;
+        source += stride_;
+      }
+    }
+  }
 }
 
 }  // namespace scene_manager
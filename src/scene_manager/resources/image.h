@@ -9,7 +9,10 @@
 #include "apps/mozart/src/scene_manager/resources/image_base.h"
 #include "apps/mozart/src/scene_manager/resources/memory.h"
 #include "apps/mozart/src/scene_manager/resources/resource.h"
+#include "apps/mozart/src/scene_manager/util/dirty_region.h"
+#include "escher/impl/gpu_uploader.h"
 #include "escher/renderer/image.h"
+#include "lib/ftl/functional/closure.h"
 
 namespace scene_manager {
 
@@ -45,6 +48,29 @@ class Image : public ImageBase {
 
   const escher::ImagePtr& GetEscherImage() override { return image_; }
 
+  // Marks |rect| as needing to be uploaded from host memory again.  Returns
+  // false if |rect| does not lie within the image.  Has no effect on images
+  // in GPU memory.  For YUV images, |rect| is widened to whole 2x2 blocks.
+  bool Invalidate(const DirtyRegion::Rect& rect);
+
+  // Marks the whole image as needing to be uploaded from host memory again.
+  void InvalidateAll();
+
+  // Uploads the invalidated regions of an image in host memory, converting
+  // them to BGRA if the image is in a YUV format.
+  void UpdatePixels() override;
+
+  // Like UpdatePixels(), except that the pixels are copied or converted into
+  // the upload buffer on the Engine's upload thread, leaving only the
+  // submission of the upload to this thread.  |callback| is called on this
+  // thread once the upload has been submitted, which never happens if the
+  // Engine is destroyed first.  Until then, UpdatePixels() does nothing, and
+  // this must not be called again.
+  void UpdatePixelsAsync(ftl::Closure callback);
+
+  const DirtyRegion& dirty_region() const { return dirty_region_; }
+  bool upload_in_progress() const { return upload_in_progress_; }
+
  private:
   // Create an Image object from a VkImage.
   // |session| is the Session that this image can be referenced from.
@@ -60,17 +86,54 @@ class Image : public ImageBase {
   // Create an Image object from a escher::Image.
   // |session| is the Session that this image can be referenced from.
   // |image| is the escher::Image that is being wrapped.
-  // |memory| is the host memory that is associated with this image.
-  //
-  // TODO: We might not want to hold on to the memory since we're uploading
-  // its contents to the GPU and using the uploaded copy.
+  // |memory| is the host memory that is associated with this image; its
+  // pixels are uploaded to |image| again whenever they are invalidated.
+  // |memory_offset|, |stride|, |bytes_per_pixel| and |pixel_format| describe
+  // the layout of the pixels within |memory|; for YUV formats, the stride and
+  // bytes per pixel are those of the Y plane.
   Image(Session* session,
         mozart::ResourceId id,
         MemoryPtr memory,
-        escher::ImagePtr image);
+        escher::ImagePtr image,
+        uint64_t memory_offset,
+        uint32_t stride,
+        uint32_t bytes_per_pixel,
+        mozart2::ImageInfo::PixelFormat pixel_format);
+
+  bool is_yuv() const {
+    return pixel_format_ != mozart2::ImageInfo::PixelFormat::BGRA_8;
+  }
+
+  // Where a dirty rectangle goes in the upload buffer, and how it is copied
+  // into the image from there.
+  struct UploadRegion {
+    DirtyRegion::Rect rect;
+    // Whether the rows of |rect| are copied along with the padding between
+    // them, rather than packed.
+    bool as_block;
+    vk::BufferImageCopy copy;
+  };
+
+  // Lays out the dirty rectangles in the upload buffer, clears them, and
+  // returns the size of the buffer.
+  size_t PlanUpload(std::vector<UploadRegion>* regions);
+
+  // Copies or converts the pixels of |regions| into |buffer|.  Only reads the
+  // image's memory, so it may be called on any thread.
+  void FillUploadBuffer(const std::vector<UploadRegion>& regions,
+                        uint8_t* buffer) const;
 
   MemoryPtr memory_;
   escher::ImagePtr image_;
+
+  // Only used for images in host memory.
+  const uint64_t memory_offset_ = 0;
+  const uint32_t stride_ = 0;
+  const uint32_t bytes_per_pixel_ = 0;
+  const mozart2::ImageInfo::PixelFormat pixel_format_ =
+      mozart2::ImageInfo::PixelFormat::BGRA_8;
+  DirtyRegion dirty_region_;
+  bool upload_in_progress_ = false;
 };
 
 }  // namespace scene_manager
@@ -17,6 +17,10 @@ class ImageBase : public Resource {
   // Returns the image that should currently be presented. Can be null.
   virtual const escher::ImagePtr& GetEscherImage() = 0;
 
+  // Called at presentation time, before GetEscherImage(), to make any changes
+  // to the image's pixels visible to the GPU.
+  virtual void UpdatePixels() {}
+
  protected:
   ImageBase(Session* session,
             mozart::ResourceId id,
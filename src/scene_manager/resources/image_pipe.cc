@@ -4,6 +4,8 @@
 
 #include "apps/mozart/src/scene_manager/resources/image_pipe.h"
 
+#include <algorithm>
+
 #include "apps/mozart/src/scene_manager/engine/session.h"
 #include "apps/mozart/src/scene_manager/fence.h"
 #include "apps/mozart/src/scene_manager/resources/gpu_memory.h"
@@ -117,55 +119,181 @@ void ImagePipe::PresentImage(
     return;
   }
 
-  auto acquire_fence_obj =
-      std::make_unique<AcquireFence>(std::move(acquire_fence));
-  acquire_fence_obj->WaitReadyAsync(
-      [ weak = weak_ptr_factory_.GetWeakPtr(), presentation_time ] {
-        if (weak) {
-          weak->session()->ScheduleImagePipeUpdate(presentation_time,
-                                                   ImagePipePtr(weak.get()));
-        }
-      });
+  // The fence is waited for on the engine's shared port, like those of
+  // session updates.
+  auto acquire_fences = ::fidl::Array<mx::event>::New(0);
+  acquire_fences.push_back(std::move(acquire_fence));
+  auto acquire_fence_obj = std::make_unique<AcquireFenceSet>(
+      std::move(acquire_fences), session()->engine()->acquire_fence_waiter());
+  acquire_fence_obj->WaitReadyAsync([weak = weak_ptr_factory_.GetWeakPtr()] {
+    if (weak) {
+      weak->PrepareFrames();
+    }
+  });
 
-  frames_.push_back(Frame{image_id, presentation_time,
-                          std::move(acquire_fence_obj),
-                          std::move(release_fence), callback});
+  Frame frame;
+  frame.frame_number = next_frame_number_++;
+  frame.image_id = image_id;
+  frame.presentation_time = presentation_time;
+  frame.enqueue_time = mx_time_get(MX_CLOCK_MONOTONIC);
+  frame.acquire_fence = std::move(acquire_fence_obj);
+  frame.release_fence = std::move(release_fence);
+  frame.present_image_callback = callback;
+  frames_.push_back(std::move(frame));
 };
 
+void ImagePipe::SetPresentationMode(mozart2::PresentationMode mode) {
+  presentation_mode_ = mode;
+}
+
+void ImagePipe::OnAttachedToMaterial() {
+  if (material_count_++ == 0 && !frames_.empty() &&
+      frames_.front().prepared) {
+    // Frames which became ready while the pipe was not rendered were not
+    // scheduled.
+    RequestUpdate(frames_.front().presentation_time);
+  }
+}
+
+void ImagePipe::OnDetachedFromMaterial() {
+  FTL_DCHECK(material_count_ > 0);
+  --material_count_;
+}
+
+void ImagePipe::RequestUpdate(uint64_t presentation_time) {
+  if (material_count_ > 0) {
+    session()->ScheduleImagePipeUpdate(presentation_time, ImagePipePtr(this));
+  } else if (presentation_mode_ == mozart2::PresentationMode::MAILBOX) {
+    // Nothing renders this pipe, so don't wake the engine for it.  Frames
+    // which have been superseded are still released, so that the producer
+    // does not run out of images; in FIFO mode, the producer waits instead.
+    while (frames_.size() >= 2 && frames_[0].prepared &&
+           frames_[1].prepared) {
+      Frame frame = std::move(frames_.front());
+      frames_.pop_front();
+      frame.release_fence.signal(0u, kFenceSignalled);
+      ReportFrame(&frame, false, last_presentation_time_,
+                  last_presentation_interval_);
+    }
+  }
+}
+
+void ImagePipe::PrepareFrames() {
+  const bool can_upload = !!session()->engine()->escher_gpu_uploader();
+  bool has_prepared_frame = false;
+  uint64_t earliest_presentation_time = 0;
+  for (Frame& frame : frames_) {
+    if (frame.prepared || frame.preparing || !frame.acquire_fence->ready()) {
+      continue;
+    }
+    ImagePtr image = images_.FindResource<Image>(frame.image_id);
+    if (image && image->upload_in_progress()) {
+      // The image was presented again while still being uploaded for an
+      // earlier frame; it is prepared once that upload is done.
+      continue;
+    }
+    if (image && can_upload && image.get() != current_image_.get()) {
+      // The client has written new pixels into the image's memory since it
+      // was last presented.  Images in GPU memory have nothing to upload.
+      image->InvalidateAll();
+      if (!image->dirty_region().is_empty()) {
+        frame.preparing = true;
+        image->UpdatePixelsAsync([
+          weak = weak_ptr_factory_.GetWeakPtr(),
+          frame_number = frame.frame_number
+        ] {
+          if (weak) {
+            weak->OnFrameUploaded(frame_number);
+          }
+        });
+        continue;
+      }
+    }
+    // Otherwise, the image is uploaded by UpdatePixels() once it has been
+    // presented, as is the current image when it is presented again.
+    frame.prepared = true;
+    if (!has_prepared_frame ||
+        frame.presentation_time < earliest_presentation_time) {
+      earliest_presentation_time = frame.presentation_time;
+    }
+    has_prepared_frame = true;
+  }
+  if (has_prepared_frame) {
+    RequestUpdate(earliest_presentation_time);
+  }
+}
+
+void ImagePipe::OnFrameUploaded(uint64_t frame_number) {
+  auto it = std::find_if(frames_.begin(), frames_.end(),
+                         [frame_number](const Frame& frame) {
+                           return frame.frame_number == frame_number;
+                         });
+  if (it != frames_.end()) {
+    it->preparing = false;
+    it->prepared = true;
+    it->uploaded = true;
+    RequestUpdate(it->presentation_time);
+  }
+  // Frames which were waiting for the upload to finish can now be prepared.
+  PrepareFrames();
+}
+
 bool ImagePipe::Update(uint64_t presentation_time,
                        uint64_t presentation_interval) {
   TRACE_DURATION("gfx", "ImagePipe::Update", "session_id", session()->id(),
                  "id", id(), "time", presentation_time, "interval",
                  presentation_interval);
 
-  mozart::ResourceId next_image_id = current_image_id_;
-  mx::event next_release_fence;
+  // In FIFO mode, at most one frame is presented per consumer frame, even if
+  // the pipe is updated more than once for it.
+  const bool fifo = presentation_mode_ == mozart2::PresentationMode::FIFO;
+  const bool may_advance =
+      !fifo || presentation_time >= next_fifo_presentation_time_;
 
-  while (!frames_.empty() &&
+  bool has_next_frame = false;
+  Frame next_frame;
+  while (may_advance && !frames_.empty() &&
          frames_.front().presentation_time <= presentation_time &&
-         frames_.front().acquire_fence->ready()) {
-    next_image_id = frames_.front().image_id;
-    if (next_release_fence) {
+         frames_.front().prepared) {
+    if (has_next_frame) {
       // We're skipping a frame, so we can immediately signal its release fence.
-      next_release_fence.signal(0u, kFenceSignalled);
-    }
-    next_release_fence = std::move(frames_.front().release_fence);
-
-    auto info = mozart2::PresentationInfo::New();
-    info->presentation_time = presentation_time;
-    info->presentation_interval = presentation_interval;
-    if (frames_.front().present_image_callback) {
-      frames_.front().present_image_callback(std::move(info));
+      next_frame.release_fence.signal(0u, kFenceSignalled);
+      ReportFrame(&next_frame, false, presentation_time, presentation_interval);
     }
+    next_frame = std::move(frames_.front());
+    has_next_frame = true;
     frames_.pop_front();
+    if (fifo) {
+      next_fifo_presentation_time_ = presentation_time + 1;
+      break;
+    }
   }
 
-  if (next_image_id == current_image_id_) {
+  last_presentation_time_ = presentation_time;
+  last_presentation_interval_ = presentation_interval;
+
+  // If the next frame is already ready, its own update may have been skipped
+  // (in FIFO mode, or while the pipe was not rendered), so request another
+  // one for when it is due.  This is posted, rather than scheduled directly,
+  // since the engine is in the middle of applying updates.
+  if (!frames_.empty() && frames_.front().prepared) {
+    uint64_t next_time = std::max(
+        frames_.front().presentation_time,
+        presentation_time + std::max<uint64_t>(presentation_interval, 1u));
+    mtl::MessageLoop::GetCurrent()->task_runner()->PostTask(
+        [ weak = weak_ptr_factory_.GetWeakPtr(), next_time ] {
+          if (weak) {
+            weak->RequestUpdate(next_time);
+          }
+        });
+  }
+
+  if (!has_next_frame) {
     // This ImagePipe did not change since the last frame was rendered.
     return false;
   }
 
-  if (auto next_image = images_.FindResource<Image>(next_image_id)) {
+  if (auto next_image = images_.FindResource<Image>(next_frame.image_id)) {
     // We're replacing a frame with a new one, so we hand off its release fence
     // to the |ReleaseFenceSignaller|, which will signal it as soon as all work
     // previously submitted to the GPU is finished.
@@ -173,15 +301,22 @@ bool ImagePipe::Update(uint64_t presentation_time,
       session()->engine()->release_fence_signaller()->AddCPUReleaseFence(
           std::move(current_release_fence_));
     }
-    current_release_fence_ = std::move(next_release_fence);
-    current_image_id_ = next_image_id;
+    current_release_fence_ = std::move(next_frame.release_fence);
+    current_image_id_ = next_frame.image_id;
     current_image_ = std::move(next_image);
+    // Unless they were uploaded ahead of time, the pixels which the client
+    // has written into the image's memory since it was last presented are
+    // uploaded by UpdatePixels().
+    if (!next_frame.uploaded) {
+      current_image_->InvalidateAll();
+    }
+    ReportFrame(&next_frame, true, presentation_time, presentation_interval);
 
     return true;
   } else {
     session()->error_reporter()->ERROR()
         << "ImagePipe::Update() could not find Image with ID: "
-        << next_image_id;
+        << next_frame.image_id;
     CloseConnectionAndCleanUp();
 
     // Tearing down an ImagePipe will very probably result in changes to
@@ -190,6 +325,47 @@ bool ImagePipe::Update(uint64_t presentation_time,
   }
 }
 
+void ImagePipe::ReportFrame(Frame* frame,
+                            bool presented,
+                            uint64_t presentation_time,
+                            uint64_t presentation_interval) {
+  uint64_t now = mx_time_get(MX_CLOCK_MONOTONIC);
+  uint64_t latency =
+      now > frame->enqueue_time ? now - frame->enqueue_time : 0u;
+  if (presented) {
+    ++statistics_.frames_presented;
+    statistics_.total_latency += latency;
+    statistics_.max_latency = std::max(statistics_.max_latency, latency);
+    if (presentation_time > frame->presentation_time) {
+      statistics_.total_delay += presentation_time - frame->presentation_time;
+    }
+  } else {
+    ++statistics_.frames_dropped;
+  }
+  TRACE_COUNTER("gfx", "ImagePipe", id(), "presented",
+                statistics_.frames_presented, "dropped",
+                statistics_.frames_dropped, "queued", frames_.size());
+
+  if (frame->present_image_callback) {
+    auto info = mozart2::PresentationInfo::New();
+    info->presentation_time = presentation_time;
+    info->presentation_interval = presentation_interval;
+    auto status = mozart2::ImagePresentationStatus::New();
+    status->presented = presented;
+    status->requested_presentation_time = frame->presentation_time;
+    status->latency = latency;
+    status->frames_presented = statistics_.frames_presented;
+    status->frames_dropped = statistics_.frames_dropped;
+    frame->present_image_callback(std::move(info), std::move(status));
+  }
+}
+
+void ImagePipe::UpdatePixels() {
+  if (current_image_) {
+    current_image_->UpdatePixels();
+  }
+}
+
 const escher::ImagePtr& ImagePipe::GetEscherImage() {
   if (current_image_) {
     return current_image_->GetEscherImage();
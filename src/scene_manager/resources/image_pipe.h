@@ -10,7 +10,7 @@
 #include <deque>
 
 #include "apps/mozart/services/images/image_pipe.fidl.h"
-#include "apps/mozart/src/scene_manager/acquire_fence.h"
+#include "apps/mozart/src/scene_manager/acquire_fence_set.h"
 #include "apps/mozart/src/scene_manager/resources/image.h"
 #include "apps/mozart/src/scene_manager/resources/image_base.h"
 #include "apps/mozart/src/scene_manager/resources/image_pipe.h"
@@ -51,12 +51,25 @@ class ImagePipe : public ImageBase {
 
   void Accept(class ResourceVisitor* visitor) override;
 
-  // Update to use the most current frame for the specified presentation time.
-  // Called before rendering a frame using this ImagePipe.  Return true if the
-  // current Image changed since the last time Update() was called, and false
-  // otherwise.
+  // Called by |ImagePipeHandler|, part of |ImagePipe| interface.
+  void SetPresentationMode(mozart2::PresentationMode mode);
+
+  // Called by Material::SetTexture().  An ImagePipe which is not the texture
+  // of any Material is not rendered, so the engine is not woken up to update
+  // it when its frames become ready.
+  void OnAttachedToMaterial();
+  void OnDetachedFromMaterial();
+
+  // Update to use the next frame for the specified presentation time,
+  // according to the presentation mode: the newest ready frame in MAILBOX
+  // mode, and the oldest in FIFO mode.  Called before rendering a frame using
+  // this ImagePipe.  Return true if the current Image changed since the last
+  // time Update() was called, and false otherwise.
   bool Update(uint64_t presentation_time, uint64_t presentation_interval);
 
+  // Uploads the pixels of the current image, if they have changed.
+  void UpdatePixels() override;
+
   // Returns the image that should be presented at the current time. Can be
   // null.
   const escher::ImagePtr& GetEscherImage() override;
@@ -64,6 +77,21 @@ class ImagePipe : public ImageBase {
   // Returns true if the connection to the ImagePipe has not closed.
   bool is_valid() { return is_valid_; };
 
+  // Aggregate statistics about the frames presented through this ImagePipe,
+  // which are also reported as trace counters.
+  struct Statistics {
+    uint64_t frames_presented = 0;
+    uint64_t frames_dropped = 0;
+
+    // The time from each presented frame being enqueued to being presented.
+    uint64_t total_latency = 0;
+    uint64_t max_latency = 0;
+
+    // The total time by which frames were presented later than requested.
+    uint64_t total_delay = 0;
+  };
+  const Statistics& statistics() const { return statistics_; }
+
  private:
   friend class ImagePipeHandler;
 
@@ -86,18 +114,58 @@ class ImagePipe : public ImageBase {
   // A |Frame| stores the arguments passed to a particular invocation of
   // Present().
   struct Frame {
+    uint64_t frame_number;
     mozart::ResourceId image_id;
     uint64_t presentation_time;
-    std::unique_ptr<AcquireFence> acquire_fence;
+    uint64_t enqueue_time;
+    std::unique_ptr<AcquireFenceSet> acquire_fence;
     mx::event release_fence;
 
     // Callback to report when the update has been applied in response to
     // an invocation of |ImagePipe.PresentImage()|.
     mozart2::ImagePipe::PresentImageCallback present_image_callback;
+
+    // A frame may be presented once it is prepared: its acquire fence has
+    // been signalled and, if |uploaded|, its pixels have already been
+    // uploaded, so that presenting it is just a matter of swapping images.
+    bool preparing = false;
+    bool prepared = false;
+    bool uploaded = false;
   };
   std::deque<Frame> frames_;
   std::unique_ptr<ImagePipeHandler> handler_;
 
+  // Called when a frame is ready to be presented at |presentation_time|.
+  // Schedules an update if the pipe is rendered.
+  void RequestUpdate(uint64_t presentation_time);
+
+  // Prepares the frames whose acquire fences have been signalled.  The pixels
+  // of images in host memory are copied into upload buffers on the engine's
+  // upload thread, ahead of the frame in which they are presented, rather
+  // than by UpdatePixels() on the render thread.
+  void PrepareFrames();
+
+  // Called once the upload of the frame numbered |frame_number| has been
+  // submitted.
+  void OnFrameUploaded(uint64_t frame_number);
+
+  // Calls the callback of |frame|, and updates |statistics_|.
+  void ReportFrame(Frame* frame,
+                   bool presented,
+                   uint64_t presentation_time,
+                   uint64_t presentation_interval);
+
+  mozart2::PresentationMode presentation_mode_ =
+      mozart2::PresentationMode::MAILBOX;
+  // The earliest presentation time at which a FIFO pipe may present its next
+  // frame.
+  uint64_t next_fifo_presentation_time_ = 0;
+  uint64_t last_presentation_time_ = 0;
+  uint64_t last_presentation_interval_ = 0;
+  uint64_t next_frame_number_ = 0;
+  size_t material_count_ = 0;
+  Statistics statistics_;
+
   mozart::ResourceId current_image_id_ = 0;
   ImagePtr current_image_;
   mx::event current_release_fence_;
@@ -37,4 +37,8 @@ void ImagePipeHandler::PresentImage(uint32_t image_id,
                             callback);
 }
 
+void ImagePipeHandler::SetPresentationMode(mozart2::PresentationMode mode) {
+  image_pipe_->SetPresentationMode(mode);
+}
+
 }  // namespace scene_manager
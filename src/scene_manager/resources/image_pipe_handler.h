@@ -29,6 +29,7 @@ class ImagePipeHandler : public mozart2::ImagePipe {
                     mx::event acquire_fence,
                     mx::event release_fence,
                     const PresentImageCallback& callback) override;
+  void SetPresentationMode(mozart2::PresentationMode mode) override;
 
   ::fidl::Binding<mozart2::ImagePipe> binding_;
   scene_manager::ImagePipe* image_pipe_;
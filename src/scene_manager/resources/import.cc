@@ -29,12 +29,17 @@ Import::Import(Session* session,
     : Resource(session, id, Import::kTypeInfo),
       import_token_(std::move(import_token)),
       import_spec_(spec),
-      delegate_(CreateDelegate(session, id, spec)) {
+      delegate_(CreateDelegate(session, id, spec)),
+      weak_factory_(this) {
   FTL_DCHECK(delegate_);
   FTL_DCHECK(!delegate_->type_info().IsKindOf(Import::kTypeInfo));
 }
 
 Import::~Import() {
+  Unbind();
+}
+
+void Import::Unbind() {
   if (imported_resource_ != nullptr) {
     imported_resource_->RemoveImport(this);
     imported_resource_ = nullptr;
@@ -6,6 +6,7 @@
 
 #include "apps/mozart/src/scene_manager/resources/resource.h"
 #include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
 #include "magenta/system/ulib/mx/include/mx/eventpair.h"
 
 namespace scene_manager {
@@ -56,6 +57,14 @@ class Import final : public Resource {
   /// Returns true if the imported resource has been bound.
   bool is_bound() const { return imported_resource_ != nullptr; }
 
+  /// Breaks the binding to the imported resource, if any, detaching the
+  /// delegate and everything attached to it from the imported resource.
+  void Unbind();
+
+  /// Used to resolve the import once the ResourceLinker finds its export,
+  /// which may happen after the import has been released.
+  ftl::WeakPtr<Import> GetWeakPtr() { return weak_factory_.GetWeakPtr(); }
+
  private:
   // TODO(MZ-132): Don't hold onto the token for the the duration of the
   // lifetime of the import resource. This bloats kernel handle tables.
@@ -80,6 +89,8 @@ class Import final : public Resource {
   /// that resource.
   void UnbindImportedResource();
 
+  ftl::WeakPtrFactory<Import> weak_factory_;  // must be last
+
   FRIEND_MAKE_REF_COUNTED(Import);
   FRIEND_REF_COUNTED_THREAD_SAFE(Import);
   FTL_DISALLOW_COPY_AND_ASSIGN(Import);
@@ -20,19 +20,61 @@ Material::Material(Session* session, mozart::ResourceId id)
 
 void Material::SetColor(float red, float green, float blue, float alpha) {
   // TODO: need to add alpha into escher material
-  escher_material_->set_color(escher::vec3(red, green, blue));
+  const escher::vec3 color(red, green, blue);
+  if (texture_) {
+    escher_material_->set_color(color);
+  } else {
+    escher_material_ = session()->GetSharedColorMaterial(color);
+    shares_escher_material_ = true;
+  }
+}
+
+Material::~Material() {
+  if (texture_ && texture_->IsKindOf<ImagePipe>()) {
+    static_cast<ImagePipe*>(texture_.get())->OnDetachedFromMaterial();
+  }
 }
 
 void Material::SetTexture(ImageBasePtr texture_image) {
+  // Let ImagePipes know whether they are rendered.
+  if (texture_image && texture_image->IsKindOf<ImagePipe>()) {
+    static_cast<ImagePipe*>(texture_image.get())->OnAttachedToMaterial();
+  }
+  if (texture_ && texture_->IsKindOf<ImagePipe>()) {
+    static_cast<ImagePipe*>(texture_.get())->OnDetachedFromMaterial();
+  }
   texture_ = std::move(texture_image);
+  texture_changed_ = true;
+
+  const escher::vec3 color = escher_material_->color();
+  if (texture_ && shares_escher_material_) {
+    escher_material_ = ftl::MakeRefCounted<escher::Material>();
+    escher_material_->set_color(color);
+    shares_escher_material_ = false;
+  } else if (!texture_ && !shares_escher_material_) {
+    escher_material_ = session()->GetSharedColorMaterial(color);
+    shares_escher_material_ = true;
+  }
 }
 
 void Material::UpdateEscherMaterial() {
-  // Update our escher::Material if our texture's presented image changed.
-  escher::ImagePtr escher_image;
-  if (texture_) {
-    escher_image = texture_->GetEscherImage();
+  // A material is drawn by each of the nodes which use it, but its texture
+  // only needs to be checked once per frame.
+  const uint64_t frame_number =
+      session()->engine()->frame_statistics().frame_count;
+  if (!texture_changed_ && (!texture_ || frame_number == last_update_frame_)) {
+    return;
   }
+  texture_changed_ = false;
+  last_update_frame_ = frame_number;
+  if (!texture_) {
+    // The shared escher::Material never has a texture.
+    return;
+  }
+
+  // Update our escher::Material if our texture's presented image changed.
+  texture_->UpdatePixels();
+  escher::ImagePtr escher_image = texture_->GetEscherImage();
   const escher::TexturePtr& escher_texture = escher_material_->texture();
 
   if (!escher_texture || escher_image != escher_texture->image()) {
@@ -20,6 +20,7 @@ class Material : public Resource {
   static const ResourceTypeInfo kTypeInfo;
 
   Material(Session* session, mozart::ResourceId id);
+  ~Material() override;
 
   void SetColor(float red, float green, float blue, float alpha);
   void SetTexture(ImageBasePtr texture_image);
@@ -39,11 +40,19 @@ class Material : public Resource {
   void Accept(class ResourceVisitor* visitor) override;
 
   // Called at presentation time to allow ImagePipes to update current image.
+  // Does nothing if the material has no texture, or was already updated in
+  // the current frame, unless its texture has been changed since.
   void UpdateEscherMaterial();
 
  private:
+  // Materials without a texture share the session's escher::Material of
+  // their color; see Session::GetSharedColorMaterial().  Those with a texture
+  // have one of their own.
   escher::MaterialPtr escher_material_;
+  bool shares_escher_material_ = false;
   ImageBasePtr texture_;
+  bool texture_changed_ = false;
+  uint64_t last_update_frame_ = 0;
 };
 
 }  // namespace scene_manager
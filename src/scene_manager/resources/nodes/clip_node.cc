@@ -0,0 +1,80 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/resources/nodes/clip_node.h"
+
+#include <algorithm>
+
+#include "apps/mozart/src/scene_manager/resources/nodes/scene.h"
+#include "apps/mozart/src/scene_manager/resources/nodes/shape_node.h"
+#include "apps/mozart/src/scene_manager/resources/shapes/rectangle_shape.h"
+
+namespace scene_manager {
+
+const ResourceTypeInfo ClipNode::kTypeInfo = {
+    ResourceType::kNode | ResourceType::kClipNode, "ClipNode"};
+
+ClipNode::ClipNode(Session* session, mozart::ResourceId node_id)
+    : Node(session, node_id, ClipNode::kTypeInfo) {}
+
+ClipNode::~ClipNode() {
+  FTL_DCHECK(clipped_nodes_.empty());
+}
+
+const ClipNode::Region& ClipNode::region() const {
+  if (region_dirty_) {
+    ComputeRegion();
+    region_dirty_ = false;
+  }
+  return region_;
+}
+
+bool ClipNode::IsRooted() const {
+  const Node* node = this;
+  while (node->parent())
+    node = node->parent();
+  return node->IsKindOf<Scene>();
+}
+
+bool ClipNode::IsRayWithinRegion(const escher::ray4& ray) const {
+  float distance;
+  for (const RegionShape& region_shape : region().shapes) {
+    if (region_shape.shape->GetIntersection(
+            region_shape.inverse_transform * ray, &distance))
+      return true;
+  }
+  return false;
+}
+
+void ClipNode::OnPartsChanged() {
+  region_dirty_ = true;
+}
+
+void ClipNode::RemoveClippedNode(Node* node) {
+  auto it = std::find(clipped_nodes_.begin(), clipped_nodes_.end(), node);
+  FTL_DCHECK(it != clipped_nodes_.end());
+  clipped_nodes_.erase(it);
+}
+
+void ClipNode::ComputeRegion() const {
+  region_.shapes.clear();
+  region_.bounds = {escher::vec2(0.f), escher::vec2(0.f)};
+  for (const NodePtr& part : parts()) {
+    // TODO(MZ-167): accept non-ShapeNode parts.
+    if (!part->IsKindOf<ShapeNode>())
+      continue;
+    const ShapePtr& shape = static_cast<ShapeNode*>(part.get())->shape();
+    if (!shape)
+      continue;
+    const auto transform = static_cast<escher::mat4>(part->transform());
+    region_.shapes.push_back({shape, transform, glm::inverse(transform)});
+    region_.bounds = region_.bounds.Union(
+        TransformBounds(transform, shape->GetLocalBounds()));
+  }
+  region_.is_rectangle = region_.shapes.size() == 1 &&
+                         region_.shapes[0].shape->IsKindOf<RectangleShape>() &&
+                         PreservesAxisAlignment(region_.shapes[0].transform);
+}
+
+}  // namespace scene_manager
@@ -0,0 +1,74 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <vector>
+
+#include "apps/mozart/src/scene_manager/resources/nodes/node.h"
+#include "apps/mozart/src/scene_manager/resources/shapes/shape.h"
+#include "apps/mozart/src/scene_manager/util/axis_aligned_rect.h"
+
+namespace scene_manager {
+
+// A ClipNode defines a clip region, the union of the shapes of its ShapeNode
+// parts, which can be applied to any number of other nodes with SetClipOp.
+// The region is computed once, when it is first needed after its parts
+// change, and shared by every node which it clips.
+class ClipNode final : public Node {
+ public:
+  static const ResourceTypeInfo kTypeInfo;
+
+  // A shape of the clip region, in the clip node's coordinate system.
+  struct RegionShape {
+    ShapePtr shape;
+    escher::mat4 transform;
+    escher::mat4 inverse_transform;
+  };
+
+  struct Region {
+    std::vector<RegionShape> shapes;
+    // The bounds of |shapes| in the Z=0 plane of the clip node, or
+    // AxisAlignedRect::Infinite() if they are not known.
+    AxisAlignedRect bounds;
+    // True if the region is a single rectangle, so that it is exactly
+    // |bounds| wherever it stays axis-aligned.
+    bool is_rectangle = false;
+  };
+
+  ClipNode(Session* session, mozart::ResourceId node_id);
+
+  ~ClipNode() override;
+
+  void Accept(class ResourceVisitor* visitor) override;
+
+  const Region& region() const;
+
+  // Returns true if the clip node belongs to a scene, which is required for
+  // it to have any effect.
+  bool IsRooted() const;
+
+  // Returns true if the ray passes through the clip region.
+  // |ray| must be in the clip node's local coordinate system.
+  bool IsRayWithinRegion(const escher::ray4& ray) const;
+
+ private:
+  // Node::SetClip() maintains |clipped_nodes_|.
+  friend class Node;
+
+  // |Node|
+  void OnPartsChanged() override;
+
+  void ComputeRegion() const;
+
+  void RemoveClippedNode(Node* node);
+
+  mutable Region region_;
+  mutable bool region_dirty_ = true;
+
+  // The nodes which are clipped by this node, each of which keeps it alive.
+  std::vector<Node*> clipped_nodes_;
+};
+
+}  // namespace scene_manager
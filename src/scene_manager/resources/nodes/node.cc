@@ -3,10 +3,14 @@
 // found in the LICENSE file.
 
 #include <algorithm>
+#include <unordered_set>
 
 #include "apps/mozart/src/scene_manager/resources/nodes/node.h"
 
+#include "apps/mozart/src/scene_manager/engine/engine.h"
+#include "apps/mozart/src/scene_manager/engine/session.h"
 #include "apps/mozart/src/scene_manager/resources/import.h"
+#include "apps/mozart/src/scene_manager/resources/nodes/clip_node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/traversal.h"
 #include "apps/mozart/src/scene_manager/util/error_reporter.h"
 #include "lib/escher/escher/geometry/types.h"
@@ -36,11 +40,26 @@ Node::Node(Session* session,
 }
 
 Node::~Node() {
+  if (clip_)
+    clip_->RemoveClippedNode(this);
+
   ForEachDirectDescendantFrontToBack(*this, [](Node* node) {
     FTL_DCHECK(node->parent_relation_ != ParentRelation::kNone);
     node->parent_relation_ = ParentRelation::kNone;
     node->parent_ = nullptr;
   });
+
+  // While the session is being torn down, hand the children and parts to the
+  // ResourceReaper instead of recursively destroying the whole subtree here.
+  if (!session()->is_valid()) {
+    ResourceReaper* reaper = session()->engine()->resource_reaper();
+    for (auto& child : children_) {
+      reaper->Defer(std::move(child));
+    }
+    for (auto& part : parts_) {
+      reaper->Defer(std::move(part));
+    }
+  }
 }
 
 bool Node::SetEventMask(uint32_t event_mask) {
@@ -70,6 +89,12 @@ bool Node::AddChild(NodePtr child_node) {
       child_node->parent_ == this) {
     return true;  // no change
   }
+  if (IsRetainedBy(child_node.get())) {
+    error_reporter()->ERROR()
+        << "scene_manager::Node::AddChild(): a node cannot be added to a "
+           "node which it contains or clips.";
+    return false;
+  }
   child_node->Detach();
 
   // Add child to its new parent (i.e. us).
@@ -91,6 +116,12 @@ bool Node::AddPart(NodePtr part_node) {
       part_node->parent_ == this) {
     return true;  // no change
   }
+  if (IsRetainedBy(part_node.get())) {
+    error_reporter()->ERROR()
+        << "scene_manager::Node::AddPart(): a node cannot be added to a node "
+           "which it contains or clips.";
+    return false;
+  }
   part_node->Detach();
 
   // Add part to its new parent (i.e. us).
@@ -98,6 +129,7 @@ bool Node::AddPart(NodePtr part_node) {
   part_node->parent_ = this;
   part_node->InvalidateGlobalTransform();
   parts_.push_back(std::move(part_node));
+  OnPartsChanged();
   return true;
 }
 
@@ -131,6 +163,7 @@ void Node::ErasePart(Node* part) {
                    [part](const NodePtr& ptr) { return part == ptr.get(); });
   FTL_DCHECK(it != parts_.end());
   parts_.erase(it);
+  OnPartsChanged();
 }
 
 void Node::EraseChild(Node* child) {
@@ -141,6 +174,31 @@ void Node::EraseChild(Node* child) {
   children_.erase(it);
 }
 
+bool Node::IsRetainedBy(const Node* node) const {
+  // A node is retained by its parent and, if it is a clip node, by every node
+  // which it clips.  These form a DAG, since clip nodes can be shared.
+  std::vector<const Node*> stack{this};
+  std::unordered_set<const Node*> visited{this};
+  auto visit = [&stack, &visited](const Node* next) {
+    if (visited.insert(next).second)
+      stack.push_back(next);
+  };
+  while (!stack.empty()) {
+    const Node* current = stack.back();
+    stack.pop_back();
+    if (current == node)
+      return true;
+    if (current->parent_)
+      visit(current->parent_);
+    if (current->IsKindOf<ClipNode>()) {
+      for (const Node* clipped_node :
+           static_cast<const ClipNode*>(current)->clipped_nodes_)
+        visit(clipped_node);
+    }
+  }
+  return false;
+}
+
 bool Node::DetachChildren() {
   if (!(type_flags() & kHasChildren)) {
     error_reporter()->ERROR()
@@ -171,6 +229,7 @@ bool Node::SetTransform(const escher::Transform& transform) {
   }
   transform_ = transform;
   InvalidateGlobalTransform();
+  NotifyPartChanged();
   return true;
 }
 
@@ -183,6 +242,7 @@ bool Node::SetTranslation(const escher::vec3& translation) {
   }
   transform_.translation = translation;
   InvalidateGlobalTransform();
+  NotifyPartChanged();
   return true;
 }
 
@@ -195,6 +255,7 @@ bool Node::SetScale(const escher::vec3& scale) {
   }
   transform_.scale = scale;
   InvalidateGlobalTransform();
+  NotifyPartChanged();
   return true;
 }
 
@@ -207,6 +268,7 @@ bool Node::SetRotation(const escher::quat& rotation) {
   }
   transform_.rotation = rotation;
   InvalidateGlobalTransform();
+  NotifyPartChanged();
   return true;
 }
 
@@ -219,6 +281,7 @@ bool Node::SetAnchor(const escher::vec3& anchor) {
   }
   transform_.anchor = anchor;
   InvalidateGlobalTransform();
+  NotifyPartChanged();
   return true;
 }
 
@@ -233,6 +296,29 @@ bool Node::SetClipToSelf(bool clip_to_self) {
   return true;
 }
 
+bool Node::SetClip(ClipNodePtr clip) {
+  if (!(type_flags() & kHasClip)) {
+    error_reporter()->ERROR()
+        << "scene_manager::Node::SetClip(): node of type " << type_name()
+        << " cannot have clip params set.";
+    return false;
+  }
+  if (clip.get() == clip_.get())
+    return true;  // no change
+  if (clip && clip->IsRetainedBy(this)) {
+    error_reporter()->ERROR()
+        << "scene_manager::Node::SetClip(): a node cannot be clipped by a "
+           "clip node which contains or clips it.";
+    return false;
+  }
+  if (clip_)
+    clip_->RemoveClippedNode(this);
+  clip_ = std::move(clip);
+  if (clip_)
+    clip_->clipped_nodes_.push_back(this);
+  return true;
+}
+
 bool Node::SetHitTestBehavior(mozart2::HitTestBehavior hit_test_behavior) {
   hit_test_behavior_ = hit_test_behavior;
   return true;
@@ -246,6 +332,11 @@ void Node::InvalidateGlobalTransform() {
   }
 }
 
+void Node::NotifyPartChanged() {
+  if (parent_relation_ == ParentRelation::kPart)
+    parent_->OnPartsChanged();
+}
+
 void Node::ComputeGlobalTransform() const {
   if (parent_) {
     global_transform_ =
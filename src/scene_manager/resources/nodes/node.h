@@ -11,7 +11,9 @@
 
 namespace scene_manager {
 
+class ClipNode;
 class Node;
+using ClipNodePtr = ftl::RefPtr<ClipNode>;
 using NodePtr = ftl::RefPtr<Node>;
 
 // Node is an abstract base class for all the concrete node types listed in
@@ -35,6 +37,9 @@ class Node : public Resource {
   bool SetRotation(const escher::quat& rotation);
   bool SetAnchor(const escher::vec3& anchor);
   bool SetClipToSelf(bool clip_to_self);
+  // Clips the node's parts and children to the region of |clip|, or removes
+  // the clip if |clip| is null.
+  bool SetClip(ClipNodePtr clip);
   bool SetHitTestBehavior(mozart2::HitTestBehavior behavior);
 
   const escher::mat4& GetGlobalTransform() const;
@@ -45,6 +50,7 @@ class Node : public Resource {
   const escher::quat& rotation() const { return transform_.rotation; }
   const escher::vec3& anchor() const { return transform_.anchor; }
   bool clip_to_self() const { return clip_to_self_; }
+  const ClipNodePtr& clip() const { return clip_; }
   mozart2::HitTestBehavior hit_test_behavior() const {
     return hit_test_behavior_;
   }
@@ -86,6 +92,13 @@ class Node : public Resource {
        mozart::ResourceId node_id,
        const ResourceTypeInfo& type_info);
 
+  // Called when a part is added or removed, or when the transform or shape
+  // of one of the node's parts changes.
+  virtual void OnPartsChanged() {}
+
+  // Calls OnPartsChanged() on the parent, if this node is one of its parts.
+  void NotifyPartChanged();
+
  private:
   void InvalidateGlobalTransform();
   void ComputeGlobalTransform() const;
@@ -93,6 +106,12 @@ class Node : public Resource {
   void ErasePart(Node* part);
   void EraseChild(Node* child);
 
+  // Returns true if this node is |node|, or is kept alive by it through its
+  // children, parts and clips.  Used to reject operations which would create
+  // a reference cycle.  Only walks the nodes which retain this one, so it is
+  // cheap for the shallow, wide trees that sessions typically build.
+  bool IsRetainedBy(const Node* node) const;
+
   // Describes the manner in which a node is related to its parent.
   enum class ParentRelation { kNone, kChild, kPart, kImportDelegate };
 
@@ -106,6 +125,7 @@ class Node : public Resource {
   mutable escher::mat4 global_transform_;
   mutable bool global_transform_dirty_ = true;
   bool clip_to_self_ = false;
+  ClipNodePtr clip_;
   mozart2::HitTestBehavior hit_test_behavior_ =
       mozart2::HitTestBehavior::kDefault;
   mozart2::Metrics reported_metrics_;
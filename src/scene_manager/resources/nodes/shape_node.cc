@@ -20,6 +20,7 @@ void ShapeNode::SetMaterial(MaterialPtr material) {
 
 void ShapeNode::SetShape(ShapePtr shape) {
   shape_ = std::move(shape);
+  NotifyPartChanged();
 }
 
 bool ShapeNode::GetIntersection(const escher::ray4& ray,
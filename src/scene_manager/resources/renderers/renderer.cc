@@ -4,6 +4,8 @@
 
 #include "apps/mozart/src/scene_manager/resources/renderers/renderer.h"
 
+#include <algorithm>
+
 #include "escher/impl/ssdo_sampler.h"
 #include "escher/renderer/renderer.h"
 #include "escher/scene/model.h"
@@ -13,12 +15,14 @@
 #include "apps/mozart/src/scene_manager/resources/dump_visitor.h"
 #include "apps/mozart/src/scene_manager/resources/import.h"
 #include "apps/mozart/src/scene_manager/resources/material.h"
+#include "apps/mozart/src/scene_manager/resources/nodes/clip_node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/entity_node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/scene.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/shape_node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/traversal.h"
 #include "apps/mozart/src/scene_manager/resources/shapes/circle_shape.h"
+#include "apps/mozart/src/scene_manager/resources/shapes/rectangle_shape.h"
 #include "apps/mozart/src/scene_manager/resources/shapes/shape.h"
 #include "apps/tracing/lib/trace/event.h"
 
@@ -32,35 +36,131 @@ const uint32_t Renderer::kRequiredSwapchainPixelMultiple =
 
 Renderer::Renderer(Session* session, mozart::ResourceId id)
     : Resource(session, id, Renderer::kTypeInfo) {
-  escher::MaterialPtr default_material_ =
-      ftl::MakeRefCounted<escher::Material>();
+  default_material_ = ftl::MakeRefCounted<escher::Material>();
   default_material_->set_color(escher::vec3(0.f, 0.f, 0.f));
 }
 
 Renderer::~Renderer() = default;
 
+namespace {
+
+// Returns true, and stores the rectangle in |clip_rect|, if the only part of
+// |node| is a rectangle which stays axis-aligned after it is transformed by
+// |viewport_transform|, so that it clips the node's children and imports to
+// that rectangle.
+bool GetRectangleClip(const Node& node,
+                      const escher::mat4& viewport_transform,
+                      AxisAlignedRect* clip_rect) {
+  if (node.parts().size() != 1 || !node.parts()[0]->IsKindOf<ShapeNode>())
+    return false;
+  auto shape_node = static_cast<ShapeNode*>(node.parts()[0].get());
+  auto& shape = shape_node->shape();
+  if (!shape || !shape->IsKindOf<RectangleShape>())
+    return false;
+  const escher::mat4 transform =
+      viewport_transform * shape_node->GetGlobalTransform();
+  if (!PreservesAxisAlignment(transform))
+    return false;
+  *clip_rect = TransformBounds(transform, shape->GetLocalBounds());
+  return true;
+}
+
+// Returns true if every object described by |items| lies within |clip_rect|,
+// so that none of them needs to be clipped to it.
+bool AllWithin(const std::vector<DrawItem>& items,
+               const AxisAlignedRect& clip_rect) {
+  return std::all_of(items.begin(), items.end(),
+                     [&clip_rect](const DrawItem& item) {
+                       return clip_rect.Contains(item.bounds);
+                     });
+}
+
+}  // namespace
+
 std::vector<escher::Object> Renderer::CreateDisplayList(
     const ScenePtr& scene,
-    escher::vec2 screen_dimensions) {
+    escher::vec2 screen_dimensions,
+    const AxisAlignedRect* viewport) {
   TRACE_DURATION("gfx", "Renderer::CreateDisplayList");
 
-  // Construct a display list from the tree.
-  Visitor v(default_material_);
+  // Construct a display list from the tree.  Objects outside the viewport are
+  // not drawn.
+  const bool orthographic = IsOrthographic();
+  FTL_DCHECK(orthographic || !viewport);
+  escher::mat4 viewport_transform(1.f);
+  if (viewport) {
+    viewport_transform[3][0] = viewport->min.x;
+    viewport_transform[3][1] = viewport->min.y;
+  }
+  Visitor v(default_material_, orthographic, viewport_transform,
+            viewport ? *viewport : AxisAlignedRect::Infinite());
   scene->Accept(&v);
-  return v.TakeDisplayList();
+  if (!orthographic) {
+    return v.TakeDisplayList();
+  }
+
+  // Draw objects which share geometry and material together, where that
+  // does not change what is seen.
+  std::vector<DrawItem> items = std::move(v.display_list_items_);
+  std::vector<escher::Object> objects = v.TakeDisplayList();
+  std::vector<size_t> order = BatchDrawOrder(items);
+  TRACE_COUNTER("gfx", "DisplayList", 0u, "objects", objects.size(),
+                "batches", CountBatches(items, order));
+  std::vector<escher::Object> display_list;
+  display_list.reserve(objects.size());
+  for (size_t index : order) {
+    display_list.push_back(std::move(objects[index]));
+  }
+
+  // Keep objects which cross the edge of the viewport out of the rest of the
+  // output image.
+  if (viewport && !AllWithin(items, *viewport)) {
+    escher::mat4 viewport_rect_transform(viewport_transform);
+    viewport_rect_transform[0][0] = viewport->max.x - viewport->min.x;
+    viewport_rect_transform[1][1] = viewport->max.y - viewport->min.y;
+    std::vector<escher::Object> clippers;
+    clippers.push_back(escher::Object::NewRect(viewport_rect_transform,
+                                               escher::MaterialPtr()));
+    std::vector<escher::Object> clip_object;
+    clip_object.push_back(
+        escher::Object(std::move(clippers), std::move(display_list)));
+    return clip_object;
+  }
+  return display_list;
 }
 
 void Renderer::SetCamera(CameraPtr camera) {
   camera_ = std::move(camera);
 }
 
-Renderer::Visitor::Visitor(const escher::MaterialPtr& default_material)
-    : default_material_(default_material) {}
+bool Renderer::IsOrthographic() const {
+  return camera_ && camera_->fovy() == 0.f;
+}
+
+Renderer::Visitor::Visitor(const escher::MaterialPtr& default_material,
+                           bool orthographic,
+                           const escher::mat4& viewport_transform,
+                           const AxisAlignedRect& clip_bounds)
+    : default_material_(default_material),
+      orthographic_(orthographic),
+      viewport_transform_(viewport_transform),
+      clip_bounds_(clip_bounds) {}
+
+escher::mat4 Renderer::Visitor::GetTransform(const Node& node) const {
+  return viewport_transform_ * node.GetGlobalTransform();
+}
 
 std::vector<escher::Object> Renderer::Visitor::TakeDisplayList() {
+  display_list_items_.clear();
   return std::move(display_list_);
 }
 
+void Renderer::Visitor::AddObject(escher::Object object,
+                                  const DrawItem& item) {
+  display_list_.push_back(std::move(object));
+  display_list_items_.push_back(item);
+}
+
 void Renderer::Visitor::Visit(GpuMemory* r) {
   FTL_CHECK(false);
 }
@@ -77,11 +177,67 @@ void Renderer::Visitor::Visit(ImagePipe* r) {
   FTL_CHECK(false);
 }
 
+void Renderer::Visitor::Visit(ClipNode* r) {
+  // Clip nodes are not drawn; they only define a region for the nodes which
+  // refer to them.
+}
+
 void Renderer::Visitor::Visit(EntityNode* r) {
   VisitNode(r);
 }
 
 void Renderer::Visitor::VisitNode(Node* r) {
+  // A clip node which is not part of the scene has no effect.
+  ClipNode* clip = r->clip().get();
+  if (!clip || !clip->IsRooted()) {
+    VisitNodeContent(r);
+    return;
+  }
+
+  // The clip region is cached by the clip node, in its own coordinate
+  // system, and shared by every node which it clips.
+  const ClipNode::Region& region = clip->region();
+  if (region.shapes.empty()) {
+    // Nothing is visible within an empty region.
+    return;
+  }
+  const escher::mat4 clip_transform = GetTransform(*clip);
+  const bool is_rectangle_clip = orthographic_ && region.is_rectangle &&
+                                 PreservesAxisAlignment(clip_transform);
+  const AxisAlignedRect clip_rect =
+      orthographic_ ? TransformBounds(clip_transform, region.bounds)
+                    : AxisAlignedRect::Infinite();
+
+  // The clip applies to both the parts and the children of the node.
+  Renderer::Visitor clippee_visitor(
+      default_material_, orthographic_, viewport_transform_,
+      is_rectangle_clip ? clip_bounds_.Intersection(clip_rect) : clip_bounds_);
+  clippee_visitor.VisitNodeContent(r);
+  std::vector<DrawItem> clippee_items =
+      std::move(clippee_visitor.display_list_items_);
+  auto clippees = clippee_visitor.TakeDisplayList();
+  if (clippees.empty())
+    return;
+
+  if (is_rectangle_clip && AllWithin(clippee_items, clip_rect)) {
+    for (size_t i = 0; i < clippees.size(); ++i) {
+      AddObject(std::move(clippees[i]), clippee_items[i]);
+    }
+    return;
+  }
+
+  std::vector<escher::Object> clippers;
+  for (const ClipNode::RegionShape& region_shape : region.shapes) {
+    clippers.push_back(region_shape.shape->GenerateRenderObject(
+        clip_transform * region_shape.transform, escher::MaterialPtr()));
+  }
+  DrawItem clip_object_item;
+  clip_object_item.bounds = clip_rect;
+  AddObject(escher::Object(std::move(clippers), std::move(clippees)),
+            clip_object_item);
+}
+
+void Renderer::Visitor::VisitNodeContent(Node* r) {
   // If not clipping, recursively visit all descendants in the normal fashion.
   if (!r->clip_to_self()) {
     ForEachDirectDescendantFrontToBack(
@@ -89,13 +245,23 @@ void Renderer::Visitor::VisitNode(Node* r) {
     return;
   }
 
+  // If the node is clipped by a single rectangle which stays axis-aligned on
+  // screen, its descendants need only be drawn where they overlap it.
+  AxisAlignedRect clip_rect;
+  const bool is_rectangle_clip =
+      orthographic_ && GetRectangleClip(*r, viewport_transform_, &clip_rect);
+
   // We might need to apply a clip.
   // Gather the escher::Objects corresponding to the children and imports.
-  Renderer::Visitor clippee_visitor(default_material_);
+  Renderer::Visitor clippee_visitor(
+      default_material_, orthographic_, viewport_transform_,
+      is_rectangle_clip ? clip_bounds_.Intersection(clip_rect) : clip_bounds_);
   ForEachChildAndImportFrontToBack(
       *r, [&clippee_visitor](Node* node) { node->Accept(&clippee_visitor); });
 
   // Check whether there's anything to clip.
+  std::vector<DrawItem> clippee_items =
+      std::move(clippee_visitor.display_list_items_);
   auto clippees = clippee_visitor.TakeDisplayList();
   if (clippees.empty()) {
     // Nothing to clip!  Just draw the parts as usual.
@@ -103,11 +269,22 @@ void Renderer::Visitor::VisitNode(Node* r) {
     return;
   }
 
+  // If every clippee lies within the rectangle, there is nothing to clip, so
+  // neither the clip object, nor the second draw of the clipper, is needed.
+  if (is_rectangle_clip && AllWithin(clippee_items, clip_rect)) {
+    for (size_t i = 0; i < clippees.size(); ++i) {
+      AddObject(std::move(clippees[i]), clippee_items[i]);
+    }
+    ForEachPartFrontToBack(*r, [this](Node* node) { node->Accept(this); });
+    return;
+  }
+
   // The node's children and imports must be clipped by the
   // Shapes/ShapeNodes amongst the node's parts.  First gather the
   // escher::Objects corresponding to these ShapeNodes.
   const escher::MaterialPtr kNoMaterial;
-  Renderer::Visitor clipper_visitor(kNoMaterial);
+  Renderer::Visitor clipper_visitor(kNoMaterial, orthographic_,
+                                    viewport_transform_, clip_bounds_);
   ForEachPartFrontToBack(*r, [&clipper_visitor](Node* node) {
     if (node->IsKindOf<ShapeNode>()) {
       node->Accept(&clipper_visitor);
@@ -120,7 +297,13 @@ void Renderer::Visitor::VisitNode(Node* r) {
     }
   });
 
-  // Check whether there are any clippers.
+  // Check whether there are any clippers.  The clip object lies within their
+  // bounds.
+  DrawItem clip_object_item;
+  clip_object_item.bounds = {escher::vec2(0.f), escher::vec2(0.f)};
+  for (const DrawItem& item : clipper_visitor.display_list_items_) {
+    clip_object_item.bounds = clip_object_item.bounds.Union(item.bounds);
+  }
   auto clippers = clipper_visitor.TakeDisplayList();
   if (clippers.empty()) {
     // The clip is empty so there's nothing to draw.
@@ -144,8 +327,8 @@ void Renderer::Visitor::VisitNode(Node* r) {
 
   // Create a new "clip object" from the display-lists generated by the
   // two visitors above.
-  display_list_.push_back(
-      escher::Object(std::move(clippers), std::move(clippees)));
+  AddObject(escher::Object(std::move(clippers), std::move(clippees)),
+            clip_object_item);
 }
 
 void Renderer::Visitor::Visit(Scene* r) {
@@ -171,9 +354,19 @@ void Renderer::Visitor::Visit(ShapeNode* r) {
     material->Accept(this);
   }
   if (shape) {
-    display_list_.push_back(shape->GenerateRenderObject(
-        r->GetGlobalTransform(),
-        material ? material->escher_material() : default_material_));
+    const escher::mat4 transform = GetTransform(*r);
+    const escher::MaterialPtr& escher_material =
+        material ? material->escher_material() : default_material_;
+    DrawItem item;
+    item.geometry = shape->GetGeometryKey();
+    item.material = escher_material.get();
+    if (orthographic_) {
+      item.bounds = TransformBounds(transform, shape->GetLocalBounds());
+      // Shapes outside the rectangular clips of their ancestors are hidden.
+      if (!item.bounds.Intersects(clip_bounds_))
+        return;
+    }
+    AddObject(shape->GenerateRenderObject(transform, escher_material), item);
   }
   // We don't need to call |VisitNode| because shape nodes don't have
   // children or parts.
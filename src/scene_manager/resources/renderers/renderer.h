@@ -6,6 +6,7 @@
 
 #include "apps/mozart/src/scene_manager/resources/resource.h"
 #include "apps/mozart/src/scene_manager/resources/resource_visitor.h"
+#include "apps/mozart/src/scene_manager/util/draw_batching.h"
 
 #include "escher/scene/object.h"
 
@@ -28,8 +29,14 @@ class Renderer : public Resource {
   Renderer(Session* session, mozart::ResourceId id);
   ~Renderer();
 
-  std::vector<escher::Object> CreateDisplayList(const ScenePtr& scene,
-                                                escher::vec2 screen_dimensions);
+  // Creates a display list which draws |scene| into an output image.  If
+  // |viewport| is not null, the scene is drawn into that rectangle of the
+  // output image, in pixels, and clipped to it, rather than into the whole
+  // image; this requires an orthographic camera.
+  std::vector<escher::Object> CreateDisplayList(
+      const ScenePtr& scene,
+      escher::vec2 screen_dimensions,
+      const AxisAlignedRect* viewport = nullptr);
 
   // |Resource|
   void Accept(class ResourceVisitor* visitor) override;
@@ -40,6 +47,9 @@ class Renderer : public Resource {
 
   Camera* camera() const { return camera_.get(); }
 
+  // True if the camera looks straight down the Z axis.
+  bool IsOrthographic() const;
+
  private:
   class Visitor : public ResourceVisitor {
    public:
@@ -49,6 +59,7 @@ class Renderer : public Resource {
     void Visit(HostMemory* r) override;
     void Visit(Image* r) override;
     void Visit(ImagePipe* r) override;
+    void Visit(ClipNode* r) override;
     void Visit(EntityNode* r) override;
     void Visit(ShapeNode* r) override;
     void Visit(CircleShape* r) override;
@@ -67,12 +78,35 @@ class Renderer : public Resource {
    protected:
    private:
     friend class Renderer;
-    Visitor(const escher::MaterialPtr& default_material);
-
+    // If |orthographic|, the camera looks straight down the Z axis, and
+    // objects which lie outside |clip_bounds|, the intersection of the
+    // rectangular clips of their ancestors, are not drawn.  Every object is
+    // transformed by |viewport_transform|, which maps the scene into the
+    // output image.
+    Visitor(const escher::MaterialPtr& default_material,
+            bool orthographic,
+            const escher::mat4& viewport_transform,
+            const AxisAlignedRect& clip_bounds);
+
+    // Returns the transform which maps |node| into the output image.
+    escher::mat4 GetTransform(const Node& node) const;
+
+    // Draws the node's parts and descendants, clipped by the node's clip
+    // node, if it has one.
     void VisitNode(Node* r);
+    // Draws the node's parts and descendants, ignoring its clip node.
+    void VisitNodeContent(Node* r);
+
+    void AddObject(escher::Object object, const DrawItem& item);
 
     std::vector<escher::Object> display_list_;
+    // Describes each object in |display_list_|.  Bounds are only known if
+    // |orthographic_|.
+    std::vector<DrawItem> display_list_items_;
     const escher::MaterialPtr& default_material_;
+    const bool orthographic_;
+    const escher::mat4 viewport_transform_;
+    const AxisAlignedRect clip_bounds_;
   };
 
   CameraPtr camera_;
@@ -3,155 +3,181 @@
 // found in the LICENSE file.
 
 #include "apps/mozart/src/scene_manager/resources/resource_linker.h"
-#include "lib/fidl/cpp/waiter/default.h"
-#include "lib/mtl/tasks/message_loop.h"
+
+#include "apps/tracing/lib/trace/event.h"
 
 namespace scene_manager {
 
 static mx_signals_t kEventPairDeathSignals = MX_EPAIR_PEER_CLOSED;
 
-#define ASSERT_INTERNAL_EXPORTS_CONSISTENCY          \
-  FTL_DCHECK(import_koid_by_export_handle_.size() == \
-             exported_resources_by_import_koid_.size());
-
 ResourceLinker::ResourceLinker() = default;
 
-ResourceLinker::~ResourceLinker() {
-  auto message_loop = mtl::MessageLoop::GetCurrent();
-  for (const auto& item : exported_resources_by_import_koid_) {
-    message_loop->RemoveHandler(item.second.death_handler);
+ResourceLinker::~ResourceLinker() = default;
+
+bool ResourceLinker::ExportResource(ResourcePtr resource,
+                                    mx::eventpair export_handle) {
+  mx_koid_t import_koid =
+      AddExport(std::move(resource), std::move(export_handle));
+  if (import_koid == MX_KOID_INVALID) {
+    return false;
   }
+
+  // Always perform linking last because it involves firing resolution callbacks
+  // which may access the linker. We need that view to be consistent.
+  PerformLinkingNow(import_koid);
+
+  return true;
 }
 
-bool ResourceLinker::ExportResource(ResourcePtr resource,
+size_t ResourceLinker::ExportResources(std::vector<ExportRequest> requests) {
+  TRACE_DURATION("gfx", "ResourceLinker::ExportResources", "count",
+                 requests.size());
+  size_t exported_count = 0;
+  BeginBatch();
+  for (auto& request : requests) {
+    if (ExportResource(std::move(request.resource),
+                       std::move(request.export_handle))) {
+      ++exported_count;
+    }
+  }
+  EndBatch();
+  return exported_count;
+}
+
+mx_koid_t ResourceLinker::AddExport(ResourcePtr resource,
                                     mx::eventpair export_handle) {
   // Basic sanity checks for resource validity.
   if (!resource) {
-    return false;
+    return MX_KOID_INVALID;
   }
 
   // If the peer koid of the handle has already expired, there is no point in
   // registering the resource because an import can never be resolved. Bail.
   mx_koid_t import_koid = mtl::GetRelatedKoid(export_handle.get());
   if (import_koid == MX_KOID_INVALID) {
-    return false;
+    return MX_KOID_INVALID;
   }
 
   // Ensure that the peer koid has not already been registered with the linker.
   auto found = exported_resources_by_import_koid_.find(import_koid);
   if (found != exported_resources_by_import_koid_.end()) {
-    return false;
+    return MX_KOID_INVALID;
   }
 
   // The resource must be removed from being considered for import if its peer
   // is closed.
-  mtl::MessageLoop::HandlerKey death_key =
-      mtl::MessageLoop::GetCurrent()->AddHandler(
-          this,                    // handler
-          export_handle.get(),     // handle
-          kEventPairDeathSignals,  // trigger
-          ftl::TimeDelta::Max()    // timeout
-      );
-
-  mx_handle_t raw_export_handle = export_handle.get();  // About to be moved.
+  if (!wait_set_) {
+    wait_set_ = std::make_unique<WaitSet>(
+        [this](const std::vector<WaitSet::Signal>& signals) {
+          OnExportHandlesClosed(signals);
+        });
+  }
+  if (!wait_set_->Add(import_koid, export_handle.get(),
+                      kEventPairDeathSignals)) {
+    return MX_KOID_INVALID;
+  }
 
   ExportedResourceEntry resource_entry = {
       .export_handle = std::move(export_handle),  // own export handle
-      .import_koid = import_koid,                 //
-      .death_handler = death_key,                 //
-      .resource = resource,                       //
+      .resource = std::move(resource),            //
   };
-
-  import_koid_by_export_handle_[raw_export_handle] = import_koid;
   exported_resources_by_import_koid_[import_koid] = std::move(resource_entry);
 
-  ASSERT_INTERNAL_EXPORTS_CONSISTENCY;
+  return import_koid;
+}
+
+void ResourceLinker::ImportResource(
+    mozart2::ImportSpec import_spec,
+    const mx::eventpair& import_handle,
+    OnImportResolvedCallback import_resolved_callback) {
+  mx_koid_t import_koid =
+      AddImport(import_handle, std::move(import_resolved_callback));
+  if (import_koid == MX_KOID_INVALID) {
+    return;
+  }
 
   // Always perform linking last because it involves firing resolution callbacks
   // which may access the linker. We need that view to be consistent.
   PerformLinkingNow(import_koid);
+}
 
-  return true;
+void ResourceLinker::ImportResources(std::vector<ImportRequest> requests) {
+  TRACE_DURATION("gfx", "ResourceLinker::ImportResources", "count",
+                 requests.size());
+  BeginBatch();
+  for (auto& request : requests) {
+    FTL_DCHECK(request.import_handle);
+    ImportResource(request.spec, *request.import_handle,
+                   std::move(request.import_resolved_callback));
+  }
+  EndBatch();
 }
 
-void ResourceLinker::ImportResource(
-    mozart2::ImportSpec import_spec,
+mx_koid_t ResourceLinker::AddImport(
     const mx::eventpair& import_handle,
     OnImportResolvedCallback import_resolved_callback) {
   // Make sure a callback is present.
   if (!import_resolved_callback) {
-    return;
+    return MX_KOID_INVALID;
   }
 
   // Make sure the import handle is valid.
   mx_koid_t import_koid = mtl::GetKoid(import_handle.get());
   if (import_koid == MX_KOID_INVALID) {
     import_resolved_callback(nullptr, ResolutionResult::kInvalidHandle);
-    return;
+    return MX_KOID_INVALID;
   }
 
   // Register the import entry.
   UnresolvedImportEntry unresolved_import_entry = {
-      .resolution_callback = import_resolved_callback,  // resolution callback
+      .resolution_callback =
+          std::move(import_resolved_callback),  // resolution callback
   };
   unresolved_imports_by_import_koid_[import_koid].emplace_back(
       std::move(unresolved_import_entry));
 
-  // Always perform linking last because it involves firing resolution callbacks
-  // which may access the linker. We need that view to be consistent.
-  PerformLinkingNow(import_koid);
+  return import_koid;
 }
 
-void ResourceLinker::OnHandleReady(mx_handle_t export_handle,
-                                   mx_signals_t pending,
-                                   uint64_t count) {
-  // This is invoked when all the peers for the registered export handle are
-  // closed.
-  if (pending & kEventPairDeathSignals) {
-    auto resource = RemoveResourceForExpiredExportHandle(export_handle);
-    if (expiration_callback_) {
-      expiration_callback_(std::move(resource),
-                           ExpirationCause::kImportHandleClosed);
-    }
-  }
+void ResourceLinker::BeginBatch() {
+  ++batch_depth_;
 }
 
-void ResourceLinker::OnHandleError(mx_handle_t export_handle,
-                                   mx_status_t error) {
-  // Should only happen in case of timeout or loop death.
-  if (error == MX_ERR_TIMED_OUT || error == MX_ERR_CANCELED) {
-    auto resource = RemoveResourceForExpiredExportHandle(export_handle);
-    if (expiration_callback_) {
-      expiration_callback_(std::move(resource),
-                           ExpirationCause::kInternalError);
-    }
+void ResourceLinker::EndBatch() {
+  FTL_DCHECK(batch_depth_ > 0);
+  if (--batch_depth_ == 0) {
+    ResolvePendingImports();
   }
 }
 
-ResourcePtr ResourceLinker::RemoveResourceForExpiredExportHandle(
-    mx_handle_t export_handle) {
-  auto import_koid_iterator = import_koid_by_export_handle_.find(export_handle);
-  FTL_DCHECK(import_koid_iterator != import_koid_by_export_handle_.end());
-
-  auto resource_iterator =
-      exported_resources_by_import_koid_.find(import_koid_iterator->second);
-  FTL_DCHECK(resource_iterator != exported_resources_by_import_koid_.end());
-
-  mtl::MessageLoop::GetCurrent()->RemoveHandler(
-      resource_iterator->second.death_handler);
-
-  auto resource = resource_iterator->second.resource;
-
-  exported_resources_by_import_koid_.erase(resource_iterator);
-  import_koid_by_export_handle_.erase(import_koid_iterator);
-
-  ASSERT_INTERNAL_EXPORTS_CONSISTENCY;
+void ResourceLinker::OnExportHandlesClosed(
+    const std::vector<WaitSet::Signal>& signals) {
+  TRACE_DURATION("gfx", "ResourceLinker::OnExportHandlesClosed", "count",
+                 signals.size());
+
+  // This is invoked when all the peers for the registered export handles are
+  // closed. Remove all the expired exports before invoking any callbacks, so
+  // that the callbacks see a consistent view of the linker.
+  std::vector<ResourcePtr> expired_resources;
+  expired_resources.reserve(signals.size());
+  for (const auto& signal : signals) {
+    FTL_DCHECK(signal.observed & kEventPairDeathSignals);
+    auto resource_iterator =
+        exported_resources_by_import_koid_.find(signal.key);
+    FTL_DCHECK(resource_iterator != exported_resources_by_import_koid_.end());
+    expired_resources.push_back(std::move(resource_iterator->second.resource));
+    exported_resources_by_import_koid_.erase(resource_iterator);
+  }
 
-  return resource;
+  if (expiration_callback_) {
+    for (auto& resource : expired_resources) {
+      expiration_callback_(std::move(resource),
+                           ExpirationCause::kImportHandleClosed);
+    }
+  }
 }
 
 size_t ResourceLinker::UnresolvedExports() const {
-  ASSERT_INTERNAL_EXPORTS_CONSISTENCY;
   return exported_resources_by_import_koid_.size();
 }
 
@@ -163,39 +189,76 @@ size_t ResourceLinker::UnresolvedImports() const {
   return unresolved_imports;
 }
 
+size_t ResourceLinker::EstimateMemoryUsage() const {
+  // Each node of an unordered_map holds the value and a next pointer; each
+  // bucket holds one pointer.
+  size_t usage = 0;
+  usage += exported_resources_by_import_koid_.size() *
+           (sizeof(ExportedResourcesMap::value_type) + sizeof(void*));
+  usage += exported_resources_by_import_koid_.bucket_count() * sizeof(void*);
+  for (const auto& collection : unresolved_imports_by_import_koid_) {
+    usage += sizeof(UnresolvedImportEntryMap::value_type) + sizeof(void*);
+    usage += collection.second.capacity() * sizeof(UnresolvedImportEntry);
+  }
+  usage += unresolved_imports_by_import_koid_.bucket_count() * sizeof(void*);
+  if (wait_set_) {
+    usage += sizeof(WaitSet) +
+             wait_set_->size() * (2 * sizeof(uint64_t) + 2 * sizeof(void*));
+  }
+  return usage;
+}
+
 void ResourceLinker::SetOnExpiredCallback(OnExpiredCallback callback) {
   expiration_callback_ = callback;
 }
 
 void ResourceLinker::PerformLinkingNow(mx_koid_t import_koid) {
-  // Find the unresolved import entry if present.
-  auto found = unresolved_imports_by_import_koid_.find(import_koid);
-  if (found == unresolved_imports_by_import_koid_.end()) {
-    return;
+  pending_import_koids_.insert(import_koid);
+  if (batch_depth_ == 0) {
+    ResolvePendingImports();
   }
+}
 
-  // Find the corresponding entry in the exported resource registrations.
-  auto resource_iterator = exported_resources_by_import_koid_.find(import_koid);
-  if (resource_iterator == exported_resources_by_import_koid_.end()) {
+void ResourceLinker::ResolvePendingImports() {
+  if (pending_import_koids_.empty()) {
     return;
   }
+  TRACE_DURATION("gfx", "ResourceLinker::ResolvePendingImports", "count",
+                 pending_import_koids_.size());
+
+  // Collect all the resolution callbacks that need to be invoked, along with
+  // the resources they resolve to.
+  std::vector<std::pair<OnImportResolvedCallback, ResourcePtr>> resolutions;
+  for (mx_koid_t import_koid : pending_import_koids_) {
+    // Find the unresolved import entry if present.
+    auto found = unresolved_imports_by_import_koid_.find(import_koid);
+    if (found == unresolved_imports_by_import_koid_.end()) {
+      continue;
+    }
 
-  // Collect all the resolution callbacks that need to be invoked.
-  std::vector<OnImportResolvedCallback> callbacks;
-  callbacks.reserve(found->second.size());
-  for (const UnresolvedImportEntry& import_entry : found->second) {
-    callbacks.emplace_back(import_entry.resolution_callback);
-  }
+    // Find the corresponding entry in the exported resource registrations.
+    auto resource_iterator =
+        exported_resources_by_import_koid_.find(import_koid);
+    if (resource_iterator == exported_resources_by_import_koid_.end()) {
+      continue;
+    }
+
+    const ResourcePtr& matched_resource = resource_iterator->second.resource;
+    for (UnresolvedImportEntry& import_entry : found->second) {
+      resolutions.emplace_back(std::move(import_entry.resolution_callback),
+                               matched_resource);
+    }
 
-  // Resolution done. Cleanup the unresolved imports collection.
-  unresolved_imports_by_import_koid_.erase(found);
+    // Resolution done. Cleanup the unresolved imports collection.
+    unresolved_imports_by_import_koid_.erase(found);
+  }
+  pending_import_koids_.clear();
 
   // Finally, invoke the resolution callbacks last. This is important because we
   // want to ensure that any code that runs within the callbacks sees a
   // consistent view of the linker.
-  auto matched_resource = resource_iterator->second.resource;
-  for (const auto& callback : callbacks) {
-    callback(matched_resource, ResolutionResult::kSuccess);
+  for (const auto& resolution : resolutions) {
+    resolution.first(resolution.second, ResolutionResult::kSuccess);
   }
 }
 
@@ -4,13 +4,16 @@
 
 #pragma once
 
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "apps/mozart/services/scene/ops.fidl-common.h"
 #include "apps/mozart/src/scene_manager/resources/resource.h"
+#include "apps/mozart/src/scene_manager/util/wait_set.h"
 #include "lib/ftl/macros.h"
 #include "lib/mtl/handles/object_info.h"
-#include "lib/mtl/tasks/message_loop.h"
 #include "third_party/gtest/include/gtest/gtest_prod.h"
 
 namespace scene_manager {
@@ -23,7 +26,12 @@ namespace scene_manager {
 /// each duplicated token. The linker owns the tokens provided in the import and
 /// export calls and handles cases where the import call arrives before the
 /// resource that matches that query has been exported.
-class ResourceLinker : private mtl::MessageLoopHandler {
+///
+/// All export handles are watched for the death of their peers by a single
+/// WaitSet. Imports and exports made between |BeginBatch()| and |EndBatch()|
+/// are matched in a single pass when the batch ends; the Engine uses this to
+/// resolve all the imports made by session updates once per frame.
+class ResourceLinker {
  public:
   ResourceLinker();
 
@@ -31,6 +39,15 @@ class ResourceLinker : private mtl::MessageLoopHandler {
 
   bool ExportResource(ResourcePtr resource, mx::eventpair export_handle);
 
+  struct ExportRequest {
+    ResourcePtr resource;
+    mx::eventpair export_handle;
+  };
+  /// Exports each resource as if by |ExportResource()|, resolving any imports
+  /// which they satisfy in a single pass. Returns the number of resources which
+  /// were successfully exported.
+  size_t ExportResources(std::vector<ExportRequest> requests);
+
   enum class ResolutionResult {
     kSuccess,
     kInvalidHandle,
@@ -41,10 +58,30 @@ class ResourceLinker : private mtl::MessageLoopHandler {
                       const mx::eventpair& import_handle,
                       OnImportResolvedCallback import_resolved_callback);
 
+  struct ImportRequest {
+    mozart2::ImportSpec spec;
+    // Must remain valid for the duration of the call.
+    const mx::eventpair* import_handle;
+    OnImportResolvedCallback import_resolved_callback;
+  };
+  /// Imports each resource as if by |ImportResource()|, resolving those which
+  /// have already been exported in a single pass.
+  void ImportResources(std::vector<ImportRequest> requests);
+
+  /// While a batch is open, matching exports and imports are not resolved
+  /// immediately; instead, all of them are resolved in a single pass by the
+  /// |EndBatch()| call which closes the outermost batch.
+  void BeginBatch();
+  void EndBatch();
+
   size_t UnresolvedExports() const;
 
   size_t UnresolvedImports() const;
 
+  /// An estimate of the heap memory used by the linker's bookkeeping, in
+  /// bytes. Does not include the resources themselves.
+  size_t EstimateMemoryUsage() const;
+
   enum class ExpirationCause {
     kInternalError,
     kImportHandleClosed,
@@ -55,14 +92,11 @@ class ResourceLinker : private mtl::MessageLoopHandler {
  private:
   struct ExportedResourceEntry {
     mx::eventpair export_handle;
-    mx_koid_t import_koid = MX_KOID_INVALID;
-    mtl::MessageLoop::HandlerKey death_handler = 0;
     ResourcePtr resource;
   };
   struct UnresolvedImportEntry {
     OnImportResolvedCallback resolution_callback;
   };
-  using HandleKoidMap = std::unordered_map<mx_handle_t, mx_koid_t>;
   using ExportedResourcesMap =
       std::unordered_map<mx_koid_t /* import koid */, ExportedResourceEntry>;
   using UnresolvedImportEntryMap =
@@ -70,20 +104,34 @@ class ResourceLinker : private mtl::MessageLoopHandler {
                          std::vector<UnresolvedImportEntry>>;
 
   OnExpiredCallback expiration_callback_;
-  HandleKoidMap import_koid_by_export_handle_;
   ExportedResourcesMap exported_resources_by_import_koid_;
   UnresolvedImportEntryMap unresolved_imports_by_import_koid_;
 
-  void OnHandleReady(mx_handle_t handle,
-                     mx_signals_t pending,
-                     uint64_t count) override;
+  // Watches the export handles for the death of their peers; the wait for
+  // each export is keyed by its import koid. Created on first use, so that
+  // notifications are delivered on the thread which exported the resources.
+  std::unique_ptr<WaitSet> wait_set_;
+
+  // Import koids which may be resolvable once the current batch ends.
+  size_t batch_depth_ = 0;
+  std::unordered_set<mx_koid_t> pending_import_koids_;
 
-  void OnHandleError(mx_handle_t handle, mx_status_t error) override;
+  // Registers the export without resolving imports. Returns the import koid,
+  // or MX_KOID_INVALID on failure.
+  mx_koid_t AddExport(ResourcePtr resource, mx::eventpair export_handle);
 
-  ResourcePtr RemoveResourceForExpiredExportHandle(mx_handle_t handle);
+  // Registers the import without resolving it. Returns the import koid, or
+  // MX_KOID_INVALID if the callback was invoked with an error.
+  mx_koid_t AddImport(const mx::eventpair& import_handle,
+                      OnImportResolvedCallback import_resolved_callback);
+
+  void OnExportHandlesClosed(const std::vector<WaitSet::Signal>& signals);
 
   void PerformLinkingNow(mx_koid_t import_koid);
 
+  // Resolves every import koid in |pending_import_koids_| in one pass.
+  void ResolvePendingImports();
+
   FTL_DISALLOW_COPY_AND_ASSIGN(ResourceLinker);
 };
 
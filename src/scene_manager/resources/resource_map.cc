@@ -15,6 +15,16 @@ void ResourceMap::Clear() {
   resources_.clear();
 }
 
+std::vector<ResourcePtr> ResourceMap::TakeResources() {
+  std::vector<ResourcePtr> resources;
+  resources.reserve(resources_.size());
+  for (auto& pair : resources_) {
+    resources.push_back(std::move(pair.second));
+  }
+  resources_.clear();
+  return resources;
+}
+
 bool ResourceMap::AddResource(mozart::ResourceId id, ResourcePtr resource) {
   FTL_DCHECK(resource);
 
@@ -8,6 +8,7 @@
 #include "apps/mozart/src/scene_manager/util/error_reporter.h"
 
 #include <unordered_map>
+#include <vector>
 
 namespace scene_manager {
 
@@ -19,6 +20,9 @@ class ResourceMap {
 
   void Clear();
 
+  // Remove all resources from the map, and return them.
+  std::vector<ResourcePtr> TakeResources();
+
   // Attempt to add the resource; return true if successful.  Return false if
   // the ID is already present in the map, which is left unchanged.
   bool AddResource(mozart::ResourceId id, ResourcePtr resource);
@@ -16,6 +16,7 @@
 #include "apps/mozart/src/scene_manager/resources/import.h"
 #include "apps/mozart/src/scene_manager/resources/lights/directional_light.h"
 #include "apps/mozart/src/scene_manager/resources/material.h"
+#include "apps/mozart/src/scene_manager/resources/nodes/clip_node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/entity_node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/scene.h"
@@ -44,6 +45,10 @@ void ImagePipe::Accept(ResourceVisitor* visitor) {
   visitor->Visit(this);
 }
 
+void ClipNode::Accept(ResourceVisitor* visitor) {
+  visitor->Visit(this);
+}
+
 void EntityNode::Accept(ResourceVisitor* visitor) {
   visitor->Visit(this);
 }
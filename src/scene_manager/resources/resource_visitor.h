@@ -11,6 +11,7 @@ class GpuMemory;
 class HostMemory;
 class Image;
 class ImagePipe;
+class ClipNode;
 class EntityNode;
 class Node;
 class ShapeNode;
@@ -36,6 +37,7 @@ class ResourceVisitor {
   virtual void Visit(ImagePipe* r) = 0;
 
   // Nodes.
+  virtual void Visit(ClipNode* r) = 0;
   virtual void Visit(EntityNode* r) = 0;
   virtual void Visit(ShapeNode* r) = 0;
 
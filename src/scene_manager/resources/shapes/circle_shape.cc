@@ -25,4 +25,8 @@ escher::Object CircleShape::GenerateRenderObject(
   return escher::Object::NewCircle(transform, radius_, material);
 }
 
+AxisAlignedRect CircleShape::GetLocalBounds() const {
+  return {escher::vec2(-radius_), escher::vec2(radius_)};
+}
+
 }  // namespace scene_manager
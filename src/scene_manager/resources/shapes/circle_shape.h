@@ -26,6 +26,9 @@ class CircleShape final : public PlanarShape {
   escher::Object GenerateRenderObject(
       const escher::mat4& transform,
       const escher::MaterialPtr& material) override;
+  AxisAlignedRect GetLocalBounds() const override;
+  // All circles are Escher's unit circle, scaled.
+  const void* GetGeometryKey() const override { return &kTypeInfo; }
 
  private:
   float radius_;
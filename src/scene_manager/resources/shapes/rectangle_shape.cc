@@ -36,4 +36,9 @@ escher::Object RectangleShape::GenerateRenderObject(
   return escher::Object::NewRect(transform * rect_transform, material);
 }
 
+AxisAlignedRect RectangleShape::GetLocalBounds() const {
+  const escher::vec2 half_size(0.5f * width_, 0.5f * height_);
+  return {-half_size, half_size};
+}
+
 }  // namespace scene_manager
@@ -30,6 +30,9 @@ class RectangleShape final : public PlanarShape {
   escher::Object GenerateRenderObject(
       const escher::mat4& transform,
       const escher::MaterialPtr& material) override;
+  AxisAlignedRect GetLocalBounds() const override;
+  // All rectangles are Escher's unit rectangle, scaled.
+  const void* GetGeometryKey() const override { return &kTypeInfo; }
 
  private:
   float width_;
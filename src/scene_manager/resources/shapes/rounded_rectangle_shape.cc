@@ -17,10 +17,12 @@ RoundedRectangleShape::RoundedRectangleShape(
     Session* session,
     mozart::ResourceId id,
     const escher::RoundedRectSpec& spec,
-    escher::MeshPtr mesh)
+    escher::MeshPtr mesh,
+    float mesh_scale)
     : PlanarShape(session, id, RoundedRectangleShape::kTypeInfo),
       spec_(spec),
-      mesh_(std::move(mesh)) {}
+      mesh_(std::move(mesh)),
+      mesh_scale_(mesh_scale) {}
 
 bool RoundedRectangleShape::ContainsPoint(const escher::vec2& point) const {
   return spec_.ContainsPoint(point);
@@ -29,7 +31,18 @@ bool RoundedRectangleShape::ContainsPoint(const escher::vec2& point) const {
 escher::Object RoundedRectangleShape::GenerateRenderObject(
     const escher::mat4& transform,
     const escher::MaterialPtr& material) {
-  return escher::Object(transform, mesh_, material);
+  if (mesh_scale_ == 1.f) {
+    return escher::Object(transform, mesh_, material);
+  }
+  escher::mat4 scale_transform(1);
+  scale_transform[0][0] = mesh_scale_;
+  scale_transform[1][1] = mesh_scale_;
+  return escher::Object(transform * scale_transform, mesh_, material);
+}
+
+AxisAlignedRect RoundedRectangleShape::GetLocalBounds() const {
+  const escher::vec2 half_size(0.5f * spec_.width, 0.5f * spec_.height);
+  return {-half_size, half_size};
 }
 
 }  // namespace scene_manager
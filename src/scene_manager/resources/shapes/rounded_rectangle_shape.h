@@ -15,10 +15,12 @@ class RoundedRectangleShape final : public PlanarShape {
  public:
   static const ResourceTypeInfo kTypeInfo;
 
+  // |mesh| is |spec| scaled down by |mesh_scale|; see RoundedRectMeshCache.
   RoundedRectangleShape(Session* session,
                         mozart::ResourceId id,
                         const escher::RoundedRectSpec& spec,
-                        escher::MeshPtr mesh);
+                        escher::MeshPtr mesh,
+                        float mesh_scale = 1.f);
 
   float width() const { return spec_.width; }
   float height() const { return spec_.height; }
@@ -37,10 +39,13 @@ class RoundedRectangleShape final : public PlanarShape {
   escher::Object GenerateRenderObject(
       const escher::mat4& transform,
       const escher::MaterialPtr& material) override;
+  AxisAlignedRect GetLocalBounds() const override;
+  const void* GetGeometryKey() const override { return mesh_.get(); }
 
  private:
   escher::RoundedRectSpec spec_;
   escher::MeshPtr mesh_;
+  float mesh_scale_;
 };
 
 }  // namespace scene_manager
@@ -15,4 +15,8 @@ Shape::Shape(Session* session,
   FTL_DCHECK(type_info.IsKindOf(Shape::kTypeInfo));
 }
 
+AxisAlignedRect Shape::GetLocalBounds() const {
+  return AxisAlignedRect::Infinite();
+}
+
 }  // namespace scene_manager
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "apps/mozart/src/scene_manager/resources/resource.h"
+#include "apps/mozart/src/scene_manager/util/axis_aligned_rect.h"
 #include "escher/geometry/types.h"
 #include "escher/scene/object.h"
 
@@ -30,6 +31,15 @@ class Shape : public Resource {
       const escher::mat4& transform,
       const escher::MaterialPtr& material) = 0;
 
+  // Returns the bounding box of the shape in the Z=0 plane of its local
+  // coordinate system, or AxisAlignedRect::Infinite() if it is not known.
+  virtual AxisAlignedRect GetLocalBounds() const;
+
+  // Returns a value which is the same for shapes whose render objects share
+  // a mesh, transformed differently, so that they can be drawn together; or
+  // null if they share it with no other shape.
+  virtual const void* GetGeometryKey() const { return nullptr; }
+
  protected:
   Shape(Session* session,
         mozart::ResourceId id,
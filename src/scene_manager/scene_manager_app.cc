@@ -9,6 +9,12 @@
 
 namespace scene_manager {
 
+bool SceneManagerApp::Params::Setup(const ftl::CommandLine& command_line) {
+  command_line.GetOptionValue("record_sessions",
+                              &session_recording_directory_);
+  return true;
+}
+
 SceneManagerApp::SceneManagerApp(app::ApplicationContext* app_context,
                                  Params* params,
                                  DisplayManager* display_manager,
@@ -23,6 +29,9 @@ SceneManagerApp::SceneManagerApp(app::ApplicationContext* app_context,
                                        demo_harness_->GetVulkanSwapchain())))) {
   FTL_DCHECK(application_context_);
 
+  scene_manager_->engine()->set_session_recording_directory(
+      params->session_recording_directory());
+
   tracing::InitializeTracer(application_context_, {"scene_manager"});
 
   application_context_->outgoing_services()->AddService<mozart2::SceneManager>(
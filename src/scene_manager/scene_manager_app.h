@@ -21,7 +21,16 @@ class SceneManagerApp {
  public:
   class Params {
    public:
-    bool Setup(const ftl::CommandLine& command_line) { return true; }
+    bool Setup(const ftl::CommandLine& command_line);
+
+    // If non-empty, record each session's op stream to this directory.
+    // Set via --record_sessions=<directory>.
+    const std::string& session_recording_directory() const {
+      return session_recording_directory_;
+    }
+
+   private:
+    std::string session_recording_directory_;
   };
 
   SceneManagerApp(app::ApplicationContext* app_context,
@@ -28,4 +28,19 @@ void SceneManagerImpl::GetDisplayInfo(const GetDisplayInfoCallback& callback) {
   callback(std::move(info));
 }
 
+void SceneManagerImpl::GetFrameStatistics(
+    const GetFrameStatisticsCallback& callback) {
+  const Engine::FrameStatistics& stats = engine_->frame_statistics();
+
+  auto statistics = mozart2::FrameStatistics::New();
+  statistics->frame_count = stats.frame_count;
+  statistics->total_apply_duration = stats.total.apply_duration;
+  statistics->max_apply_duration = stats.max.apply_duration;
+  statistics->total_traversal_duration = stats.total.traversal_duration;
+  statistics->max_traversal_duration = stats.max.traversal_duration;
+  statistics->total_render_duration = stats.total.render_duration;
+  statistics->max_render_duration = stats.max.render_duration;
+  callback(std::move(statistics));
+}
+
 }  // namespace scene_manager
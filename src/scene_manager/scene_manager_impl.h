@@ -25,6 +25,7 @@ class SceneManagerImpl : public mozart2::SceneManager {
       ::fidl::InterfaceRequest<mozart2::Session> request,
       ::fidl::InterfaceHandle<mozart2::SessionListener> listener) override;
   void GetDisplayInfo(const GetDisplayInfoCallback& callback) override;
+  void GetFrameStatistics(const GetFrameStatisticsCallback& callback) override;
 
  private:
   std::unique_ptr<Engine> engine_;
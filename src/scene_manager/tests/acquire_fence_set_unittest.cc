@@ -108,5 +108,54 @@ TEST_F(AcquireFenceSetTest, DestroyWhileWaiting) {
   // We expect there to be no errors while tearing down |acquire_fence_set|.
 }
 
+TEST_F(AcquireFenceSetTest, PollReady) {
+  mx::event fence1;
+  ASSERT_EQ(MX_OK, mx::event::create(0, &fence1));
+  mx::event fence2;
+  ASSERT_EQ(MX_OK, mx::event::create(0, &fence2));
+  ::fidl::Array<mx::event> acquire_fences;
+  acquire_fences.push_back(CopyEvent(fence1));
+  acquire_fences.push_back(CopyEvent(fence2));
+  AcquireFenceSet acquire_fence_set(std::move(acquire_fences));
+
+  // Fences which have already been signalled are seen without waiting.
+  fence1.signal(0u, kFenceSignalled);
+  ASSERT_FALSE(acquire_fence_set.PollReady());
+  fence2.signal(0u, kFenceSignalled);
+  ASSERT_TRUE(acquire_fence_set.PollReady());
+  ASSERT_TRUE(acquire_fence_set.ready());
+}
+
+TEST_F(AcquireFenceSetTest, SharedWaiter) {
+  AcquireFenceWaiter waiter;
+  mx::event fence1;
+  ASSERT_EQ(MX_OK, mx::event::create(0, &fence1));
+  mx::event fence2;
+  ASSERT_EQ(MX_OK, mx::event::create(0, &fence2));
+
+  // Both sets wait for |fence1|, and only the second for |fence2|.
+  ::fidl::Array<mx::event> acquire_fences1;
+  acquire_fences1.push_back(CopyEvent(fence1));
+  AcquireFenceSet acquire_fence_set1(std::move(acquire_fences1), &waiter);
+  ::fidl::Array<mx::event> acquire_fences2;
+  acquire_fences2.push_back(CopyEvent(fence1));
+  acquire_fences2.push_back(CopyEvent(fence2));
+  AcquireFenceSet acquire_fence_set2(std::move(acquire_fences2), &waiter);
+
+  bool signalled1 = false;
+  acquire_fence_set1.WaitReadyAsync([&signalled1]() { signalled1 = true; });
+  bool signalled2 = false;
+  acquire_fence_set2.WaitReadyAsync([&signalled2]() { signalled2 = true; });
+
+  fence1.signal(0u, kFenceSignalled);
+  RUN_MESSAGE_LOOP_UNTIL(signalled1);
+  ::mozart::test::RunLoopWithTimeout(kPumpMessageLoopDuration);
+  ASSERT_FALSE(signalled2);
+
+  fence2.signal(0u, kFenceSignalled);
+  RUN_MESSAGE_LOOP_UNTIL(signalled2);
+  ASSERT_TRUE(acquire_fence_set2.ready());
+}
+
 }  // namespace test
 }  // namespace scene_manager
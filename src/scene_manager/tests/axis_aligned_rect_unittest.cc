@@ -0,0 +1,111 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/util/axis_aligned_rect.h"
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+namespace scene_manager {
+namespace test {
+
+AxisAlignedRect MakeRect(float min_x, float min_y, float max_x, float max_y) {
+  return {escher::vec2(min_x, min_y), escher::vec2(max_x, max_y)};
+}
+
+// Returns a transform which scales by |scale|, rotates by |angle| radians
+// about the Z axis, and translates by |translation|, in that order.
+escher::mat4 MakeTransform(escher::vec2 scale,
+                           float angle,
+                           escher::vec2 translation) {
+  escher::mat4 transform(1.f);
+  transform[0][0] = std::cos(angle) * scale.x;
+  transform[0][1] = std::sin(angle) * scale.x;
+  transform[1][0] = -std::sin(angle) * scale.y;
+  transform[1][1] = std::cos(angle) * scale.y;
+  transform[3][0] = translation.x;
+  transform[3][1] = translation.y;
+  return transform;
+}
+
+TEST(AxisAlignedRectTest, DetectsTransformsWhichPreserveAxisAlignment) {
+  const float kQuarterTurn = 1.57079632679f;
+  EXPECT_TRUE(PreservesAxisAlignment(escher::mat4(1.f)));
+  EXPECT_TRUE(PreservesAxisAlignment(
+      MakeTransform(escher::vec2(2.f, 3.f), 0.f, escher::vec2(10.f, 20.f))));
+  EXPECT_TRUE(PreservesAxisAlignment(
+      MakeTransform(escher::vec2(1.f), kQuarterTurn, escher::vec2(0.f))));
+  EXPECT_TRUE(PreservesAxisAlignment(
+      MakeTransform(escher::vec2(1.f), 2 * kQuarterTurn, escher::vec2(0.f))));
+  EXPECT_FALSE(PreservesAxisAlignment(
+      MakeTransform(escher::vec2(1.f), 0.5f, escher::vec2(0.f))));
+
+  // Shear and perspective do not.
+  escher::mat4 shear(1.f);
+  shear[1][0] = 0.5f;
+  EXPECT_FALSE(PreservesAxisAlignment(shear));
+  escher::mat4 perspective(1.f);
+  perspective[0][3] = 0.01f;
+  EXPECT_FALSE(PreservesAxisAlignment(perspective));
+}
+
+TEST(AxisAlignedRectTest, TransformBounds) {
+  const AxisAlignedRect rect = MakeRect(-10.f, -5.f, 10.f, 5.f);
+  EXPECT_EQ(MakeRect(80.f, 185.f, 120.f, 215.f),
+            TransformBounds(MakeTransform(escher::vec2(2.f, 3.f), 0.f,
+                                          escher::vec2(100.f, 200.f)),
+                            rect));
+
+  // A rotated rectangle is bounded by a larger one.
+  const AxisAlignedRect rotated_bounds = TransformBounds(
+      MakeTransform(escher::vec2(1.f), 0.5f, escher::vec2(0.f)), rect);
+  EXPECT_TRUE(rotated_bounds.Contains(rect));
+  EXPECT_FALSE(rect.Contains(rotated_bounds));
+  EXPECT_LT(rotated_bounds.min.y, -5.f);
+  EXPECT_GT(rotated_bounds.max.y, 5.f);
+
+  escher::mat4 perspective(1.f);
+  perspective[0][3] = 0.01f;
+  EXPECT_TRUE(TransformBounds(perspective, rect).is_infinite());
+}
+
+TEST(AxisAlignedRectTest, NestedClipsIntersect) {
+  const AxisAlignedRect outer = MakeRect(0.f, 0.f, 100.f, 100.f);
+  const AxisAlignedRect inner = MakeRect(50.f, -20.f, 150.f, 40.f);
+  const AxisAlignedRect visible = AxisAlignedRect::Infinite()
+                                      .Intersection(outer)
+                                      .Intersection(inner);
+  EXPECT_EQ(MakeRect(50.f, 0.f, 100.f, 40.f), visible);
+
+  // Objects are culled if they lie outside the intersection, and need no
+  // clipping if they lie within it.
+  EXPECT_TRUE(visible.Contains(MakeRect(60.f, 10.f, 90.f, 30.f)));
+  EXPECT_FALSE(visible.Contains(MakeRect(60.f, 10.f, 90.f, 50.f)));
+  EXPECT_TRUE(visible.Intersects(MakeRect(60.f, 10.f, 90.f, 50.f)));
+  EXPECT_FALSE(visible.Intersects(MakeRect(0.f, 0.f, 40.f, 100.f)));
+  EXPECT_FALSE(visible.Intersects(MakeRect(100.f, 0.f, 120.f, 40.f)));
+
+  // Disjoint clips leave nothing visible.
+  EXPECT_TRUE(
+      outer.Intersection(MakeRect(200.f, 200.f, 300.f, 300.f)).is_empty());
+
+  // Everything intersects, and lies within, an infinite rectangle.
+  EXPECT_TRUE(AxisAlignedRect::Infinite().Contains(outer));
+  EXPECT_TRUE(AxisAlignedRect::Infinite().Intersects(
+      AxisAlignedRect::Infinite()));
+  EXPECT_FALSE(outer.Contains(AxisAlignedRect::Infinite()));
+}
+
+TEST(AxisAlignedRectTest, Union) {
+  const AxisAlignedRect empty = MakeRect(0.f, 0.f, 0.f, 0.f);
+  const AxisAlignedRect a = MakeRect(10.f, 10.f, 20.f, 20.f);
+  const AxisAlignedRect b = MakeRect(30.f, 0.f, 40.f, 15.f);
+  EXPECT_EQ(a, empty.Union(a));
+  EXPECT_EQ(a, a.Union(empty));
+  EXPECT_EQ(MakeRect(10.f, 0.f, 40.f, 20.f), a.Union(b));
+}
+
+}  // namespace test
+}  // namespace scene_manager
@@ -0,0 +1,82 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/util/dirty_region.h"
+
+#include "gtest/gtest.h"
+
+namespace scene_manager {
+namespace test {
+
+using Rect = DirtyRegion::Rect;
+
+TEST(DirtyRegionTest, RectsAreClippedToBounds) {
+  DirtyRegion region(100, 50);
+  region.Add({90, 40, 20, 20});
+  ASSERT_EQ(1u, region.rects().size());
+  EXPECT_EQ((Rect{90, 40, 10, 10}), region.rects()[0]);
+
+  // Rects which are entirely out of bounds, or empty, are ignored.
+  region.Clear();
+  region.Add({100, 0, 10, 10});
+  region.Add({0, 0, 0, 10});
+  region.Add({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff});
+  EXPECT_TRUE(region.is_empty());
+
+  region.AddAll();
+  ASSERT_EQ(1u, region.rects().size());
+  EXPECT_EQ((Rect{0, 0, 100, 50}), region.rects()[0]);
+}
+
+TEST(DirtyRegionTest, CoveredRectsAreDropped) {
+  DirtyRegion region(100, 100);
+  region.Add({10, 10, 20, 20});
+  region.Add({15, 15, 5, 5});
+  ASSERT_EQ(1u, region.rects().size());
+  EXPECT_EQ((Rect{10, 10, 20, 20}), region.rects()[0]);
+
+  // A rect which covers existing ones replaces them.
+  region.Add({50, 50, 10, 10});
+  region.Add({0, 0, 40, 40});
+  ASSERT_EQ(2u, region.rects().size());
+  EXPECT_EQ(40u * 40u + 10u * 10u, region.area());
+}
+
+TEST(DirtyRegionTest, AdjacentRectsAreMerged) {
+  DirtyRegion region(100, 100);
+  region.Add({0, 0, 10, 10});
+  region.Add({10, 0, 10, 10});
+  region.Add({0, 10, 20, 10});
+  ASSERT_EQ(1u, region.rects().size());
+  EXPECT_EQ((Rect{0, 0, 20, 20}), region.rects()[0]);
+}
+
+TEST(DirtyRegionTest, DistantRectsAreKeptSeparate) {
+  // A text caret and a spinner in opposite corners of a large image.
+  DirtyRegion region(1000, 1000);
+  region.Add({10, 10, 2, 20});
+  region.Add({950, 950, 40, 40});
+  ASSERT_EQ(2u, region.rects().size());
+  EXPECT_EQ(2u * 20u + 40u * 40u, region.area());
+}
+
+TEST(DirtyRegionTest, RectCountIsBounded) {
+  DirtyRegion region(1000, 1000);
+  for (uint32_t i = 0; i < 2 * DirtyRegion::kMaxRectCount; ++i) {
+    region.Add({i * 50, i * 50, 10, 10});
+    EXPECT_LE(region.rects().size(), DirtyRegion::kMaxRectCount);
+  }
+
+  // Every added pixel is still covered.
+  for (uint32_t i = 0; i < 2 * DirtyRegion::kMaxRectCount; ++i) {
+    Rect added{i * 50, i * 50, 10, 10};
+    bool covered = false;
+    for (const Rect& rect : region.rects())
+      covered = covered || rect.Contains(added);
+    EXPECT_TRUE(covered) << "rect " << i << " is not covered";
+  }
+}
+
+}  // namespace test
+}  // namespace scene_manager
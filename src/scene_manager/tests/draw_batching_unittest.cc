@@ -0,0 +1,115 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/util/draw_batching.h"
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+namespace scene_manager {
+namespace test {
+
+const int kRectGeometry = 1;
+const int kCircleGeometry = 2;
+const int kRedMaterial = 3;
+const int kBlueMaterial = 4;
+
+DrawItem MakeItem(float x,
+                  float y,
+                  float size,
+                  const void* geometry,
+                  const void* material) {
+  DrawItem item;
+  item.bounds = {escher::vec2(x, y), escher::vec2(x + size, y + size)};
+  item.geometry = geometry;
+  item.material = material;
+  return item;
+}
+
+// Checks that |order| is a permutation of |items| in which every pair of
+// objects that overlap is drawn in the original order.
+void ExpectSameAppearance(const std::vector<DrawItem>& items,
+                          const std::vector<size_t>& order) {
+  ASSERT_EQ(items.size(), order.size());
+  std::vector<size_t> position(items.size(), items.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    ASSERT_LT(order[i], items.size());
+    ASSERT_EQ(items.size(), position[order[i]]) << "drawn twice";
+    position[order[i]] = i;
+  }
+  for (size_t a = 0; a < items.size(); ++a) {
+    for (size_t b = a + 1; b < items.size(); ++b) {
+      if (items[a].bounds.Intersects(items[b].bounds)) {
+        EXPECT_LT(position[a], position[b]) << a << " and " << b;
+      }
+    }
+  }
+}
+
+TEST(DrawBatchingTest, GroupsSeparateObjects) {
+  // A grid of cells, each a red rectangle with a blue circle beside it.
+  std::vector<DrawItem> items;
+  for (int row = 0; row < 8; ++row) {
+    for (int column = 0; column < 8; ++column) {
+      items.push_back(MakeItem(column * 20.f, row * 10.f, 10.f,
+                               &kRectGeometry, &kRedMaterial));
+      items.push_back(MakeItem(column * 20.f + 10.f, row * 10.f, 10.f,
+                               &kCircleGeometry, &kBlueMaterial));
+    }
+  }
+  std::vector<size_t> identity(items.size());
+  for (size_t i = 0; i < identity.size(); ++i)
+    identity[i] = i;
+  EXPECT_EQ(items.size(), CountBatches(items, identity));
+
+  auto order = BatchDrawOrder(items);
+  ExpectSameAppearance(items, order);
+  EXPECT_EQ(2u, CountBatches(items, order));
+}
+
+TEST(DrawBatchingTest, OverlappingObjectsKeepTheirOrder) {
+  // The second rectangle cannot be drawn before the circle which it covers,
+  // so it cannot join the first.
+  std::vector<DrawItem> items = {
+      MakeItem(0.f, 0.f, 10.f, &kRectGeometry, &kRedMaterial),
+      MakeItem(20.f, 0.f, 10.f, &kCircleGeometry, &kBlueMaterial),
+      MakeItem(25.f, 5.f, 10.f, &kRectGeometry, &kRedMaterial),
+      MakeItem(50.f, 0.f, 10.f, &kRectGeometry, &kRedMaterial)};
+  auto order = BatchDrawOrder(items);
+  ExpectSameAppearance(items, order);
+  EXPECT_EQ((std::vector<size_t>{0, 3, 1, 2}), order);
+
+  // Objects with unknown bounds, such as clip objects, overlap everything,
+  // and objects without geometry are never batched.
+  items[1].bounds = AxisAlignedRect::Infinite();
+  items[1].geometry = nullptr;
+  order = BatchDrawOrder(items);
+  EXPECT_EQ((std::vector<size_t>{0, 1, 2, 3}), order);
+}
+
+TEST(DrawBatchingTest, RandomScenesLookTheSame) {
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> position(0.f, 100.f);
+  std::uniform_real_distribution<float> size(1.f, 20.f);
+  const void* geometries[] = {&kRectGeometry, &kCircleGeometry, nullptr};
+  const void* materials[] = {&kRedMaterial, &kBlueMaterial};
+  for (int scene = 0; scene < 50; ++scene) {
+    std::vector<DrawItem> items;
+    for (int i = 0; i < 100; ++i) {
+      items.push_back(MakeItem(position(random), position(random),
+                               size(random), geometries[random() % 3],
+                               materials[random() % 2]));
+    }
+    auto order = BatchDrawOrder(items);
+    ExpectSameAppearance(items, order);
+    std::vector<size_t> identity(items.size());
+    for (size_t i = 0; i < identity.size(); ++i)
+      identity[i] = i;
+    EXPECT_LE(CountBatches(items, order), CountBatches(items, identity));
+  }
+}
+
+}  // namespace test
+}  // namespace scene_manager
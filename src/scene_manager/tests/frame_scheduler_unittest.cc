@@ -0,0 +1,142 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/engine/frame_scheduler.h"
+
+#include <vector>
+
+#include "apps/mozart/src/scene_manager/displays/display.h"
+#include "gtest/gtest.h"
+
+namespace scene_manager {
+namespace test {
+
+constexpr uint64_t kVsyncInterval = 16'000'000;
+constexpr uint64_t kRenderDuration = 3'000'000;
+
+// Records the frames it is asked to render, and simulates the time taken to
+// render each one.  If |animating|, each frame requests the next.
+class FakeRenderer : public FrameSchedulerDelegate {
+ public:
+  FakeRenderer(VirtualFrameTimer* timer, FrameScheduler* scheduler)
+      : timer_(timer), scheduler_(scheduler) {
+    scheduler_->set_delegate(this);
+  }
+
+  void RenderFrame(uint64_t presentation_time,
+                   uint64_t presentation_interval) override {
+    render_start_times.push_back(timer_->Now());
+    presentation_times.push_back(presentation_time);
+    timer_->Advance(kRenderDuration);
+    if (animating)
+      scheduler_->RequestFrame(presentation_time + presentation_interval);
+  }
+
+  bool animating = false;
+  std::vector<uint64_t> render_start_times;
+  std::vector<uint64_t> presentation_times;
+
+ private:
+  VirtualFrameTimer* const timer_;
+  FrameScheduler* const scheduler_;
+};
+
+class FrameSchedulerTest : public ::testing::Test {
+ protected:
+  FrameSchedulerTest()
+      : display_(1280,
+                 800,
+                 1.f,
+                 std::make_unique<SimulatedVsyncSource>(0, kVsyncInterval)) {
+    auto timer = std::make_unique<VirtualFrameTimer>(1'000'000);
+    timer_ = timer.get();
+    scheduler_ = std::make_unique<FrameScheduler>(&display_, std::move(timer));
+    renderer_ = std::make_unique<FakeRenderer>(timer_, scheduler_.get());
+  }
+
+  Display display_;
+  VirtualFrameTimer* timer_;
+  std::unique_ptr<FrameScheduler> scheduler_;
+  std::unique_ptr<FakeRenderer> renderer_;
+};
+
+TEST_F(FrameSchedulerTest, PresentsAtTheRequestedVsync) {
+  scheduler_->RequestFrame(5 * kVsyncInterval - 1'000);
+  timer_->RunUntil(100 * kVsyncInterval);
+  ASSERT_EQ(1u, renderer_->presentation_times.size());
+  EXPECT_EQ(5 * kVsyncInterval, renderer_->presentation_times[0]);
+  EXPECT_LE(renderer_->render_start_times[0] + kRenderDuration,
+            renderer_->presentation_times[0]);
+
+  // A request for a time which has passed is presented at the next vsync
+  // that can be rendered in time.
+  scheduler_->RequestFrame(0);
+  timer_->RunUntil(200 * kVsyncInterval);
+  ASSERT_EQ(2u, renderer_->presentation_times.size());
+  EXPECT_EQ(101 * kVsyncInterval, renderer_->presentation_times[1]);
+}
+
+TEST_F(FrameSchedulerTest, EarliestRequestIsPresentedFirst) {
+  scheduler_->RequestFrame(20 * kVsyncInterval);
+  scheduler_->RequestFrame(10 * kVsyncInterval);
+  scheduler_->RequestFrame(30 * kVsyncInterval);
+  timer_->RunUntil(100 * kVsyncInterval);
+  EXPECT_EQ((std::vector<uint64_t>{10 * kVsyncInterval, 20 * kVsyncInterval,
+                                   30 * kVsyncInterval}),
+            renderer_->presentation_times);
+}
+
+TEST_F(FrameSchedulerTest, AnimationPresentsAtEveryVsync) {
+  // Simulate several minutes of continuous animation.
+  constexpr uint64_t kFrameCount = 10'000;
+  renderer_->animating = true;
+  scheduler_->RequestFrame(0);
+  timer_->RunUntil(kFrameCount * kVsyncInterval);
+
+  const auto& presentation_times = renderer_->presentation_times;
+  ASSERT_GE(presentation_times.size(), kFrameCount - 1);
+  for (size_t i = 0; i < presentation_times.size(); ++i) {
+    EXPECT_EQ((i + 1) * kVsyncInterval, presentation_times[i]);
+    EXPECT_LE(renderer_->render_start_times[i] + kRenderDuration,
+              presentation_times[i]);
+  }
+}
+
+TEST_F(FrameSchedulerTest, PredictsFuturePresentations) {
+  // The first prediction is the next vsync which leaves enough time to render,
+  // so the one due in 1ms is skipped.
+  timer_->Advance(11 * kVsyncInterval - 2'000'000);
+  std::vector<FuturePresentation> presentations =
+      scheduler_->GetFuturePresentations(4);
+  ASSERT_EQ(4u, presentations.size());
+  for (size_t i = 0; i < presentations.size(); ++i) {
+    EXPECT_EQ((12 + i) * kVsyncInterval, presentations[i].presentation_time);
+    EXPECT_LT(presentations[i].latch_point,
+              presentations[i].presentation_time);
+  }
+  EXPECT_EQ(FrameScheduler::kMaxFuturePresentationCount,
+            scheduler_->GetFuturePresentations(1000).size());
+
+  // Requesting a frame at a latch point presents it at the predicted time,
+  // but requesting one just after is too late.
+  timer_->RunUntil(presentations[1].latch_point);
+  scheduler_->RequestFrame(0);
+  timer_->RunUntil(presentations[1].presentation_time);
+  timer_->RunUntil(presentations[2].latch_point + 1);
+  scheduler_->RequestFrame(0);
+  timer_->RunUntil(presentations[3].presentation_time);
+  EXPECT_EQ((std::vector<uint64_t>{presentations[1].presentation_time,
+                                   presentations[3].presentation_time}),
+            renderer_->presentation_times);
+
+  // A vsync for which a frame has already been rendered is not predicted.
+  renderer_->animating = true;
+  scheduler_->RequestFrame(0);
+  timer_->RunUntil(20 * kVsyncInterval);
+  EXPECT_LT(renderer_->presentation_times.back(),
+            scheduler_->GetFuturePresentations(1)[0].presentation_time);
+}
+
+}  // namespace test
+}  // namespace scene_manager
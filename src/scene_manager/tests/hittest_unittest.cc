@@ -295,5 +295,43 @@ TEST_F(HitTestTest, Clipping) {
               {.tag = 100, .tx = 0.f, .ty = 0.f, .tz = 0.f, .d = 8.f}});
 }
 
+TEST_F(HitTestTest, ClipNode) {
+  // Clip 25 and 35 to a clip node whose region covers 10, but not the part
+  // of 20 which lies outside 10.
+  Apply(mozart::NewCreateClipNodeOp(13));
+  Apply(mozart::NewCreateShapeNodeOp(14));
+  Apply(mozart::NewSetShapeOp(14, 20));
+  Apply(mozart::NewSetTranslationOp(14, (float[3]){4.f, 4.f, 0.f}));
+  Apply(mozart::NewAddPartOp(13, 14));
+  Apply(mozart::NewSetClipOp(3, 13, false));
+  Apply(mozart::NewSetClipOp(7, 13, false));
+
+  // The clip has no effect until the clip node belongs to a scene.
+  ExpectHits(1, vec3(9.f, 9.f, 10.f), kDownVector,
+             {{.tag = 20, .tx = -9.f, .ty = -9.f, .tz = -1.f, .d = 9.f},
+              {.tag = 25, .tx = -4.f, .ty = -4.f, .tz = 0.f, .d = 9.f},
+              {.tag = 100, .tx = 0.f, .ty = 0.f, .tz = 0.f, .d = 9.f}});
+
+  Apply(mozart::NewCreateSceneOp(15));
+  Apply(mozart::NewAddChildOp(15, 1));
+  Apply(mozart::NewAddChildOp(15, 13));
+  ExpectHits(1, vec3(9.f, 9.f, 10.f), kDownVector, {});
+  ExpectHits(1, vec3(12.f, 6.f, 10.f), kDownVector, {});
+  ExpectHits(1, vec3(1.f, 1.f, 10.f), kDownVector,
+             {{.tag = 10, .tx = -4.f, .ty = -4.f, .tz = -2.f, .d = 8.f},
+              {.tag = 25, .tx = -4.f, .ty = -4.f, .tz = 0.f, .d = 8.f},
+              {.tag = 100, .tx = 0.f, .ty = 0.f, .tz = 0.f, .d = 8.f}});
+
+  // Moving the clip node's part moves the region of both clipped nodes.
+  Apply(mozart::NewSetTranslationOp(14, (float[3]){14.f, 4.f, 0.f}));
+  ExpectHits(1, vec3(1.f, 1.f, 10.f), kDownVector, {});
+  ExpectHits(1, vec3(12.f, 6.f, 10.f), kDownVector,
+             {{.tag = 30, .tx = -14.f, .ty = -4.f, .tz = -1.f, .d = 9.f},
+              {.tag = 35, .tx = -10.f, .ty = 0.f, .tz = -1.f, .d = 9.f},
+              {.tag = 20, .tx = -9.f, .ty = -9.f, .tz = -1.f, .d = 9.f},
+              {.tag = 25, .tx = -4.f, .ty = -4.f, .tz = 0.f, .d = 9.f},
+              {.tag = 100, .tx = 0.f, .ty = 0.f, .tz = 0.f, .d = 9.f}});
+}
+
 }  // namespace test
 }  // namespace scene_manager
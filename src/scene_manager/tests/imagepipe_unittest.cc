@@ -2,6 +2,10 @@
 // Use of source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "escher/util/image_utils.h"
 #include "gtest/gtest.h"
 
@@ -10,6 +14,7 @@
 #include "apps/mozart/src/scene_manager/acquire_fence.h"
 #include "apps/mozart/src/scene_manager/fence.h"
 #include "apps/mozart/src/scene_manager/resources/image_pipe.h"
+#include "apps/mozart/src/scene_manager/resources/material.h"
 #include "apps/mozart/src/scene_manager/tests/mocks.h"
 #include "apps/mozart/src/scene_manager/tests/session_test.h"
 #include "apps/mozart/src/scene_manager/tests/util.h"
@@ -156,6 +161,8 @@ TEST_F(ImagePipeTest, ImagePipePresentTwoFrames) {
   ImagePipePtr image_pipe =
       ftl::MakeRefCounted<ImagePipeThatCreatesDummyImages>(session_.get(),
                                                            this);
+  auto material = ftl::MakeRefCounted<Material>(session_.get(), 1u);
+  material->SetTexture(image_pipe);
 
   uint32_t imageId1 = 1;
 
@@ -258,6 +265,153 @@ TEST_F(ImagePipeTest, ImagePipePresentTwoFrames) {
   ASSERT_FALSE(IsEventSignalled(release_fence2, kFenceSignalled));
 }
 
+// Adds two images to |image_pipe|, and presents them both with acquire fences
+// which are signalled in reverse order, so that both are ready by the time
+// the pipe is next updated.  Returns the statuses reported for the frames, in
+// the order in which they were reported.
+std::vector<mozart2::ImagePresentationStatusPtr> PresentTwoReadyFrames(
+    ImagePipe* image_pipe,
+    mx::event* release_fence1) {
+  for (uint32_t image_id = 1; image_id <= 2; ++image_id) {
+    size_t image_dim = 100;
+    auto image_info = mozart2::ImageInfo::New();
+    image_info->pixel_format = mozart2::ImageInfo::PixelFormat::BGRA_8;
+    image_info->tiling = mozart2::ImageInfo::Tiling::LINEAR;
+    image_info->width = image_dim;
+    image_info->height = image_dim;
+    image_info->stride = image_dim;
+    image_pipe->AddImage(
+        image_id, std::move(image_info),
+        CopyVmo(CreateVmoWithCheckerboardPixels(image_dim, image_dim)->vmo()),
+        mozart2::MemoryType::HOST_MEMORY, 0);
+  }
+
+  auto statuses =
+      std::make_shared<std::vector<mozart2::ImagePresentationStatusPtr>>();
+  auto callback = [statuses](mozart2::PresentationInfoPtr info,
+                             mozart2::ImagePresentationStatusPtr status) {
+    statuses->push_back(std::move(status));
+  };
+  mx::event acquire_fence1, acquire_fence2, release_fence2;
+  EXPECT_EQ(MX_OK, mx::event::create(0, &acquire_fence1));
+  EXPECT_EQ(MX_OK, mx::event::create(0, &acquire_fence2));
+  EXPECT_EQ(MX_OK, mx::event::create(0, release_fence1));
+  EXPECT_EQ(MX_OK, mx::event::create(0, &release_fence2));
+  image_pipe->PresentImage(1, 0, CopyEvent(acquire_fence1),
+                           CopyEvent(*release_fence1), callback);
+  image_pipe->PresentImage(2, 0, CopyEvent(acquire_fence2),
+                           std::move(release_fence2), callback);
+
+  // The second frame is ready first, but cannot be presented before the
+  // first one is.
+  acquire_fence2.signal(0u, kFenceSignalled);
+  ::mozart::test::RunLoopWithTimeout(kPumpMessageLoopDuration);
+  EXPECT_TRUE(statuses->empty());
+
+  acquire_fence1.signal(0u, kFenceSignalled);
+  ::mozart::test::RunLoopWithTimeout(kPumpMessageLoopDuration);
+  return std::move(*statuses);
+}
+
+// In MAILBOX mode, only the newest ready frame is presented, and the older
+// ones are dropped and released immediately.
+TEST_F(ImagePipeTest, MailboxModeDropsOlderFrames) {
+  ImagePipePtr image_pipe =
+      ftl::MakeRefCounted<ImagePipeThatCreatesDummyImages>(session_.get(),
+                                                           this);
+  auto material = ftl::MakeRefCounted<Material>(session_.get(), 1u);
+  material->SetTexture(image_pipe);
+  mx::event release_fence1;
+  auto statuses = PresentTwoReadyFrames(image_pipe.get(), &release_fence1);
+
+  ASSERT_EQ(2u, statuses.size());
+  EXPECT_FALSE(statuses[0]->presented);
+  EXPECT_EQ(1u, statuses[0]->frames_dropped);
+  EXPECT_TRUE(statuses[1]->presented);
+  EXPECT_EQ(1u, statuses[1]->frames_presented);
+  EXPECT_TRUE(IsEventSignalled(release_fence1, kFenceSignalled));
+  EXPECT_EQ(1u, image_pipe->statistics().frames_presented);
+  EXPECT_EQ(1u, image_pipe->statistics().frames_dropped);
+}
+
+// In FIFO mode, every frame is presented in turn, one per update.
+TEST_F(ImagePipeTest, FifoModePresentsEveryFrame) {
+  ImagePipePtr image_pipe =
+      ftl::MakeRefCounted<ImagePipeThatCreatesDummyImages>(session_.get(),
+                                                           this);
+  auto material = ftl::MakeRefCounted<Material>(session_.get(), 1u);
+  material->SetTexture(image_pipe);
+  image_pipe->SetPresentationMode(mozart2::PresentationMode::FIFO);
+  mx::event release_fence1;
+  auto statuses = PresentTwoReadyFrames(image_pipe.get(), &release_fence1);
+
+  ASSERT_EQ(2u, statuses.size());
+  EXPECT_TRUE(statuses[0]->presented);
+  EXPECT_TRUE(statuses[1]->presented);
+  EXPECT_EQ(2u, statuses[1]->frames_presented);
+  EXPECT_EQ(0u, statuses[1]->frames_dropped);
+  EXPECT_EQ(2u, image_pipe->statistics().frames_presented);
+  EXPECT_EQ(0u, image_pipe->statistics().frames_dropped);
+}
+
+// An ImagePipe which is not the texture of any Material is not updated, but
+// in MAILBOX mode it still releases frames which have been superseded.  Once
+// it is attached, its newest frame is presented.
+TEST_F(ImagePipeTest, UnattachedImagePipeIsNotUpdated) {
+  ImagePipePtr image_pipe =
+      ftl::MakeRefCounted<ImagePipeThatCreatesDummyImages>(session_.get(),
+                                                           this);
+  mx::event release_fence1;
+  auto statuses = PresentTwoReadyFrames(image_pipe.get(), &release_fence1);
+
+  ASSERT_EQ(1u, statuses.size());
+  EXPECT_FALSE(statuses[0]->presented);
+  EXPECT_TRUE(IsEventSignalled(release_fence1, kFenceSignalled));
+  EXPECT_FALSE(image_pipe->GetEscherImage());
+
+  auto material = ftl::MakeRefCounted<Material>(session_.get(), 1u);
+  material->SetTexture(image_pipe);
+  RUN_MESSAGE_LOOP_UNTIL(image_pipe->GetEscherImage());
+  EXPECT_EQ(1u, image_pipe->statistics().frames_presented);
+  EXPECT_EQ(1u, image_pipe->statistics().frames_dropped);
+}
+
+// The upload buffers of ImagePipe frames are filled on the Engine's upload
+// thread, and the uploads are submitted back on this thread.
+TEST_F(ImagePipeTest, UploadIsSubmittedAfterItIsFilled) {
+  std::atomic<bool> filled(false);
+  bool submitted = false;
+  engine_->PostUpload(session_, [&filled] { filled = true; },
+                      [&filled, &submitted] {
+                        EXPECT_TRUE(filled);
+                        submitted = true;
+                      });
+  EXPECT_FALSE(submitted);
+  RUN_MESSAGE_LOOP_UNTIL(submitted);
+}
+
+// An upload which is still in flight when the Engine is destroyed is
+// abandoned: the Engine waits for its buffer to be filled, then releases what
+// it holds without submitting it.
+TEST_F(ImagePipeTest, PendingUploadIsAbandonedWithTheEngine) {
+  auto engine = std::make_unique<EngineForTest>(&display_manager_, nullptr);
+  auto held = std::make_shared<int>(0);
+  std::atomic<bool> filled(false);
+  bool submitted = false;
+  engine->PostUpload(session_, [&filled] { filled = true; },
+                     [held, &submitted] { submitted = true; });
+  EXPECT_EQ(2, held.use_count());
+
+  engine.reset();
+  EXPECT_TRUE(filled);
+  EXPECT_EQ(1, held.use_count());
+
+  // The reply posted by the upload thread finds the Engine gone.
+  mtl::MessageLoop::GetCurrent()->PostQuitTask();
+  mtl::MessageLoop::GetCurrent()->Run();
+  EXPECT_FALSE(submitted);
+}
+
 // TODO(MZ-151): More tests.
 // - Test that you can't add the same image twice.
 // - Test that you can't present an image that doesn't exist.
@@ -43,9 +43,16 @@ void ReleaseFenceSignallerForTest::AddCPUReleaseFence(mx::event fence) {
   fence.signal(0u, kFenceSignalled);
 }
 
+void ReleaseFenceSignallerForTest::AddCPUReleaseFences(
+    ::fidl::Array<mx::event> fences) {
+  for (auto& fence : fences)
+    AddCPUReleaseFence(std::move(fence));
+}
+
 EngineForTest::EngineForTest(DisplayManager* display_manager,
-                             std::unique_ptr<ReleaseFenceSignaller> r)
-    : Engine(display_manager, std::move(r)) {}
+                             std::unique_ptr<ReleaseFenceSignaller> r,
+                             std::unique_ptr<FrameTimer> frame_timer)
+    : Engine(display_manager, std::move(r), std::move(frame_timer)) {}
 
 std::unique_ptr<SessionHandler> EngineForTest::CreateSessionHandler(
     SessionId session_id,
@@ -45,6 +45,7 @@ class ReleaseFenceSignallerForTest : public ReleaseFenceSignaller {
       escher::impl::CommandBufferSequencer* command_buffer_sequencer);
 
   void AddCPUReleaseFence(mx::event fence) override;
+  void AddCPUReleaseFences(::fidl::Array<mx::event> fences) override;
 
   uint32_t num_calls_to_add_cpu_release_fence() {
     return num_calls_to_add_cpu_release_fence_;
@@ -57,7 +58,8 @@ class ReleaseFenceSignallerForTest : public ReleaseFenceSignaller {
 class EngineForTest : public Engine {
  public:
   EngineForTest(DisplayManager* display_manager,
-                std::unique_ptr<ReleaseFenceSignaller> r);
+                std::unique_ptr<ReleaseFenceSignaller> r,
+                std::unique_ptr<FrameTimer> frame_timer = nullptr);
   using Engine::FindSession;
 
  private:
@@ -3,6 +3,7 @@
 // found in the LICENSE file.
 
 #include "apps/mozart/lib/scene/session_helpers.h"
+#include "apps/mozart/src/scene_manager/resources/nodes/clip_node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/entity_node.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/shape_node.h"
 #include "apps/mozart/src/scene_manager/tests/session_test.h"
@@ -48,6 +49,30 @@ TEST_F(NodeTest, ShapeNodeMaterialAndShape) {
   EXPECT_EQ(shape_node->shape(), circle);
 }
 
+TEST_F(NodeTest, MaterialsOfTheSameColorShareEscherMaterials) {
+  const mozart::ResourceId kMaterialId1 = 1;
+  const mozart::ResourceId kMaterialId2 = 2;
+  const mozart::ResourceId kMaterialId3 = 3;
+
+  EXPECT_TRUE(Apply(mozart::NewCreateMaterialOp(kMaterialId1)));
+  EXPECT_TRUE(Apply(mozart::NewCreateMaterialOp(kMaterialId2)));
+  EXPECT_TRUE(Apply(mozart::NewCreateMaterialOp(kMaterialId3)));
+  EXPECT_TRUE(Apply(mozart::NewSetColorOp(kMaterialId1, 255, 100, 100, 255)));
+  EXPECT_TRUE(Apply(mozart::NewSetColorOp(kMaterialId2, 255, 100, 100, 255)));
+  EXPECT_TRUE(Apply(mozart::NewSetColorOp(kMaterialId3, 100, 100, 255, 255)));
+  auto material1 = FindResource<Material>(kMaterialId1);
+  auto material2 = FindResource<Material>(kMaterialId2);
+  auto material3 = FindResource<Material>(kMaterialId3);
+  EXPECT_EQ(material1->escher_material(), material2->escher_material());
+  EXPECT_NE(material1->escher_material(), material3->escher_material());
+
+  // Changing the color of one material does not affect the others.
+  EXPECT_TRUE(Apply(mozart::NewSetColorOp(kMaterialId1, 100, 100, 255, 255)));
+  EXPECT_EQ(material1->escher_material(), material3->escher_material());
+  EXPECT_NE(material1->escher_material(), material2->escher_material());
+  EXPECT_EQ(1.f, material2->red());
+}
+
 TEST_F(NodeTest, NodesWithChildren) {
   // Child node that we will attach to various types of nodes.
   const mozart::ResourceId kChildNodeId = 1;
@@ -59,13 +84,13 @@ TEST_F(NodeTest, NodesWithChildren) {
 
   const mozart::ResourceId kEntityNodeId = 10;
   const mozart::ResourceId kShapeNodeId = 11;
-  // TODO: const mozart::ResourceId kClipNodeId = 12;
+  const mozart::ResourceId kClipNodeId = 12;
   EXPECT_TRUE(Apply(mozart::NewCreateEntityNodeOp(kEntityNodeId)));
   EXPECT_TRUE(Apply(mozart::NewCreateShapeNodeOp(kShapeNodeId)));
-  // TODO: EXPECT_TRUE(Apply(mozart::NewCreateClipNodeOp(kClipNodeId)));
+  EXPECT_TRUE(Apply(mozart::NewCreateClipNodeOp(kClipNodeId)));
   auto entity_node = FindResource<EntityNode>(kEntityNodeId);
   auto shape_node = FindResource<ShapeNode>(kShapeNodeId);
-  // auto clip_node = FindResource<ClipNode>(kClipNodeId);
+  auto clip_node = FindResource<ClipNode>(kClipNodeId);
 
   // We expect to be able to add children to these types.
   EXPECT_TRUE(Apply(mozart::NewAddChildOp(kEntityNodeId, kChildNodeId)));
@@ -74,14 +99,111 @@ TEST_F(NodeTest, NodesWithChildren) {
   // EXPECT_TRUE(Apply(mozart::NewDetachOp(kChildNodeId)));
 
   // We do not expect to be able to add children to these types.
-  // TODO:
-  // EXPECT_FALSE(Apply(mozart::NewAddChildOp(kClipNodeId, kChildNodeId)));
-  // EXPECT_EQ(nullptr, child_node->parent());
-  // EXPECT_EQ(nullptr, child_node->parent());
+  EXPECT_FALSE(Apply(mozart::NewAddChildOp(kClipNodeId, kChildNodeId)));
+  EXPECT_EQ(nullptr, child_node->parent());
   EXPECT_FALSE(Apply(mozart::NewAddChildOp(kShapeNodeId, kChildNodeId)));
   EXPECT_EQ(nullptr, child_node->parent());
 }
 
+TEST_F(NodeTest, ClipNodeRegion) {
+  const mozart::ResourceId kClipNodeId = 1;
+  const mozart::ResourceId kPartNodeId = 2;
+  const mozart::ResourceId kRectangleId = 3;
+  const mozart::ResourceId kEntityNodeId1 = 4;
+  const mozart::ResourceId kEntityNodeId2 = 5;
+  EXPECT_TRUE(Apply(mozart::NewCreateClipNodeOp(kClipNodeId)));
+  EXPECT_TRUE(Apply(mozart::NewCreateShapeNodeOp(kPartNodeId)));
+  EXPECT_TRUE(Apply(mozart::NewCreateRectangleOp(kRectangleId, 10.f, 20.f)));
+  EXPECT_TRUE(Apply(mozart::NewSetShapeOp(kPartNodeId, kRectangleId)));
+  EXPECT_TRUE(Apply(
+      mozart::NewSetTranslationOp(kPartNodeId, (float[3]){5.f, 0.f, 0.f})));
+  EXPECT_TRUE(Apply(mozart::NewAddPartOp(kClipNodeId, kPartNodeId)));
+  auto clip_node = FindResource<ClipNode>(kClipNodeId);
+  EXPECT_EQ(1u, clip_node->region().shapes.size());
+  EXPECT_TRUE(clip_node->region().is_rectangle);
+  EXPECT_EQ(
+      (AxisAlignedRect{escher::vec2(0.f, -10.f), escher::vec2(10.f, 10.f)}),
+      clip_node->region().bounds);
+
+  // The cached region follows changes to the parts.
+  EXPECT_TRUE(Apply(
+      mozart::NewSetTranslationOp(kPartNodeId, (float[3]){0.f, 0.f, 0.f})));
+  EXPECT_EQ(
+      (AxisAlignedRect{escher::vec2(-5.f, -10.f), escher::vec2(5.f, 10.f)}),
+      clip_node->region().bounds);
+  EXPECT_TRUE(Apply(mozart::NewDetachOp(kPartNodeId)));
+  EXPECT_TRUE(clip_node->region().shapes.empty());
+  EXPECT_TRUE(Apply(mozart::NewAddPartOp(kClipNodeId, kPartNodeId)));
+
+  // One clip node can clip many nodes.
+  EXPECT_TRUE(Apply(mozart::NewCreateEntityNodeOp(kEntityNodeId1)));
+  EXPECT_TRUE(Apply(mozart::NewCreateEntityNodeOp(kEntityNodeId2)));
+  EXPECT_TRUE(Apply(mozart::NewSetClipOp(kEntityNodeId1, kClipNodeId, false)));
+  EXPECT_TRUE(Apply(mozart::NewSetClipOp(kEntityNodeId2, kClipNodeId, true)));
+  EXPECT_EQ(clip_node.get(), FindResource<Node>(kEntityNodeId1)->clip().get());
+  EXPECT_EQ(clip_node.get(), FindResource<Node>(kEntityNodeId2)->clip().get());
+  EXPECT_TRUE(FindResource<Node>(kEntityNodeId2)->clip_to_self());
+
+  // Only nodes with the has_clip characteristic can be clipped, and only by
+  // clip nodes.
+  EXPECT_FALSE(Apply(mozart::NewSetClipOp(kPartNodeId, kClipNodeId, false)));
+  EXPECT_FALSE(
+      Apply(mozart::NewSetClipOp(kEntityNodeId1, kEntityNodeId2, false)));
+
+  EXPECT_TRUE(Apply(mozart::NewSetClipOp(kEntityNodeId1, 0, false)));
+  EXPECT_EQ(nullptr, FindResource<Node>(kEntityNodeId1)->clip().get());
+}
+
+TEST_F(NodeTest, ClipsCannotCreateCycles) {
+  const mozart::ResourceId kClipNodeId = 1;
+  const mozart::ResourceId kClippedNodeId = 2;
+  const mozart::ResourceId kPartNodeId = 3;
+  const mozart::ResourceId kChildNodeId = 4;
+  EXPECT_TRUE(Apply(mozart::NewCreateClipNodeOp(kClipNodeId)));
+  EXPECT_TRUE(Apply(mozart::NewCreateEntityNodeOp(kClippedNodeId)));
+  EXPECT_TRUE(Apply(mozart::NewCreateEntityNodeOp(kPartNodeId)));
+  EXPECT_TRUE(Apply(mozart::NewCreateEntityNodeOp(kChildNodeId)));
+  EXPECT_TRUE(Apply(mozart::NewAddPartOp(kClipNodeId, kPartNodeId)));
+  EXPECT_TRUE(Apply(mozart::NewSetClipOp(kClippedNodeId, kClipNodeId, false)));
+  auto clipped_node = FindResource<Node>(kClippedNodeId);
+
+  // A clipped node cannot be added to its clip node, or to anything in it.
+  EXPECT_FALSE(Apply(mozart::NewAddPartOp(kClipNodeId, kClippedNodeId)));
+  EXPECT_EQ(nullptr, clipped_node->parent());
+  EXPECT_FALSE(Apply(mozart::NewAddChildOp(kPartNodeId, kClippedNodeId)));
+  EXPECT_EQ(nullptr, clipped_node->parent());
+
+  // Nor can a node be added to one of its own descendants.
+  EXPECT_TRUE(Apply(mozart::NewAddChildOp(kClippedNodeId, kChildNodeId)));
+  EXPECT_FALSE(Apply(mozart::NewAddChildOp(kChildNodeId, kClippedNodeId)));
+  EXPECT_EQ(nullptr, clipped_node->parent());
+
+  // A node cannot be clipped by a clip node which contains it.
+  EXPECT_FALSE(Apply(mozart::NewSetClipOp(kPartNodeId, kClipNodeId, false)));
+  EXPECT_EQ(nullptr, FindResource<Node>(kPartNodeId)->clip().get());
+
+  // Once the clip is removed, the node can be added to the clip node.
+  EXPECT_TRUE(Apply(mozart::NewSetClipOp(kClippedNodeId, 0, false)));
+  EXPECT_TRUE(Apply(mozart::NewAddPartOp(kClipNodeId, kClippedNodeId)));
+  EXPECT_EQ(FindResource<Node>(kClipNodeId).get(), clipped_node->parent());
+}
+
+TEST_F(NodeTest, DestroyedNodesNoLongerRetainTheirClip) {
+  const mozart::ResourceId kClipNodeId = 1;
+  const mozart::ResourceId kClippedNodeId = 2;
+  const mozart::ResourceId kPartNodeId = 3;
+  EXPECT_TRUE(Apply(mozart::NewCreateClipNodeOp(kClipNodeId)));
+  EXPECT_TRUE(Apply(mozart::NewCreateEntityNodeOp(kClippedNodeId)));
+  EXPECT_TRUE(Apply(mozart::NewCreateEntityNodeOp(kPartNodeId)));
+  EXPECT_TRUE(Apply(mozart::NewSetClipOp(kClippedNodeId, kClipNodeId, false)));
+
+  // Destroying the clipped node leaves the clip node free to be rearranged.
+  EXPECT_TRUE(Apply(mozart::NewReleaseResourceOp(kClippedNodeId)));
+  EXPECT_TRUE(Apply(mozart::NewAddPartOp(kClipNodeId, kPartNodeId)));
+  EXPECT_EQ(FindResource<Node>(kClipNodeId).get(),
+            FindResource<Node>(kPartNodeId)->parent());
+}
+
 TEST_F(NodeTest, SettingHitTestBehavior) {
   const mozart::ResourceId kNodeId = 1;
 
@@ -14,7 +14,14 @@ namespace test {
 
 class ReleaseFenceSignallerTest
     : public ::testing::Test,
-      protected escher::impl::CommandBufferSequencerController {};
+      protected escher::impl::CommandBufferSequencerController {
+ protected:
+  mx::event CreateFence() {
+    mx::event fence;
+    EXPECT_EQ(MX_OK, mx::event::create(0, &fence));
+    return fence;
+  }
+};
 
 TEST_F(ReleaseFenceSignallerTest, FencesSignalledProperly) {
   escher::impl::CommandBufferSequencer sequencer;
@@ -56,5 +63,78 @@ TEST_F(ReleaseFenceSignallerTest, FencesSignalledProperly) {
   ASSERT_TRUE(IsEventSignalled(fence3, kFenceSignalled));
 }
 
+TEST_F(ReleaseFenceSignallerTest, FencesOfAFrameAreSignalledTogether) {
+  escher::impl::CommandBufferSequencer sequencer;
+  ReleaseFenceSignaller release_fence_signaller(&sequencer);
+
+  // Three fences are released while the first command buffer is pending, and
+  // one more while the second is.
+  uint64_t seq_num1 = GenerateNextCommandBufferSequenceNumber(&sequencer);
+  mx::event fence1 = CreateFence();
+  mx::event fence2 = CreateFence();
+  mx::event fence3 = CreateFence();
+  auto fences = ::fidl::Array<mx::event>::New(0);
+  fences.push_back(CopyEvent(fence1));
+  fences.push_back(CopyEvent(fence2));
+  release_fence_signaller.AddCPUReleaseFences(std::move(fences));
+  release_fence_signaller.AddCPUReleaseFence(CopyEvent(fence3));
+
+  uint64_t seq_num2 = GenerateNextCommandBufferSequenceNumber(&sequencer);
+  mx::event fence4 = CreateFence();
+  release_fence_signaller.AddCPUReleaseFence(CopyEvent(fence4));
+  EXPECT_EQ(4u, release_fence_signaller.pending_fence_count());
+
+  CommandBufferFinished(&sequencer, seq_num1);
+  EXPECT_TRUE(IsEventSignalled(fence1, kFenceSignalled));
+  EXPECT_TRUE(IsEventSignalled(fence2, kFenceSignalled));
+  EXPECT_TRUE(IsEventSignalled(fence3, kFenceSignalled));
+  EXPECT_FALSE(IsEventSignalled(fence4, kFenceSignalled));
+  EXPECT_EQ(1u, release_fence_signaller.pending_fence_count());
+
+  CommandBufferFinished(&sequencer, seq_num2);
+  EXPECT_TRUE(IsEventSignalled(fence4, kFenceSignalled));
+  EXPECT_EQ(0u, release_fence_signaller.pending_fence_count());
+}
+
+TEST_F(ReleaseFenceSignallerTest, FencesAreSignalledAtOnceWhenIdle) {
+  escher::impl::CommandBufferSequencer sequencer;
+  ReleaseFenceSignaller release_fence_signaller(&sequencer);
+  CommandBufferFinished(&sequencer,
+                        GenerateNextCommandBufferSequenceNumber(&sequencer));
+
+  mx::event fence1 = CreateFence();
+  mx::event fence2 = CreateFence();
+  auto fences = ::fidl::Array<mx::event>::New(0);
+  fences.push_back(CopyEvent(fence1));
+  release_fence_signaller.AddCPUReleaseFences(std::move(fences));
+  release_fence_signaller.AddCPUReleaseFence(CopyEvent(fence2));
+  EXPECT_TRUE(IsEventSignalled(fence1, kFenceSignalled));
+  EXPECT_TRUE(IsEventSignalled(fence2, kFenceSignalled));
+  EXPECT_EQ(0u, release_fence_signaller.pending_fence_count());
+}
+
+TEST_F(ReleaseFenceSignallerTest, VulkanFencesWaitForCommandBuffers) {
+  escher::impl::CommandBufferSequencer sequencer;
+  ReleaseFenceSignaller release_fence_signaller(&sequencer);
+
+  uint64_t seq_num = GenerateNextCommandBufferSequenceNumber(&sequencer);
+  mx::event vulkan_fence = CreateFence();
+  mx::event cpu_fence = CreateFence();
+  release_fence_signaller.AddVulkanReleaseFence(CopyEvent(vulkan_fence));
+  release_fence_signaller.AddCPUReleaseFence(CopyEvent(cpu_fence));
+  EXPECT_FALSE(IsEventSignalled(vulkan_fence, kFenceSignalled));
+  EXPECT_EQ(2u, release_fence_signaller.pending_fence_count());
+
+  CommandBufferFinished(&sequencer, seq_num);
+  EXPECT_TRUE(IsEventSignalled(vulkan_fence, kFenceSignalled));
+  EXPECT_TRUE(IsEventSignalled(cpu_fence, kFenceSignalled));
+  EXPECT_EQ(0u, release_fence_signaller.pending_fence_count());
+
+  // With no CommandBuffer outstanding, the fence is signalled at once.
+  mx::event idle_fence = CreateFence();
+  release_fence_signaller.AddVulkanReleaseFence(CopyEvent(idle_fence));
+  EXPECT_TRUE(IsEventSignalled(idle_fence, kFenceSignalled));
+}
+
 }  // namespace test
 }  // namespace scene_manager
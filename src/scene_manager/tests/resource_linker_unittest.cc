@@ -3,7 +3,13 @@
 // found in the LICENSE file.
 
 #include "apps/mozart/src/scene_manager/resources/resource_linker.h"
+
+#include <algorithm>
+
+#include <magenta/syscalls.h>
+
 #include "apps/mozart/lib/scene/session_helpers.h"
+#include "apps/mozart/src/scene_manager/resources/import.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/entity_node.h"
 #include "apps/mozart/src/scene_manager/tests/session_test.h"
 #include "gtest/gtest.h"
@@ -228,5 +234,165 @@ TEST_F(ResourceLinkerTest, DuplicatedDestinationHandlesAllowMultipleImports) {
   ASSERT_EQ(kImportCount, resolution_count);
 }
 
+TEST_F(ResourceLinkerTest, BatchedImportsAreResolvedWhenBatchEnds) {
+  ResourceLinker linker;
+
+  mx::eventpair source, destination;
+  ASSERT_EQ(MX_OK, mx::eventpair::create(0, &source, &destination));
+  auto exported =
+      ftl::MakeRefCounted<EntityNode>(session_.get(), 1 /* resource id */);
+
+  bool did_resolve = false;
+  linker.BeginBatch();
+  ASSERT_TRUE(linker.ExportResource(exported, std::move(source)));
+  linker.ImportResource(
+      mozart2::ImportSpec::NODE, destination,
+      [exported, &did_resolve](ResourcePtr resource,
+                               ResourceLinker::ResolutionResult cause) {
+        did_resolve = true;
+        ASSERT_EQ(exported, resource);
+        ASSERT_EQ(ResourceLinker::ResolutionResult::kSuccess, cause);
+      });
+  ASSERT_FALSE(did_resolve);
+  ASSERT_EQ(1u, linker.UnresolvedImports());
+
+  linker.EndBatch();
+  ASSERT_TRUE(did_resolve);
+  ASSERT_EQ(0u, linker.UnresolvedImports());
+}
+
+// An Import which is released before the batch in which it was imported ends
+// must not be bound when the batch resolves it.
+TEST_F(ResourceLinkerTest, ImportReleasedDuringBatchIsNotBound) {
+  mx::eventpair source, destination;
+  ASSERT_EQ(MX_OK, mx::eventpair::create(0, &source, &destination));
+  auto exported =
+      ftl::MakeRefCounted<EntityNode>(session_.get(), 1 /* resource id */);
+
+  ResourceLinker& linker = engine_->GetResourceLinker();
+  linker.BeginBatch();
+  ASSERT_TRUE(engine_->ExportResource(exported, std::move(source)));
+  auto import = ftl::MakeRefCounted<Import>(
+      session_.get(), 2 /* resource id */, mozart2::ImportSpec::NODE,
+      std::move(destination));
+  engine_->ImportResource(import, mozart2::ImportSpec::NODE,
+                          import->import_token());
+  import = nullptr;
+  linker.EndBatch();
+
+  EXPECT_TRUE(exported->imports().empty());
+}
+
+// Resolving a mix of imports and exports in a batch must link exactly the
+// same resources as resolving them one at a time.
+TEST_F(ResourceLinkerTest, BatchedLinkingMatchesUnbatchedLinking) {
+  // Pair |i| is imported before it is exported if i % 4 == 0, exported before
+  // it is imported if i % 4 == 1, only exported if i % 4 == 2, and only
+  // imported if i % 4 == 3.
+  constexpr size_t kPairCount = 64;
+
+  struct Links {
+    std::vector<mozart::ResourceId> resolved_ids;
+    size_t unresolved_exports;
+    size_t unresolved_imports;
+  };
+  std::vector<mx::eventpair> import_handles;
+  import_handles.reserve(2 * kPairCount);
+  auto link = [this, &import_handles](ResourceLinker* linker, bool batched,
+                                      Links* links) {
+    links->resolved_ids.resize(kPairCount, 0u);
+
+    std::vector<ResourceLinker::ExportRequest> exports;
+    std::vector<ResourceLinker::ImportRequest> early_imports;
+    std::vector<ResourceLinker::ImportRequest> late_imports;
+    const size_t first_handle = import_handles.size();
+    import_handles.resize(first_handle + kPairCount);
+    for (size_t i = 0; i < kPairCount; ++i) {
+      mx::eventpair source;
+      mx::eventpair& destination = import_handles[first_handle + i];
+      EXPECT_EQ(MX_OK, mx::eventpair::create(0, &source, &destination));
+      if (i % 4 != 3) {
+        exports.push_back(
+            {ftl::MakeRefCounted<EntityNode>(session_.get(), i + 1),
+             std::move(source)});
+      }
+      if (i % 4 != 2) {
+        ResourceLinker::ImportRequest request{
+            mozart2::ImportSpec::NODE, &destination,
+            [links, i](ResourcePtr resource,
+                        ResourceLinker::ResolutionResult cause) {
+              if (resource &&
+                  cause == ResourceLinker::ResolutionResult::kSuccess)
+                links->resolved_ids[i] = resource->id();
+            }};
+        (i % 4 == 0 ? early_imports : late_imports)
+            .push_back(std::move(request));
+      }
+    }
+
+    if (batched) {
+      linker->BeginBatch();
+      linker->ImportResources(std::move(early_imports));
+      EXPECT_EQ(exports.size(), linker->ExportResources(std::move(exports)));
+      linker->ImportResources(std::move(late_imports));
+      EXPECT_TRUE(std::all_of(links->resolved_ids.begin(),
+                              links->resolved_ids.end(),
+                              [](mozart::ResourceId id) { return id == 0u; }));
+      linker->EndBatch();
+    } else {
+      for (auto& request : early_imports) {
+        linker->ImportResource(request.spec, *request.import_handle,
+                               std::move(request.import_resolved_callback));
+      }
+      for (auto& request : exports) {
+        EXPECT_TRUE(linker->ExportResource(std::move(request.resource),
+                                           std::move(request.export_handle)));
+      }
+      for (auto& request : late_imports) {
+        linker->ImportResource(request.spec, *request.import_handle,
+                               std::move(request.import_resolved_callback));
+      }
+    }
+
+    links->unresolved_exports = linker->UnresolvedExports();
+    links->unresolved_imports = linker->UnresolvedImports();
+  };
+
+  Links unbatched;
+  ResourceLinker unbatched_linker;
+  link(&unbatched_linker, false, &unbatched);
+  Links batched;
+  ResourceLinker batched_linker;
+  link(&batched_linker, true, &batched);
+
+  EXPECT_EQ(unbatched.resolved_ids, batched.resolved_ids);
+  EXPECT_EQ(unbatched.unresolved_exports, batched.unresolved_exports);
+  EXPECT_EQ(unbatched.unresolved_imports, batched.unresolved_imports);
+  for (size_t i = 0; i < kPairCount; ++i) {
+    EXPECT_EQ(i % 4 < 2 ? i + 1 : 0u, batched.resolved_ids[i]);
+  }
+  EXPECT_EQ(kPairCount * 3 / 4, batched.unresolved_exports);
+  EXPECT_EQ(kPairCount / 4, batched.unresolved_imports);
+
+  // Closing the import handles expires the exports of both linkers, whose
+  // WaitSets share a single waiter.
+  auto message_loop = mtl::MessageLoop::GetCurrent();
+  size_t expired_count = 0;
+  auto on_expired = [message_loop, &expired_count, &batched, &unbatched](
+      ResourcePtr resource, ResourceLinker::ExpirationCause cause) {
+    EXPECT_EQ(ResourceLinker::ExpirationCause::kImportHandleClosed, cause);
+    if (++expired_count ==
+        batched.unresolved_exports + unbatched.unresolved_exports)
+      message_loop->QuitNow();
+  };
+  unbatched_linker.SetOnExpiredCallback(on_expired);
+  batched_linker.SetOnExpiredCallback(on_expired);
+  import_handles.clear();
+  message_loop->Run();
+
+  EXPECT_EQ(0u, unbatched_linker.UnresolvedExports());
+  EXPECT_EQ(0u, batched_linker.UnresolvedExports());
+}
+
 }  // namespace test
 }  // namespace scene_manager
@@ -0,0 +1,69 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/engine/resource_reaper.h"
+
+#include "apps/mozart/lib/scene/session_helpers.h"
+#include "apps/mozart/src/scene_manager/tests/session_test.h"
+#include "gtest/gtest.h"
+
+namespace scene_manager {
+namespace test {
+
+class ResourceReaperTest : public SessionTest {
+ protected:
+  // Creates a chain of |count| EntityNodes, each the child of the previous
+  // one, and releases all of them except the root.
+  void CreateDeepTree(mozart::ResourceId count) {
+    for (mozart::ResourceId id = 1; id <= count; ++id) {
+      ASSERT_TRUE(Apply(mozart::NewCreateEntityNodeOp(id)));
+      if (id > 1) {
+        ASSERT_TRUE(Apply(mozart::NewAddChildOp(id - 1, id)));
+        ASSERT_TRUE(Apply(mozart::NewReleaseResourceOp(id)));
+      }
+    }
+  }
+};
+
+TEST_F(ResourceReaperTest, TearDownIsIncremental) {
+  constexpr mozart::ResourceId kNodeCount = 1000;
+  CreateDeepTree(kNodeCount);
+  EXPECT_EQ(kNodeCount, session_->GetTotalResourceCount());
+  EXPECT_EQ(1u, session_->GetMappedResourceCount());
+
+  // Nothing is destroyed until the reaper runs.
+  session_->TearDown();
+  ResourceReaper* reaper = engine_->resource_reaper();
+  EXPECT_FALSE(reaper->is_idle());
+  EXPECT_EQ(0u, session_->GetMappedResourceCount());
+  EXPECT_EQ(kNodeCount, session_->GetTotalResourceCount());
+
+  // With a deadline in the past, only a small batch of resources is destroyed,
+  // even though releasing the root would otherwise destroy the whole chain.
+  EXPECT_FALSE(reaper->ReapUntil(0u));
+  EXPECT_LT(0u, session_->GetTotalResourceCount());
+  EXPECT_GT(kNodeCount, session_->GetTotalResourceCount());
+
+  EXPECT_TRUE(reaper->ReapUntil(UINT64_MAX));
+  EXPECT_TRUE(reaper->is_idle());
+  EXPECT_EQ(0u, session_->GetTotalResourceCount());
+}
+
+TEST_F(ResourceReaperTest, PartsAreReaped) {
+  EXPECT_TRUE(Apply(mozart::NewCreateEntityNodeOp(1)));
+  EXPECT_TRUE(Apply(mozart::NewCreateShapeNodeOp(2)));
+  EXPECT_TRUE(Apply(mozart::NewCreateShapeNodeOp(3)));
+  EXPECT_TRUE(Apply(mozart::NewAddPartOp(1, 2)));
+  EXPECT_TRUE(Apply(mozart::NewAddChildOp(1, 3)));
+  EXPECT_TRUE(Apply(mozart::NewReleaseResourceOp(2)));
+  EXPECT_TRUE(Apply(mozart::NewReleaseResourceOp(3)));
+  EXPECT_EQ(3u, session_->GetTotalResourceCount());
+
+  session_->TearDown();
+  EXPECT_TRUE(engine_->resource_reaper()->ReapUntil(UINT64_MAX));
+  EXPECT_EQ(0u, session_->GetTotalResourceCount());
+}
+
+}  // namespace test
+}  // namespace scene_manager
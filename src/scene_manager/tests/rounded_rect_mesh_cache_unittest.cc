@@ -0,0 +1,64 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/engine/rounded_rect_mesh_cache.h"
+
+#include "apps/mozart/src/scene_manager/tests/escher_test_environment.h"
+#include "gtest/gtest.h"
+
+extern std::unique_ptr<scene_manager::test::EscherTestEnvironment> g_escher_env;
+
+namespace scene_manager {
+namespace test {
+
+TEST(RoundedRectMeshCacheTest, RectanglesOfTheSameShapeShareMeshes) {
+  escher::RoundedRectFactory factory(g_escher_env->escher());
+  RoundedRectMeshCache cache(&factory);
+
+  float scale_a, scale_b, scale_c;
+  auto mesh_a = cache.GetMesh(
+      escher::RoundedRectSpec(100.f, 50.f, 10.f, 10.f, 10.f, 10.f), &scale_a);
+  auto mesh_b = cache.GetMesh(
+      escher::RoundedRectSpec(200.f, 100.f, 20.f, 20.f, 20.f, 20.f), &scale_b);
+  auto mesh_c = cache.GetMesh(
+      escher::RoundedRectSpec(100.f, 50.f, 5.f, 10.f, 10.f, 10.f), &scale_c);
+
+  // Only the radii of the third rectangle are in different proportions.
+  EXPECT_EQ(mesh_a, mesh_b);
+  EXPECT_NE(mesh_a, mesh_c);
+  EXPECT_EQ(100.f, scale_a);
+  EXPECT_EQ(200.f, scale_b);
+  EXPECT_EQ(100.f, scale_c);
+  EXPECT_EQ(1u, cache.hit_count());
+  EXPECT_EQ(2u, cache.miss_count());
+  EXPECT_EQ(2u, cache.mesh_count());
+}
+
+TEST(RoundedRectMeshCacheTest, UnusedMeshesAreEvicted) {
+  escher::RoundedRectFactory factory(g_escher_env->escher());
+  RoundedRectMeshCache cache(&factory, 1u);
+
+  float scale;
+  auto mesh_a = cache.GetMesh(
+      escher::RoundedRectSpec(100.f, 50.f, 10.f, 10.f, 10.f, 10.f), &scale);
+  auto mesh_b = cache.GetMesh(
+      escher::RoundedRectSpec(100.f, 60.f, 10.f, 10.f, 10.f, 10.f), &scale);
+  auto mesh_c = cache.GetMesh(
+      escher::RoundedRectSpec(100.f, 70.f, 10.f, 10.f, 10.f, 10.f), &scale);
+  EXPECT_EQ(3u, cache.mesh_count());
+
+  // Meshes in use are kept, however many there are; of those which are not,
+  // only the most recently used is.
+  mesh_a = nullptr;
+  mesh_b = nullptr;
+  cache.GetMesh(
+      escher::RoundedRectSpec(100.f, 80.f, 10.f, 10.f, 10.f, 10.f), &scale);
+  EXPECT_EQ(3u, cache.mesh_count());
+  mesh_b = cache.GetMesh(
+      escher::RoundedRectSpec(100.f, 60.f, 10.f, 10.f, 10.f, 10.f), &scale);
+  EXPECT_EQ(1u, cache.hit_count());
+}
+
+}  // namespace test
+}  // namespace scene_manager
@@ -143,5 +143,26 @@ TEST_F(SceneManagerTest, AcquireAndReleaseFences) {
   RUN_MESSAGE_LOOP_UNTIL(IsFenceSignalled(release_fence));
 }
 
+TEST_F(SceneManagerTest, ClientsCannotClaimSystemPriority) {
+  mozart2::SessionPtr session;
+  manager_->CreateSession(session.NewRequest(), nullptr);
+  RUN_MESSAGE_LOOP_UNTIL(engine()->GetSessionCount() == 1);
+  auto handler = static_cast<SessionHandlerForTest*>(engine()->FindSession(1));
+
+  // Messages are handled in order, so once the Enqueue() has been processed
+  // so has the SetPriority() before it.
+  session->SetPriority(mozart2::SessionPriority::SYSTEM);
+  session->Enqueue(::fidl::Array<mozart2::OpPtr>::New(0));
+  RUN_MESSAGE_LOOP_UNTIL(handler->enqueue_count() == 1);
+  EXPECT_EQ(mozart2::SessionPriority::FOREGROUND,
+            handler->session()->priority());
+
+  session->SetPriority(mozart2::SessionPriority::BACKGROUND);
+  session->Enqueue(::fidl::Array<mozart2::OpPtr>::New(0));
+  RUN_MESSAGE_LOOP_UNTIL(handler->enqueue_count() == 2);
+  EXPECT_EQ(mozart2::SessionPriority::BACKGROUND,
+            handler->session()->priority());
+}
+
 }  // namespace test
 }  // namespace scene_manager
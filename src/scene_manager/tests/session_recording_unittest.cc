@@ -0,0 +1,168 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/engine/session_recording.h"
+
+#include "apps/mozart/lib/scene/session_helpers.h"
+#include "gtest/gtest.h"
+#include "lib/mtl/handles/object_info.h"
+
+namespace scene_manager {
+namespace test {
+
+using recording::Reader;
+using recording::RecordType;
+using recording::Writer;
+
+// Records the handles requested while decoding.
+class HandleFactoryForTest : public recording::HandleFactory {
+ public:
+  mx::eventpair CreateEventPair(uint64_t koid, uint64_t related_koid) override {
+    requested_koids.push_back(koid);
+    requested_related_koids.push_back(related_koid);
+    mx::eventpair a, b;
+    mx::eventpair::create(0, &a, &b);
+    return a;
+  }
+
+  mx::vmo CreateVmo(uint64_t size) override {
+    requested_vmo_sizes.push_back(size);
+    mx::vmo vmo;
+    mx::vmo::create(size, 0u, &vmo);
+    return vmo;
+  }
+
+  ::fidl::InterfaceRequest<mozart2::ImagePipe> CreateImagePipe() override {
+    mozart2::ImagePipePtr image_pipe;
+    return image_pipe.NewRequest();
+  }
+
+  std::vector<uint64_t> requested_koids;
+  std::vector<uint64_t> requested_related_koids;
+  std::vector<uint64_t> requested_vmo_sizes;
+};
+
+TEST(SessionRecordingTest, OpsWithoutHandlesRoundTrip) {
+  const float translation[3] = {1.f, 2.f, 3.f};
+  const float rotation[4] = {0.f, 0.f, 0.7071f, 0.7071f};
+  const float size[2] = {64.f, 32.f};
+
+  ::fidl::Array<mozart2::OpPtr> ops;
+  ops.push_back(mozart::NewCreateRoundedRectangleOp(1, 100.f, 50.f, 4.f, 5.f,
+                                                    6.f, 7.f));
+  ops.push_back(mozart::NewCreateVarCircleOp(2, 3));
+  ops.push_back(mozart::NewCreateEntityNodeOp(4));
+  ops.push_back(mozart::NewSetTranslationOp(4, translation));
+  ops.push_back(mozart::NewSetRotationOp(4, rotation));
+  ops.push_back(mozart::NewSetSizeOp(4, size));
+  ops.push_back(mozart::NewSetColorOp(5, 10, 20, 30, 40));
+  ops.push_back(mozart::NewSetClipOp(4, 0, true));
+  ops.push_back(mozart::NewSetLabelOp(4, "a label"));
+  ops.push_back(mozart::NewReleaseResourceOp(1));
+
+  Writer writer;
+  writer.WriteHeader(7u, 1234u);
+  writer.BeginRecord(RecordType::kEnqueue, 5678u);
+  writer.WriteUint32(ops.size());
+  for (auto& op : ops) {
+    writer.WriteOp(op);
+  }
+
+  HandleFactoryForTest handle_factory;
+  Reader reader(writer.data().data(), writer.data().size());
+  uint64_t session_id, start_time;
+  ASSERT_TRUE(reader.ReadHeader(&session_id, &start_time));
+  EXPECT_EQ(7u, session_id);
+  EXPECT_EQ(1234u, start_time);
+
+  RecordType type;
+  uint64_t timestamp;
+  uint32_t count;
+  ASSERT_TRUE(reader.ReadRecordHeader(&type, &timestamp));
+  EXPECT_EQ(RecordType::kEnqueue, type);
+  EXPECT_EQ(5678u, timestamp);
+  ASSERT_TRUE(reader.ReadUint32(&count));
+  ASSERT_EQ(ops.size(), count);
+  for (size_t i = 0; i < count; ++i) {
+    auto op = reader.ReadOp(&handle_factory);
+    ASSERT_TRUE(op);
+    EXPECT_TRUE(op->Equals(*ops[i])) << "op " << i;
+  }
+  EXPECT_TRUE(reader.at_end());
+}
+
+// The ops enqueued by the HostImageCycler and HostCanvasCycler, which must
+// not truncate their recordings.
+TEST(SessionRecordingTest, InvalidateImageOpsRoundTrip) {
+  ::fidl::Array<mozart2::ImageRectPtr> dirty_rects;
+  dirty_rects.push_back(mozart::NewImageRect(0, 0, 16, 8));
+  dirty_rects.push_back(mozart::NewImageRect(32, 4, 1, 1));
+
+  ::fidl::Array<mozart2::OpPtr> ops;
+  ops.push_back(mozart::NewInvalidateImageOp(3, std::move(dirty_rects)));
+  ops.push_back(mozart::NewInvalidateImageOp(3, nullptr));
+  ops.push_back(mozart::NewSetTextureOp(5, 3));
+
+  Writer writer;
+  for (auto& op : ops) {
+    writer.WriteOp(op);
+  }
+
+  HandleFactoryForTest handle_factory;
+  Reader reader(writer.data().data(), writer.data().size());
+  for (size_t i = 0; i < ops.size(); ++i) {
+    auto op = reader.ReadOp(&handle_factory);
+    ASSERT_TRUE(op) << "op " << i;
+    EXPECT_TRUE(op->Equals(*ops[i])) << "op " << i;
+  }
+  EXPECT_TRUE(reader.at_end());
+}
+
+TEST(SessionRecordingTest, HandlesAreReplacedByKoids) {
+  mx::eventpair import_token;
+  auto export_op = mozart::NewExportResourceOpAsRequest(1, &import_token);
+  mx::vmo vmo;
+  ASSERT_EQ(MX_OK, mx::vmo::create(4096, 0u, &vmo));
+  auto memory_op = mozart::NewCreateMemoryOp(2, std::move(vmo),
+                                             mozart2::MemoryType::HOST_MEMORY);
+
+  Writer writer;
+  writer.WriteOp(export_op);
+  writer.WriteOp(memory_op);
+
+  HandleFactoryForTest handle_factory;
+  Reader reader(writer.data().data(), writer.data().size());
+  auto decoded_export = reader.ReadOp(&handle_factory);
+  auto decoded_memory = reader.ReadOp(&handle_factory);
+  ASSERT_TRUE(decoded_export);
+  ASSERT_TRUE(decoded_memory);
+
+  ASSERT_EQ(1u, handle_factory.requested_koids.size());
+  EXPECT_EQ(mtl::GetRelatedKoid(import_token.get()),
+            handle_factory.requested_koids[0]);
+  EXPECT_EQ(mtl::GetKoid(import_token.get()),
+            handle_factory.requested_related_koids[0]);
+  EXPECT_TRUE(decoded_export->get_export_resource()->token);
+
+  ASSERT_EQ(1u, handle_factory.requested_vmo_sizes.size());
+  EXPECT_EQ(4096u, handle_factory.requested_vmo_sizes[0]);
+  EXPECT_EQ(mozart2::MemoryType::HOST_MEMORY,
+            decoded_memory->get_create_resource()
+                ->resource->get_memory()
+                ->memory_type);
+}
+
+TEST(SessionRecordingTest, TruncatedRecordFailsGracefully) {
+  Writer writer;
+  writer.WriteOp(mozart::NewCreateCircleOp(1, 50.f));
+
+  HandleFactoryForTest handle_factory;
+  for (size_t size = 0; size < writer.data().size(); ++size) {
+    Reader reader(writer.data().data(), size);
+    EXPECT_FALSE(reader.ReadOp(&handle_factory));
+  }
+}
+
+}  // namespace test
+}  // namespace scene_manager
@@ -2,11 +2,20 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <cmath>
+
 #include "apps/mozart/lib/scene/session_helpers.h"
+#include "apps/mozart/lib/tests/test_with_message_loop.h"
+#include "apps/mozart/src/scene_manager/displays/vsync_source.h"
+#include "apps/mozart/src/scene_manager/engine/frame_timer.h"
+#include "apps/mozart/src/scene_manager/engine/session_command.h"
+#include "apps/mozart/src/scene_manager/fence.h"
 #include "apps/mozart/src/scene_manager/resources/material.h"
 #include "apps/mozart/src/scene_manager/resources/nodes/shape_node.h"
 #include "apps/mozart/src/scene_manager/resources/shapes/circle_shape.h"
+#include "apps/mozart/src/scene_manager/tests/mocks.h"
 #include "apps/mozart/src/scene_manager/tests/session_test.h"
+#include "apps/mozart/src/scene_manager/tests/util.h"
 
 #include "gtest/gtest.h"
 
@@ -73,6 +82,341 @@ TEST_F(SessionTest, Labeling) {
             shape_node->label());
 }
 
+TEST_F(SessionTest, OpsAreDecoded) {
+  const float kTranslation[3] = {1.f, 2.f, 3.f};
+  SessionCommand translation;
+  EXPECT_TRUE(DecodeOp(mozart::NewSetTranslationOp(7, kTranslation),
+                       &translation, this));
+  EXPECT_EQ(mozart2::Op::Tag::SET_TRANSLATION, translation.tag);
+  EXPECT_EQ(7u, translation.ids[0]);
+  EXPECT_EQ(escher::vec3(1.f, 2.f, 3.f), escher::vec3(translation.vector));
+  EXPECT_FALSE(translation.op);
+
+  SessionCommand color;
+  EXPECT_TRUE(
+      DecodeOp(mozart::NewSetColorOp(8, 255, 0, 255, 0), &color, this));
+  EXPECT_EQ(8u, color.ids[0]);
+  EXPECT_EQ(escher::vec4(1.f, 0.f, 1.f, 0.f), color.vector);
+
+  SessionCommand clip;
+  EXPECT_TRUE(DecodeOp(mozart::NewSetClipOp(1, 2, true), &clip, this));
+  EXPECT_EQ(1u, clip.ids[0]);
+  EXPECT_EQ(2u, clip.ids[1]);
+  EXPECT_EQ(1u, clip.value);
+
+  // Ops which carry handles or strings keep their FIDL form.
+  SessionCommand label;
+  EXPECT_TRUE(DecodeOp(mozart::NewSetLabelOp(9, "label"), &label, this));
+  EXPECT_TRUE(label.op);
+  ExpectLastReportedError(nullptr);
+}
+
+TEST_F(SessionTest, InvalidOpsAreRejectedByDecoding) {
+  SessionCommand command;
+  EXPECT_FALSE(DecodeOp(mozart::NewCreateVarCircleOp(1, 2), &command, this));
+  ExpectLastReportedError(
+      "scene_manager::Session::ApplyCreateCircle(): unimplemented: variable "
+      "radius.");
+
+  // Decoding happens before anything is applied, so the session is unchanged.
+  EXPECT_FALSE(Apply(mozart::NewCreateVarCircleOp(1, 2)));
+  EXPECT_EQ(0u, session_->GetTotalResourceCount());
+}
+
+// Updates presented more often than the session's maximum update rate are
+// deferred, rather than dropped or applied early.
+TEST_F(SessionTest, MaxUpdateRateDefersUpdates) {
+  constexpr uint64_t kMillisecond = 1'000'000;
+  std::vector<uint64_t> presentation_times;
+  auto present = [this, &presentation_times](uint64_t presentation_time) {
+    session_->ScheduleUpdate(
+        presentation_time, std::vector<SessionCommand>(),
+        ::fidl::Array<mx::event>::New(0), ::fidl::Array<mx::event>::New(0),
+        [&presentation_times](mozart2::PresentationInfoPtr info) {
+          presentation_times.push_back(info->presentation_time);
+        });
+  };
+
+  session_->SetMaxUpdateRate(10.f);
+  present(1000 * kMillisecond);
+  present(1010 * kMillisecond);
+  present(1250 * kMillisecond);
+  session_->SetMaxUpdateRate(0.f);
+  present(1260 * kMillisecond);
+  EXPECT_EQ((std::vector<uint64_t>{1000 * kMillisecond, 1100 * kMillisecond,
+                                   1250 * kMillisecond, 1260 * kMillisecond}),
+            presentation_times);
+  ExpectLastReportedError(nullptr);
+}
+
+// Rates so low that the interval between updates would be very long are
+// clamped, and negative or NaN rates are rejected.
+TEST_F(SessionTest, MaxUpdateRateIsClamped) {
+  constexpr uint64_t kMillisecond = 1'000'000;
+  std::vector<uint64_t> presentation_times;
+  auto present = [this, &presentation_times](uint64_t presentation_time) {
+    session_->ScheduleUpdate(
+        presentation_time, std::vector<SessionCommand>(),
+        ::fidl::Array<mx::event>::New(0), ::fidl::Array<mx::event>::New(0),
+        [&presentation_times](mozart2::PresentationInfoPtr info) {
+          presentation_times.push_back(info->presentation_time);
+        });
+  };
+
+  session_->SetMaxUpdateRate(1e-30f);
+  present(1000 * kMillisecond);
+  present(1010 * kMillisecond);
+  EXPECT_EQ((std::vector<uint64_t>{1000 * kMillisecond,
+                                   1000 * kMillisecond +
+                                       Session::kMaxUpdateInterval}),
+            presentation_times);
+  ExpectLastReportedError(nullptr);
+
+  // The previous limit still applies after an invalid rate.
+  session_->SetMaxUpdateRate(-1.f);
+  ExpectLastReportedError(
+      "scene_manager::Session::SetMaxUpdateRate(): the rate must not be "
+      "negative.");
+  session_->SetMaxUpdateRate(std::nanf(""));
+  ExpectLastReportedError(
+      "scene_manager::Session::SetMaxUpdateRate(): the rate must not be "
+      "negative.");
+  present(0u);
+  EXPECT_EQ(1000 * kMillisecond + 2 * Session::kMaxUpdateInterval,
+            presentation_times.back());
+
+  // The earliest time for the next update saturates, rather than wrapping
+  // around to a time before the last update.
+  session_->SetMaxUpdateRate(10.f);
+  present(UINT64_MAX - kMillisecond);
+  present(0u);
+  EXPECT_EQ(UINT64_MAX, presentation_times.back());
+}
+
+// Renders frames through a FrameScheduler, rather than applying each update
+// as soon as it is presented.  The FrameScheduler runs in virtual time, with a
+// vsync at every multiple of |kVsyncInterval|; frames are only rendered when
+// the test runs the tasks of |timer_|.
+class SessionWithFrameSchedulerTest : public SessionTest {
+ public:
+  static constexpr uint64_t kVsyncInterval = 16'666'667;
+
+  std::unique_ptr<Engine> CreateEngine() override {
+    display_manager_.SetDefaultDisplayForTests(std::make_unique<Display>(
+        1280, 800, 1.f,
+        std::make_unique<SimulatedVsyncSource>(0u, kVsyncInterval)));
+    auto timer = std::make_unique<VirtualFrameTimer>();
+    timer_ = timer.get();
+    return std::make_unique<EngineForTest>(&display_manager_, nullptr,
+                                           std::move(timer));
+  }
+
+ protected:
+  // The first vsync after the current virtual time.
+  uint64_t NextVsyncTime() const {
+    return (timer_->Now() / kVsyncInterval + 1) * kVsyncInterval;
+  }
+
+  // Runs the FrameScheduler until |condition| holds, or there is nothing
+  // left for it to do.
+  template <typename Condition>
+  bool RunFramesUntil(Condition condition) {
+    while (!condition() && timer_->RunNextTask()) {
+    }
+    return condition();
+  }
+
+  VirtualFrameTimer* timer_ = nullptr;
+};
+
+constexpr uint64_t SessionWithFrameSchedulerTest::kVsyncInterval;
+
+// Updates without acquire fences, or whose fences have already been signalled,
+// are scheduled within Present() itself, without a trip through the message
+// loop, and so are presented at the next vsync.  The others are scheduled
+// once their fences are signalled, and presented at the following vsync.
+TEST_F(SessionWithFrameSchedulerTest, PresentLatency) {
+  uint64_t presentation_time = 0;
+  auto present = [this, &presentation_time](
+      ::fidl::Array<mx::event> acquire_fences) {
+    presentation_time = 0;
+    session_->ScheduleUpdate(
+        0u, std::vector<SessionCommand>(), std::move(acquire_fences),
+        ::fidl::Array<mx::event>::New(0),
+        [&presentation_time](mozart2::PresentationInfoPtr info) {
+          presentation_time = info->presentation_time;
+        });
+  };
+
+  // No fences.
+  timer_->Advance(kVsyncInterval / 2);
+  uint64_t expected_time = NextVsyncTime();
+  present(::fidl::Array<mx::event>::New(0));
+  EXPECT_EQ(1u, timer_->pending_task_count());
+  ASSERT_TRUE(RunFramesUntil([&] { return presentation_time != 0; }));
+  EXPECT_EQ(expected_time, presentation_time);
+
+  // A fence which has already been signalled.
+  mx::event fence;
+  ASSERT_EQ(MX_OK, mx::event::create(0, &fence));
+  fence.signal(0u, kFenceSignalled);
+  auto acquire_fences = ::fidl::Array<mx::event>::New(0);
+  acquire_fences.push_back(CopyEvent(fence));
+  timer_->Advance(kVsyncInterval / 2);
+  expected_time = NextVsyncTime();
+  present(std::move(acquire_fences));
+  EXPECT_EQ(1u, timer_->pending_task_count());
+  ASSERT_TRUE(RunFramesUntil([&] { return presentation_time != 0; }));
+  EXPECT_EQ(expected_time, presentation_time);
+
+  // A fence which is signalled a vsync after Present().
+  ASSERT_EQ(MX_OK, mx::event::create(0, &fence));
+  acquire_fences = ::fidl::Array<mx::event>::New(0);
+  acquire_fences.push_back(CopyEvent(fence));
+  timer_->Advance(kVsyncInterval / 2);
+  present(std::move(acquire_fences));
+  EXPECT_EQ(0u, timer_->pending_task_count());
+  timer_->Advance(kVsyncInterval);
+  expected_time = NextVsyncTime();
+  fence.signal(0u, kFenceSignalled);
+  RUN_MESSAGE_LOOP_UNTIL(timer_->pending_task_count() == 1u);
+  ASSERT_TRUE(RunFramesUntil([&] { return presentation_time != 0; }));
+  EXPECT_EQ(expected_time, presentation_time);
+  ExpectLastReportedError(nullptr);
+}
+
+// The due updates of a session which would not fit in what remains of a
+// frame's budget are deferred whole to a later frame, unless it is a SYSTEM
+// session, while those of sessions which do fit are applied meanwhile.  In
+// virtual time applying commands takes no time, so only their estimated cost
+// counts against the budget.
+TEST_F(SessionWithFrameSchedulerTest, UpdatesOverBudgetAreDeferred) {
+  constexpr uint64_t kBudget = 1'000'000;
+  engine_->set_session_update_budget(kBudget);
+  engine_->set_session_command_cost(kBudget / 2);
+  auto system = ftl::MakeRefCounted<Session>(2, engine_.get(), this);
+  system->set_priority(mozart2::SessionPriority::SYSTEM);
+  auto large = ftl::MakeRefCounted<Session>(3, engine_.get(), this);
+  auto background = ftl::MakeRefCounted<Session>(4, engine_.get(), this);
+  background->set_priority(mozart2::SessionPriority::BACKGROUND);
+
+  auto present = [this](const SessionPtr& session, size_t command_count,
+                        uint64_t* presentation_time) {
+    std::vector<SessionCommand> commands(command_count);
+    for (size_t i = 0; i < command_count; ++i) {
+      EXPECT_TRUE(
+          DecodeOp(mozart::NewCreateEntityNodeOp(i + 1), &commands[i], this));
+    }
+    session->ScheduleUpdate(
+        0u, std::move(commands), ::fidl::Array<mx::event>::New(0),
+        ::fidl::Array<mx::event>::New(0),
+        [presentation_time](mozart2::PresentationInfoPtr info) {
+          *presentation_time = info->presentation_time;
+        });
+  };
+  uint64_t small_time = 0;
+  uint64_t large_time = 0;
+  uint64_t background_time = 0;
+  uint64_t system_time = 0;
+  present(session_, 1, &small_time);
+  present(large, 3, &large_time);
+  present(background, 2, &background_time);
+  present(system, 3, &system_time);
+  ASSERT_TRUE(RunFramesUntil([&] {
+    return small_time && large_time && background_time && system_time;
+  }));
+
+  // The SYSTEM session's updates are applied at once, although they exceed
+  // the budget on their own.  In each later frame, the sessions whose updates
+  // fit are applied, until the large update is the only one left.
+  EXPECT_EQ(system_time + kVsyncInterval, small_time);
+  EXPECT_EQ(system_time + 2 * kVsyncInterval, background_time);
+  EXPECT_EQ(system_time + 3 * kVsyncInterval, large_time);
+  EXPECT_EQ(0u, system->deferral_count());
+  EXPECT_EQ(1u, session_->deferral_count());
+  EXPECT_EQ(2u, background->deferral_count());
+  EXPECT_EQ(3u, large->deferral_count());
+  EXPECT_EQ(0u, large->consecutive_deferral_count());
+  ExpectLastReportedError(nullptr);
+  system->TearDown();
+  large->TearDown();
+  background->TearDown();
+}
+
+// A session is not deferred for more than kMaxConsecutiveSessionDeferrals
+// frames in a row, even if other sessions' updates keep filling the budget.
+TEST_F(SessionWithFrameSchedulerTest, DeferredUpdatesAreNotStarved) {
+  engine_->set_session_update_budget(1u);
+  engine_->set_session_command_cost(1u);
+  auto starved = ftl::MakeRefCounted<Session>(2, engine_.get(), this);
+
+  uint64_t starved_time = 0;
+  session_->set_priority(mozart2::SessionPriority::SYSTEM);
+  std::vector<SessionCommand> commands(2);
+  EXPECT_TRUE(DecodeOp(mozart::NewCreateEntityNodeOp(1), &commands[0], this));
+  EXPECT_TRUE(DecodeOp(mozart::NewCreateEntityNodeOp(2), &commands[1], this));
+  starved->ScheduleUpdate(
+      0u, std::move(commands), ::fidl::Array<mx::event>::New(0),
+      ::fidl::Array<mx::event>::New(0),
+      [&starved_time](mozart2::PresentationInfoPtr info) {
+        starved_time = info->presentation_time;
+      });
+
+  // The SYSTEM session presents an update in every frame, which the starved
+  // session's updates never fit beside.
+  bool presented = false;
+  for (uint32_t frame = 0; !starved_time && frame < 10; ++frame) {
+    presented = false;
+    session_->ScheduleUpdate(
+        0u, std::vector<SessionCommand>(), ::fidl::Array<mx::event>::New(0),
+        ::fidl::Array<mx::event>::New(0),
+        [&presented](mozart2::PresentationInfoPtr) { presented = true; });
+    ASSERT_TRUE(RunFramesUntil([&presented] { return presented; }));
+  }
+
+  EXPECT_NE(0u, starved_time);
+  EXPECT_EQ(Engine::kMaxConsecutiveSessionDeferrals,
+            starved->deferral_count());
+  ExpectLastReportedError(nullptr);
+  starved->TearDown();
+}
+
+// A session which presents again as soon as each update takes effect causes a
+// frame to be rendered at every vsync; limiting its update rate reduces the
+// number of frames rendered, and so the work done by the scene manager, in
+// proportion.
+TEST_F(SessionWithFrameSchedulerTest, MaxUpdateRateReducesFramesRendered) {
+  constexpr uint64_t kSecond = 1'000'000'000;
+  bool presented = false;
+  auto count_frames_in_one_second = [this, &presented] {
+    // Let any update presented at the previous rate take effect first.
+    RunFramesUntil([&presented] { return !presented; });
+    const uint64_t end_time = timer_->Now() + kSecond;
+    const uint64_t frame_count = engine_->frame_statistics().frame_count;
+    while (timer_->Now() < end_time) {
+      if (!presented) {
+        presented = true;
+        session_->ScheduleUpdate(
+            0u, std::vector<SessionCommand>(),
+            ::fidl::Array<mx::event>::New(0), ::fidl::Array<mx::event>::New(0),
+            [&presented](mozart2::PresentationInfoPtr) {
+              presented = false;
+            });
+      }
+      if (!timer_->RunNextTask())
+        break;
+    }
+    return engine_->frame_statistics().frame_count - frame_count;
+  };
+
+  EXPECT_NEAR(60.0, count_frames_in_one_second(), 1.0);
+  session_->SetMaxUpdateRate(10.f);
+  EXPECT_NEAR(10.0, count_frames_in_one_second(), 1.0);
+  session_->SetMaxUpdateRate(0.f);
+  EXPECT_NEAR(60.0, count_frames_in_one_second(), 1.0);
+  ExpectLastReportedError(nullptr);
+}
+
 // TODO:
 // - test that FindResource() cannot return resources that have the wrong type.
 
@@ -0,0 +1,70 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/util/viewport_layout.h"
+
+#include "gtest/gtest.h"
+
+namespace scene_manager {
+namespace test {
+
+const escher::vec2 kOutputSize(1024.f, 768.f);
+
+LayerViewport MakeViewport(float x,
+                           float y,
+                           float width,
+                           float height,
+                           bool orthographic) {
+  LayerViewport viewport;
+  viewport.rect = {escher::vec2(x, y), escher::vec2(x + width, y + height)};
+  viewport.orthographic = orthographic;
+  return viewport;
+}
+
+TEST(ViewportLayoutTest, SplitScreen) {
+  // Side-by-side layers are both drawn into their own half of the output.
+  EXPECT_EQ((std::vector<bool>{true, true}),
+            FindLayersDrawnInViewports(
+                {MakeViewport(0.f, 0.f, 512.f, 768.f, true),
+                 MakeViewport(512.f, 0.f, 512.f, 768.f, true)},
+                kOutputSize));
+
+  // Only orthographic layers can be moved into part of the output.
+  EXPECT_EQ((std::vector<bool>{true, false}),
+            FindLayersDrawnInViewports(
+                {MakeViewport(0.f, 0.f, 512.f, 768.f, true),
+                 MakeViewport(512.f, 0.f, 512.f, 768.f, false)},
+                kOutputSize));
+}
+
+TEST(ViewportLayoutTest, PictureInPicture) {
+  // A full-screen layer may use any camera; the picture on top of it must be
+  // composited from a texture.
+  EXPECT_EQ((std::vector<bool>{true, false}),
+            FindLayersDrawnInViewports(
+                {MakeViewport(0.f, 0.f, 1024.f, 768.f, false),
+                 MakeViewport(700.f, 500.f, 300.f, 200.f, true)},
+                kOutputSize));
+
+  // A layer which does not overlap the texture below it can still be drawn
+  // into its viewport, but one which does cannot, since it would be drawn
+  // beneath the texture.
+  EXPECT_EQ((std::vector<bool>{false, true, false}),
+            FindLayersDrawnInViewports(
+                {MakeViewport(0.f, 0.f, 512.f, 384.f, false),
+                 MakeViewport(512.f, 0.f, 512.f, 384.f, true),
+                 MakeViewport(256.f, 192.f, 512.f, 384.f, true)},
+                kOutputSize));
+}
+
+TEST(ViewportLayoutTest, LayersOutsideTheOutput) {
+  EXPECT_EQ((std::vector<bool>{false, false}),
+            FindLayersDrawnInViewports(
+                {MakeViewport(900.f, 0.f, 512.f, 768.f, true),
+                 MakeViewport(0.f, 0.f, 2048.f, 1536.f, true)},
+                kOutputSize));
+}
+
+}  // namespace test
+}  // namespace scene_manager
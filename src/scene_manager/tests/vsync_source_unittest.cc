@@ -0,0 +1,100 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/displays/vsync_source.h"
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+namespace scene_manager {
+namespace test {
+
+constexpr uint64_t kNominalInterval = 16'666'667;  // 60Hz
+
+// Reports |count| vsyncs, |interval| apart from |start|, with uniformly
+// distributed jitter of up to |jitter|, to |source|.  Returns the time of the
+// last vsync, without jitter.
+double ReportVsyncs(MeasuredVsyncSource* source,
+                    double start,
+                    double interval,
+                    double jitter,
+                    int count,
+                    std::mt19937* random) {
+  std::uniform_real_distribution<double> noise(-jitter, jitter);
+  double vsync = start;
+  for (int i = 0; i < count; ++i) {
+    vsync = start + i * interval;
+    source->AddVsyncTimestamp(static_cast<uint64_t>(vsync + noise(*random)));
+  }
+  return vsync;
+}
+
+TEST(VsyncSourceTest, SimulatedVsyncs) {
+  SimulatedVsyncSource source(1000, 100);
+  EXPECT_EQ(100u, source.GetVsyncInterval());
+  EXPECT_EQ(1000u, source.GetLastVsyncTime(1000));
+  EXPECT_EQ(1000u, source.GetLastVsyncTime(1099));
+  EXPECT_EQ(1100u, source.GetLastVsyncTime(1100));
+  EXPECT_EQ(1500u, source.GetLastVsyncTime(1550));
+}
+
+TEST(VsyncSourceTest, MeasuredSourceCorrectsDrift) {
+  // Before any vsync is reported, the nominal timing is used.
+  MeasuredVsyncSource source(1'000'000'000, kNominalInterval);
+  EXPECT_EQ(kNominalInterval, source.GetVsyncInterval());
+  EXPECT_EQ(1'000'000'000u + kNominalInterval,
+            source.GetLastVsyncTime(1'000'000'000 + kNominalInterval + 5));
+
+  // The display actually refreshes slightly slower, with jitter of 0.5ms.
+  std::mt19937 random(1234);
+  const double kActualInterval = 16'700'000.0;
+  const double last_vsync = ReportVsyncs(&source, 2'000'000'000.0,
+                                         kActualInterval, 500'000.0, 1000,
+                                         &random);
+  EXPECT_NEAR(kActualInterval, source.interval(), 10'000.0);
+
+  // Predictions stay close to the actual vsyncs after the last report.
+  const double later_vsync = last_vsync + 10 * kActualInterval;
+  EXPECT_NEAR(later_vsync,
+              static_cast<double>(source.GetLastVsyncTime(
+                  static_cast<uint64_t>(later_vsync + 1'000'000.0))),
+              300'000.0);
+
+  const VsyncStatistics statistics = source.GetStatistics();
+  EXPECT_EQ(1000u, statistics.sample_count);
+  EXPECT_EQ(0u, statistics.rejected_sample_count);
+  EXPECT_EQ(0u, statistics.resync_count);
+  EXPECT_GT(statistics.mean_error_nanos, 100'000.0);
+  EXPECT_LT(statistics.mean_error_nanos, 500'000.0);
+  EXPECT_LE(statistics.max_error_nanos, 1'000'000.0);
+}
+
+TEST(VsyncSourceTest, MeasuredSourceSkipsMissedAndSpuriousVsyncs) {
+  MeasuredVsyncSource source(0, kNominalInterval);
+  std::mt19937 random(1234);
+  ReportVsyncs(&source, 1'000'000'000.0, kNominalInterval, 0.0, 10, &random);
+
+  // Vsyncs which are not reported do not disturb the estimate, and nor do
+  // isolated timestamps far from any vsync.
+  const double start = 1'000'000'000.0 + 20 * kNominalInterval;
+  source.AddVsyncTimestamp(static_cast<uint64_t>(start - 8'000'000.0));
+  ReportVsyncs(&source, start, 3.0 * kNominalInterval, 0.0, 10, &random);
+  EXPECT_NEAR(kNominalInterval, source.interval(), 1.0);
+  EXPECT_EQ(1u, source.GetStatistics().rejected_sample_count);
+  EXPECT_EQ(0u, source.GetStatistics().resync_count);
+}
+
+TEST(VsyncSourceTest, MeasuredSourceFollowsRefreshRateChange) {
+  // The display refreshes at 50Hz, not the nominal 60Hz.
+  MeasuredVsyncSource source(0, kNominalInterval);
+  std::mt19937 random(1234);
+  ReportVsyncs(&source, 1'000'000'000.0, 20'000'000.0, 200'000.0, 500,
+               &random);
+  EXPECT_NEAR(20'000'000.0, source.interval(), 20'000.0);
+  EXPECT_GE(source.GetStatistics().resync_count, 1u);
+}
+
+}  // namespace test
+}  // namespace scene_manager
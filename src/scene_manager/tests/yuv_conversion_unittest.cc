@@ -0,0 +1,123 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/util/yuv_conversion.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace scene_manager {
+namespace test {
+
+// Converts a single 2x2 NV12 block of uniform color.
+std::vector<uint8_t> ConvertUniformNv12(uint8_t y, uint8_t u, uint8_t v) {
+  std::vector<uint8_t> y_plane(4, y);
+  std::vector<uint8_t> uv_plane = {u, v};
+  std::vector<uint8_t> bgra(16);
+  ConvertNv12ToBgra(y_plane.data(), 2, uv_plane.data(), 2, 2, 2, bgra.data(),
+                    8);
+  return std::vector<uint8_t>(bgra.begin(), bgra.begin() + 4);
+}
+
+// The YUV values of colors are themselves rounded, so allow for an error of a
+// couple of steps.
+void ExpectColorNear(const std::vector<uint8_t>& expected,
+                     const std::vector<uint8_t>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i)
+    EXPECT_NEAR(expected[i], actual[i], 2) << "channel " << i;
+}
+
+TEST(YuvConversionTest, ConvertsKnownColors) {
+  // Black and white are exact, and the largest values saturate.
+  EXPECT_EQ((std::vector<uint8_t>{0, 0, 0, 255}),
+            ConvertUniformNv12(16, 128, 128));
+  EXPECT_EQ((std::vector<uint8_t>{255, 255, 255, 255}),
+            ConvertUniformNv12(235, 128, 128));
+  EXPECT_EQ((std::vector<uint8_t>{255, 255, 255, 255}),
+            ConvertUniformNv12(255, 128, 128));
+  // Red, green and blue, in BGRA order.
+  ExpectColorNear({0, 0, 255, 255}, ConvertUniformNv12(81, 90, 240));
+  ExpectColorNear({0, 255, 0, 255}, ConvertUniformNv12(145, 54, 34));
+  ExpectColorNear({255, 0, 0, 255}, ConvertUniformNv12(41, 240, 110));
+}
+
+// Rows of every even width up to 40 cover both the vectorized path, where it
+// exists, and the scalar remainder of each row.  Strides are padded, so that
+// rows which are read or written in the wrong place show up.
+TEST(YuvConversionTest, Nv12AndI420Agree) {
+  const uint32_t kHeight = 4;
+  for (uint32_t width = 2; width <= 40; width += 2) {
+    const uint32_t y_stride = width + 6;
+    const uint32_t uv_stride = width + 4;
+    const uint32_t i420_stride = width / 2 + 3;
+    std::vector<uint8_t> y_plane(y_stride * kHeight);
+    std::vector<uint8_t> uv_plane(uv_stride * kHeight / 2);
+    std::vector<uint8_t> u_plane(i420_stride * kHeight / 2);
+    std::vector<uint8_t> v_plane(i420_stride * kHeight / 2);
+    for (size_t i = 0; i < y_plane.size(); ++i)
+      y_plane[i] = static_cast<uint8_t>(i * 37 + width);
+    for (uint32_t row = 0; row < kHeight / 2; ++row) {
+      for (uint32_t x = 0; x < width / 2; ++x) {
+        uint8_t u = static_cast<uint8_t>(x * 53 + row * 11 + 7);
+        uint8_t v = static_cast<uint8_t>(x * 29 + row * 71 + 200);
+        uv_plane[row * uv_stride + 2 * x] = u;
+        uv_plane[row * uv_stride + 2 * x + 1] = v;
+        u_plane[row * i420_stride + x] = u;
+        v_plane[row * i420_stride + x] = v;
+      }
+    }
+
+    const uint32_t bgra_stride = width * 4 + 8;
+    std::vector<uint8_t> nv12_bgra(bgra_stride * kHeight, 0xab);
+    std::vector<uint8_t> i420_bgra(bgra_stride * kHeight, 0xab);
+    ConvertNv12ToBgra(y_plane.data(), y_stride, uv_plane.data(), uv_stride,
+                      width, kHeight, nv12_bgra.data(), bgra_stride);
+    ConvertI420ToBgra(y_plane.data(), y_stride, u_plane.data(), v_plane.data(),
+                      i420_stride, width, kHeight, i420_bgra.data(),
+                      bgra_stride);
+    EXPECT_EQ(nv12_bgra, i420_bgra) << "width " << width;
+
+    for (uint32_t row = 0; row < kHeight; ++row) {
+      const uint8_t* pixels = &nv12_bgra[row * bgra_stride];
+      // Every pixel is opaque, and the padding is untouched.
+      for (uint32_t x = 0; x < width; ++x)
+        EXPECT_EQ(255, pixels[4 * x + 3]);
+      EXPECT_TRUE(std::all_of(pixels + width * 4, pixels + bgra_stride,
+                              [](uint8_t byte) { return byte == 0xab; }));
+    }
+  }
+}
+
+// The vectorized and scalar paths agree: a row of 16 pixels gives the same
+// result as the same pixels converted in 2x2 blocks.
+TEST(YuvConversionTest, WideRowsMatchSmallBlocks) {
+  const uint32_t kWidth = 16;
+  std::vector<uint8_t> y_plane(kWidth * 2);
+  std::vector<uint8_t> uv_plane(kWidth);
+  for (size_t i = 0; i < y_plane.size(); ++i)
+    y_plane[i] = static_cast<uint8_t>(i * 16 + 3);
+  for (size_t i = 0; i < uv_plane.size(); ++i)
+    uv_plane[i] = static_cast<uint8_t>(255 - i * 17);
+
+  std::vector<uint8_t> row_bgra(kWidth * 4 * 2);
+  ConvertNv12ToBgra(y_plane.data(), kWidth, uv_plane.data(), kWidth, kWidth, 2,
+                    row_bgra.data(), kWidth * 4);
+  for (uint32_t x = 0; x < kWidth; x += 2) {
+    std::vector<uint8_t> block_bgra(16);
+    ConvertNv12ToBgra(&y_plane[x], kWidth, &uv_plane[x], kWidth, 2, 2,
+                      block_bgra.data(), 8);
+    for (uint32_t row = 0; row < 2; ++row) {
+      EXPECT_TRUE(std::equal(block_bgra.begin() + row * 8,
+                             block_bgra.begin() + row * 8 + 8,
+                             row_bgra.begin() + row * kWidth * 4 + x * 4))
+          << "pixel " << x << ", row " << row;
+    }
+  }
+}
+
+}  // namespace test
+}  // namespace scene_manager
@@ -0,0 +1,90 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/util/axis_aligned_rect.h"
+
+#include <cmath>
+#include <limits>
+
+namespace scene_manager {
+
+namespace {
+
+// Allows for the rounding error of rotations by multiples of 90 degrees.
+constexpr float kEpsilon = 1e-6f;
+
+bool IsZero(float value) {
+  return std::abs(value) < kEpsilon;
+}
+
+}  // namespace
+
+AxisAlignedRect AxisAlignedRect::Infinite() {
+  const float infinity = std::numeric_limits<float>::infinity();
+  return {escher::vec2(-infinity, -infinity),
+          escher::vec2(infinity, infinity)};
+}
+
+bool AxisAlignedRect::is_infinite() const {
+  return std::isinf(min.x) || std::isinf(min.y) || std::isinf(max.x) ||
+         std::isinf(max.y);
+}
+
+bool AxisAlignedRect::Contains(const AxisAlignedRect& other) const {
+  return other.is_empty() ||
+         (min.x <= other.min.x && min.y <= other.min.y &&
+          other.max.x <= max.x && other.max.y <= max.y);
+}
+
+bool AxisAlignedRect::Intersects(const AxisAlignedRect& other) const {
+  return !Intersection(other).is_empty();
+}
+
+AxisAlignedRect AxisAlignedRect::Intersection(
+    const AxisAlignedRect& other) const {
+  return {glm::max(min, other.min), glm::min(max, other.max)};
+}
+
+AxisAlignedRect AxisAlignedRect::Union(const AxisAlignedRect& other) const {
+  if (is_empty())
+    return other;
+  if (other.is_empty())
+    return *this;
+  return {glm::min(min, other.min), glm::max(max, other.max)};
+}
+
+bool PreservesAxisAlignment(const escher::mat4& transform) {
+  // |transform| is column-major, so transform[column][row].  X and Y must
+  // each depend on only one of the input X and Y, and W on neither.
+  const bool no_perspective = IsZero(transform[0][3]) &&
+                              IsZero(transform[1][3]) &&
+                              std::abs(transform[3][3] - 1.f) < kEpsilon;
+  const bool unrotated = IsZero(transform[1][0]) && IsZero(transform[0][1]);
+  const bool quarter_turn = IsZero(transform[0][0]) && IsZero(transform[1][1]);
+  return no_perspective && (unrotated || quarter_turn);
+}
+
+AxisAlignedRect TransformBounds(const escher::mat4& transform,
+                                const AxisAlignedRect& rect) {
+  if (!IsZero(transform[0][3]) || !IsZero(transform[1][3]) ||
+      std::abs(transform[3][3] - 1.f) >= kEpsilon || rect.is_infinite()) {
+    return AxisAlignedRect::Infinite();
+  }
+
+  AxisAlignedRect bounds;
+  for (int i = 0; i < 4; ++i) {
+    const escher::vec4 corner(i & 1 ? rect.max.x : rect.min.x,
+                              i & 2 ? rect.max.y : rect.min.y, 0.f, 1.f);
+    const escher::vec2 point(transform * corner);
+    if (i == 0) {
+      bounds = {point, point};
+    } else {
+      bounds.min = glm::min(bounds.min, point);
+      bounds.max = glm::max(bounds.max, point);
+    }
+  }
+  return bounds;
+}
+
+}  // namespace scene_manager
@@ -0,0 +1,48 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "escher/geometry/types.h"
+
+namespace scene_manager {
+
+// A rectangle in the XY plane whose edges are parallel to the axes, such as
+// the bounding box of an object, or a rectangular clip, as seen by an
+// orthographic camera looking down the Z axis.
+struct AxisAlignedRect {
+  escher::vec2 min;
+  escher::vec2 max;
+
+  // Contains every point; used when bounds are unknown.
+  static AxisAlignedRect Infinite();
+
+  bool is_empty() const { return max.x <= min.x || max.y <= min.y; }
+  bool is_infinite() const;
+
+  bool Contains(const AxisAlignedRect& other) const;
+  bool Intersects(const AxisAlignedRect& other) const;
+
+  // The result is empty if the rectangles do not intersect.
+  AxisAlignedRect Intersection(const AxisAlignedRect& other) const;
+  AxisAlignedRect Union(const AxisAlignedRect& other) const;
+
+  bool operator==(const AxisAlignedRect& other) const {
+    return min == other.min && max == other.max;
+  }
+};
+
+// Returns true if |transform| maps every rectangle in the Z=0 plane whose
+// edges are parallel to the axes to another such rectangle, as seen looking
+// down the Z axis: that is, if it only translates, scales, and rotates by
+// multiples of 90 degrees within the XY plane, and has no perspective.
+bool PreservesAxisAlignment(const escher::mat4& transform);
+
+// Returns the bounding box, ignoring Z, of |rect| in the Z=0 plane after it is
+// transformed by |transform|.  If |transform| has perspective, the bounds are
+// unknown, and Infinite() is returned.
+AxisAlignedRect TransformBounds(const escher::mat4& transform,
+                                const AxisAlignedRect& rect);
+
+}  // namespace scene_manager
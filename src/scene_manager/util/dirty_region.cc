@@ -0,0 +1,104 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/util/dirty_region.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "lib/ftl/logging.h"
+
+namespace scene_manager {
+
+constexpr size_t DirtyRegion::kMaxRectCount;
+
+bool DirtyRegion::Rect::Contains(const Rect& other) const {
+  return other.x >= x && other.y >= y && other.right() <= right() &&
+         other.bottom() <= bottom();
+}
+
+DirtyRegion::DirtyRegion(uint32_t width, uint32_t height)
+    : width_(width), height_(height) {}
+
+DirtyRegion::Rect DirtyRegion::Union(const Rect& a, const Rect& b) {
+  uint32_t x = std::min(a.x, b.x);
+  uint32_t y = std::min(a.y, b.y);
+  return {x, y, std::max(a.right(), b.right()) - x,
+          std::max(a.bottom(), b.bottom()) - y};
+}
+
+void DirtyRegion::Add(const Rect& rect) {
+  // Clip to the bounds of the image.  Compute in 64 bits, since the far edge
+  // of |rect| may not fit in 32.
+  uint64_t right = std::min<uint64_t>(uint64_t{rect.x} + rect.width, width_);
+  uint64_t bottom = std::min<uint64_t>(uint64_t{rect.y} + rect.height, height_);
+  if (rect.x >= right || rect.y >= bottom)
+    return;
+  Rect clipped{rect.x, rect.y, static_cast<uint32_t>(right - rect.x),
+               static_cast<uint32_t>(bottom - rect.y)};
+
+  // Merge with existing rectangles for as long as doing so is free.  Each
+  // merge may make another one free, so start over after every merge.
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (auto it = rects_.begin(); it != rects_.end(); ++it) {
+      if (it->Contains(clipped))
+        return;
+      Rect bounds = Union(*it, clipped);
+      if (bounds.area() <= it->area() + clipped.area()) {
+        clipped = bounds;
+        rects_.erase(it);
+        merged = true;
+        break;
+      }
+    }
+  }
+  rects_.push_back(clipped);
+
+  if (rects_.size() > kMaxRectCount)
+    MergeCheapestPair();
+}
+
+void DirtyRegion::AddAll() {
+  rects_.clear();
+  if (width_ > 0 && height_ > 0)
+    rects_.push_back({0, 0, width_, height_});
+}
+
+uint64_t DirtyRegion::area() const {
+  uint64_t area = 0;
+  for (const Rect& rect : rects_)
+    area += rect.area();
+  return area;
+}
+
+void DirtyRegion::MergeCheapestPair() {
+  FTL_DCHECK(rects_.size() >= 2);
+  size_t best_i = 0;
+  size_t best_j = 1;
+  uint64_t best_cost = std::numeric_limits<uint64_t>::max();
+  for (size_t i = 0; i < rects_.size(); ++i) {
+    for (size_t j = i + 1; j < rects_.size(); ++j) {
+      uint64_t bounds_area = Union(rects_[i], rects_[j]).area();
+      uint64_t separate_area = rects_[i].area() + rects_[j].area();
+      uint64_t cost =
+          bounds_area > separate_area ? bounds_area - separate_area : 0;
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_i = i;
+        best_j = j;
+      }
+    }
+  }
+
+  // Re-add the merged rectangle, so that it absorbs any others which it now
+  // covers.
+  Rect bounds = Union(rects_[best_i], rects_[best_j]);
+  rects_.erase(rects_.begin() + best_j);
+  rects_.erase(rects_.begin() + best_i);
+  Add(bounds);
+}
+
+}  // namespace scene_manager
@@ -0,0 +1,72 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace scene_manager {
+
+// Tracks the parts of an image whose pixels have changed since they were last
+// uploaded, as a small set of rectangles.
+//
+// Rectangles are clipped to the bounds of the image.  Rectangles which are
+// covered by others are dropped, and a new rectangle is merged with an
+// existing one whenever their bounding box is no larger than the two of them
+// together (for example, when they are adjacent, or one almost covers the
+// other).  If there are more than |kMaxRectCount| rectangles, the pair whose
+// bounding box wastes the fewest pixels is merged, so that the number of
+// separate uploads stays bounded.  The rectangles may still overlap.
+class DirtyRegion {
+ public:
+  struct Rect {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+
+    uint32_t right() const { return x + width; }
+    uint32_t bottom() const { return y + height; }
+    uint64_t area() const { return uint64_t{width} * height; }
+    bool is_empty() const { return width == 0 || height == 0; }
+    bool Contains(const Rect& other) const;
+
+    bool operator==(const Rect& other) const {
+      return x == other.x && y == other.y && width == other.width &&
+             height == other.height;
+    }
+  };
+
+  static constexpr size_t kMaxRectCount = 8;
+
+  DirtyRegion(uint32_t width, uint32_t height);
+
+  // Adds |rect|, clipped to the bounds of the image.
+  void Add(const Rect& rect);
+
+  // Adds the whole image.
+  void AddAll();
+
+  void Clear() { rects_.clear(); }
+
+  bool is_empty() const { return rects_.empty(); }
+  const std::vector<Rect>& rects() const { return rects_; }
+
+  // Returns the total number of pixels in all rectangles, counting pixels
+  // which are covered by more than one rectangle more than once.
+  uint64_t area() const;
+
+ private:
+  static Rect Union(const Rect& a, const Rect& b);
+
+  void MergeCheapestPair();
+
+  const uint32_t width_;
+  const uint32_t height_;
+  std::vector<Rect> rects_;
+};
+
+}  // namespace scene_manager
@@ -0,0 +1,57 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/util/draw_batching.h"
+
+#include <algorithm>
+
+namespace scene_manager {
+
+std::vector<size_t> BatchDrawOrder(const std::vector<DrawItem>& items) {
+  std::vector<size_t> order;
+  order.reserve(items.size());
+  std::vector<bool> placed(items.size(), false);
+  std::vector<size_t> skipped;
+
+  for (size_t i = 0; i < items.size(); ++i) {
+    if (placed[i])
+      continue;
+    order.push_back(i);
+    placed[i] = true;
+    if (!items[i].geometry)
+      continue;
+
+    // Pull later objects of the same batch forward, past the objects which
+    // are skipped over, as long as they do not overlap any of those.
+    skipped.clear();
+    for (size_t j = i + 1;
+         j < items.size() && skipped.size() < kMaxSkippedDrawItems; ++j) {
+      if (placed[j])
+        continue;
+      const DrawItem& item = items[j];
+      if (item.CanBatchWith(items[i]) &&
+          std::none_of(skipped.begin(), skipped.end(), [&](size_t k) {
+            return items[k].bounds.Intersects(item.bounds);
+          })) {
+        order.push_back(j);
+        placed[j] = true;
+      } else {
+        skipped.push_back(j);
+      }
+    }
+  }
+  return order;
+}
+
+size_t CountBatches(const std::vector<DrawItem>& items,
+                    const std::vector<size_t>& order) {
+  size_t batch_count = 0;
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (i == 0 || !items[order[i]].CanBatchWith(items[order[i - 1]]))
+      ++batch_count;
+  }
+  return batch_count;
+}
+
+}  // namespace scene_manager
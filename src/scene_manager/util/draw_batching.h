@@ -0,0 +1,47 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include "apps/mozart/src/scene_manager/util/axis_aligned_rect.h"
+
+namespace scene_manager {
+
+// Describes an object in a display list, for BatchDrawOrder().
+struct DrawItem {
+  // Where the object may draw; objects whose bounds do not intersect can be
+  // drawn in either order.
+  AxisAlignedRect bounds = AxisAlignedRect::Infinite();
+
+  // Objects with the same non-null geometry and material can be drawn
+  // together.
+  const void* geometry = nullptr;
+  const void* material = nullptr;
+
+  bool CanBatchWith(const DrawItem& other) const {
+    return geometry && geometry == other.geometry &&
+           material == other.material;
+  }
+};
+
+// The most objects which a batch is moved past, to bound the cost of
+// BatchDrawOrder().
+constexpr size_t kMaxSkippedDrawItems = 128;
+
+// Returns an order in which to draw |items| which looks the same as drawing
+// them in the given order, but in which objects that can be drawn together
+// are adjacent where possible.  An object is moved earlier, to join the batch
+// of an earlier object, only past objects it does not overlap, and only past
+// |kMaxSkippedDrawItems| of them.
+std::vector<size_t> BatchDrawOrder(const std::vector<DrawItem>& items);
+
+// Returns the number of runs of adjacent objects in |order| which can be
+// drawn together.
+size_t CountBatches(const std::vector<DrawItem>& items,
+                    const std::vector<size_t>& order);
+
+}  // namespace scene_manager
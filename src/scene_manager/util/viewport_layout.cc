@@ -0,0 +1,32 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/util/viewport_layout.h"
+
+namespace scene_manager {
+
+std::vector<bool> FindLayersDrawnInViewports(
+    const std::vector<LayerViewport>& layers,
+    escher::vec2 output_size) {
+  const AxisAlignedRect output_rect = {escher::vec2(0.f), output_size};
+  std::vector<bool> drawn_in_viewport(layers.size(), false);
+  for (size_t i = 0; i < layers.size(); ++i) {
+    const AxisAlignedRect& rect = layers[i].rect;
+    if (!(rect == output_rect) &&
+        !(layers[i].orthographic && output_rect.Contains(rect)))
+      continue;
+
+    // Layers drawn in viewports share a depth buffer, and textured layers
+    // are drawn after all of them, so a layer must not overlap either kind
+    // of layer beneath it.
+    bool overlaps = false;
+    for (size_t j = 0; j < i && !overlaps; ++j) {
+      overlaps = rect.Intersects(layers[j].rect);
+    }
+    drawn_in_viewport[i] = !overlaps;
+  }
+  return drawn_in_viewport;
+}
+
+}  // namespace scene_manager
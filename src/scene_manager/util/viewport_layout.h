@@ -0,0 +1,32 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <vector>
+
+#include "apps/mozart/src/scene_manager/util/axis_aligned_rect.h"
+
+namespace scene_manager {
+
+// Describes where a layer appears in the output image of a compositor.
+struct LayerViewport {
+  // The rectangle of the output image covered by the layer, in pixels.
+  AxisAlignedRect rect;
+  // True if the layer's camera is orthographic, so that its content can be
+  // translated into any part of the output image.
+  bool orthographic = false;
+};
+
+// Returns, for each of |layers| ordered from bottom to top, whether it can be
+// drawn directly into its viewport of an output image of |output_size|, in
+// the same pass as the other such layers, instead of into a texture which is
+// composited on top of that pass.  That requires the layer to lie within the
+// output image, to be orthographic unless it covers all of it, and not to
+// overlap any layer beneath it.
+std::vector<bool> FindLayersDrawnInViewports(
+    const std::vector<LayerViewport>& layers,
+    escher::vec2 output_size);
+
+}  // namespace scene_manager
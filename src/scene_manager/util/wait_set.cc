@@ -0,0 +1,185 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/util/wait_set.h"
+
+#include <mutex>
+#include <thread>
+
+#include <magenta/syscalls.h>
+#include <magenta/syscalls/port.h>
+#include <mx/port.h>
+
+#include "lib/ftl/logging.h"
+#include "lib/ftl/tasks/task_runner.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace scene_manager {
+
+// Owns the port and thread shared by all WaitSets.  Every wait on the port is
+// given a packet key which is unique for the lifetime of the process, and
+// which maps back to the WaitSet that started it.
+class WaitSet::Waiter {
+ public:
+  static Waiter* Get() {
+    // Never destroyed, since the thread may be blocked on the port at exit.
+    static Waiter* waiter = new Waiter();
+    return waiter;
+  }
+
+  uint64_t Register(ftl::RefPtr<ftl::TaskRunner> task_runner,
+                    ftl::WeakPtr<WaitSet> wait_set) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t id = next_id_++;
+    wait_sets_[id] = {std::move(task_runner), std::move(wait_set)};
+    return id;
+  }
+
+  void Unregister(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wait_sets_.erase(id);
+  }
+
+  // Returns the packet key of the new wait, or 0 if it could not be started.
+  uint64_t Add(uint64_t id,
+               uint64_t key,
+               mx_handle_t handle,
+               mx_signals_t signals) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t packet_key = next_packet_key_++;
+    mx_status_t status = mx_object_wait_async(handle, port_.get(), packet_key,
+                                              signals, MX_WAIT_ASYNC_ONCE);
+    if (status != MX_OK) {
+      FTL_LOG(ERROR) << "WaitSet: failed to wait on handle: " << status;
+      return 0u;
+    }
+    waits_[packet_key] = {id, key};
+    return packet_key;
+  }
+
+  // The wait itself stays armed until the handle is signalled or closed; its
+  // completion is then discarded.
+  void Remove(uint64_t packet_key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    waits_.erase(packet_key);
+  }
+
+ private:
+  struct WaitSetEntry {
+    ftl::RefPtr<ftl::TaskRunner> task_runner;
+    ftl::WeakPtr<WaitSet> wait_set;
+  };
+  struct WaitEntry {
+    uint64_t id;
+    uint64_t key;
+  };
+
+  Waiter() {
+    mx_status_t status = mx::port::create(MX_PORT_OPT_V2, &port_);
+    FTL_CHECK(status == MX_OK) << "WaitSet: failed to create port: " << status;
+    std::thread(&Waiter::ThreadMain, this).detach();
+  }
+
+  void ThreadMain() {
+    while (true) {
+      // Block until something happens, then collect everything else which is
+      // already queued without blocking again.
+      std::vector<mx_port_packet_t> packets;
+      mx_time_t deadline = MX_TIME_INFINITE;
+      mx_port_packet_t packet;
+      mx_status_t status;
+      while ((status = mx_port_wait(port_.get(), deadline, &packet, 0u)) ==
+             MX_OK) {
+        if (packet.type == MX_PKT_TYPE_SIGNAL_ONE)
+          packets.push_back(packet);
+        deadline = 0u;
+      }
+      // Only the non-blocking waits may time out.  The port is never closed,
+      // so any other error means that it is unusable; since this thread is
+      // shared by every WaitSet, carrying on would silently stall them all.
+      FTL_CHECK(status == MX_ERR_TIMED_OUT && deadline == 0u)
+          << "WaitSet: failed to wait on port: " << status;
+      if (!packets.empty())
+        Dispatch(packets);
+    }
+  }
+
+  // Posts one task per WaitSet with all of its completed waits.
+  void Dispatch(const std::vector<mx_port_packet_t>& packets) {
+    std::unordered_map<uint64_t, std::vector<Signal>> signals_by_id;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const mx_port_packet_t& packet : packets) {
+      auto it = waits_.find(packet.key);
+      if (it == waits_.end())
+        continue;
+      signals_by_id[it->second.id].push_back(
+          {it->second.key, packet.signal.observed});
+      waits_.erase(it);
+    }
+    for (auto& pair : signals_by_id) {
+      auto it = wait_sets_.find(pair.first);
+      if (it == wait_sets_.end())
+        continue;
+      ftl::WeakPtr<WaitSet> weak = it->second.wait_set;
+      it->second.task_runner->PostTask(
+          [weak, signals = std::move(pair.second)] {
+            if (weak)
+              weak->OnSignals(signals);
+          });
+    }
+  }
+
+  mx::port port_;
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, WaitSetEntry> wait_sets_;
+  std::unordered_map<uint64_t, WaitEntry> waits_;
+  uint64_t next_id_ = 1u;
+  uint64_t next_packet_key_ = 1u;
+};
+
+WaitSet::WaitSet(SignalsCallback callback)
+    : callback_(std::move(callback)),
+      waiter_(Waiter::Get()),
+      weak_factory_(this) {
+  FTL_DCHECK(callback_);
+  id_ = waiter_->Register(mtl::MessageLoop::GetCurrent()->task_runner(),
+                          weak_factory_.GetWeakPtr());
+}
+
+WaitSet::~WaitSet() {
+  for (const auto& pair : pending_keys_)
+    waiter_->Remove(pair.second);
+  waiter_->Unregister(id_);
+}
+
+bool WaitSet::Add(uint64_t key, mx_handle_t handle, mx_signals_t signals) {
+  FTL_DCHECK(pending_keys_.find(key) == pending_keys_.end());
+
+  uint64_t packet_key = waiter_->Add(id_, key, handle, signals);
+  if (!packet_key)
+    return false;
+  pending_keys_[key] = packet_key;
+  return true;
+}
+
+void WaitSet::Remove(uint64_t key) {
+  auto it = pending_keys_.find(key);
+  if (it == pending_keys_.end())
+    return;
+  waiter_->Remove(it->second);
+  pending_keys_.erase(it);
+}
+
+void WaitSet::OnSignals(const std::vector<Signal>& signals) {
+  std::vector<Signal> pending_signals;
+  pending_signals.reserve(signals.size());
+  for (const Signal& signal : signals) {
+    if (pending_keys_.erase(signal.key))
+      pending_signals.push_back(signal);
+  }
+  if (!pending_signals.empty())
+    callback_(pending_signals);
+}
+
+}  // namespace scene_manager
@@ -0,0 +1,71 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <magenta/types.h>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+
+namespace scene_manager {
+
+// Waits for signals on any number of handles, rather than registering a
+// separate message loop handler per handle.
+//
+// All WaitSets share a single kernel port, which is drained by a single
+// background thread for the lifetime of the process.  Whenever waits
+// complete, the thread posts all of the completions for a WaitSet which are
+// available at that moment to the message loop of the thread which created
+// the WaitSet, as a single batch.  This keeps the cost of watching thousands
+// of handles (such as the export tokens held by the ResourceLinker) to one
+// kernel wait per handle, and one task per burst of signals, no matter how
+// many WaitSets there are.
+class WaitSet {
+ public:
+  struct Signal {
+    uint64_t key;
+    mx_signals_t observed;
+  };
+  using SignalsCallback = std::function<void(const std::vector<Signal>&)>;
+
+  // |callback| is invoked on the current thread's message loop.
+  explicit WaitSet(SignalsCallback callback);
+  ~WaitSet();
+
+  // Waits once for any of |signals| to be asserted on |handle|, which is then
+  // reported with |key|.  Keys must never be reused, even after the wait has
+  // completed or been removed; koids are a good choice.  Returns false if the
+  // wait could not be started.
+  bool Add(uint64_t key, mx_handle_t handle, mx_signals_t signals);
+
+  // Stops reporting the wait identified by |key|, if it has not already been
+  // reported.
+  void Remove(uint64_t key);
+
+  size_t size() const { return pending_keys_.size(); }
+
+ private:
+  class Waiter;
+
+  void OnSignals(const std::vector<Signal>& signals);
+
+  SignalsCallback callback_;
+  Waiter* const waiter_;
+  uint64_t id_;
+
+  // Maps keys of pending waits to the keys of their packets on the shared
+  // port.
+  std::unordered_map<uint64_t, uint64_t> pending_keys_;
+
+  ftl::WeakPtrFactory<WaitSet> weak_factory_;  // must be last
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(WaitSet);
+};
+
+}  // namespace scene_manager
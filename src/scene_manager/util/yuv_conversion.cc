@@ -0,0 +1,186 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "apps/mozart/src/scene_manager/util/yuv_conversion.h"
+
+#include <stddef.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "lib/ftl/logging.h"
+
+namespace scene_manager {
+
+namespace {
+
+// BT.601 limited-range coefficients, scaled by 2^kShift so that every
+// intermediate value of the SSE2 path fits in 16 bits.
+constexpr int kShift = 6;
+constexpr int kRound = 1 << (kShift - 1);
+constexpr int kYScale = 75;  // 1.164
+constexpr int kVToR = 102;   // 1.596
+constexpr int kUToG = 25;    // 0.391
+constexpr int kVToG = 52;    // 0.813
+constexpr int kUToB = 129;   // 2.018
+
+inline uint8_t Clamp(int value) {
+  return value < 0 ? 0 : (value > 255 ? 255 : static_cast<uint8_t>(value));
+}
+
+// Converts the two horizontally adjacent pixels which share the chroma
+// samples |u| and |v|.
+inline void ConvertPixelPair(const uint8_t* y, int u, int v, uint8_t* bgra) {
+  u -= 128;
+  v -= 128;
+  const int b_chroma = kUToB * u;
+  const int g_chroma = kUToG * u + kVToG * v;
+  const int r_chroma = kVToR * v;
+  for (int i = 0; i < 2; ++i) {
+    const int luma = (y[i] - 16) * kYScale + kRound;
+    bgra[0] = Clamp((luma + b_chroma) >> kShift);
+    bgra[1] = Clamp((luma - g_chroma) >> kShift);
+    bgra[2] = Clamp((luma + r_chroma) >> kShift);
+    bgra[3] = 255;
+    bgra += 4;
+  }
+}
+
+#if defined(__SSE2__)
+
+// Converts 16 pixels, given their Y samples and, as 16-bit values, the U and V
+// samples of each of the 8 pairs of them.  The arithmetic matches that of
+// ConvertPixelPair(); sums which saturate would have been clamped anyway.
+inline void ConvertSixteenPixels(__m128i y, __m128i u, __m128i v,
+                                 uint8_t* bgra) {
+  const __m128i zero = _mm_setzero_si128();
+  u = _mm_sub_epi16(u, _mm_set1_epi16(128));
+  v = _mm_sub_epi16(v, _mm_set1_epi16(128));
+  const __m128i b_chroma = _mm_mullo_epi16(u, _mm_set1_epi16(kUToB));
+  const __m128i g_chroma =
+      _mm_add_epi16(_mm_mullo_epi16(u, _mm_set1_epi16(kUToG)),
+                    _mm_mullo_epi16(v, _mm_set1_epi16(kVToG)));
+  const __m128i r_chroma = _mm_mullo_epi16(v, _mm_set1_epi16(kVToR));
+
+  __m128i b[2], g[2], r[2];
+  for (int half = 0; half < 2; ++half) {
+    __m128i luma = half == 0 ? _mm_unpacklo_epi8(y, zero)
+                             : _mm_unpackhi_epi8(y, zero);
+    luma = _mm_mullo_epi16(_mm_sub_epi16(luma, _mm_set1_epi16(16)),
+                           _mm_set1_epi16(kYScale));
+    luma = _mm_add_epi16(luma, _mm_set1_epi16(kRound));
+
+    // Each chroma sample applies to two adjacent pixels.
+    const __m128i b_pair = half == 0 ? _mm_unpacklo_epi16(b_chroma, b_chroma)
+                                     : _mm_unpackhi_epi16(b_chroma, b_chroma);
+    const __m128i g_pair = half == 0 ? _mm_unpacklo_epi16(g_chroma, g_chroma)
+                                     : _mm_unpackhi_epi16(g_chroma, g_chroma);
+    const __m128i r_pair = half == 0 ? _mm_unpacklo_epi16(r_chroma, r_chroma)
+                                     : _mm_unpackhi_epi16(r_chroma, r_chroma);
+    b[half] = _mm_srai_epi16(_mm_adds_epi16(luma, b_pair), kShift);
+    g[half] = _mm_srai_epi16(_mm_subs_epi16(luma, g_pair), kShift);
+    r[half] = _mm_srai_epi16(_mm_adds_epi16(luma, r_pair), kShift);
+  }
+
+  // Clamp to bytes, and interleave into B, G, R, A order.
+  const __m128i b8 = _mm_packus_epi16(b[0], b[1]);
+  const __m128i g8 = _mm_packus_epi16(g[0], g[1]);
+  const __m128i r8 = _mm_packus_epi16(r[0], r[1]);
+  const __m128i a8 = _mm_set1_epi8(static_cast<char>(0xff));
+  const __m128i bg_lo = _mm_unpacklo_epi8(b8, g8);
+  const __m128i bg_hi = _mm_unpackhi_epi8(b8, g8);
+  const __m128i ra_lo = _mm_unpacklo_epi8(r8, a8);
+  const __m128i ra_hi = _mm_unpackhi_epi8(r8, a8);
+  auto out = reinterpret_cast<__m128i*>(bgra);
+  _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(bg_lo, ra_lo));
+  _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(bg_lo, ra_lo));
+  _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(bg_hi, ra_hi));
+  _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(bg_hi, ra_hi));
+}
+
+inline __m128i Load16(const uint8_t* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+#endif  // defined(__SSE2__)
+
+void ConvertNv12Row(const uint8_t* y,
+                    const uint8_t* uv,
+                    uint32_t width,
+                    uint8_t* bgra) {
+  uint32_t x = 0;
+#if defined(__SSE2__)
+  for (; x + 16 <= width; x += 16) {
+    // Each 16-bit lane holds a U sample in its low byte and a V sample in its
+    // high byte.
+    const __m128i uv_samples = Load16(uv + x);
+    ConvertSixteenPixels(Load16(y + x),
+                         _mm_and_si128(uv_samples, _mm_set1_epi16(0xff)),
+                         _mm_srli_epi16(uv_samples, 8), bgra + 4 * x);
+  }
+#endif
+  for (; x < width; x += 2) {
+    ConvertPixelPair(y + x, uv[x], uv[x + 1], bgra + 4 * x);
+  }
+}
+
+void ConvertI420Row(const uint8_t* y,
+                    const uint8_t* u,
+                    const uint8_t* v,
+                    uint32_t width,
+                    uint8_t* bgra) {
+  uint32_t x = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for (; x + 16 <= width; x += 16) {
+    const __m128i u_samples = _mm_unpacklo_epi8(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + x / 2)), zero);
+    const __m128i v_samples = _mm_unpacklo_epi8(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + x / 2)), zero);
+    ConvertSixteenPixels(Load16(y + x), u_samples, v_samples, bgra + 4 * x);
+  }
+#endif
+  for (; x < width; x += 2) {
+    ConvertPixelPair(y + x, u[x / 2], v[x / 2], bgra + 4 * x);
+  }
+}
+
+}  // namespace
+
+void ConvertNv12ToBgra(const uint8_t* y_plane,
+                       uint32_t y_stride,
+                       const uint8_t* uv_plane,
+                       uint32_t uv_stride,
+                       uint32_t width,
+                       uint32_t height,
+                       uint8_t* bgra,
+                       uint32_t bgra_stride) {
+  FTL_DCHECK(width % 2 == 0 && height % 2 == 0);
+  for (uint32_t row = 0; row < height; ++row) {
+    ConvertNv12Row(y_plane + size_t{row} * y_stride,
+                   uv_plane + size_t{row / 2} * uv_stride, width,
+                   bgra + size_t{row} * bgra_stride);
+  }
+}
+
+void ConvertI420ToBgra(const uint8_t* y_plane,
+                       uint32_t y_stride,
+                       const uint8_t* u_plane,
+                       const uint8_t* v_plane,
+                       uint32_t uv_stride,
+                       uint32_t width,
+                       uint32_t height,
+                       uint8_t* bgra,
+                       uint32_t bgra_stride) {
+  FTL_DCHECK(width % 2 == 0 && height % 2 == 0);
+  for (uint32_t row = 0; row < height; ++row) {
+    ConvertI420Row(y_plane + size_t{row} * y_stride,
+                   u_plane + size_t{row / 2} * uv_stride,
+                   v_plane + size_t{row / 2} * uv_stride, width,
+                   bgra + size_t{row} * bgra_stride);
+  }
+}
+
+}  // namespace scene_manager
@@ -0,0 +1,42 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace scene_manager {
+
+// Converts YUV 4:2:0 pixels to opaque BGRA_8, using the BT.601 coefficients
+// for limited-range ("video") YUV.  Each 2x2 block of pixels shares one pair
+// of chroma samples, so |width| and |height| must be even.  Rows of |bgra| are
+// |bgra_stride| bytes apart.
+//
+// Where SSE2 is available, 16 pixels are converted at a time; otherwise, and
+// for the remainder of each row, pixels are converted one pair at a time.  The
+// results are the same either way.
+
+// NV12: a plane of Y samples followed by a plane of interleaved U and V
+// samples.
+void ConvertNv12ToBgra(const uint8_t* y_plane,
+                       uint32_t y_stride,
+                       const uint8_t* uv_plane,
+                       uint32_t uv_stride,
+                       uint32_t width,
+                       uint32_t height,
+                       uint8_t* bgra,
+                       uint32_t bgra_stride);
+
+// I420: separate planes of Y, U and V samples.
+void ConvertI420ToBgra(const uint8_t* y_plane,
+                       uint32_t y_stride,
+                       const uint8_t* u_plane,
+                       const uint8_t* v_plane,
+                       uint32_t uv_stride,
+                       uint32_t width,
+                       uint32_t height,
+                       uint8_t* bgra,
+                       uint32_t bgra_stride);
+
+}  // namespace scene_manager
@@ -4,14 +4,29 @@
 
 #include "apps/mozart/src/scene_manager/vulkan_swapchain.h"
 
+#include <magenta/syscalls.h>
+
+#include "apps/mozart/src/scene_manager/displays/display.h"
 #include "apps/tracing/lib/trace/event.h"
 #include "escher/escher.h"
 
 namespace scene_manager {
 
+namespace {
+
+// The swapchain has no vsync timestamps, so the time at which
+// acquireNextImageKHR() returns after waiting for a present to complete is
+// taken as the vsync.  Shorter waits mean that an image was already free, and
+// say nothing about when the vsync happened.
+constexpr uint64_t kMinAcquireWaitForVsyncNanos = 1'000'000;
+
+}  // namespace
+
 DisplaySwapchain::DisplaySwapchain(escher::Escher* escher,
-                                   escher::VulkanSwapchain swapchain)
+                                   escher::VulkanSwapchain swapchain,
+                                   Display* display)
     : swapchain_(std::move(swapchain)),
+      display_(display),
       device_(escher->device()->vk_device()),
       queue_(escher->device()->vk_main_queue()) {
   image_available_semaphores_.reserve(swapchain_.images.size());
@@ -37,6 +52,7 @@ bool DisplaySwapchain::DrawAndPresentFrame(DrawCallback draw_callback) {
   {
     TRACE_DURATION("gfx", "DisplaySwapchain::DrawAndPresent() acquire");
 
+    const uint64_t acquire_start_time = mx_time_get(MX_CLOCK_MONOTONIC);
     auto result = device_.acquireNextImageKHR(
         swapchain_.swapchain, UINT64_MAX, image_available_semaphore->value(),
         nullptr);
@@ -49,6 +65,12 @@ bool DisplaySwapchain::DrawAndPresentFrame(DrawCallback draw_callback) {
       return false;
     }
 
+    const uint64_t acquire_end_time = mx_time_get(MX_CLOCK_MONOTONIC);
+    if (display_ &&
+        acquire_end_time - acquire_start_time >= kMinAcquireWaitForVsyncNanos) {
+      display_->OnVsync(acquire_end_time);
+    }
+
     swapchain_index = result.value;
     next_semaphore_index_ =
         (next_semaphore_index_ + 1) % swapchain_.images.size();
@@ -8,6 +8,8 @@
 
 namespace scene_manager {
 
+class Display;
+
 // Swapchain is an interface used used to render into an escher::Image and
 // present the result (to a physical display or elsewhere).
 class Swapchain {
@@ -28,13 +30,17 @@ class Swapchain {
 // swapchain to present images to a physical display.
 class DisplaySwapchain : public Swapchain {
  public:
-  DisplaySwapchain(escher::Escher* escher, escher::VulkanSwapchain swapchain);
+  // Reports the vsyncs it observes to |display|.
+  DisplaySwapchain(escher::Escher* escher,
+                   escher::VulkanSwapchain swapchain,
+                   Display* display);
   ~DisplaySwapchain();
 
   bool DrawAndPresentFrame(DrawCallback draw_callback) override;
 
  private:
   escher::VulkanSwapchain swapchain_;
+  Display* const display_;
   vk::Device device_;
   vk::Queue queue_;
 